@@ -1,5 +1,5 @@
 #pragma once
-#include "Layer.h"
+#include "Add.h"
 
 namespace dnn
 {
@@ -254,12 +254,204 @@ namespace dnn
 		bool reorderFwdSrc;
 		bool reorderBwdSrc;
 		bool reorderBwdDiffSrc;
+
+		// with a Fused Add input: y = f(a * scale0 + b * scale1) in one pass over the Add inputs, a skipped input (stochastic depth) has scale 0
+		auto AddScales() const
+		{
+			const auto add = static_cast<const Add*>(InputLayer);
+			const auto fullDepth = add->SurvivalProbability[0] == Float(1) && add->SurvivalProbability[1] == Float(1);
+
+			return std::make_pair(fullDepth || !add->Inputs[0]->Skip ? Float(1) : Float(0), fullDepth || !add->Inputs[1]->Skip ? Float(1) : Float(0));
+		}
+
+		void ForwardPropAdd(const UInt batchSize, const bool training)
+		{
+			const auto plain = IsPlainFormat();
+			const auto size = plain ? CDHW() : PaddedCDHW();
+			const auto part = GetVectorPart(size);
+			const auto threads = batchSize == 1ull ? 1ull : GetThreads(batchSize * size, Float(10));
+			const auto scales = AddScales();
+			const auto scale0 = scales.first;
+			const auto scale1 = scales.second;
+			const auto input0 = InputLayer->InputsFwd[0];
+			const auto input1 = InputLayer->InputsFwd[1];
+
+			for_i(batchSize, threads, [=](UInt n)
+			{
+				const auto start = n * size;
+				for (auto cdhw = start; cdhw < start + part; cdhw += VectorSize)
+				{
+					Func.fVec(VecFloat().load_a(&input0->Neurons[cdhw]) * scale0 + VecFloat().load_a(&input1->Neurons[cdhw]) * scale1, Alpha, Beta).store_a(&Neurons[cdhw]);
+#ifndef DNN_LEAN
+					if (training && !GradientOverwritten)
+						VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+#endif // DNN_LEAN
+				}
+				for (auto cdhw = start + part; cdhw < start + size; cdhw++)
+				{
+					Neurons[cdhw] = Func.f(input0->Neurons[cdhw] * scale0 + input1->Neurons[cdhw] * scale1, Alpha, Beta);
+#ifndef DNN_LEAN
+					if (training && !GradientOverwritten)
+						NeuronsD1[cdhw] = Float(0);
+#endif // DNN_LEAN
+				}
+			});
+		}
+
+		// the sum is formed again from the Add inputs, so the gradient of the activation is split straight into theirs
+		void BackwardPropAdd(const UInt batchSize)
+		{
+			const auto plain = IsPlainFormat();
+			const auto size = plain ? CDHW() : PaddedCDHW();
+			const auto part = GetVectorPart(size);
+			const auto threads = batchSize == 1ull ? 1ull : GetThreads(batchSize * size, Float(10));
+			const auto scales = AddScales();
+			const auto scale0 = scales.first;
+			const auto scale1 = scales.second;
+			const auto input0 = InputLayer->InputsFwd[0];
+			const auto input1 = InputLayer->InputsFwd[1];
+			const auto inputD0 = InputLayer->Inputs[0];		// an InplaceBwd input shares the gradient of its own input
+			const auto inputD1 = InputLayer->Inputs[1];
+
+#ifdef DNN_LEAN
+			for (auto input : { inputD0, inputD1 })
+				input->NeuronsD1.resize(batchSize, input->C, input->H, input->W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
+#endif // DNN_LEAN
+
+			for_i(batchSize, threads, [=](UInt n)
+			{
+				const auto start = n * size;
+				VecFloat D1;
+				for (auto cdhw = start; cdhw < start + part; cdhw += VectorSize)
+				{
+					D1 = Func.dfVec(VecFloat().load_a(&input0->Neurons[cdhw]) * scale0 + VecFloat().load_a(&input1->Neurons[cdhw]) * scale1, Alpha, Beta) * VecFloat().load_a(&NeuronsD1[cdhw]);
+					mul_add(D1, scale0, VecFloat().load_a(&inputD0->NeuronsD1[cdhw])).store_a(&inputD0->NeuronsD1[cdhw]);
+					mul_add(D1, scale1, VecFloat().load_a(&inputD1->NeuronsD1[cdhw])).store_a(&inputD1->NeuronsD1[cdhw]);
+				}
+				for (auto cdhw = start + part; cdhw < start + size; cdhw++)
+				{
+					const auto d1 = Func.df(input0->Neurons[cdhw] * scale0 + input1->Neurons[cdhw] * scale1, Alpha, Beta) * NeuronsD1[cdhw];
+					inputD0->NeuronsD1[cdhw] += d1 * scale0;
+					inputD1->NeuronsD1[cdhw] += d1 * scale1;
+				}
+			});
+
+#ifdef DNN_LEAN
+			ReleaseGradient();
+#endif // DNN_LEAN
+		}
+
+		// with MaskBackward: one bit per input value set when it lies in the range where the derivative is MaskSlopes().first, a sample starts on a word
+		std::vector<std::uint64_t> mask;
+		UInt maskWords;
+
+		inline bool Active(const Float x) const NOEXCEPT
+		{
+			switch (ActivationFunction)
+			{
+			case Activations::BoundedRelu:
+				return x > Float(0) && x <= Alpha;
+			case Activations::HardSigmoid:
+				return x > -Beta / Alpha && x < (Float(1) - Beta) / Alpha;
+			default:
+				return x > Float(0);
+			}
+		}
+
+		inline VecFloatBool ActiveVec(const VecFloat& x) const NOEXCEPT
+		{
+			switch (ActivationFunction)
+			{
+			case Activations::BoundedRelu:
+				return (x > Float(0)) & (x <= Alpha);
+			case Activations::HardSigmoid:
+				return (x > -Beta / Alpha) & (x < (Float(1) - Beta) / Alpha);
+			default:
+				return x > Float(0);
+			}
+		}
+
+		// the derivative inside and outside the active range
+		inline std::pair<Float, Float> MaskSlopes() const NOEXCEPT
+		{
+			switch (ActivationFunction)
+			{
+			case Activations::BoundedRelu:
+				return std::make_pair(Float(1), Float(0));
+			case Activations::HardSigmoid:
+				return std::make_pair(Alpha, Float(0));
+			default:
+				return std::make_pair(Float(1), Alpha);
+			}
+		}
+
+		void ForwardPropMask(const UInt batchSize)
+		{
+			const auto size = IsPlainFormat() ? CDHW() : PaddedCDHW();
+			const auto part = GetVectorPart(size);
+			const auto threads = batchSize == 1ull ? 1ull : GetThreads(batchSize * size, Float(2));
+
+			maskWords = (size + 63ull) / 64ull;
+			mask.resize(batchSize * maskWords);
+
+			for_i(batchSize, threads, [=](UInt n)
+			{
+				const auto input = InputLayer->Neurons.data() + n * size;
+				auto words = mask.data() + n * maskWords;
+
+				std::fill_n(words, maskWords, 0ull);
+				for (auto i = 0ull; i < part; i += VectorSize)
+					words[i / 64ull] |= static_cast<std::uint64_t>(to_bits(ActiveVec(VecFloat().load(input + i)))) << (i % 64ull);
+				for (auto i = part; i < size; i++)
+					if (Active(input[i]))
+						words[i / 64ull] |= 1ull << (i % 64ull);
+			});
+		}
+
+		// the gradient from the mask alone, written like the primitive: scaled in place (InplaceBwd), added (SharesInput) or stored
+		void BackwardPropMask(const UInt batchSize)
+		{
+			const auto size = IsPlainFormat() ? CDHW() : PaddedCDHW();
+			const auto part = GetVectorPart(size);
+			const auto threads = batchSize == 1ull ? 1ull : GetThreads(batchSize * size, Float(2));
+			const auto slopes = MaskSlopes();
+			const auto active = slopes.first;
+			const auto inactive = slopes.second;
+			const auto accumulate = SharesInput && !InplaceBwd;
+
+			for_i(batchSize, threads, [=](UInt n)
+			{
+				const auto words = mask.data() + n * maskWords;
+				const auto start = n * size;
+				const auto& srcD1 = InplaceBwd ? InputLayer->NeuronsD1 : NeuronsD1;
+
+				for (auto i = 0ull; i < part; i += VectorSize)
+				{
+					const auto bits = static_cast<decltype(to_bits(VecFloatBool()))>(words[i / 64ull] >> (i % 64ull));
+					const auto D1 = select(VecFloatBool().load_bits(bits), VecFloat(active), VecFloat(inactive)) * VecFloat().load(&srcD1[start + i]);
+					if (accumulate)
+						(D1 + VecFloat().load(&InputLayer->NeuronsD1[start + i])).store(&InputLayer->NeuronsD1[start + i]);
+					else
+						D1.store(&InputLayer->NeuronsD1[start + i]);
+				}
+				for (auto i = part; i < size; i++)
+				{
+					const auto d1 = ((words[i / 64ull] >> (i % 64ull)) & 1ull ? active : inactive) * srcD1[start + i];
+					if (accumulate)
+						InputLayer->NeuronsD1[start + i] += d1;
+					else
+						InputLayer->NeuronsD1[start + i] = d1;
+				}
+			});
+		}
 	
 	public:
 		const Activations ActivationFunction;
 		const Float Alpha;
 		const Float Beta;
 		const Act Func;
+		// training keeps a bitmask of the input range instead of reading the input in backprop (Model lets the released inputs share their Neurons, see Maskable)
+		bool MaskBackward;
 
 		static auto GetAlpha(const Activations activation, const Float alpha, const Float beta)
 		{
@@ -848,7 +1040,9 @@ namespace dnn
 			algorithm(dnnl::algorithm::eltwise_linear),
 			reorderFwdSrc(false),
 			reorderBwdSrc(false),
-			reorderBwdDiffSrc(false)
+			reorderBwdDiffSrc(false),
+			maskWords(0),
+			MaskBackward(false)
 		{
 			assert(Inputs.size() == 1);
 		}
@@ -866,10 +1060,26 @@ namespace dnn
 			description.append(nwl + std::string(" Activation:") + tab + std::string(magic_enum::enum_name<Activations>(ActivationFunction)));
 			description.append(nwl + std::string(" Alpha:") + dtab + FloatToString(Alpha));
 			description.append(nwl + std::string(" Beta:") + dtab + FloatToString(Beta));
+			if (MaskBackward)
+				description.append(nwl + std::string(" Mask:") + dtab + std::string("1 bit/value"));
 
 			return description;
 		}
 
+		// the activations whose derivative is constant inside and outside one input range, so backprop only needs a bit per value
+		static bool Maskable(const Activations activation)
+		{
+			switch (activation)
+			{
+			case Activations::BoundedRelu:
+			case Activations::HardSigmoid:
+			case Activations::Relu:
+				return true;
+			default:
+				return false;
+			}
+		}
+
 		UInt FanIn() const final override
 		{
 			return 1;
@@ -880,6 +1090,27 @@ namespace dnn
 			return 1;
 		}
 
+		// the activations computed with Func instead of the primitive or with a Func checked against it (CheckActivations) can absorb an Add
+		bool FusesAdd() const
+		{
+			switch (ActivationFunction)
+			{
+			case Activations::ASinh:
+			case Activations::Selu:
+			case Activations::SoftPlus:
+			case Activations::SoftSign:
+			case Activations::TanhExp:
+				return true;
+			default:
+				return Func.test;
+			}
+		}
+
+		bool OverwritesGradients() const final override
+		{
+			return !InplaceBwd;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			auto alpha = Alpha;
@@ -1003,6 +1234,21 @@ namespace dnn
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
+			if (Fused)	// computed by the root of its elementwise chain
+				return;
+
+			if (Chain)
+			{
+				Chain->ForwardProp(batchSize, training);
+				return;
+			}
+
+			if (InputLayer->Fused)
+			{
+				ForwardPropAdd(batchSize, training);
+				return;
+			}
+
 			const auto plain = IsPlainFormat();
 			const auto threads = batchSize == 1 ? 1ull : GetThreads(batchSize * (plain ? CDHW() : PaddedCDHW()), Float(10));
 
@@ -1029,7 +1275,7 @@ namespace dnn
 								{
 									Func.fVec(VecFloat().load_a(&InputLayer->Neurons[c]), Alpha, Beta).store_a(&Neurons[c]);
 #ifndef DNN_LEAN
-									if (!InplaceBwd)
+									if (!InplaceBwd && !GradientOverwritten)
 										VecFloat(0).store_nt(&NeuronsD1[c]);
 #endif // DNN_LEAN
 								}
@@ -1039,7 +1285,7 @@ namespace dnn
 								{
 									Neurons[c] = Func.f(InputLayer->Neurons[c], Alpha, Beta);
 #ifndef DNN_LEAN
-									if (!InplaceBwd)
+									if (!InplaceBwd && !GradientOverwritten)
 										NeuronsD1[c] = Float(0);
 #endif // DNN_LEAN
 								}
@@ -1067,7 +1313,7 @@ namespace dnn
 									{
 										Func.fVec(VecFloat().load_a(&InputLayer->Neurons[c]), Alpha, Beta).store_a(&Neurons[c]);
 #ifndef DNN_LEAN
-										if (!InplaceBwd)
+										if (!InplaceBwd && !GradientOverwritten)
 											VecFloat(0).store_nt(&NeuronsD1[c]);
 #endif // DNN_LEAN
 									}
@@ -1080,7 +1326,7 @@ namespace dnn
 									{
 										Neurons[c] = Func.f(InputLayer->Neurons[c], Alpha, Beta);
 #ifndef DNN_LEAN
-										if (!InplaceBwd)
+										if (!InplaceBwd && !GradientOverwritten)
 											NeuronsD1[c] = Float(0);
 #endif // DNN_LEAN
 									}
@@ -1122,7 +1368,7 @@ namespace dnn
 									{
 										Func.fVec(VecFloat().load_a(&InputLayer->Neurons[hw + offset]), Alpha, Beta).store_a(&Neurons[hw + offset]);
 #ifndef DNN_LEAN
-										if (!InplaceBwd)
+										if (!InplaceBwd && !GradientOverwritten)
 											VecFloat(0).store_nt(&NeuronsD1[hw + offset]);
 #endif // DNN_LEAN
 									}
@@ -1135,7 +1381,7 @@ namespace dnn
 									{
 										Neurons[hw + offset] = Func.f(InputLayer->Neurons[hw + offset], Alpha, Beta);
 #ifndef DNN_LEAN
-										if (!InplaceBwd)
+										if (!InplaceBwd && !GradientOverwritten)
 											NeuronsD1[hw + offset] = Float(0);
 #endif // DNN_LEAN
 									}
@@ -1174,7 +1420,7 @@ namespace dnn
 										{
 											Func.fVec(VecFloat().load_a(&InputLayer->Neurons[hw + offset]), Alpha, Beta).store_a(&Neurons[hw + offset]);
 #ifndef DNN_LEAN
-											if (!InplaceBwd)
+											if (!InplaceBwd && !GradientOverwritten)
 												VecFloat(0).store_nt(&NeuronsD1[hw + offset]);
 #endif // DNN_LEAN
 										}
@@ -1190,7 +1436,7 @@ namespace dnn
 										{
 											Neurons[hw + offset] = Func.f(InputLayer->Neurons[hw + offset], Alpha, Beta);
 #ifndef DNN_LEAN
-											if (!InplaceBwd)
+											if (!InplaceBwd && !GradientOverwritten)
 												NeuronsD1[hw + offset] = Float(0);
 #endif // DNN_LEAN
 										}
@@ -1250,22 +1496,51 @@ namespace dnn
 				Device.stream.wait();
 
 #ifndef DNN_LEAN
-				if (training && !InplaceBwd)
+				if (training && !InplaceBwd && !GradientOverwritten)
 					InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 #endif
 			}
 			}
+
+			if (training && MaskBackward && !Recomputing)
+				ForwardPropMask(batchSize);
 		}
 
 		void BackwardProp(const UInt batchSize) final override
 		{
+			if (Fused)
+				return;
+
+			if (Chain)
+			{
+				Chain->BackwardProp(batchSize);
+				return;
+			}
+
+			if (InputLayer->Fused)
+			{
+				BackwardPropAdd(batchSize);
+				return;
+			}
+
 #ifdef DNN_LEAN
 			ZeroGradient(batchSize);
 #endif // DNN_LEAN
 
+			if (MaskBackward)
+			{
+				BackwardPropMask(batchSize);
+#ifdef DNN_LEAN
+				ReleaseGradient();
+#endif // DNN_LEAN
+				return;
+			}
+
 			const auto plain = IsPlainFormat();
 			const auto threads = batchSize == 1ull ? 1ull : GetThreads(batchSize * (plain ? CDHW() : PaddedCDHW()), Float(10));
 			const auto strideHW = HW() * VectorSize;
+			// like the primitive the gradient of the input is written, and only added to when the input is shared
+			const auto accumulate = SharesInput;
 
 			switch (ActivationFunction)
 			{
@@ -1298,12 +1573,12 @@ namespace dnn
 							if (!plain)
 							{
 								for (auto c = 0ull; c < PaddedC; c += VectorSize)
-									mul_add(Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[c]), Alpha, Beta), VecFloat().load_a(&NeuronsD1[c]), VecFloat().load_a(&InputLayer->NeuronsD1[c])).store_a(&InputLayer->NeuronsD1[c]);
+									(accumulate ? mul_add(Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[c]), Alpha, Beta), VecFloat().load_a(&NeuronsD1[c]), VecFloat().load_a(&InputLayer->NeuronsD1[c])) : Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[c]), Alpha, Beta) * VecFloat().load_a(&NeuronsD1[c])).store_a(&InputLayer->NeuronsD1[c]);
 							}
 							else
 							{
 								for (auto c = 0ull; c < C; c++)
-									InputLayer->NeuronsD1[c] += Func.df(InputLayerFwd->Neurons[c], Alpha, Beta) * NeuronsD1[c];
+									InputLayer->NeuronsD1[c] = (accumulate ? InputLayer->NeuronsD1[c] : Float(0)) + Func.df(InputLayerFwd->Neurons[c], Alpha, Beta) * NeuronsD1[c];
 							}
 						}
 					}
@@ -1334,14 +1609,14 @@ namespace dnn
 								{
 									const auto offset = n * PaddedC;
 									for (auto c = offset; c < offset + PaddedC; c += VectorSize)
-										mul_add(Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[c]), Alpha, Beta), VecFloat().load_a(&NeuronsD1[c]), VecFloat().load_a(&InputLayer->NeuronsD1[c])).store_a(&InputLayer->NeuronsD1[c]);
+										(accumulate ? mul_add(Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[c]), Alpha, Beta), VecFloat().load_a(&NeuronsD1[c]), VecFloat().load_a(&InputLayer->NeuronsD1[c])) : Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[c]), Alpha, Beta) * VecFloat().load_a(&NeuronsD1[c])).store_a(&InputLayer->NeuronsD1[c]);
 								});
 							else
 								for_i(batchSize, threads, [=](UInt n)
 								{
 									const auto offset = n * C;
 									for (auto c = offset; c < offset + C; c++)
-										InputLayer->NeuronsD1[c] += Func.df(InputLayerFwd->Neurons[c], Alpha, Beta) * NeuronsD1[c];
+										InputLayer->NeuronsD1[c] = (accumulate ? InputLayer->NeuronsD1[c] : Float(0)) + Func.df(InputLayerFwd->Neurons[c], Alpha, Beta) * NeuronsD1[c];
 								});
 						}
 #ifdef DNN_STOCHASTIC
@@ -1379,7 +1654,7 @@ namespace dnn
 								{
 									const auto offset = c * HW();
 									for (auto hw = offset; hw < offset + strideHW; hw += VectorSize)
-										mul_add(Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[hw]), Alpha, Beta), VecFloat().load_a(&NeuronsD1[hw]), VecFloat().load_a(&InputLayer->NeuronsD1[hw])).store_a(&InputLayer->NeuronsD1[hw]);
+										(accumulate ? mul_add(Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[hw]), Alpha, Beta), VecFloat().load_a(&NeuronsD1[hw]), VecFloat().load_a(&InputLayer->NeuronsD1[hw])) : Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[hw]), Alpha, Beta) * VecFloat().load_a(&NeuronsD1[hw])).store_a(&InputLayer->NeuronsD1[hw]);
 								}
 							else
 							{
@@ -1387,7 +1662,7 @@ namespace dnn
 								{
 									const auto offset = c * HW();
 									for (auto hw = offset; hw < offset + HW(); hw++)
-										InputLayer->NeuronsD1[hw] += Func.df(InputLayerFwd->Neurons[hw], Alpha, Beta) * NeuronsD1[hw];
+										InputLayer->NeuronsD1[hw] = (accumulate ? InputLayer->NeuronsD1[hw] : Float(0)) + Func.df(InputLayerFwd->Neurons[hw], Alpha, Beta) * NeuronsD1[hw];
 								}
 							}
 						}
@@ -1427,7 +1702,7 @@ namespace dnn
 									{
 										const auto offset = n * PaddedCDHW() + c * HW();
 										for (auto hw = offset; hw < offset + strideHW; hw += VectorSize)
-											mul_add(Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[hw]), Alpha, Beta), VecFloat().load_a(&NeuronsD1[hw]), VecFloat().load_a(&InputLayer->NeuronsD1[hw])).store_a(&InputLayer->NeuronsD1[hw]);
+											(accumulate ? mul_add(Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[hw]), Alpha, Beta), VecFloat().load_a(&NeuronsD1[hw]), VecFloat().load_a(&InputLayer->NeuronsD1[hw])) : Func.dfVec(VecFloat().load_a(&InputLayerFwd->Neurons[hw]), Alpha, Beta) * VecFloat().load_a(&NeuronsD1[hw])).store_a(&InputLayer->NeuronsD1[hw]);
 									}
 								});
 							else
@@ -1437,7 +1712,7 @@ namespace dnn
 									{
 										const auto offset = n * CDHW() + c * HW();
 										for (auto hw = offset; hw < offset + HW(); hw++)
-											InputLayer->NeuronsD1[hw] += Func.df(InputLayerFwd->Neurons[hw], Alpha, Beta) * NeuronsD1[hw];
+											InputLayer->NeuronsD1[hw] = (accumulate ? InputLayer->NeuronsD1[hw] : Float(0)) + Func.df(InputLayerFwd->Neurons[hw], Alpha, Beta) * NeuronsD1[hw];
 									}
 								});
 						}
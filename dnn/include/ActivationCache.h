@@ -0,0 +1,124 @@
+#pragma once
+#include "Layer.h"
+#include "MappedFile.h"
+
+namespace dnn
+{
+	// per sample and view copies of the Neurons of the layers a frozen prefix hands to the trainable part of a model,
+	// kept in their own memory layout in RAM or in a mapped file, fp32 or fp16, a row is filled the first time its sample runs through the prefix
+	class ActivationCache final
+	{
+	private:
+		std::vector<Layer*> layers;
+		std::vector<UInt> elements;		// per layer values of one sample in Neurons
+		std::vector<UInt> offsets;		// per layer offset of its values in a row
+		UInt rowElements;
+		std::vector<Byte> filled;
+		std::vector<Byte> memory;
+		std::unique_ptr<MappedFile> file;
+		Byte* data;
+
+		inline auto ElementSize() const noexcept { return HalfPrecision ? sizeof(std::uint16_t) : sizeof(Float); }
+
+		inline Byte* Row(const UInt row) const noexcept { return data + row * rowElements * ElementSize(); }
+
+	public:
+		const UInt Rows;
+		const bool HalfPrecision;
+
+		// rows = samples x views, an empty fileName keeps the cache in RAM
+		ActivationCache(const std::vector<Layer*>& frontier, const UInt rows, const bool halfPrecision, const std::string& fileName) :
+			layers(frontier),
+			elements(frontier.size()),
+			offsets(frontier.size()),
+			rowElements(0),
+			filled(rows, 0),
+			data(nullptr),
+			Rows(rows),
+			HalfPrecision(halfPrecision)
+		{
+			if (layers.empty() || Rows == 0ull)
+				throw std::invalid_argument("Nothing to cache in ActivationCache");
+
+			for (auto l = 0ull; l < layers.size(); l++)
+			{
+				elements[l] = layers[l]->IsPlainFormat() ? layers[l]->CDHW() : layers[l]->PaddedCDHW();
+				offsets[l] = rowElements;
+				rowElements += elements[l];
+			}
+
+			if (fileName.empty())
+			{
+				memory = std::vector<Byte>(Rows * rowElements * ElementSize());
+				data = memory.data();
+			}
+			else
+			{
+				file = std::make_unique<MappedFile>(fileName, Rows * rowElements * ElementSize());
+				data = file->Data();
+			}
+		}
+
+		inline UInt Size() const noexcept
+		{
+			return Rows * rowElements * ElementSize();
+		}
+
+		bool Filled(const std::vector<UInt>& rows) const
+		{
+			for (auto row : rows)
+				if (!filled[row])
+					return false;
+
+			return true;
+		}
+
+		// batch row n of the layers' Neurons goes to cache row rows[n]
+		void Store(const std::vector<UInt>& rows)
+		{
+			const auto threads = GetThreads(rows.size() * rowElements, Float(0.25));
+
+			for_i(rows.size(), threads, [=](const UInt n)
+			{
+				auto row = Row(rows[n]);
+				for (auto l = 0ull; l < layers.size(); l++)
+				{
+					const auto src = layers[l]->Neurons.data() + n * elements[l];
+					if (HalfPrecision)
+					{
+						auto dst = reinterpret_cast<std::uint16_t*>(row) + offsets[l];
+						for (auto i = 0ull; i < elements[l]; i++)
+							dst[i] = FloatToHalf(src[i]);
+					}
+					else
+						std::memcpy(reinterpret_cast<Float*>(row) + offsets[l], src, elements[l] * sizeof(Float));
+				}
+			});
+
+			for (auto row : rows)
+				filled[row] = 1;
+		}
+
+		void Load(const std::vector<UInt>& rows)
+		{
+			const auto threads = GetThreads(rows.size() * rowElements, Float(0.25));
+
+			for_i(rows.size(), threads, [=](const UInt n)
+			{
+				const auto row = Row(rows[n]);
+				for (auto l = 0ull; l < layers.size(); l++)
+				{
+					auto dst = layers[l]->Neurons.data() + n * elements[l];
+					if (HalfPrecision)
+					{
+						const auto src = reinterpret_cast<const std::uint16_t*>(row) + offsets[l];
+						for (auto i = 0ull; i < elements[l]; i++)
+							dst[i] = HalfToFloat(src[i]);
+					}
+					else
+						std::memcpy(dst, reinterpret_cast<const Float*>(row) + offsets[l], elements[l] * sizeof(Float));
+				}
+			});
+		}
+	};
+}
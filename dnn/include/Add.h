@@ -1,5 +1,5 @@
 #pragma once
-#include "Layer.h"
+#include "ElementwiseChain.h"
 
 namespace dnn
 {
@@ -51,6 +51,12 @@ namespace dnn
 			return 1;
 		}
 
+		// a broadcast input is summed into over H x W, only the other one has its gradient written whole
+		bool OverwritesInputGradient(const Layer* inputLayer) const final override
+		{
+			return !Fused && !Chain && (EqualDimensions(InputsFwd) || inputLayer == InputsFwd[first]);
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (Inputs[first]->DstMemDesc->get_ndims() == 2)
@@ -89,6 +95,15 @@ namespace dnn
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
+			if (Fused)	// summed by the Activation or the elementwise chain reading it
+				return;
+
+			if (Chain)
+			{
+				Chain->ForwardProp(batchSize, training);
+				return;
+			}
+
 			const auto fullDepth = SurvivalProbability[0] == Float(1) && SurvivalProbability[1] == Float(1);
 			scales[0] = fullDepth ? Float(1) : (Inputs[0]->Skip ? Float(0) : Float(1));
 			scales[1] = fullDepth ? Float(1) : (Inputs[1]->Skip ? Float(0) : Float(1));
@@ -116,7 +131,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = Inputs[0]->Neurons[cdhw] + Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -134,7 +150,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0)  + (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -155,7 +172,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = Inputs[first]->Neurons[hw + outputOffset] + Inputs[second]->Neurons[channelOffset];
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -177,7 +195,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = ((Inputs[first]->Neurons[hw + outputOffset] * scales0) + (Inputs[second]->Neurons[channelOffset] * scales1));
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -198,14 +217,16 @@ namespace dnn
 								{
 									(VecFloat().load_a(&Inputs[0]->Neurons[cdhw]) + VecFloat().load_a(&Inputs[1]->Neurons[cdhw])).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
 									Neurons[cdhw] = Inputs[0]->Neurons[cdhw] + Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -225,14 +246,16 @@ namespace dnn
 									In1.load_a(&Inputs[1]->Neurons[cdhw]);
 									((In0 * scales0) + (In1 * scales1)).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) + (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -252,7 +275,8 @@ namespace dnn
 									{
 										(VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) + VecFloat().load_a(&Inputs[second]->Neurons[channelOffset])).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -273,7 +297,8 @@ namespace dnn
 									{
 										((VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) * scales0) + (VecFloat().load_a(&Inputs[second]->Neurons[channelOffset]) * scales1)).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -295,10 +320,23 @@ namespace dnn
 
 		void BackwardProp(const UInt batchSize) final override
 		{
+			if (Fused)
+				return;
+
+			if (Chain)
+			{
+				Chain->BackwardProp(batchSize);
+				return;
+			}
+
 #ifdef DNN_LEAN
 			ZeroGradientMulti(batchSize);
 #endif
 
+			const auto overwrite0 = OverwritesInput(0);
+			const auto overwrite1 = OverwritesInput(1);
+			const auto overwriteFirst = OverwritesInput(first);
+
 			const auto plain = IsPlainFormat();
 			const auto size = plain ? CDHW() : PaddedCDHW();
 			const auto part = GetVectorPart(size);
@@ -320,8 +358,8 @@ namespace dnn
 						PRAGMA_OMP_SIMD()
 						for (auto cdhw = 0ull; cdhw < size; cdhw++)
 						{
-							Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scales0;
-							Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scales1;
+							Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scales0;
+							Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scales1;
 						}
 					}
 					else
@@ -331,18 +369,18 @@ namespace dnn
 						{
 							D1.load_a(&NeuronsD1[cdhw]);
 
-							inputD1.load_a(&Inputs[0]->NeuronsD1[cdhw]);
+							inputD1 = overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]);
 							inputD1 += D1 * scales0;
 							inputD1.store_a(&Inputs[0]->NeuronsD1[cdhw]);
 
-							inputD1.load_a(&Inputs[1]->NeuronsD1[cdhw]);
+							inputD1 = overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]);
 							inputD1 += D1 * scales1;
 							inputD1.store_a(&Inputs[1]->NeuronsD1[cdhw]);
 						}
 						for (auto cdhw = part; cdhw < size; cdhw++)
 						{
-							Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scales0;
-							Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scales1;
+							Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scales0;
+							Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scales1;
 						}
 					}
 				}
@@ -356,7 +394,7 @@ namespace dnn
 							PRAGMA_OMP_SIMD()
 							for (auto hw = 0ull; hw < HW(); hw++)
 							{
-								Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset];
+								Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset];
 								Inputs[second]->NeuronsD1[c] += NeuronsD1[hw + outputOffset];
 							}
 						}
@@ -371,7 +409,7 @@ namespace dnn
 							for (auto hw = 0ull; hw < strideHW; hw += VectorSize)
 							{
 								D1.load_a(&NeuronsD1[hw + outputOffset]);
-								(D1 + VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+								(D1 + (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
 								(D1 + VecFloat().load_a(&Inputs[second]->NeuronsD1[c])).store_a(&Inputs[second]->NeuronsD1[c]);
 							}
 						}
@@ -396,8 +434,8 @@ namespace dnn
 								PRAGMA_OMP_SIMD()
 								for (auto cdhw = start; cdhw < end; cdhw++)
 								{
-									Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw];
-									Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw];
+									Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw];
+									Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw];
 								}
 							});
 						}
@@ -412,8 +450,8 @@ namespace dnn
 								PRAGMA_OMP_SIMD()
 								for (auto cdhw = start; cdhw < end; cdhw++)
 								{
-									Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scale0;
-									Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scale1;
+									Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scale0;
+									Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scale1;
 								}
 							});
 						}
@@ -430,13 +468,13 @@ namespace dnn
 								for (auto cdhw = start; cdhw < start + part; cdhw += VectorSize)
 								{
 									D1.load_a(&NeuronsD1[cdhw]);
-									(VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]) + D1).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-									(VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]) + D1).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+									((overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])) + D1).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+									((overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])) + D1).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
-									Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw];
-									Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw];
+									Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw];
+									Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw];
 								}
 							});
 						}
@@ -452,13 +490,13 @@ namespace dnn
 								for (auto cdhw = start; cdhw < start + part; cdhw += VectorSize)
 								{
 									D1.load_a(&NeuronsD1[cdhw]);
-									mul_add(D1, scale0, VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-									mul_add(D1, scale1, VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+									mul_add(D1, scale0, (overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]))).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+									mul_add(D1, scale1, (overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]))).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
-									Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scale0;
-									Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scale1;
+									Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scale0;
+									Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scale1;
 								}
 							});
 						}
@@ -479,7 +517,7 @@ namespace dnn
 									PRAGMA_OMP_SIMD()
 									for (auto hw = 0ull; hw < HW(); hw++)
 									{
-										Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset];
+										Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset];
 										Inputs[second]->NeuronsD1[channelOffset] += NeuronsD1[hw + outputOffset];
 									}
 								}
@@ -498,7 +536,7 @@ namespace dnn
 									PRAGMA_OMP_SIMD()
 									for (auto hw = 0ull; hw < HW(); hw++)
 									{
-										Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset] * scale0;
+										Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset] * scale0;
 										Inputs[second]->NeuronsD1[channelOffset] += NeuronsD1[hw + outputOffset] * scale1;
 									}
 								}
@@ -521,7 +559,7 @@ namespace dnn
 									for (auto hw = 0ull; hw < strideHW; hw += VectorSize)
 									{
 										D1.load_a(&NeuronsD1[hw + outputOffset]);
-										(D1 + VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+										(D1 + (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
 										(D1 + VecFloat().load_a(&Inputs[second]->NeuronsD1[channelOffset])).store_a(&Inputs[second]->NeuronsD1[channelOffset]);
 									}
 								}
@@ -541,7 +579,7 @@ namespace dnn
 									for (auto hw = 0ull; hw < strideHW; hw += VectorSize)
 									{
 										D1.load_a(&NeuronsD1[hw + outputOffset]);
-										mul_add(D1, scale0, VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+										mul_add(D1, scale0, (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
 										mul_add(D1, scale1, VecFloat().load_a(&Inputs[second]->NeuronsD1[channelOffset])).store_a(&Inputs[second]->NeuronsD1[channelOffset]);
 									}
 								}
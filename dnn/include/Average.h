@@ -1,5 +1,5 @@
 #pragma once
-#include "Layer.h"
+#include "ElementwiseChain.h"
 
 namespace dnn
 {
@@ -52,6 +52,12 @@ namespace dnn
 			return 1;
 		}
 
+		// a broadcast input is summed into over H x W, only the other one has its gradient written whole
+		bool OverwritesInputGradient(const Layer* inputLayer) const final override
+		{
+			return !Fused && !Chain && (EqualDimensions(InputsFwd) || inputLayer == InputsFwd[first]);
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (Inputs[first]->DstMemDesc->get_ndims() == 2)
@@ -96,6 +102,15 @@ namespace dnn
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
+			if (Fused)	// computed by the root of its elementwise chain
+				return;
+
+			if (Chain)
+			{
+				Chain->ForwardProp(batchSize, training);
+				return;
+			}
+
 			const auto fullDepth = SurvivalProbability[0] == Float(1) && SurvivalProbability[1] == Float(1);
 			scales[0] = fullDepth ? Float(1) : (Inputs[0]->Skip ? Float(0) : Float(1));
 			scales[1] = fullDepth ? Float(1) : (Inputs[1]->Skip ? Float(0) : Float(1));
@@ -123,7 +138,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] + Inputs[1]->Neurons[cdhw]) / Float(2);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -141,7 +157,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) + (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -162,7 +179,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = (Inputs[first]->Neurons[hw + outputOffset] + Inputs[second]->Neurons[channelOffset]) / Float(2);
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -184,7 +202,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = (Inputs[first]->Neurons[hw + outputOffset] * scales0) + (Inputs[second]->Neurons[channelOffset] * scales1);
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -205,14 +224,16 @@ namespace dnn
 								{
 									((VecFloat().load_a(&Inputs[0]->Neurons[cdhw]) + VecFloat().load_a(&Inputs[1]->Neurons[cdhw])) / Float(2)).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] + Inputs[1]->Neurons[cdhw]) / Float(2);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -232,14 +253,16 @@ namespace dnn
 									In1.load_a(&Inputs[1]->Neurons[cdhw]);
 									((In0 * scales0) + (In1 * scales1)).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) + (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -259,7 +282,8 @@ namespace dnn
 									{
 										((VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) + VecFloat().load_a(&Inputs[second]->Neurons[channelOffset])) / Float(2)).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -280,7 +304,8 @@ namespace dnn
 									{
 										((VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) * scales0) + (VecFloat().load_a(&Inputs[second]->Neurons[channelOffset]) * scales1)).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -302,10 +327,23 @@ namespace dnn
 
 		void BackwardProp(const UInt batchSize) final override
 		{
+			if (Fused)
+				return;
+
+			if (Chain)
+			{
+				Chain->BackwardProp(batchSize);
+				return;
+			}
+
 #ifdef DNN_LEAN
 			ZeroGradientMulti(batchSize);
 #endif
 
+			const auto overwrite0 = OverwritesInput(0);
+			const auto overwrite1 = OverwritesInput(1);
+			const auto overwriteFirst = OverwritesInput(first);
+
 			const auto plain = IsPlainFormat();
 			const auto size = plain ? CDHW() : PaddedCDHW();
 			const auto part = GetVectorPart(size);
@@ -327,8 +365,8 @@ namespace dnn
 						PRAGMA_OMP_SIMD()
 						for (auto cdhw = 0ull; cdhw < size; cdhw++)
 						{
-							Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scales0 * Float(0.5);
-							Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scales1 * Float(0.5);
+							Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scales0 * Float(0.5);
+							Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scales1 * Float(0.5);
 						}
 					}
 					else
@@ -338,18 +376,18 @@ namespace dnn
 						{
 							D1.load_a(&NeuronsD1[cdhw]);
 							D1 *= Float(0.5);
-							inputD1.load_a(&Inputs[0]->NeuronsD1[cdhw]);
+							inputD1 = overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]);
 							inputD1 += D1 * scales0;
 							inputD1.store_a(&Inputs[0]->NeuronsD1[cdhw]);
 
-							inputD1.load_a(&Inputs[1]->NeuronsD1[cdhw]);
+							inputD1 = overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]);
 							inputD1 += D1 * scales1;
 							inputD1.store_a(&Inputs[1]->NeuronsD1[cdhw]);
 						}
 						for (auto cdhw = part; cdhw < size; cdhw++)
 						{
-							Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scales0 * Float(0.5);
-							Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scales1 * Float(0.5);
+							Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scales0 * Float(0.5);
+							Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scales1 * Float(0.5);
 						}
 					}
 				}
@@ -363,7 +401,7 @@ namespace dnn
 							PRAGMA_OMP_SIMD()
 							for (auto hw = 0ull; hw < HW(); hw++)
 							{
-								Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset] * Float(0.5);;
+								Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset] * Float(0.5);;
 								Inputs[second]->NeuronsD1[c] += NeuronsD1[hw + outputOffset] * Float(0.5);;
 							}
 						}
@@ -379,7 +417,7 @@ namespace dnn
 							{
 								D1.load_a(&NeuronsD1[hw + outputOffset]);
 								D1 *= Float(0.5);
-								(D1 + VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+								(D1 + (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
 								(D1 + VecFloat().load_a(&Inputs[second]->NeuronsD1[c])).store_a(&Inputs[second]->NeuronsD1[c]);
 							}
 						}
@@ -404,8 +442,8 @@ namespace dnn
 								PRAGMA_OMP_SIMD()
 								for (auto cdhw = start; cdhw < end; cdhw++)
 								{
-									Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * Float(0.5);
-									Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * Float(0.5);
+									Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * Float(0.5);
+									Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * Float(0.5);
 								}
 							});
 						}
@@ -420,8 +458,8 @@ namespace dnn
 								PRAGMA_OMP_SIMD()
 								for (auto cdhw = start; cdhw < end; cdhw++)
 								{
-									Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scale0;
-									Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scale1;
+									Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scale0;
+									Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scale1;
 								}
 							});
 						}
@@ -439,13 +477,13 @@ namespace dnn
 								{
 									D1.load_a(&NeuronsD1[cdhw]);
 									D1 *= Float(0.5);
-									(VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]) + D1).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-									(VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]) + D1).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+									((overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])) + D1).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+									((overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])) + D1).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
-									Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * Float(0.5);
-									Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * Float(0.5);
+									Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * Float(0.5);
+									Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * Float(0.5);
 								}
 							});
 						}
@@ -461,13 +499,13 @@ namespace dnn
 								for (auto cdhw = start; cdhw < start + part; cdhw += VectorSize)
 								{
 									D1.load_a(&NeuronsD1[cdhw]);
-									mul_add(D1, scale0, VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-									mul_add(D1, scale1, VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+									mul_add(D1, scale0, (overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]))).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+									mul_add(D1, scale1, (overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]))).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
-									Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scale0;
-									Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * scale1;
+									Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scale0;
+									Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * scale1;
 								}
 							});
 						}
@@ -488,7 +526,7 @@ namespace dnn
 									PRAGMA_OMP_SIMD()
 									for (auto hw = 0ull; hw < HW(); hw++)
 									{
-										Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset] * Float(0.5);
+										Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset] * Float(0.5);
 										Inputs[second]->NeuronsD1[channelOffset] += NeuronsD1[hw + outputOffset] * Float(0.5);
 									}
 								}
@@ -507,7 +545,7 @@ namespace dnn
 									PRAGMA_OMP_SIMD()
 									for (auto hw = 0ull; hw < HW(); hw++)
 									{
-										Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset] * scale0;
+										Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset] * scale0;
 										Inputs[second]->NeuronsD1[channelOffset] += NeuronsD1[hw + outputOffset] * scale1;
 									}
 								}
@@ -531,7 +569,7 @@ namespace dnn
 									{
 										D1.load_a(&NeuronsD1[hw + outputOffset]);
 										D1 *= Float(0.5);
-										(D1 + VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+										(D1 + (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
 										(D1 + VecFloat().load_a(&Inputs[second]->NeuronsD1[channelOffset])).store_a(&Inputs[second]->NeuronsD1[channelOffset]);
 									}
 								}
@@ -551,7 +589,7 @@ namespace dnn
 									for (auto hw = 0ull; hw < strideHW; hw += VectorSize)
 									{
 										D1.load_a(&NeuronsD1[hw + outputOffset]);
-										mul_add(D1, scale0, VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+										mul_add(D1, scale0, (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
 										mul_add(D1, scale1, VecFloat().load_a(&Inputs[second]->NeuronsD1[channelOffset])).store_a(&Inputs[second]->NeuronsD1[channelOffset]);
 									}
 								}
@@ -89,6 +89,11 @@ namespace dnn
 			return 1;
 		}
 
+		bool OverwritesGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (InputLayer->DstMemDesc->get_ndims() == 2)
@@ -152,7 +157,7 @@ namespace dnn
 			Device.stream.wait();
 
 #ifndef DNN_LEAN
-			if (training)
+			if (training && !GradientOverwritten)
 				InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 #else
 			DNN_UNREF_PAR(batchSize);
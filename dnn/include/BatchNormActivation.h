@@ -1,5 +1,6 @@
 #pragma once
 #include "Activation.h"
+#include "ChannelStatistics.h"
 
 namespace dnn
 {
@@ -19,6 +20,51 @@ namespace dnn
 		bool reorderFwdSrc;
 		bool reorderBwdSrc;
 		bool reorderBwdDiffSrc;
+		FloatVector batchUnbiasedVariance;
+
+		// the activation input z of an output y = f(z), InPlace only selects invertible activations
+		inline Float Inverse(const Float y) const NOEXCEPT
+		{
+			switch (ActivationFunction)
+			{
+			case Activations::Elu:
+				return y > Float(0) ? y : std::log(std::max(y / Alpha + Float(1), std::numeric_limits<Float>::min()));
+			case Activations::Linear:
+				return (y - Beta) / Alpha;
+			case Activations::Relu:
+				return y > Float(0) ? y : y / Alpha;
+			default:
+				return y;
+			}
+		}
+
+		inline VecFloat InverseVec(const VecFloat& y) const NOEXCEPT
+		{
+			switch (ActivationFunction)
+			{
+			case Activations::Elu:
+				return select(y > Float(0), y, log(max(y / Alpha + Float(1), std::numeric_limits<Float>::min())));
+			case Activations::Linear:
+				return (y - Beta) / Alpha;
+			case Activations::Relu:
+				return select(y > Float(0), y, y / Alpha);
+			default:
+				return y;
+			}
+		}
+
+		// 1 / (Weights[c] * InvStdDev[c]), kept finite for a vanishing scale
+		static inline Float SafeReciprocal(const Float value) NOEXCEPT
+		{
+			constexpr auto eps = Float(1e-12);
+			return Float(1) / (std::abs(value) < eps ? std::copysign(eps, value) : value);
+		}
+
+		static inline VecFloat SafeReciprocal(const VecFloat& value) NOEXCEPT
+		{
+			constexpr auto eps = Float(1e-12);
+			return VecFloat(1) / select(abs(value) < eps, sign_combine(VecFloat(eps), value), value);
+		}
 
 	public:
 		const Activations ActivationFunction;
@@ -26,14 +72,25 @@ namespace dnn
 		const Float Beta;
 		const Act Func;
 		const Float Eps;
-		const Float Momentum;
-		const Float OneMinusMomentum;
+		const Float BaseMomentum;
+		Float Momentum;
+		Float OneMinusMomentum;
 		FloatVector Mean;
 		FloatVector RunningMean;
 		FloatVector Variance;
 		FloatVector RunningVariance;
 		FloatVector InvStdDev;
 		FloatArray InputNeurons;
+		// set for one forward pass by a DepthwiseConvolution with this layer as its epilogue: at inference it already wrote Neurons,
+		// in training InputBlockStatistics holds the merged per channel block statistics of its output, the same ChannelStatistics computes
+		bool InputFolded;
+		bool InputStatistics;
+		std::vector<Welford<VecFloat>> InputBlockStatistics;
+		// the batch statistics come from one parallel pass over the samples and channels with merged partial statistics (ChannelStatistics.h)
+		bool WelfordStatistics;
+		// in-place activated batch norm: in training the input Neurons aren't read after the forward pass (Model lets the released inputs share them),
+		// backprop reconstructs the normalized input from the output by inverting the activation and the affine transform
+		bool InPlace;
 
 		BatchNormActivation(const dnn::Device& device, const dnnl::memory::format_tag format, const std::string& name, const Activations activation, const std::vector<Layer*>& inputs, const bool scaling = true, const Float alpha = Float(0), const Float beta = Float(0), const Float momentum = Float(0.99), const Float eps = Float(1e-04), const bool hasBias = true) :
 			Layer(device, format, name, LayerTypes::BatchNormActivation, inputs[0]->C, inputs[0]->C, inputs[0]->C, inputs[0]->D, inputs[0]->H, inputs[0]->W, 0, 0, 0, inputs, hasBias, scaling),
@@ -42,6 +99,7 @@ namespace dnn
 			Beta(Activation::GetBeta(activation, alpha, beta)),
 			Func(Activation::GetActivation(activation)),
 			Eps(eps),
+			BaseMomentum(momentum),
 			Momentum(momentum),
 			OneMinusMomentum(Float(1) - momentum),
 			Mean(FloatVector(PaddedC, Float(0))),
@@ -50,11 +108,17 @@ namespace dnn
 			RunningVariance(FloatVector(PaddedC, Float(1))),
 			InvStdDev(FloatVector(PaddedC)),
 			InputNeurons(FloatArray()),
+			InputFolded(false),
+			InputStatistics(false),
+			InputBlockStatistics(std::vector<Welford<VecFloat>>(PaddedC / VectorSize)),
+			WelfordStatistics(false),
+			InPlace(false),
 			flags(static_cast<dnnl::normalization_flags>(0U)),
 			inference(false),
 			reorderFwdSrc(false),
 			reorderBwdSrc(false),
-			reorderBwdDiffSrc(false)
+			reorderBwdDiffSrc(false),
+			batchUnbiasedVariance(FloatVector(PaddedC, Float(1)))
 		{
 			assert(Inputs.size() == 1);
 
@@ -62,6 +126,13 @@ namespace dnn
 			PersistWeightsMemDesc = std::make_unique<dnnl::memory::desc>(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(C) }), dnnl::memory::data_type::f32, dnnl::memory::format_tag::x));
 		}
 	
+		// the running statistics decay once per optimizer step when the gradients of several micro-batches are accumulated
+		void UpdateMicroBatches(const UInt microBatches)
+		{
+			Momentum = microBatches > 1 ? std::pow(BaseMomentum, Float(1) / Float(microBatches)) : BaseMomentum;
+			OneMinusMomentum = Float(1) - Momentum;
+		}
+
 		void UpdateResolution() final override
 		{
 			H = InputLayer->H;
@@ -91,10 +162,27 @@ namespace dnn
 
 			description.append(nwl + std::string(" Mean:") + dtab + FloatToStringFixed(mean));
 			description.append(nwl + std::string(" Variance:") + tab + FloatToStringFixed(variance));
+			if (InPlace)
+				description.append(nwl + std::string(" InPlace:") + tab + std::string("yes"));
 						
 			return description;
 		}
 
+		// the activations InPlace can invert: leaky Relu, Elu and Linear with a non zero slope
+		static bool Invertible(const Activations activation, const Float alpha)
+		{
+			switch (activation)
+			{
+			case Activations::Elu:
+			case Activations::Relu:
+				return alpha > Float(0);
+			case Activations::Linear:
+				return alpha != Float(0);
+			default:
+				return false;
+			}
+		}
+
 		UInt FanIn() const final override
 		{ 
 			return 1; 
@@ -113,6 +201,11 @@ namespace dnn
 				InputNeurons.resize(batchSize, C, H, W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
 		}
 
+		bool OverwritesWeightsGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (InputLayer->DstMemDesc->get_ndims() == 2)
@@ -178,7 +271,15 @@ namespace dnn
 		}
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
-		{			
+		{
+			const auto inputFolded = InputFolded;
+			const auto inputStatistics = InputStatistics;
+			InputFolded = false;
+			InputStatistics = false;
+
+			if (!training && inputFolded)
+				return;
+
 			if constexpr (Reference && !TestBatchNormalization)
 				ForwardPropRef(batchSize, training);
 			else
@@ -243,6 +344,11 @@ namespace dnn
 				else
 				{
 					const auto maxTreads = GetThreads(elements, Float(10));
+					// statistics handed over by a depthwise epilogue are already merged the way ChannelStatistics merges them
+					const auto welford = WelfordStatistics && !inputStatistics;
+
+					if (welford)
+						ChannelStatistics(InputLayer->Neurons.data(), batchSize, C, PaddedC, HW(), plain, Mean.data(), Variance.data(), batchUnbiasedVariance.data());
 
 					if (plain)
 					{
@@ -262,7 +368,13 @@ namespace dnn
 							auto correction0Float = Float(0);
 							auto correction1Float = Float(0);
 															
-							if constexpr (SingleMeanVariancePass)
+							if (welford)
+							{
+								mean = Mean[c];
+								variance = Variance[c];
+								unbiasedVariance = batchUnbiasedVariance[c];
+							}
+							else if constexpr (SingleMeanVariancePass)
 							{
 								for (auto n = 0ull; n < batchSize; n++)
 								{
@@ -327,8 +439,11 @@ namespace dnn
 								Variance[c] = variance;
 							}
 							
-							RunningMean[c] = RunningMean[c] * Momentum + OneMinusMomentum * mean;
-							RunningVariance[c] = RunningVariance[c] * Momentum + OneMinusMomentum * unbiasedVariance;
+							if (!Recomputing)
+							{
+								RunningMean[c] = RunningMean[c] * Momentum + OneMinusMomentum * mean;
+								RunningVariance[c] = RunningVariance[c] * Momentum + OneMinusMomentum * unbiasedVariance;
+							}
 
 							const auto invStddev = Float(1) / std::sqrt(variance + Eps);
 							const auto weightedInvStdDev = Scaling ? (Weights[c] * invStddev) : invStddev;
@@ -356,14 +471,16 @@ namespace dnn
 									{
 										Func.fVec(((VecFloat().load_a(&InputLayer->Neurons[hw]) - mean) * weightedInvStdDev + biases), Alpha, Beta).store_a(&Neurons[hw]);
 	#ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw]);
 	#endif
 									}
 									for (auto hw = part; hw < start + HW(); hw++)
 									{
 										Neurons[hw] = Func.f((InputLayer->Neurons[hw] - mean) * weightedInvStdDev + biases, Alpha, Beta);
 	#ifndef DNN_LEAN
-										NeuronsD1[hw] = Float(0);
+										if (!GradientOverwritten)
+											NeuronsD1[hw] = Float(0);
 	#endif
 									}
 								}
@@ -382,7 +499,22 @@ namespace dnn
 							auto variance = VecFloat(0);
 							auto unbiasedVariance = VecFloat(0);
 
-							if constexpr (SingleMeanVariancePass)
+							if (inputStatistics)
+							{
+								const auto& statistics = InputBlockStatistics[c];
+								mean = statistics.Mean;
+								mean.store_a(&Mean[channelOffset]);
+
+								variance = statistics.M2 / statistics.Count;
+								unbiasedVariance = statistics.M2 / std::max(Float(1), statistics.Count - Float(1));
+							}
+							else if (welford)
+							{
+								mean = VecFloat().load_a(&Mean[channelOffset]);
+								variance = VecFloat().load_a(&Variance[channelOffset]);
+								unbiasedVariance = VecFloat().load_a(&batchUnbiasedVariance[channelOffset]);
+							}
+							else if constexpr (SingleMeanVariancePass)
 							{
 								auto correction0 = VecFloat(0);
 								auto correction1 = VecFloat(0);
@@ -443,8 +575,11 @@ namespace dnn
 							variance = max(VecFloat(0), variance);
 							variance.store_a(&Variance[channelOffset]);
 
-							mul_add(VecFloat().load_a(&RunningMean[channelOffset]), Momentum, OneMinusMomentum * mean).store_a(&RunningMean[channelOffset]);
-							mul_add(VecFloat().load_a(&RunningVariance[channelOffset]), Momentum, OneMinusMomentum * unbiasedVariance).store_a(&RunningVariance[channelOffset]);
+							if (!Recomputing)
+							{
+								mul_add(VecFloat().load_a(&RunningMean[channelOffset]), Momentum, OneMinusMomentum * mean).store_a(&RunningMean[channelOffset]);
+								mul_add(VecFloat().load_a(&RunningVariance[channelOffset]), Momentum, OneMinusMomentum * unbiasedVariance).store_a(&RunningVariance[channelOffset]);
+							}
 
 							const auto invStddev = VecFloat(Float(1)) / sqrt(variance + Eps);
 							const auto weightedInvStdDev = Scaling ? (VecFloat().load_a(&Weights[channelOffset]) * invStddev) : invStddev;
@@ -474,7 +609,8 @@ namespace dnn
 										{
 											Func.fVec(mul_add(VecFloat().load_a(&InputLayer->Neurons[w]) - mean, weightedInvStdDev, biases), Alpha, Beta).store_a(&Neurons[w]);
 #ifndef DNN_LEAN
-											VecFloat(0).store_nt(&NeuronsD1[w]);
+											if (!GradientOverwritten)
+												VecFloat(0).store_nt(&NeuronsD1[w]);
 #endif
 										}
 									}
@@ -521,6 +657,7 @@ namespace dnn
 				const auto plain = IsPlainFormat();
 				const auto elements = batchSize * (plain ? CDHW() : PaddedCDHW());
 				const auto maxThreads = GetThreads(elements, Float(10));
+				const auto inPlace = InPlace;
 
 				if (plain)
 				{
@@ -531,6 +668,11 @@ namespace dnn
 					{
 						const auto weightedInvStdDev = Scaling ? InvStdDev[c] * Weights[c] : InvStdDev[c];
 						const auto biases = Scaling && HasBias ? Biases[c] : Float(0);
+						const auto invWeightedInvStdDev = inPlace ? SafeReciprocal(weightedInvStdDev) : Float(0);
+
+						// the input minus the batch mean, in place reconstructed from the output
+						const auto centered = [=](const UInt hw) { return inPlace ? (Inverse(Neurons[hw]) - biases) * invWeightedInvStdDev : InputLayerFwd->Neurons[hw] - Mean[c]; };
+						const auto centeredVec = [=](const UInt hw) { return inPlace ? (InverseVec(VecFloat().load_a(&Neurons[hw])) - biases) * invWeightedInvStdDev : VecFloat().load_a(&InputLayerFwd->Neurons[hw]) - Mean[c]; };
 
 						auto diffGammaFloat = Float(0);
 						auto diffBetaFloat = Float(0);
@@ -551,16 +693,16 @@ namespace dnn
 							const auto part = start + partialHW;
 							for (auto hw = start; hw < part; hw += VectorSize)
 							{
-								inputNeurons.load_a(&InputLayerFwd->Neurons[hw]);
-								inputNeurons -= Mean[c];
+								inputNeurons = centeredVec(hw);
 								diffSrc = Func.dfVec(inputNeurons * weightedInvStdDev + biases, Alpha, Beta) * VecFloat().load_a(&layerD1[hw]);
 								KahanSum<VecFloat>(diffSrc * inputNeurons, diffGamma, correction0);
 								KahanSum<VecFloat>(diffSrc, diffBeta, correction1);
 							}
 							for (auto hw = part; hw < start + HW(); hw++)
 							{
-								diffSrcFloat = Func.df(((InputLayerFwd->Neurons[hw] - Mean[c]) * weightedInvStdDev) + biases, Alpha, Beta) * layerD1[hw];
-								KahanSum<Float>(diffSrcFloat * (InputLayerFwd->Neurons[hw] - Mean[c]), diffGammaFloat, correction0Float);
+								const auto inputNeuron = centered(hw);
+								diffSrcFloat = Func.df((inputNeuron * weightedInvStdDev) + biases, Alpha, Beta) * layerD1[hw];
+								KahanSum<Float>(diffSrcFloat * inputNeuron, diffGammaFloat, correction0Float);
 								KahanSum<Float>(diffSrcFloat, diffBetaFloat, correction1Float);
 							}
 						}
@@ -571,8 +713,8 @@ namespace dnn
 
 						if (Scaling)
 						{
-							WeightsD1[c] += diffGammaFloat;
-							BiasesD1[c] += diffBetaFloat;
+							WeightsD1[c] = diffGammaFloat;
+							BiasesD1[c] = diffBetaFloat;
 						}
 
 						diffGammaFloat *= InvStdDev[c] / Float(batchSize * HW());
@@ -586,10 +728,11 @@ namespace dnn
 								const auto part = start + partialHW;
 								for (auto hw = start; hw < part; hw += VectorSize)
 								{
-									diffSrc = Func.dfVec((VecFloat().load_a(&InputLayerFwd->Neurons[hw]) - Mean[c]) * weightedInvStdDev + biases, Alpha, Beta) * VecFloat().load_a(&layerD1[hw]);
+									inputNeurons = centeredVec(hw);
+									diffSrc = Func.dfVec(inputNeurons * weightedInvStdDev + biases, Alpha, Beta) * VecFloat().load_a(&layerD1[hw]);
 
 									// if not using global stats!
-									diffSrc -= mul_add(VecFloat().load_a(&InputLayerFwd->Neurons[hw]) - Mean[c], diffGammaFloat, diffBetaFloat);
+									diffSrc -= mul_add(inputNeurons, diffGammaFloat, diffBetaFloat);
 
 									//diffSrc *= gamma;
 									mul_add(diffSrc, gamma, VecFloat(0)).store_a(&InputLayer->NeuronsD1[hw]);
@@ -597,10 +740,11 @@ namespace dnn
 								for (auto hw = part; hw < start + HW(); hw++)
 								{
 
-									diffSrcFloat = Func.df(((InputLayerFwd->Neurons[hw] - Mean[c]) * weightedInvStdDev) + biases, Alpha, Beta) * layerD1[hw];
+									const auto inputNeuron = centered(hw);
+									diffSrcFloat = Func.df((inputNeuron * weightedInvStdDev) + biases, Alpha, Beta) * layerD1[hw];
 
 									// if not using global stats!
-									diffSrcFloat -= (InputLayerFwd->Neurons[hw] - Mean[c]) * diffGammaFloat + diffBetaFloat;
+									diffSrcFloat -= inputNeuron * diffGammaFloat + diffBetaFloat;
 
 									//diffSrc *= gamma;
 									InputLayer->NeuronsD1[hw] = diffSrcFloat * gamma;
@@ -613,20 +757,22 @@ namespace dnn
 								const auto part = start + partialHW;
 								for (auto hw = start; hw < part; hw += VectorSize)
 								{
-									diffSrc = Func.dfVec((VecFloat().load_a(&InputLayerFwd->Neurons[hw]) - Mean[c]) * weightedInvStdDev + biases, Alpha, Beta) * VecFloat().load_a(&layerD1[hw]);
+									inputNeurons = centeredVec(hw);
+									diffSrc = Func.dfVec(inputNeurons * weightedInvStdDev + biases, Alpha, Beta) * VecFloat().load_a(&layerD1[hw]);
 
 									// if not using global stats!
-									diffSrc -= mul_add(VecFloat().load_a(&InputLayerFwd->Neurons[hw]) - Mean[c], diffGammaFloat, diffBetaFloat);
+									diffSrc -= mul_add(inputNeurons, diffGammaFloat, diffBetaFloat);
 
 									//diffSrc *= gamma;
 									mul_add(diffSrc, gamma, VecFloat().load_a(&InputLayer->NeuronsD1[hw])).store_a(&InputLayer->NeuronsD1[hw]);
 								}
 								for (auto hw = part; hw < start + HW(); hw++)
 								{
-									diffSrcFloat = Func.df(((InputLayerFwd->Neurons[hw] - Mean[c]) * weightedInvStdDev) + biases, Alpha, Beta) * layerD1[hw];
+									const auto inputNeuron = centered(hw);
+									diffSrcFloat = Func.df((inputNeuron * weightedInvStdDev) + biases, Alpha, Beta) * layerD1[hw];
 
 									// if not using global stats!
-									diffSrcFloat -= (InputLayerFwd->Neurons[hw] - Mean[c]) * diffGammaFloat + diffBetaFloat;
+									diffSrcFloat -= inputNeuron * diffGammaFloat + diffBetaFloat;
 
 									//diffSrc *= gamma;
 									InputLayer->NeuronsD1[hw] += diffSrcFloat * gamma;
@@ -647,6 +793,7 @@ namespace dnn
 						const auto invStdDev = VecFloat().load_a(&InvStdDev[channelOffset]);
 						const auto weightedInvStdDev = Scaling ? invStdDev * VecFloat().load_a(&Weights[channelOffset]) : invStdDev;
 						const auto biases = Scaling && HasBias ? VecFloat().load_a(&Biases[channelOffset]) : VecFloat(0);
+						const auto invWeightedInvStdDev = inPlace ? SafeReciprocal(weightedInvStdDev) : VecFloat(0);
 						auto diffGamma = VecFloat(0);
 						auto diffBeta = VecFloat(0);
 						auto diffSrc = VecFloat(0);
@@ -664,8 +811,7 @@ namespace dnn
 								for (auto w = offsetH; w < offsetH + strideH; w += VectorSize)
 								{
 									diffSrc.load_a(&layerD1[w]);
-									inputNeurons.load_a(&InputLayerFwd->Neurons[w]);
-									inputNeurons -= mean;
+									inputNeurons = inPlace ? (InverseVec(VecFloat().load_a(&Neurons[w])) - biases) * invWeightedInvStdDev : VecFloat().load_a(&InputLayerFwd->Neurons[w]) - mean;
 									diffSrc *= Func.dfVec(mul_add(inputNeurons, weightedInvStdDev, biases), Alpha, Beta);
 									KahanSum<VecFloat>(diffSrc * inputNeurons, diffGamma, correction0);
 									KahanSum<VecFloat>(diffSrc, diffBeta, correction1);
@@ -677,8 +823,8 @@ namespace dnn
 
 						if (Scaling)
 						{
-							(VecFloat().load_a(&WeightsD1[channelOffset]) + diffGamma).store_a(&WeightsD1[channelOffset]);
-							(VecFloat().load_a(&BiasesD1[channelOffset]) + diffBeta).store_a(&BiasesD1[channelOffset]);
+							diffGamma.store_a(&WeightsD1[channelOffset]);
+							diffBeta.store_a(&BiasesD1[channelOffset]);
 						}
 
 						diffGamma *= invStdDev / Float(batchSize * HW());
@@ -697,8 +843,7 @@ namespace dnn
 									for (auto w = offsetH; w < offsetH + strideH; w += VectorSize)
 									{
 										diffSrc.load_a(&layerD1[w]);
-										inputNeurons.load_a(&InputLayerFwd->Neurons[w]);
-										inputNeurons -= mean;
+										inputNeurons = inPlace ? (InverseVec(VecFloat().load_a(&Neurons[w])) - biases) * invWeightedInvStdDev : VecFloat().load_a(&InputLayerFwd->Neurons[w]) - mean;
 										diffSrc = mul_add(Func.dfVec(mul_add(inputNeurons, weightedInvStdDev, biases), Alpha, Beta), diffSrc, -mul_add(inputNeurons, diffGamma, diffBeta));
 										(diffSrc * gamma).store_a(&InputLayer->NeuronsD1[w]);
 									}
@@ -715,8 +860,7 @@ namespace dnn
 									for (auto w = offsetH; w < offsetH + strideH; w += VectorSize)
 									{
 										diffSrc.load_a(&layerD1[w]);
-										inputNeurons.load_a(&InputLayerFwd->Neurons[w]);
-										inputNeurons -= mean;
+										inputNeurons = inPlace ? (InverseVec(VecFloat().load_a(&Neurons[w])) - biases) * invWeightedInvStdDev : VecFloat().load_a(&InputLayerFwd->Neurons[w]) - mean;
 										diffSrc = mul_add(Func.dfVec(mul_add(inputNeurons, weightedInvStdDev, biases), Alpha, Beta), diffSrc, -mul_add(inputNeurons, diffGamma, diffBeta));
 										mul_add(diffSrc, gamma, VecFloat().load_a(&InputLayer->NeuronsD1[w])).store_a(&InputLayer->NeuronsD1[w]);
 									}
@@ -837,11 +981,12 @@ namespace dnn
 				Device.stream.wait();
 
 				const Float unbiasedFactor = Float(batchSize * HW()) / Float(batchSize * HW() - 1);
-				for (auto c = 0ull; c < C; c++)
-				{
-					RunningMean[c] = (Momentum * RunningMean[c]) + (OneMinusMomentum * Mean[c]);
-					RunningVariance[c] = (Momentum * RunningVariance[c]) + (OneMinusMomentum * Variance[c] * unbiasedFactor);
-				}
+				if (!Recomputing)
+					for (auto c = 0ull; c < C; c++)
+					{
+						RunningMean[c] = (Momentum * RunningMean[c]) + (OneMinusMomentum * Mean[c]);
+						RunningVariance[c] = (Momentum * RunningVariance[c]) + (OneMinusMomentum * Variance[c] * unbiasedFactor);
+					}
 			}
 				
 			const auto strideHW = HW() * VectorSize;
@@ -861,7 +1006,8 @@ namespace dnn
 								{
 									Func.fVec(VecFloat().load_a(&InputNeurons[hw]), Alpha, Beta).store_a(&Neurons[hw]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[hw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[hw]);
 #endif // DNN_LEAN
 								}
 							}
@@ -893,7 +1039,8 @@ namespace dnn
 								{
 									Neurons[hw] = Func.f(InputNeurons[hw], Alpha, Beta);
 #ifndef DNN_LEAN
-									NeuronsD1[hw] = Float(0);
+									if (!GradientOverwritten)
+										NeuronsD1[hw] = Float(0);
 #endif // DNN_LEAN
 								}
 							}
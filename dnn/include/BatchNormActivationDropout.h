@@ -1,6 +1,7 @@
 #pragma once
 #include "Layer.h"
 #include "Activation.h"
+#include "ChannelStatistics.h"
 
 namespace dnn
 {
@@ -20,6 +21,7 @@ namespace dnn
 		bool reorderFwdSrc;
 		bool reorderBwdSrc;
 		bool reorderBwdDiffSrc;
+		FloatVector batchUnbiasedVariance;
 
 	public:
 		const bool LocalValue;
@@ -28,8 +30,9 @@ namespace dnn
 		const Float Beta;
 		const Act Func;
 		const Float Eps;
-		const Float Momentum;
-		const Float OneMinusMomentum;
+		const Float BaseMomentum;
+		Float Momentum;
+		Float OneMinusMomentum;
 		Float Keep;
 		Float Scale;
 		FloatVector Mean;
@@ -39,6 +42,8 @@ namespace dnn
 		FloatVector InvStdDev;
 		FloatArray NeuronsActive;
 		FloatArray InputNeurons;
+		// the batch statistics come from one parallel pass over the samples and channels (ChannelStatistics.h)
+		bool WelfordStatistics;
 
 		BatchNormActivationDropout(const dnn::Device& device, const dnnl::memory::format_tag format, const std::string& name, const Activations activation, const std::vector<Layer*>& inputs, const Float dropout = Float(0.5), const bool localValue = false, const bool scaling = true, const Float alpha = Float(0), const Float beta = Float(0), const Float momentum = Float(0.99), const Float eps = Float(1e-04), const bool hasBias = true) :
 			Layer(device, format, name, LayerTypes::BatchNormActivationDropout, inputs[0]->C, inputs[0]->C, inputs[0]->C, inputs[0]->D, inputs[0]->H, inputs[0]->W, 0, 0, 0, inputs, hasBias, scaling, dropout > 0),
@@ -48,6 +53,7 @@ namespace dnn
 			Beta(Activation::GetBeta(activation, alpha, beta)),
 			Func(Activation::GetActivation(activation)),
 			Eps(eps),
+			BaseMomentum(momentum),
 			Momentum(momentum),
 			OneMinusMomentum(Float(1) - momentum),
 			Keep(Float(1) - dropout),
@@ -58,11 +64,13 @@ namespace dnn
 			RunningVariance(FloatVector(PaddedC, Float(1))),
 			InvStdDev(FloatVector(PaddedC)),
 			InputNeurons(FloatArray()),
+			WelfordStatistics(false),
 			flags(static_cast<dnnl::normalization_flags>(0U)),
 			inference(false),
 			reorderFwdSrc(false),
 			reorderBwdSrc(false),
-			reorderBwdDiffSrc(false)
+			reorderBwdDiffSrc(false),
+			batchUnbiasedVariance(FloatVector(PaddedC, Float(1)))
 		{
 			assert(Inputs.size() == 1);			
 
@@ -70,6 +78,13 @@ namespace dnn
 			PersistWeightsMemDesc = std::make_unique<dnnl::memory::desc>(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(C) }), dnnl::memory::data_type::f32, dnnl::memory::format_tag::x));
 		}
 				
+		// the running statistics decay once per optimizer step when the gradients of several micro-batches are accumulated
+		void UpdateMicroBatches(const UInt microBatches)
+		{
+			Momentum = microBatches > 1 ? std::pow(BaseMomentum, Float(1) / Float(microBatches)) : BaseMomentum;
+			OneMinusMomentum = Float(1) - Momentum;
+		}
+
 		void UpdateResolution() final override
 		{
 			H = InputLayer->H;
@@ -131,6 +146,16 @@ namespace dnn
 			return 1;
 		}
 
+		bool Recomputable() const final override
+		{
+			return false;
+		}
+
+		bool OverwritesWeightsGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (InputLayer->DstMemDesc->get_ndims() == 2)
@@ -276,6 +301,9 @@ namespace dnn
 				{
 					const auto maxTreads = GetThreads(elements, Float(10));
 
+					if (WelfordStatistics)
+						ChannelStatistics(InputLayer->Neurons.data(), batchSize, C, PaddedC, HW(), plain, Mean.data(), Variance.data(), batchUnbiasedVariance.data());
+
 					if (plain)
 					{
 						const auto partialHW = GetVectorPart(HW());
@@ -294,7 +322,13 @@ namespace dnn
 							auto correction0Float = Float(0);
 							auto correction1Float = Float(0);
 
-							if constexpr (SingleMeanVariancePass)
+							if (WelfordStatistics)
+							{
+								mean = Mean[c];
+								variance = Variance[c];
+								unbiasedVariance = batchUnbiasedVariance[c];
+							}
+							else if constexpr (SingleMeanVariancePass)
 							{
 								for (auto n = 0ull; n < batchSize; n++)
 								{
@@ -359,8 +393,11 @@ namespace dnn
 								Variance[c] = variance;
 							}
 
-							RunningMean[c] = RunningMean[c] * Momentum + OneMinusMomentum * mean;
-							RunningVariance[c] = RunningVariance[c] * Momentum + OneMinusMomentum * unbiasedVariance;
+							if (!Recomputing)
+							{
+								RunningMean[c] = RunningMean[c] * Momentum + OneMinusMomentum * mean;
+								RunningVariance[c] = RunningVariance[c] * Momentum + OneMinusMomentum * unbiasedVariance;
+							}
 
 							const auto invStddev = Float(1) / std::sqrt(variance + Eps);
 							const auto weightedInvStdDev = Scaling ? (Weights[c] * invStddev) : invStddev;
@@ -400,7 +437,8 @@ namespace dnn
 											mask.store_a(&NeuronsActive[hw]);
 											(mask * Scale * Func.fVec(((VecFloat().load_a(&InputLayer->Neurons[hw]) - mean) * weightedInvStdDev + biases), Alpha, Beta)).store_a(&Neurons[hw]);
 	#ifndef DNN_LEAN
-											VecFloat(0).store_nt(&NeuronsD1[hw]);
+											if (!GradientOverwritten)
+												VecFloat(0).store_nt(&NeuronsD1[hw]);
 	#endif
 										}
 										const auto end = start + HW();
@@ -409,7 +447,8 @@ namespace dnn
 											NeuronsActive[hw] = Bernoulli<Float>(Keep);
 											Neurons[hw] = NeuronsActive[hw] * Scale * Func.f((InputLayer->Neurons[hw] - mean) * weightedInvStdDev + biases, Alpha, Beta);
 	#ifndef DNN_LEAN
-											NeuronsD1[hw] = Float(0);
+											if (!GradientOverwritten)
+												NeuronsD1[hw] = Float(0);
 	#endif
 										}
 									}
@@ -436,7 +475,8 @@ namespace dnn
 										{
 											(Scale * Func.fVec(((VecFloat().load_a(&InputLayer->Neurons[hw]) - mean) * weightedInvStdDev + biases), Alpha, Beta)).store_a(&Neurons[hw]);
 	#ifndef DNN_LEAN
-											VecFloat(0).store_nt(&NeuronsD1[hw]);
+											if (!GradientOverwritten)
+												VecFloat(0).store_nt(&NeuronsD1[hw]);
 	#endif
 										}
 										const auto end = start + HW();
@@ -444,7 +484,8 @@ namespace dnn
 										{
 											Neurons[hw] = Scale * Func.f((InputLayer->Neurons[hw] - mean) * weightedInvStdDev + biases, Alpha, Beta);
 	#ifndef DNN_LEAN
-											NeuronsD1[hw] = Float(0);
+											if (!GradientOverwritten)
+												NeuronsD1[hw] = Float(0);
 	#endif
 										}
 									}
@@ -464,7 +505,13 @@ namespace dnn
 							auto variance = VecFloat(0);
 							auto unbiasedVariance = VecFloat(0);
 
-							if constexpr (SingleMeanVariancePass)
+							if (WelfordStatistics)
+							{
+								mean = VecFloat().load_a(&Mean[channelOffset]);
+								variance = VecFloat().load_a(&Variance[channelOffset]);
+								unbiasedVariance = VecFloat().load_a(&batchUnbiasedVariance[channelOffset]);
+							}
+							else if constexpr (SingleMeanVariancePass)
 							{
 								auto correction0 = VecFloat(0);
 								auto correction1 = VecFloat(0);
@@ -525,8 +572,11 @@ namespace dnn
 							variance = max(VecFloat(0), variance);
 							variance.store_a(&Variance[channelOffset]);
 
-							mul_add(VecFloat().load_a(&RunningMean[channelOffset]), Momentum, OneMinusMomentum * mean).store_a(&RunningMean[channelOffset]);
-							mul_add(VecFloat().load_a(&RunningVariance[channelOffset]), Momentum, OneMinusMomentum * unbiasedVariance).store_a(&RunningVariance[channelOffset]);
+							if (!Recomputing)
+							{
+								mul_add(VecFloat().load_a(&RunningMean[channelOffset]), Momentum, OneMinusMomentum * mean).store_a(&RunningMean[channelOffset]);
+								mul_add(VecFloat().load_a(&RunningVariance[channelOffset]), Momentum, OneMinusMomentum * unbiasedVariance).store_a(&RunningVariance[channelOffset]);
+							}
 
 							const auto invStddev = VecFloat(1) / sqrt(variance + Eps);
 							const auto weightedInvStdDev = Scaling ? (VecFloat().load_a(&Weights[channelOffset]) * invStddev) : invStddev;
@@ -565,7 +615,8 @@ namespace dnn
 												mask.store_a(&NeuronsActive[w]);
 												(mask * Scale * Func.fVec(mul_add(VecFloat().load_a(&InputLayer->Neurons[w]) - mean, weightedInvStdDev, biases), Alpha, Beta)).store_a(&Neurons[w]);
 	#ifndef DNN_LEAN
-												VecFloat(0).store_nt(&NeuronsD1[w]);
+												if (!GradientOverwritten)
+													VecFloat(0).store_nt(&NeuronsD1[w]);
 	#endif
 											}
 										}
@@ -595,7 +646,8 @@ namespace dnn
 											{
 												(Scale * Func.fVec(mul_add(VecFloat().load_a(&InputLayer->Neurons[w]) - mean, weightedInvStdDev, biases), Alpha, Beta)).store_a(&Neurons[w]);
 	#ifndef DNN_LEAN
-												VecFloat(0).store_nt(&NeuronsD1[w]);
+												if (!GradientOverwritten)
+													VecFloat(0).store_nt(&NeuronsD1[w]);
 	#endif
 											}
 										}
@@ -671,8 +723,8 @@ namespace dnn
 
 						if (Scaling)
 						{
-							WeightsD1[c] += diffGammaFloat;
-							BiasesD1[c] += diffBetaFloat;
+							WeightsD1[c] = diffGammaFloat;
+							BiasesD1[c] = diffBetaFloat;
 						}
 
 						diffGammaFloat *= InvStdDev[c] / Float(batchSize * HW());
@@ -774,8 +826,8 @@ namespace dnn
 
 						if (Scaling)
 						{
-							(VecFloat().load_a(&WeightsD1[channelOffset]) += diffGamma).store_a(&WeightsD1[channelOffset]);
-							(VecFloat().load_a(&BiasesD1[channelOffset]) += diffBeta).store_a(&BiasesD1[channelOffset]);
+							diffGamma.store_a(&WeightsD1[channelOffset]);
+							diffBeta.store_a(&BiasesD1[channelOffset]);
 						}
 
 						diffGamma *= invStdDev / Float(batchSize * HW());
@@ -917,11 +969,12 @@ namespace dnn
 				Device.stream.wait();
 
 				const Float unbiasedFactor = Float(batchSize * HW()) / Float(batchSize * HW() - 1);
-				for (auto c = 0ull; c < C; c++)
-				{
-					RunningMean[c] = (Momentum * RunningMean[c]) + (OneMinusMomentum * Mean[c]);
-					RunningVariance[c] = (Momentum * RunningVariance[c]) + (OneMinusMomentum * Variance[c] * unbiasedFactor);
-				}
+				if (!Recomputing)
+					for (auto c = 0ull; c < C; c++)
+					{
+						RunningMean[c] = (Momentum * RunningMean[c]) + (OneMinusMomentum * Mean[c]);
+						RunningVariance[c] = (Momentum * RunningVariance[c]) + (OneMinusMomentum * Variance[c] * unbiasedFactor);
+					}
 			}
 
 			const auto strideHW = HW() * VectorSize;
@@ -946,7 +999,8 @@ namespace dnn
 										mask.store_a(&NeuronsActive[hw]);
 										(mask * Scale * Func.fVec(VecFloat().load_a(&InputNeurons[hw]), Alpha, Beta)).store_a(&Neurons[hw]);										
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw]);
 #endif // DNN_LEAN
 									}
 								}
@@ -956,7 +1010,8 @@ namespace dnn
 									{
 										Func.fVec(VecFloat().load_a(&InputNeurons[hw]), Alpha, Beta).store_a(&Neurons[hw]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw]);
 #endif // DNN_LEAN
 									}
 								}
@@ -1007,7 +1062,8 @@ namespace dnn
 									NeuronsActive[hw] = Bernoulli<Float>(Keep);
 									Neurons[hw] = NeuronsActive[hw] * Scale * Func.f(InputNeurons[hw], Alpha, Beta);
 #ifndef DNN_LEAN
-									NeuronsD1[hw] = Float(0);
+									if (!GradientOverwritten)
+										NeuronsD1[hw] = Float(0);
 #endif // DNN_LEAN
 								}
 							}
@@ -23,8 +23,9 @@ namespace dnn
 
 	public:
 		const Float Eps;
-		const Float Momentum;
-		const Float OneMinusMomentum;
+		const Float BaseMomentum;
+		Float Momentum;
+		Float OneMinusMomentum;
 
 		FloatVector Mean;
 		FloatVector RunningMean;
@@ -35,6 +36,7 @@ namespace dnn
 		BatchNormRelu(const dnn::Device& device, const dnnl::memory::format_tag format, const std::string& name, const std::vector<Layer*>& inputs, const bool scaling = true, const Float momentum = Float(0.99), const Float eps = Float(1e-04), const bool hasBias = true) :
 			Layer(device, format, name, LayerTypes::BatchNormRelu, inputs[0]->C, inputs[0]->C, inputs[0]->C, inputs[0]->D, inputs[0]->H, inputs[0]->W, 0, 0, 0, inputs, hasBias, scaling),
 			Eps(eps),
+			BaseMomentum(momentum),
 			Momentum(momentum),
 			OneMinusMomentum(Float(1) - momentum),
 			Mean(FloatVector(PaddedC, Float(0))),
@@ -54,6 +56,13 @@ namespace dnn
 			PersistWeightsMemDesc = std::make_unique<dnnl::memory::desc>(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(C) }), dnnl::memory::data_type::f32, dnnl::memory::format_tag::a));
 		}
 
+		// the running statistics decay once per optimizer step when the gradients of several micro-batches are accumulated
+		void UpdateMicroBatches(const UInt microBatches)
+		{
+			Momentum = microBatches > 1 ? std::pow(BaseMomentum, Float(1) / Float(microBatches)) : BaseMomentum;
+			OneMinusMomentum = Float(1) - Momentum;
+		}
+
 		void UpdateResolution() final override
 		{
 			H = InputLayer->H;
@@ -93,6 +102,11 @@ namespace dnn
 			return 1;
 		}
 
+		bool OverwritesWeightsGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (InputLayer->DstMemDesc->get_ndims() == 2)
@@ -240,14 +254,15 @@ namespace dnn
 				Device.stream.wait();
 
 				const auto unbiasedFactor = Float(batchSize * HW()) / Float(batchSize * HW() - 1);
-				for (auto c = 0ull; c < C; c++)
-				{
-					RunningMean[c] = (Momentum * RunningMean[c]) + (OneMinusMomentum * Mean[c]);
-					RunningVariance[c] = (Momentum * RunningVariance[c]) + (OneMinusMomentum * Variance[c] * unbiasedFactor);
-				}
+				if (!Recomputing)
+					for (auto c = 0ull; c < C; c++)
+					{
+						RunningMean[c] = (Momentum * RunningMean[c]) + (OneMinusMomentum * Mean[c]);
+						RunningVariance[c] = (Momentum * RunningVariance[c]) + (OneMinusMomentum * Variance[c] * unbiasedFactor);
+					}
 
 #ifndef DNN_LEAN
-				if (!InplaceBwd)
+				if (!InplaceBwd && !GradientOverwritten)
 					InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 #else
 				DNN_UNREF_PAR(batchSize);
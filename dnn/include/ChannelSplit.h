@@ -47,6 +47,16 @@ namespace dnn
 			return 1;
 		}
 
+		bool Viewable() const final override
+		{
+			return true;
+		}
+
+		UInt ViewChannel() const final override
+		{
+			return (Group - 1) * C;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (InputLayer->DstMemDesc->get_ndims() == 2)
@@ -74,6 +84,9 @@ namespace dnn
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
+			if (View)
+				return;
+
 			const auto plain = IsPlainFormat();
 			const auto threads = GetThreads(batchSize * (plain ? CDHW() : PaddedCDHW()), Float(10));
 			const auto groupC = (Group - 1) * C;
@@ -96,7 +109,8 @@ namespace dnn
 								In.load_a(&InputLayer->Neurons[hw + inputOffset]);
 								In.store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-								VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+								if (!GradientOverwritten)
+									VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif // DNN_LEAN
 							}
 						}
@@ -112,7 +126,8 @@ namespace dnn
 							{
 								Neurons[hw + outputOffset] = InputLayer->Neurons[hw + inputOffset];
 #ifndef DNN_LEAN
-								NeuronsD1[hw + outputOffset] = Float(0);
+								if (!GradientOverwritten)
+									NeuronsD1[hw + outputOffset] = Float(0);
 #endif // DNN_LEAN
 							}
 						}
@@ -166,7 +181,8 @@ namespace dnn
 									In.load_a(&InputLayer->Neurons[hw + inputOffset]);
 									In.store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif // DNN_LEAN
 								}
 							}
@@ -183,7 +199,8 @@ namespace dnn
 								{
 									Neurons[hw + outputOffset] = InputLayer->Neurons[hw + inputOffset];
 #ifndef DNN_LEAN
-									NeuronsD1[hw + outputOffset] = Float(0);
+									if (!GradientOverwritten)
+										NeuronsD1[hw + outputOffset] = Float(0);
 #endif // DNN_LEAN
 								}
 							}
@@ -226,6 +243,9 @@ namespace dnn
 
 		void BackwardProp(const UInt batchSize) final override
 		{
+			if (View)
+				return;
+
 #ifdef DNN_LEAN
 			ZeroGradient(batchSize);
 #endif // DNN_LEAN
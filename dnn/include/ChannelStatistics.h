@@ -0,0 +1,151 @@
+#pragma once
+#include "Utils.h"
+
+namespace dnn
+{
+	// count, mean and sum of squared deviations of a set of values, the statistics of two sets merge exactly (Chan, Golub and LeVeque)
+	template<typename T>
+	struct Welford
+	{
+		Float Count;
+		T Mean;
+		T M2;
+
+		Welford() :
+			Count(Float(0)),
+			Mean(T(0)),
+			M2(T(0))
+		{
+		}
+
+		Welford(const Float count, const T& mean, const T& m2) :
+			Count(count),
+			Mean(mean),
+			M2(m2)
+		{
+		}
+
+		inline void Merge(const Welford& other) NOEXCEPT
+		{
+			if (other.Count == Float(0))
+				return;
+
+			const auto count = Count + other.Count;
+			const auto factor = other.Count / count;
+			const auto delta = other.Mean - Mean;
+
+			Mean += delta * factor;
+			M2 += other.M2 + delta * delta * (Count * factor);
+			Count = count;
+		}
+	};
+
+	// one pass over count values at stride VectorSize (a channel block of a blocked sample), the values are shifted by the first one
+	// so the sums stay small relative to the spread and the mean and deviations don't cancel out
+	inline Welford<VecFloat> BlockStatistics(const Float* data, const UInt count) NOEXCEPT
+	{
+		const auto shift = VecFloat().load_a(data);
+
+		auto sum = VecFloat(0);
+		auto squareSum = VecFloat(0);
+		for (auto i = 0ull; i < count * VectorSize; i += VectorSize)
+		{
+			const auto value = VecFloat().load_a(data + i) - shift;
+			sum += value;
+			squareSum = mul_add(value, value, squareSum);
+		}
+
+		const auto mean = sum / Float(count);
+		return Welford<VecFloat>(Float(count), shift + mean, max(VecFloat(0), squareSum - sum * mean));
+	}
+
+	// one pass over count contiguous values (a channel of a plain sample)
+	inline Welford<Float> PlainStatistics(const Float* data, const UInt count) NOEXCEPT
+	{
+		const auto part = GetVectorPart(count);
+		const auto shift = data[0];
+
+		auto vecSum = VecFloat(0);
+		auto vecSquareSum = VecFloat(0);
+		for (auto i = 0ull; i < part; i += VectorSize)
+		{
+			const auto value = VecFloat().load(data + i) - shift;
+			vecSum += value;
+			vecSquareSum = mul_add(value, value, vecSquareSum);
+		}
+
+		auto sum = horizontal_add(vecSum);
+		auto squareSum = horizontal_add(vecSquareSum);
+		for (auto i = part; i < count; i++)
+		{
+			const auto value = data[i] - shift;
+			sum += value;
+			squareSum += value * value;
+		}
+
+		const auto mean = sum / Float(count);
+		return Welford<Float>(Float(count), shift + mean, std::max(Float(0), squareSum - sum * mean));
+	}
+
+	// pairwise merge of the statistics of the samples, partials[0] holds the total
+	template<typename T>
+	inline void MergeTree(Welford<T>* partials, const UInt count) NOEXCEPT
+	{
+		for (auto stride = 1ull; stride < count; stride *= 2ull)
+			for (auto i = 0ull; i + stride < count; i += 2ull * stride)
+				partials[i].Merge(partials[i + stride]);
+	}
+
+	// per channel mean, variance and unbiased variance of batchSize samples of C (PaddedC in blocked layout) x HW values,
+	// parallel over the samples and channels (blocks), every sample and channel is reduced in one pass and the partial statistics are merged in a tree
+	inline void ChannelStatistics(const Float* data, const UInt batchSize, const UInt C, const UInt PaddedC, const UInt HW, const bool plain, Float* mean, Float* variance, Float* unbiasedVariance)
+	{
+		const auto threads = GetThreads(batchSize * (plain ? C : PaddedC) * HW, Float(0.25));
+		const auto count = Float(batchSize * HW);
+		const auto unbiasedCount = std::max(Float(1), count - Float(1));
+
+		if (plain)
+		{
+			auto partials = std::vector<Welford<Float>>(C * batchSize);
+
+			for_i(C * batchSize, threads, [&](UInt i)
+			{
+				const auto c = i / batchSize;
+				const auto n = i % batchSize;
+				partials[i] = PlainStatistics(data + (n * C + c) * HW, HW);
+			});
+
+			for_i(C, std::min<UInt>(threads, C), [&](UInt c)
+			{
+				auto statistics = &partials[c * batchSize];
+				MergeTree(statistics, batchSize);
+
+				mean[c] = statistics->Mean;
+				variance[c] = statistics->M2 / count;
+				unbiasedVariance[c] = statistics->M2 / unbiasedCount;
+			});
+		}
+		else
+		{
+			const auto blocks = PaddedC / VectorSize;
+			auto partials = std::vector<Welford<VecFloat>>(blocks * batchSize);
+
+			for_i(blocks * batchSize, threads, [&](UInt i)
+			{
+				const auto block = i / batchSize;
+				const auto n = i % batchSize;
+				partials[i] = BlockStatistics(data + n * PaddedC * HW + block * VectorSize * HW, HW);
+			});
+
+			for_i(blocks, std::min<UInt>(threads, blocks), [&](UInt block)
+			{
+				auto statistics = &partials[block * batchSize];
+				MergeTree(statistics, batchSize);
+
+				statistics->Mean.store_a(mean + block * VectorSize);
+				(statistics->M2 / count).store_a(variance + block * VectorSize);
+				(statistics->M2 / unbiasedCount).store_a(unbiasedVariance + block * VectorSize);
+			});
+		}
+	}
+}
@@ -36,6 +36,16 @@ namespace dnn
 			return 1;
 		}
 
+		bool AcceptsViews() const final override
+		{
+			return true;
+		}
+
+		bool OverwritesInputGradient(const Layer* inputLayer) const final override
+		{
+			return !Fused && !Chain;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (InputLayer->DstMemDesc->get_ndims() == 2)
@@ -69,6 +79,8 @@ namespace dnn
 		{
 			const auto plain = IsPlainFormat();
 			const auto threads = GetThreads(batchSize * (plain ? CDHW() : PaddedCDHW()));
+			const auto input = InputLayer->Storage();
+			const auto inputChannel = InputLayer->StorageChannel();
 
 			DNN_UNREF_PAR(training);
 
@@ -80,17 +92,19 @@ namespace dnn
 					if (!plain)
 						for (auto c = 0ull; c < PaddedC; c++)
 						{
-							Neurons[c] = c < InputLayer->PaddedC ? InputLayer->Neurons[c] : Float(0);
+							Neurons[c] = c < InputLayer->PaddedC ? input->Neurons[c + inputChannel] : Float(0);
 #ifndef DNN_LEAN
-							NeuronsD1[c] = Float(0);
+							if (!GradientOverwritten)
+								NeuronsD1[c] = Float(0);
 #endif // DNN_LEAN
 						}
 					else
 						for (auto c = 0ull; c < C; c++)
 						{
-							Neurons[c] = c < InputLayer->C ? InputLayer->Neurons[c] : Float(0);
+							Neurons[c] = c < InputLayer->C ? input->Neurons[c + inputChannel] : Float(0);
 #ifndef DNN_LEAN
-							NeuronsD1[c] = Float(0);
+							if (!GradientOverwritten)
+								NeuronsD1[c] = Float(0);
 #endif // DNN_LEAN
 						}
 				}
@@ -101,13 +115,14 @@ namespace dnn
 						for_i(batchSize, threads, [=](UInt n)
 						{
 							const auto outputOffset = n * PaddedCDHW();
-							const auto inputOffset = n * InputLayer->PaddedCDHW();
+							const auto inputOffset = n * input->PaddedCDHW() + inputChannel;
 
 							for (auto c = 0ull; c < PaddedC; c++)
 							{
-								Neurons[c + outputOffset] = c < InputLayer->PaddedC ? InputLayer->Neurons[c + inputOffset] : Float(0);
+								Neurons[c + outputOffset] = c < InputLayer->PaddedC ? input->Neurons[c + inputOffset] : Float(0);
 #ifndef DNN_LEAN
-								NeuronsD1[c + outputOffset] = Float(0);
+								if (!GradientOverwritten)
+									NeuronsD1[c + outputOffset] = Float(0);
 #endif // DNN_LEAN
 							}
 						});
@@ -115,13 +130,14 @@ namespace dnn
 						for_i(batchSize, threads, [=](UInt n)
 						{
 							const auto outputOffset = n * CDHW();
-							const auto inputOffset = n * InputLayer->CDHW();
+							const auto inputOffset = n * input->CDHW() + inputChannel;
 
 							for (auto c = 0ull; c < C; c++)
 							{
-								Neurons[c + outputOffset] = c < InputLayer->C ? InputLayer->Neurons[c + inputOffset] : Float(0);
+								Neurons[c + outputOffset] = c < InputLayer->C ? input->Neurons[c + inputOffset] : Float(0);
 #ifndef DNN_LEAN
-								NeuronsD1[c + outputOffset] = Float(0);
+								if (!GradientOverwritten)
+									NeuronsD1[c + outputOffset] = Float(0);
 #endif // DNN_LEAN
 							}
 						});
@@ -145,10 +161,11 @@ namespace dnn
 							inputOffset = c * HW();
 							for (auto w = 0ull; w < strideH; w += VectorSize)
 							{
-								In.load_a(&InputLayer->Neurons[w + inputOffset]);
+								In.load_a(&input->Neurons[w + inputOffset + inputChannel * HW()]);
 								In.store_a(&Neurons[w + inputOffset]);
 #ifndef DNN_LEAN
-								VecFloat(0).store_nt(&NeuronsD1[w + inputOffset]);
+								if (!GradientOverwritten)
+									VecFloat(0).store_nt(&NeuronsD1[w + inputOffset]);
 #endif // DNN_LEAN
 							}
 							
@@ -160,7 +177,8 @@ namespace dnn
 							{
 								VecFloat(0).store_a(&Neurons[w + inputOffset]);
 #ifndef DNN_LEAN
-								VecFloat(0).store_nt(&NeuronsD1[w + inputOffset]);
+								if (!GradientOverwritten)
+									VecFloat(0).store_nt(&NeuronsD1[w + inputOffset]);
 #endif // DNN_LEAN
 							}
 						}
@@ -173,9 +191,10 @@ namespace dnn
 
 							for (auto w = 0ull; w < HW(); w++)
 							{
-								Neurons[w + offsetC] = skip ? Float(0) : InputLayer->Neurons[w + offsetC];
+								Neurons[w + offsetC] = skip ? Float(0) : input->Neurons[w + offsetC + inputChannel * HW()];
 #ifndef DNN_LEAN
-								NeuronsD1[w + offsetC] = Float(0);
+								if (!GradientOverwritten)
+									NeuronsD1[w + offsetC] = Float(0);
 #endif // DNN_LEAN
 							}
 							
@@ -191,14 +210,15 @@ namespace dnn
 							UInt inputOffset, outputOffset;
 							for (auto c = 0ull; c < InputLayer->PaddedC; c += VectorSize)
 							{
-								inputOffset = n * InputLayer->PaddedCDHW() + c * HW();
+								inputOffset = n * input->PaddedCDHW() + (c + inputChannel) * HW();
 								outputOffset = n * PaddedCDHW() + c * HW();
 								for (auto w = 0ull; w < strideH; w += VectorSize)
 								{
-									In.load_a(&InputLayer->Neurons[w + inputOffset]);
+									In.load_a(&input->Neurons[w + inputOffset]);
 									In.store_a(&Neurons[w + outputOffset]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[w + outputOffset]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[w + outputOffset]);
 #endif // DNN_LEAN
 								}
 							}
@@ -209,7 +229,8 @@ namespace dnn
 								{
 									VecFloat(0).store_a(&Neurons[w + outputOffset]);
 #ifndef DNN_LEAN								
-									VecFloat(0).store_nt(&NeuronsD1[w + outputOffset]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[w + outputOffset]);
 #endif // DNN_LEAN
 								}
 							}
@@ -220,14 +241,15 @@ namespace dnn
 							UInt inputOffset, outputOffset;
 							for (auto c = 0ull; c < InputLayer->C; c++)
 							{
-								inputOffset = n * InputLayer->CDHW() + c * HW();
+								inputOffset = n * input->CDHW() + (c + inputChannel) * HW();
 								outputOffset = n * CDHW() + c * HW();
 								
 								for (auto w = 0ull; w < HW(); w++)
 								{
-									Neurons[w + outputOffset] = InputLayer->Neurons[w + inputOffset];
+									Neurons[w + outputOffset] = input->Neurons[w + inputOffset];
 #ifndef DNN_LEAN
-									NeuronsD1[w + outputOffset] = Float(0);
+									if (!GradientOverwritten)
+										NeuronsD1[w + outputOffset] = Float(0);
 #endif // DNN_LEAN
 								}
 							}
@@ -238,7 +260,8 @@ namespace dnn
 								{
 									Neurons[w + outputOffset] = Float(0);
 #ifndef DNN_LEAN
-									NeuronsD1[w + outputOffset] = Float(0);
+									if (!GradientOverwritten)
+										NeuronsD1[w + outputOffset] = Float(0);
 #endif // DNN_LEAN
 								}
 							}
@@ -251,8 +274,12 @@ namespace dnn
 
 		void BackwardProp(const UInt batchSize) final override
 		{
+			const auto input = InputLayer->Storage();
+			const auto inputChannel = InputLayer->StorageChannel();
+			const auto overwrite = OverwritesInput(0);
+
 #ifdef DNN_LEAN
-			ZeroGradient(batchSize);
+			input->NeuronsD1.resize(batchSize, input->C, input->H, input->W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine, Float(0), !input->GradientOverwritten);
 #endif // DNN_LEAN
 
 			const auto plain = IsPlainFormat();
@@ -263,16 +290,16 @@ namespace dnn
 #ifdef DNN_STOCHASTIC
 				if (batchSize == 1)
 					for (auto c = 0ull; c < InputLayer->C; c++)
-						InputLayer->NeuronsD1[c] += NeuronsD1[c];
+						input->NeuronsD1[c + inputChannel] = (overwrite ? Float(0) : input->NeuronsD1[c + inputChannel]) + NeuronsD1[c];
 				else
 #endif
 					for_i(batchSize, threads, [=](UInt n)
 					{
 						const auto offsetN = n * CDHW();
-						const auto offsetNinput = n * InputLayer->CDHW();
+						const auto offsetNinput = n * input->CDHW() + inputChannel;
 
 						for (auto c = 0ull; c < InputLayer->C; c++)
-							InputLayer->NeuronsD1[c + offsetNinput] += NeuronsD1[c + offsetN];
+							input->NeuronsD1[c + offsetNinput] = (overwrite ? Float(0) : input->NeuronsD1[c + offsetNinput]) + NeuronsD1[c + offsetN];
 					});
 			}
 			else
@@ -286,7 +313,7 @@ namespace dnn
 					{
 						inputOffset = c * HW();
 						for (auto w = 0ull; w < strideH; w += VectorSize)
-							(VecFloat().load_a(&InputLayer->NeuronsD1[w + inputOffset]) + VecFloat().load_a(&NeuronsD1[w + inputOffset])).store_a(&InputLayer->NeuronsD1[w + inputOffset]);
+							((overwrite ? VecFloat(0) : VecFloat().load_a(&input->NeuronsD1[w + inputOffset + inputChannel * HW()])) + VecFloat().load_a(&NeuronsD1[w + inputOffset])).store_a(&input->NeuronsD1[w + inputOffset + inputChannel * HW()]);
 					}
 				}
 				else
@@ -299,10 +326,10 @@ namespace dnn
 							for (auto c = 0ull; c < InputLayer->PaddedC; c += VectorSize)
 							{
 								outputOffset = n * PaddedCDHW() + c * HW();
-								inputOffset = n * InputLayer->PaddedCDHW() + c * HW();
+								inputOffset = n * input->PaddedCDHW() + (c + inputChannel) * HW();
 
 								for (auto w = 0ull; w < strideH; w += VectorSize)
-									(VecFloat().load_a(&InputLayer->NeuronsD1[w + inputOffset]) + VecFloat().load_a(&NeuronsD1[w + outputOffset])).store_a(&InputLayer->NeuronsD1[w + inputOffset]);
+									((overwrite ? VecFloat(0) : VecFloat().load_a(&input->NeuronsD1[w + inputOffset])) + VecFloat().load_a(&NeuronsD1[w + outputOffset])).store_a(&input->NeuronsD1[w + inputOffset]);
 							}
 						});
 					else
@@ -311,11 +338,11 @@ namespace dnn
 							UInt inputOffset, outputOffset;
 							for (auto c = 0ull; c < InputLayer->C; c++)
 							{
-								inputOffset = n * InputLayer->CDHW() + c * HW();
+								inputOffset = n * input->CDHW() + (c + inputChannel) * HW();
 								outputOffset = n * CDHW() + c * HW();
 								
 								for (auto w = 0ull; w < HW(); w++)
-									InputLayer->NeuronsD1[w + inputOffset] += NeuronsD1[w + outputOffset];
+									input->NeuronsD1[w + inputOffset] = (overwrite ? Float(0) : input->NeuronsD1[w + inputOffset]) + NeuronsD1[w + outputOffset];
 							}
 						});
 #ifdef DNN_STOCHASTIC
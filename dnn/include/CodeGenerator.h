@@ -0,0 +1,772 @@
+#pragma once
+#include "Model.h"
+
+namespace dnn
+{
+	// ahead-of-time code generation: emits a standalone inference translation unit for a fixed model and batch size,
+	// all shapes and loop bounds become literals, chains of elementwise layers are fused into one SIMD loop
+	// and Convolution, DepthwiseConvolution, Dense, MaxPooling, AvgPooling, Resampling, Shuffle and (Log)Softmax run on oneDNN primitives built once in the constructor
+	class CodeGenerator final
+	{
+	private:
+		const Model& model;
+		const UInt N;
+		std::unordered_map<const Layer*, UInt> index;
+		std::vector<std::vector<UInt>> consumers;
+		std::vector<bool> materialized;
+		FloatVector parameters;
+		std::ostringstream members;
+		std::ostringstream setup;
+		std::ostringstream forward;
+
+		static std::string Literal(const Float value)
+		{
+			if (!std::isfinite(value))
+				throw std::invalid_argument("Non finite value in CodeGenerator");
+
+			std::ostringstream os;
+			os.imbue(std::locale::classic());
+			os << std::setprecision(9) << value;
+
+			return "Float(" + os.str() + ")";
+		}
+
+		template <typename T>
+		static std::string Dims(const std::vector<T>& dims)
+		{
+			auto text = std::string("dnnl::memory::dims({ ");
+			for (auto i = 0ull; i < dims.size(); i++)
+				text += (i > 0ull ? ", " : "") + std::to_string(dims[i]);
+
+			return text + " })";
+		}
+
+		static bool IsElementwise(const Layer* layer)
+		{
+			switch (layer->LayerType)
+			{
+			case LayerTypes::Activation:
+			case LayerTypes::Add:
+			case LayerTypes::Average:
+			case LayerTypes::BatchNorm:
+			case LayerTypes::BatchNormActivation:
+			case LayerTypes::BatchNormActivationDropout:
+			case LayerTypes::BatchNormRelu:
+			case LayerTypes::Divide:
+			case LayerTypes::Dropout:
+			case LayerTypes::Max:
+			case LayerTypes::Min:
+			case LayerTypes::Multiply:
+			case LayerTypes::PRelu:
+			case LayerTypes::Substract:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		std::string Buffer(const Layer* layer) const
+		{
+			return "B" + std::to_string(index.at(layer));
+		}
+
+		// vector aligned offset of count values in the parameters
+		UInt Append(const Float* data, const UInt count)
+		{
+			const auto offset = parameters.size();
+			parameters.resize(offset + DivUp(count));
+			std::copy_n(data, count, parameters.begin() + offset);
+
+			return offset;
+		}
+
+		template <typename T>
+		std::pair<UInt, UInt> AppendBatchNorm(const T* bn)
+		{
+			auto scale = FloatVector(bn->C);
+			auto shift = FloatVector(bn->C);
+			for (auto c = 0ull; c < bn->C; c++)
+			{
+				const auto gamma = bn->Scaling ? bn->Weights[c] : Float(1);
+				const auto beta = bn->Scaling ? bn->Biases[c] : Float(0);
+				scale[c] = gamma / std::sqrt(bn->RunningVariance[c] + bn->Eps);
+				shift[c] = beta - bn->RunningMean[c] * scale[c];
+			}
+
+			return { Append(scale.data(), bn->C), Append(shift.data(), bn->C) };
+		}
+
+		static std::string Activate(const Activations activation, const Float alpha, const Float beta, const bool vec)
+		{
+			if (Activation::GetActivation(activation).f == nullptr)
+				throw std::invalid_argument("Activation " + std::string(magic_enum::enum_name<Activations>(activation)) + " not supported in CodeGenerator");
+
+			return "x = " + std::string(magic_enum::enum_name<Activations>(activation)) + (vec ? "::fVec(x, " : "::f(x, ") + Literal(alpha) + ", " + Literal(beta) + ");";
+		}
+
+		// operand of an elementwise layer: same shape, or one value per channel broadcast over H x W
+		std::string Operand(const Layer* input, const Layer* layer, const bool vec) const
+		{
+			const auto hw = std::to_string(layer->H * layer->W);
+			if (input->C == layer->C && input->H * input->W == layer->H * layer->W)
+				return vec ? "VecFloat().load(" + Buffer(input) + ".data() + nc * " + hw + " + hw)" : Buffer(input) + "[nc * " + hw + " + hw]";
+			if (input->C == layer->C && input->H * input->W == 1ull)
+				return vec ? "VecFloat(" + Buffer(input) + "[nc])" : Buffer(input) + "[nc]";
+
+			throw std::invalid_argument("Broadcast of layer " + input->Name + " not supported in CodeGenerator");
+		}
+
+		// statements updating the chain value x with layer, chained is the input already held in x (nullptr for the head of the chain)
+		std::vector<std::string> Statements(const Layer* layer, const Layer* chained, const std::vector<std::pair<UInt, UInt>>& bn, const bool vec) const
+		{
+			auto statements = std::vector<std::string>();
+			const auto i = index.at(layer);
+
+			auto operands = std::vector<std::string>();
+			auto first = true;
+			auto chainedFirst = true;
+			for (auto input : layer->InputsFwd)
+			{
+				if (input == chained)
+					chainedFirst = first;
+				else
+					operands.push_back(Operand(input, layer, vec));
+				first = false;
+			}
+			if (chained == nullptr)
+			{
+				statements.push_back("x = " + operands.front() + ";");
+				operands.erase(operands.begin());
+			}
+
+			const auto bnScale = [&]() { return vec ?
+				"x = mul_add(x, VecFloat(Parameters[" + std::to_string(bn[i].first) + " + c]), VecFloat(Parameters[" + std::to_string(bn[i].second) + " + c]));" :
+				"x = x * Parameters[" + std::to_string(bn[i].first) + " + c] + Parameters[" + std::to_string(bn[i].second) + " + c];"; };
+
+			switch (layer->LayerType)
+			{
+			case LayerTypes::Activation:
+			{
+				const auto act = dynamic_cast<const Activation*>(layer);
+				statements.push_back(Activate(act->ActivationFunction, act->Alpha, act->Beta, vec));
+			}
+			break;
+
+			case LayerTypes::BatchNorm:
+				statements.push_back(bnScale());
+				break;
+
+			case LayerTypes::BatchNormActivation:
+			{
+				const auto bna = dynamic_cast<const BatchNormActivation*>(layer);
+				statements.push_back(bnScale());
+				statements.push_back(Activate(bna->ActivationFunction, bna->Alpha, bna->Beta, vec));
+			}
+			break;
+
+			case LayerTypes::BatchNormActivationDropout:
+			{
+				const auto bnad = dynamic_cast<const BatchNormActivationDropout*>(layer);
+				statements.push_back(bnScale());
+				statements.push_back(Activate(bnad->ActivationFunction, bnad->Alpha, bnad->Beta, vec));
+			}
+			break;
+
+			case LayerTypes::BatchNormRelu:
+				statements.push_back(bnScale());
+				statements.push_back(Activate(Activations::Relu, Float(0), Float(0), vec));
+				break;
+
+			case LayerTypes::Dropout:
+				break;
+
+			case LayerTypes::PRelu:
+				statements.push_back(vec ?
+					"x = select(x > VecFloat(0), x, x * VecFloat(Parameters[" + std::to_string(bn[i].first) + " + c]));" :
+					"x = x > Float(0) ? x : x * Parameters[" + std::to_string(bn[i].first) + " + c];");
+				break;
+
+			case LayerTypes::Add:
+			case LayerTypes::Average:
+				for (const auto& operand : operands)
+					statements.push_back("x += " + operand + ";");
+				if (layer->LayerType == LayerTypes::Average)
+					statements.push_back("x *= " + Literal(Float(1) / Float(layer->InputsFwd.size())) + ";");
+				break;
+
+			case LayerTypes::Multiply:
+				for (const auto& operand : operands)
+					statements.push_back("x *= " + operand + ";");
+				break;
+
+			case LayerTypes::Max:
+			case LayerTypes::Min:
+			{
+				const auto func = std::string(layer->LayerType == LayerTypes::Max ? "max" : "min");
+				for (const auto& operand : operands)
+					statements.push_back("x = " + (vec ? func : "std::" + func) + "(x, " + operand + ");");
+			}
+			break;
+
+			case LayerTypes::Substract:
+			case LayerTypes::Divide:
+			{
+				if (operands.size() != 1ull)
+					throw std::invalid_argument("Layer " + layer->Name + " must have two inputs in CodeGenerator");
+
+				const auto op = std::string(layer->LayerType == LayerTypes::Substract ? " - " : " / ");
+				statements.push_back(chainedFirst ? "x = x" + op + operands[0] + ";" : "x = " + operands[0] + op + "x;");
+			}
+			break;
+
+			default:
+				throw std::invalid_argument("Layer " + layer->Name + " is not elementwise in CodeGenerator");
+			}
+
+			return statements;
+		}
+
+		void EmitChain(const std::vector<const Layer*>& chain, const std::vector<std::pair<UInt, UInt>>& bn)
+		{
+			const auto last = chain.back();
+			const auto C = last->C;
+			const auto HW = last->H * last->W;
+			const auto part = GetVectorPart(HW);
+
+			forward << "\t\t\t\t// ";
+			for (auto i = 0ull; i < chain.size(); i++)
+				forward << (i > 0ull ? " > " : "") << chain[i]->Name;
+			forward << nwl;
+			forward << "\t\t\t\tfor_i(" << N * C << "ull, GetThreads(" << N * C * HW << "ull), [&](const UInt nc)" << nwl;
+			forward << "\t\t\t\t{" << nwl;
+			forward << "\t\t\t\t\tconst auto c = nc % " << C << "ull;" << nwl;
+			forward << "\t\t\t\t\tDNN_UNREF_PAR(c);" << nwl;
+			forward << "\t\t\t\t\tauto dst = " << Buffer(last) << ".data() + nc * " << HW << "ull;" << nwl;
+
+			for (const auto vec : { true, false })
+			{
+				if ((vec && part == 0ull) || (!vec && part == HW))
+					continue;
+
+				forward << (vec ?
+					"\t\t\t\t\tfor (auto hw = 0ull; hw < " + std::to_string(part) + "ull; hw += VectorSize)" :
+					"\t\t\t\t\tfor (auto hw = " + std::to_string(part) + "ull; hw < " + std::to_string(HW) + "ull; hw++)") << nwl;
+				forward << "\t\t\t\t\t{" << nwl;
+				forward << (vec ? "\t\t\t\t\t\tauto x = VecFloat();" : "\t\t\t\t\t\tauto x = Float(0);") << nwl;
+
+				const Layer* chained = nullptr;
+				for (auto layer : chain)
+				{
+					for (const auto& statement : Statements(layer, chained, bn, vec))
+						forward << "\t\t\t\t\t\t" << statement << nwl;
+					chained = layer;
+				}
+
+				forward << (vec ? "\t\t\t\t\t\tx.store(dst + hw);" : "\t\t\t\t\t\tdst[hw] = x;") << nwl;
+				forward << "\t\t\t\t\t}" << nwl;
+			}
+			forward << "\t\t\t\t});" << nwl;
+		}
+
+		void EmitPrimitive(const Layer* layer, const std::string& kind)
+		{
+			const auto i = std::to_string(index.at(layer));
+			forward << "\t\t\t\t// " << layer->Name << nwl;
+			forward << "\t\t\t\tP" << i << ".execute(stream, A" << i << ");" << nwl;
+			forward << "\t\t\t\tstream.wait();" << nwl;
+
+			members << "\t\t\t" << kind << " P" << i << ";" << nwl;
+			members << "\t\t\tstd::unordered_map<int, dnnl::memory> A" << i << ";" << nwl;
+		}
+
+		std::string Desc(const std::vector<UInt>& dims, const std::string& tag) const
+		{
+			return "dnnl::memory::desc(" + Dims(dims) + ", dnnl::memory::data_type::f32, dnnl::memory::format_tag::" + tag + ")";
+		}
+
+		std::string DataDesc(const Layer* layer) const
+		{
+			return layer->H * layer->W == 1ull && layer->LayerType == LayerTypes::Dense ? Desc({ N, layer->C }, "nc") : Desc({ N, layer->C, layer->H, layer->W }, "nchw");
+		}
+
+		void EmitWeighted(Layer* layer)
+		{
+			const auto i = std::to_string(index.at(layer));
+			const auto input = layer->InputLayerFwd;
+
+			auto plain = layer->GetPlainWeights();
+			if (plain.empty() || plain.size() < layer->WeightCount)
+				throw std::invalid_argument("Layer " + layer->Name + " has no weights of its own in CodeGenerator");
+			const auto weightsOffset = Append(plain.data(), layer->WeightCount);
+			const auto biasesOffset = layer->HasBias ? Append(layer->BiasesData(), layer->BiasCount) : 0ull;
+
+			auto weightsDims = std::vector<UInt>();
+			auto tag = std::string();
+			auto pd = std::string();
+			switch (layer->LayerType)
+			{
+			case LayerTypes::Convolution:
+			{
+				const auto conv = dynamic_cast<const Convolution*>(layer);
+				weightsDims = conv->Groups > 1ull ? std::vector<UInt>({ conv->Groups, conv->C / conv->Groups, input->C / conv->Groups, conv->KernelH, conv->KernelW }) : std::vector<UInt>({ conv->C, input->C, conv->KernelH, conv->KernelW });
+				tag = conv->Groups > 1ull ? "goihw" : "oihw";
+				pd = "dnnl::convolution_forward::primitive_desc(engine, dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_auto, src, weights, " + std::string(layer->HasBias ? "bias, " : "") + "dst, " + Dims(conv->Strides) + ", " + Dims(conv->Dilates) + ", " + Dims(conv->Padding) + ", " + Dims(conv->Padding) + ")";
+			}
+			break;
+
+			case LayerTypes::DepthwiseConvolution:
+			{
+				const auto conv = dynamic_cast<const DepthwiseConvolution*>(layer);
+				weightsDims = std::vector<UInt>({ input->C, conv->Multiplier, 1ull, conv->KernelH, conv->KernelW });
+				tag = "goihw";
+				pd = "dnnl::convolution_forward::primitive_desc(engine, dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_auto, src, weights, " + std::string(layer->HasBias ? "bias, " : "") + "dst, " + Dims(conv->Strides) + ", " + Dims(conv->Dilates) + ", " + Dims(conv->Padding) + ", " + Dims(conv->Padding) + ")";
+			}
+			break;
+
+			case LayerTypes::Dense:
+				weightsDims = std::vector<UInt>({ layer->C, input->C, input->H, input->W });
+				tag = "oihw";
+				pd = "dnnl::inner_product_forward::primitive_desc(engine, dnnl::prop_kind::forward_inference, src, weights, " + std::string(layer->HasBias ? "bias, " : "") + "dst)";
+				break;
+
+			default:
+				throw std::invalid_argument("Layer " + layer->Name + " has no weights in CodeGenerator");
+			}
+
+			auto anyDims = std::string("dnnl::memory::desc(" + Dims(weightsDims) + ", dnnl::memory::data_type::f32, dnnl::memory::format_tag::any)");
+			setup << "\t\t\t\t{" << nwl;
+			setup << "\t\t\t\t\t// " << layer->Name << nwl;
+			setup << "\t\t\t\t\tconst auto src = " << Desc({ N, input->C, input->H, input->W }, "nchw") << ";" << nwl;
+			setup << "\t\t\t\t\tconst auto weights = " << anyDims << ";" << nwl;
+			if (layer->HasBias)
+				setup << "\t\t\t\t\tconst auto bias = " << Desc({ layer->C }, "a") << ";" << nwl;
+			setup << "\t\t\t\t\tconst auto dst = " << DataDesc(layer) << ";" << nwl;
+			setup << "\t\t\t\t\tconst auto pd = " << pd << ";" << nwl;
+			setup << "\t\t\t\t\tP" << i << " = decltype(P" << i << ")(pd);" << nwl;
+			setup << "\t\t\t\t\tA" << i << " = std::unordered_map<int, dnnl::memory>{ { DNNL_ARG_SRC, dnnl::memory(src, engine, " << Buffer(input) << ".data()) }, { DNNL_ARG_WEIGHTS, Weights(pd.weights_desc(), " << Desc(weightsDims, tag) << ", " << weightsOffset << "ull, W" << i << ") }, { DNNL_ARG_DST, dnnl::memory(dst, engine, " << Buffer(layer) << ".data()) } };" << nwl;
+			if (layer->HasBias)
+				setup << "\t\t\t\t\tA" << i << ".insert({ DNNL_ARG_BIAS, dnnl::memory(bias, engine, const_cast<Float*>(Parameters + " << biasesOffset << "ull)) });" << nwl;
+			setup << "\t\t\t\t}" << nwl;
+
+			members << "\t\t\tFloatVector W" << i << ";" << nwl;
+			EmitPrimitive(layer, layer->LayerType == LayerTypes::Dense ? "dnnl::inner_product_forward" : "dnnl::convolution_forward");
+		}
+
+		void EmitShuffle(const Layer* layer)
+		{
+			const auto i = std::to_string(index.at(layer));
+			const auto shuffle = dynamic_cast<const Shuffle*>(layer);
+			const auto input = layer->InputLayerFwd;
+
+			setup << "\t\t\t\t{" << nwl;
+			setup << "\t\t\t\t\t// " << layer->Name << nwl;
+			setup << "\t\t\t\t\tconst auto src = " << Desc({ N, input->C, input->H, input->W }, "nchw") << ";" << nwl;
+			setup << "\t\t\t\t\tconst auto dst = " << DataDesc(layer) << ";" << nwl;
+			setup << "\t\t\t\t\tP" << i << " = dnnl::shuffle_forward(dnnl::shuffle_forward::primitive_desc(engine, dnnl::prop_kind::forward_inference, src, dst, 1, " << shuffle->GroupSize << "));" << nwl;
+			setup << "\t\t\t\t\tA" << i << " = std::unordered_map<int, dnnl::memory>{ { DNNL_ARG_SRC, dnnl::memory(src, engine, " << Buffer(input) << ".data()) }, { DNNL_ARG_DST, dnnl::memory(dst, engine, " << Buffer(layer) << ".data()) } };" << nwl;
+			setup << "\t\t\t\t}" << nwl;
+
+			EmitPrimitive(layer, "dnnl::shuffle_forward");
+		}
+
+		void EmitSoftmax(const Layer* layer)
+		{
+			const auto i = std::to_string(index.at(layer));
+			const auto input = layer->InputLayerFwd;
+			const auto axis = (layer->H == 1ull && layer->W == 1ull) ? 1 : 3;
+			const auto algorithm = std::string(layer->LayerType == LayerTypes::LogSoftmax ? "softmax_log" : "softmax_accurate");
+
+			setup << "\t\t\t\t{" << nwl;
+			setup << "\t\t\t\t\t// " << layer->Name << nwl;
+			setup << "\t\t\t\t\tconst auto src = " << DataDesc(input) << ";" << nwl;
+			setup << "\t\t\t\t\tconst auto dst = " << DataDesc(input) << ";" << nwl;
+			setup << "\t\t\t\t\tP" << i << " = dnnl::softmax_forward(dnnl::softmax_forward::primitive_desc(engine, dnnl::prop_kind::forward_inference, dnnl::algorithm::" << algorithm << ", src, dst, " << axis << "));" << nwl;
+			setup << "\t\t\t\t\tA" << i << " = std::unordered_map<int, dnnl::memory>{ { DNNL_ARG_SRC, dnnl::memory(src, engine, " << Buffer(input) << ".data()) }, { DNNL_ARG_DST, dnnl::memory(dst, engine, " << Buffer(layer) << ".data()) } };" << nwl;
+			setup << "\t\t\t\t}" << nwl;
+
+			EmitPrimitive(layer, "dnnl::softmax_forward");
+		}
+
+		void EmitPooling(const Layer* layer)
+		{
+			const auto i = std::to_string(index.at(layer));
+			const auto input = layer->InputLayerFwd;
+
+			auto algorithm = std::string("pooling_max");
+			auto params = std::string();
+			if (layer->LayerType == LayerTypes::MaxPooling)
+			{
+				const auto pool = dynamic_cast<const MaxPooling*>(layer);
+				params = Dims(pool->Strides) + ", " + Dims(pool->Kernel) + ", " + Dims(pool->Dilation) + ", " + Dims(pool->Padding) + ", " + Dims(pool->Padding);
+			}
+			else
+			{
+				const auto pool = dynamic_cast<const AvgPooling*>(layer);
+				algorithm = layer->HasPadding ? "pooling_avg_include_padding" : "pooling_avg_exclude_padding";
+				params = Dims(pool->Strides) + ", " + Dims(pool->Kernel) + ", " + Dims(pool->Dilation) + ", " + Dims(pool->Padding) + ", " + Dims(pool->Padding);
+			}
+
+			setup << "\t\t\t\t{" << nwl;
+			setup << "\t\t\t\t\t// " << layer->Name << nwl;
+			setup << "\t\t\t\t\tconst auto src = " << Desc({ N, input->C, input->H, input->W }, "nchw") << ";" << nwl;
+			setup << "\t\t\t\t\tconst auto dst = " << Desc({ N, layer->C, layer->H, layer->W }, "nchw") << ";" << nwl;
+			setup << "\t\t\t\t\tP" << i << " = dnnl::pooling_forward(dnnl::pooling_forward::primitive_desc(engine, dnnl::prop_kind::forward_inference, dnnl::algorithm::" << algorithm << ", src, dst, " << params << "));" << nwl;
+			setup << "\t\t\t\t\tA" << i << " = std::unordered_map<int, dnnl::memory>{ { DNNL_ARG_SRC, dnnl::memory(src, engine, " << Buffer(input) << ".data()) }, { DNNL_ARG_DST, dnnl::memory(dst, engine, " << Buffer(layer) << ".data()) } };" << nwl;
+			setup << "\t\t\t\t}" << nwl;
+
+			EmitPrimitive(layer, "dnnl::pooling_forward");
+		}
+
+		void EmitResampling(const Layer* layer)
+		{
+			const auto i = std::to_string(index.at(layer));
+			const auto resampling = dynamic_cast<const Resampling*>(layer);
+			const auto input = layer->InputLayerFwd;
+			const auto algorithm = std::string(resampling->Algorithm == Algorithms::Nearest ? "resampling_nearest" : "resampling_linear");
+
+			setup << "\t\t\t\t{" << nwl;
+			setup << "\t\t\t\t\t// " << layer->Name << nwl;
+			setup << "\t\t\t\t\tconst auto src = " << Desc({ N, input->C, input->H, input->W }, "nchw") << ";" << nwl;
+			setup << "\t\t\t\t\tconst auto dst = " << Desc({ N, layer->C, layer->H, layer->W }, "nchw") << ";" << nwl;
+			setup << "\t\t\t\t\tP" << i << " = dnnl::resampling_forward(dnnl::resampling_forward::primitive_desc(engine, dnnl::prop_kind::forward_inference, dnnl::algorithm::" << algorithm << ", std::vector<float>({ " << Literal(resampling->FactorH) << ", " << Literal(resampling->FactorW) << " }), src, dst));" << nwl;
+			setup << "\t\t\t\t\tA" << i << " = std::unordered_map<int, dnnl::memory>{ { DNNL_ARG_SRC, dnnl::memory(src, engine, " << Buffer(input) << ".data()) }, { DNNL_ARG_DST, dnnl::memory(dst, engine, " << Buffer(layer) << ".data()) } };" << nwl;
+			setup << "\t\t\t\t}" << nwl;
+
+			EmitPrimitive(layer, "dnnl::resampling_forward");
+		}
+
+		void EmitCopies(const Layer* layer)
+		{
+			const auto HW = layer->H * layer->W;
+			forward << "\t\t\t\t// " << layer->Name << nwl;
+
+			switch (layer->LayerType)
+			{
+			case LayerTypes::GlobalAvgPooling:
+			{
+				const auto input = layer->InputLayerFwd;
+				const auto inputHW = input->H * input->W;
+				forward << "\t\t\t\tfor_i(" << N * layer->C << "ull, GetThreads(" << N * layer->C * inputHW << "ull), [&](const UInt nc)" << nwl;
+				forward << "\t\t\t\t{" << nwl;
+				forward << "\t\t\t\t\tconst auto src = " << Buffer(input) << ".data() + nc * " << inputHW << "ull;" << nwl;
+				forward << "\t\t\t\t\tauto sum = Float(0);" << nwl;
+				forward << "\t\t\t\t\tfor (auto hw = 0ull; hw < " << inputHW << "ull; hw++)" << nwl;
+				forward << "\t\t\t\t\t\tsum += src[hw];" << nwl;
+				forward << "\t\t\t\t\t" << Buffer(layer) << "[nc] = sum * " << Literal(Float(1) / Float(inputHW)) << ";" << nwl;
+				forward << "\t\t\t\t});" << nwl;
+			}
+			break;
+
+			case LayerTypes::ChannelSplit:
+			{
+				const auto split = dynamic_cast<const ChannelSplit*>(layer);
+				const auto input = layer->InputLayerFwd;
+				forward << "\t\t\t\tfor (auto n = 0ull; n < " << N << "ull; n++)" << nwl;
+				forward << "\t\t\t\t\tstd::copy_n(" << Buffer(input) << ".data() + n * " << input->C * HW << "ull + " << (split->Group - 1ull) * layer->C * HW << "ull, " << layer->C * HW << "ull, " << Buffer(layer) << ".data() + n * " << layer->C * HW << "ull);" << nwl;
+			}
+			break;
+
+			case LayerTypes::ChannelZeroPad:
+			{
+				// the padded channels keep the zeros the buffer was created with
+				const auto input = layer->InputLayerFwd;
+				forward << "\t\t\t\tfor (auto n = 0ull; n < " << N << "ull; n++)" << nwl;
+				forward << "\t\t\t\t\tstd::copy_n(" << Buffer(input) << ".data() + n * " << input->C * HW << "ull, " << input->C * HW << "ull, " << Buffer(layer) << ".data() + n * " << layer->C * HW << "ull);" << nwl;
+			}
+			break;
+
+			case LayerTypes::Concat:
+			{
+				auto channels = 0ull;
+				forward << "\t\t\t\tfor (auto n = 0ull; n < " << N << "ull; n++)" << nwl;
+				forward << "\t\t\t\t{" << nwl;
+				for (auto input : layer->InputsFwd)
+				{
+					forward << "\t\t\t\t\tstd::copy_n(" << Buffer(input) << ".data() + n * " << input->C * HW << "ull, " << input->C * HW << "ull, " << Buffer(layer) << ".data() + n * " << layer->C * HW << "ull + " << channels * HW << "ull);" << nwl;
+					channels += input->C;
+				}
+				forward << "\t\t\t\t}" << nwl;
+			}
+			break;
+
+			default:
+				throw std::invalid_argument("Layer type " + std::string(magic_enum::enum_name<LayerTypes>(layer->LayerType)) + " of layer " + layer->Name + " not supported in CodeGenerator");
+			}
+		}
+
+		static std::string Preamble(const bool embedded)
+		{
+			auto preamble = std::string(R"(#include "Activation.h"
+)");
+			if (!embedded)
+				preamble += R"(#if defined(_WIN32) || defined(__CYGWIN__)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+)";
+			return preamble;
+		}
+
+		static std::string MappedParameters()
+		{
+			return R"(		// read-only mapping of the parameters file written next to this source
+		class MappedParameters final
+		{
+		private:
+#if defined(_WIN32) || defined(__CYGWIN__)
+			HANDLE file;
+			HANDLE mapping;
+#else
+			int file;
+			size_t size;
+#endif
+			void* data;
+
+		public:
+			MappedParameters(const std::string& fileName)
+			{
+#if defined(_WIN32) || defined(__CYGWIN__)
+				file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (file == INVALID_HANDLE_VALUE)
+					throw std::runtime_error("Cannot open " + fileName);
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+				file = open(fileName.c_str(), O_RDONLY);
+				if (file < 0)
+					throw std::runtime_error("Cannot open " + fileName);
+				struct stat info;
+				size = fstat(file, &info) == 0 ? size_t(info.st_size) : 0;
+				data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+				if (data == MAP_FAILED)
+					data = nullptr;
+#endif
+				if (data == nullptr)
+					throw std::runtime_error("Cannot map " + fileName);
+			}
+
+			MappedParameters(const MappedParameters&) = delete;
+			MappedParameters& operator=(const MappedParameters&) = delete;
+
+			~MappedParameters()
+			{
+#if defined(_WIN32) || defined(__CYGWIN__)
+				UnmapViewOfFile(data);
+				CloseHandle(mapping);
+				CloseHandle(file);
+#else
+				munmap(data, size);
+				close(file);
+#endif
+			}
+
+			const Float* Data() const
+			{
+				return static_cast<const Float*>(data);
+			}
+		};
+
+)";
+		}
+
+	public:
+		CodeGenerator(const Model& model) :
+			model(model),
+			N(model.BatchSize)
+		{
+		}
+
+		// writes fileName (a single .cpp) with the parameters either embedded or in fileName with extension .bin (mapped at run time)
+		void Generate(const std::string& fileName, const bool embedParameters)
+		{
+			const auto& layers = model.Layers;
+			if (layers.empty() || layers[0]->Neurons.empty())
+				throw std::invalid_argument("Model not initialized in CodeGenerator");
+
+			index.clear();
+			for (auto i = 0ull; i < layers.size(); i++)
+				index[layers[i].get()] = i;
+
+			consumers = std::vector<std::vector<UInt>>(layers.size());
+			for (auto i = 1ull; i < layers.size(); i++)
+				for (auto input : layers[i]->InputsFwd)
+					consumers[index.at(input)].push_back(i);
+
+			// a layer stays in registers when its only consumer is the next elementwise layer of the same shape
+			materialized = std::vector<bool>(layers.size(), true);
+			for (auto i = 1ull; i + 1ull < layers.size(); i++)
+			{
+				const auto layer = layers[i].get();
+				const auto next = layers[i + 1ull].get();
+				if (IsElementwise(layer) && IsElementwise(next) && consumers[i].size() == 1ull && consumers[i][0] == i + 1ull && layer->C == next->C && layer->H * layer->W == next->H * next->W)
+					materialized[i] = false;
+			}
+
+			parameters = FloatVector();
+			members.str(std::string());
+			setup.str(std::string());
+			forward.str(std::string());
+
+			auto bn = std::vector<std::pair<UInt, UInt>>(layers.size());
+			auto chain = std::vector<const Layer*>();
+			for (auto i = 1ull; i < layers.size(); i++)
+			{
+				auto layer = layers[i].get();
+				if (layer->LayerType == LayerTypes::Cost)
+					continue;
+				if (layer->D != 1ull)
+					throw std::invalid_argument("Layer " + layer->Name + " has depth in CodeGenerator");
+
+				switch (layer->LayerType)
+				{
+				case LayerTypes::BatchNorm:
+					bn[i] = AppendBatchNorm(dynamic_cast<BatchNorm*>(layer));
+					break;
+				case LayerTypes::BatchNormActivation:
+					bn[i] = AppendBatchNorm(dynamic_cast<BatchNormActivation*>(layer));
+					break;
+				case LayerTypes::BatchNormActivationDropout:
+					bn[i] = AppendBatchNorm(dynamic_cast<BatchNormActivationDropout*>(layer));
+					break;
+				case LayerTypes::BatchNormRelu:
+					bn[i] = AppendBatchNorm(dynamic_cast<BatchNormRelu*>(layer));
+					break;
+				case LayerTypes::PRelu:
+					// the slopes of PRelu are kept in its Biases
+					bn[i] = { Append(layer->BiasesData(), layer->C), 0ull };
+					break;
+				default:
+					break;
+				}
+
+				if (IsElementwise(layer))
+				{
+					chain.push_back(layer);
+					if (materialized[i])
+					{
+						EmitChain(chain, bn);
+						chain.clear();
+					}
+					continue;
+				}
+
+				switch (layer->LayerType)
+				{
+				case LayerTypes::Convolution:
+				case LayerTypes::DepthwiseConvolution:
+				case LayerTypes::Dense:
+					EmitWeighted(layer);
+					break;
+				case LayerTypes::MaxPooling:
+				case LayerTypes::AvgPooling:
+					EmitPooling(layer);
+					break;
+				case LayerTypes::Resampling:
+					EmitResampling(layer);
+					break;
+				case LayerTypes::Shuffle:
+					EmitShuffle(layer);
+					break;
+				case LayerTypes::LogSoftmax:
+				case LayerTypes::Softmax:
+					EmitSoftmax(layer);
+					break;
+				default:
+					EmitCopies(layer);
+					break;
+				}
+			}
+
+			const auto inputLayer = layers[0].get();
+			const auto outputLayer = model.CostLayers[model.CostIndex]->InputLayer;
+			const auto inputSize = inputLayer->C * inputLayer->H * inputLayer->W;
+			const auto outputSize = outputLayer->C * outputLayer->H * outputLayer->W;
+
+			std::ofstream os(fileName, std::ios::out | std::ios::trunc);
+			if (os.bad() || !os.good())
+				throw std::invalid_argument("Cannot create " + fileName + " in CodeGenerator");
+			os.imbue(std::locale::classic());
+
+			os << "// generated from model " << model.Name << " with batch size " << N << ", do not edit" << nwl;
+			os << Preamble(embedParameters) << nwl;
+			os << "namespace dnn" << nwl << "{" << nwl;
+			os << "\tnamespace generated" << nwl << "\t{" << nwl;
+			os << "\t\tconstexpr UInt N = " << N << "ull;" << nwl;
+			os << "\t\tconstexpr UInt InputSize = " << inputSize << "ull;" << nwl;
+			os << "\t\tconstexpr UInt OutputSize = " << outputSize << "ull;" << nwl << nwl;
+
+			if (embedParameters)
+			{
+				os << "\t\talignas(64) static const Float Parameters[" << std::max<UInt>(parameters.size(), 1ull) << "] =" << nwl << "\t\t{";
+				for (auto i = 0ull; i < parameters.size(); i++)
+					os << (i % 8ull == 0ull ? nwl + "\t\t\t" : std::string(" ")) << std::hexfloat << parameters[i] << "f" << (i + 1ull < parameters.size() ? "," : "");
+				os << std::defaultfloat << nwl << "\t\t};" << nwl << nwl;
+			}
+			else
+			{
+				auto path = std::filesystem::path(fileName).replace_extension(".bin");
+				std::ofstream bin(path, std::ios::out | std::ios::binary | std::ios::trunc);
+				if (bin.bad() || !bin.good())
+					throw std::invalid_argument("Cannot create " + path.string() + " in CodeGenerator");
+				bin.write(reinterpret_cast<const char*>(parameters.data()), std::streamsize(parameters.size() * sizeof(Float)));
+
+				os << MappedParameters();
+			}
+
+			os << "\t\tclass Network final" << nwl << "\t\t{" << nwl << "\t\tprivate:" << nwl;
+			os << "\t\t\tconst dnnl::engine engine;" << nwl;
+			os << "\t\t\tdnnl::stream stream;" << nwl;
+			if (!embedParameters)
+			{
+				os << "\t\t\tconst MappedParameters mapped;" << nwl;
+				os << "\t\t\tconst Float* Parameters;" << nwl;
+			}
+			for (auto i = 0ull; i < layers.size(); i++)
+				if (materialized[i] && layers[i]->LayerType != LayerTypes::Cost)
+					os << "\t\t\tFloatVector B" << i << ";" << nwl;
+			os << members.str() << nwl;
+
+			os << "\t\t\t// weights in the layout the primitive picked, reordered once from the plain layout in Parameters" << nwl;
+			os << "\t\t\tdnnl::memory Weights(const dnnl::memory::desc& chosen, const dnnl::memory::desc& plain, const UInt offset, FloatVector& storage)" << nwl;
+			os << "\t\t\t{" << nwl;
+			os << "\t\t\t\tauto plainMem = dnnl::memory(plain, engine, const_cast<Float*>(Parameters + offset));" << nwl;
+			os << "\t\t\t\tif (chosen == plain)" << nwl;
+			os << "\t\t\t\t\treturn plainMem;" << nwl << nwl;
+			os << "\t\t\t\tstorage = FloatVector(chosen.get_size() / sizeof(Float));" << nwl;
+			os << "\t\t\t\tauto chosenMem = dnnl::memory(chosen, engine, storage.data());" << nwl;
+			os << "\t\t\t\tdnnl::reorder(plainMem, chosenMem).execute(stream, std::unordered_map<int, dnnl::memory>{ { DNNL_ARG_FROM, plainMem }, { DNNL_ARG_TO, chosenMem } });" << nwl;
+			os << "\t\t\t\tstream.wait();" << nwl << nwl;
+			os << "\t\t\t\treturn chosenMem;" << nwl;
+			os << "\t\t\t}" << nwl << nwl;
+
+			os << "\t\tpublic:" << nwl;
+			os << (embedParameters ? "\t\t\tNetwork() :" : "\t\t\tNetwork(const std::string& parametersFile) :") << nwl;
+			os << "\t\t\t\tengine(dnnl::engine(dnnl::engine::kind::cpu, 0))," << nwl;
+			os << "\t\t\t\tstream(dnnl::stream(engine))";
+			if (!embedParameters)
+				os << "," << nwl << "\t\t\t\tmapped(parametersFile)," << nwl << "\t\t\t\tParameters(mapped.Data())";
+			for (auto i = 0ull; i < layers.size(); i++)
+				if (materialized[i] && layers[i]->LayerType != LayerTypes::Cost)
+					os << "," << nwl << "\t\t\t\tB" << i << "(FloatVector(" << N * layers[i]->C * layers[i]->H * layers[i]->W << "ull))";
+			os << nwl << "\t\t\t{" << nwl << setup.str() << "\t\t\t}" << nwl << nwl;
+
+			os << "\t\t\t// input holds N plain C x H x W samples, output receives N x OutputSize values" << nwl;
+			os << "\t\t\tvoid Forward(const Float* input, Float* output)" << nwl;
+			os << "\t\t\t{" << nwl;
+			os << "\t\t\t\tstd::copy_n(input, N * InputSize, " << Buffer(inputLayer) << ".data());" << nwl << nwl;
+			os << forward.str() << nwl;
+			os << "\t\t\t\tstd::copy_n(" << Buffer(outputLayer) << ".data(), N * OutputSize, output);" << nwl;
+			os << "\t\t\t}" << nwl;
+			os << "\t\t};" << nwl;
+			os << "\t}" << nwl << "}" << nwl;
+
+			os.flush();
+			if (os.bad())
+				throw std::invalid_argument("Cannot write " + fileName + " in CodeGenerator");
+		}
+	};
+}
@@ -0,0 +1,857 @@
+#pragma once
+#include "Utils.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dnn
+{
+	typedef std::vector<std::pair<Float*, UInt>> CommBuffers;
+
+	// data-parallel training: every worker runs a Model replica, the gradients are averaged over all workers before UpdateWeights
+	class Communicator
+	{
+	public:
+		const UInt Rank;
+		const UInt WorldSize;
+
+		Communicator(const UInt rank, const UInt worldSize) :
+			Rank(rank),
+			WorldSize(worldSize)
+		{
+			if (worldSize < 1 || rank >= worldSize)
+				throw std::invalid_argument("Invalid rank or world size in Communicator");
+		}
+
+		virtual ~Communicator() = default;
+
+		// in-place average over all workers
+		virtual void Allreduce(const CommBuffers& buffers) = 0;
+
+		// in-place copy of the buffers of rank 0 to all workers
+		virtual void Broadcast(const CommBuffers& buffers) = 0;
+
+		virtual void Barrier() = 0;
+
+		// starts the communication of the requests still waiting to fill a bucket
+		virtual void Flush()
+		{
+		}
+
+		virtual std::future<void> AllreduceAsync(const CommBuffers& buffers)
+		{
+			Allreduce(buffers);
+
+			auto done = std::promise<void>();
+			done.set_value();
+			return done.get_future();
+		}
+
+		static UInt TotalCount(const CommBuffers& buffers)
+		{
+			auto count = UInt(0);
+			for (const auto& buffer : buffers)
+				count += buffer.second;
+
+			return count;
+		}
+
+		// copies the window [offset, offset + count) of the concatenated buffers from or to dst
+		static void CopyWindow(const CommBuffers& buffers, const UInt offset, const UInt count, Float* dst, const bool toBuffers)
+		{
+			auto start = UInt(0);
+			for (const auto& [data, size] : buffers)
+			{
+				const auto first = std::max<UInt>(offset, start);
+				const auto last = std::min<UInt>(offset + count, start + size);
+				if (first < last)
+				{
+					if (toBuffers)
+						std::copy(dst + (first - offset), dst + (last - offset), data + (first - start));
+					else
+						std::copy(data + (first - start), data + (last - start), dst + (first - offset));
+				}
+				start += size;
+			}
+		}
+	};
+
+	// pins the process to the rank-th subset of the cores, oneDNN and for_i then stay on their own socket
+	inline void PinToCores(const UInt rank, const UInt worldSize)
+	{
+		const auto cores = std::max<UInt>(1ull, std::thread::hardware_concurrency() / worldSize);
+		const auto first = rank * cores;
+
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+		auto mask = DWORD_PTR(0);
+		for (auto core = first; core < first + cores && core < sizeof(DWORD_PTR) * 8ull; core++)
+			mask |= DWORD_PTR(1) << core;
+		if (mask)
+			SetProcessAffinityMask(GetCurrentProcess(), mask);
+#else
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (auto core = first; core < first + cores; core++)
+			CPU_SET(static_cast<int>(core), &set);
+		sched_setaffinity(0, sizeof(cpu_set_t), &set);
+#endif
+
+		omp_set_num_threads(static_cast<int>(cores));
+	}
+
+	// single host: every rank owns a slot in a named shared memory segment, each rank reduces 1/WorldSize of the window (reduce-scatter)
+	// and all ranks read back the averaged window (allgather), the ranks only synchronize through a spinning barrier on atomics,
+	// a background thread reduces the queued gradients in order while the backward pass goes on
+	class SharedMemoryCommunicator final : public Communicator
+	{
+	private:
+		struct Header
+		{
+			std::atomic<UInt> Attached;
+			std::atomic<UInt> Arrived;
+			std::atomic<UInt> Generation;
+			std::atomic<UInt> Owner;
+		};
+
+		struct Request
+		{
+			CommBuffers Buffers;
+			std::promise<void> Done;
+		};
+
+		static constexpr auto HeaderSize = 4096ull;
+
+		const std::string Name;
+		const UInt Capacity;
+		const UInt Size;
+		Header* header;
+		Float* slots;
+		Float* results;
+		UInt parity;
+		std::deque<Request> queue;
+		bool busy;
+		bool stop;
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::condition_variable idle;
+		std::thread worker;
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+		HANDLE handle;
+#else
+		int handle;
+#endif
+
+		void Unmap()
+		{
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			UnmapViewOfFile(header);
+			CloseHandle(handle);
+#else
+			munmap(header, Size);
+			close(handle);
+			if (Rank == 0)
+				shm_unlink((std::string("/dnn-") + Name).c_str());
+#endif
+		}
+
+		// the spinning barrier all collectives are built on
+		void Synchronize()
+		{
+			const auto generation = header->Generation.load(std::memory_order_acquire);
+
+			if (header->Arrived.fetch_add(1ull, std::memory_order_acq_rel) + 1ull == WorldSize)
+			{
+				header->Arrived.store(0ull, std::memory_order_relaxed);
+				header->Generation.fetch_add(1ull, std::memory_order_release);
+			}
+			else
+				while (header->Generation.load(std::memory_order_acquire) == generation)
+					std::this_thread::yield();
+		}
+
+		void Reduce(const CommBuffers& buffers)
+		{
+			const auto total = TotalCount(buffers);
+			const auto scale = Float(1) / Float(WorldSize);
+
+			for (auto offset = 0ull; offset < total; offset += Capacity)
+			{
+				const auto count = std::min<UInt>(Capacity, total - offset);
+				// the results alternate between two buffers, a slow rank may still be reading the previous ones
+				const auto result = results + parity * Capacity;
+				parity ^= 1ull;
+
+				CopyWindow(buffers, offset, count, slots + Rank * Capacity, false);
+				Synchronize();
+
+				const auto part = (count + WorldSize - 1ull) / WorldSize;
+				const auto first = std::min<UInt>(count, Rank * part);
+				const auto last = std::min<UInt>(count, first + part);
+				for (auto i = first; i < last; i++)
+				{
+					auto sum = Float(0);
+					for (auto rank = 0ull; rank < WorldSize; rank++)
+						sum += slots[rank * Capacity + i];
+					result[i] = sum * scale;
+				}
+				Synchronize();
+
+				CopyWindow(buffers, offset, count, result, true);
+			}
+		}
+
+		// every rank queues the same requests in the same order, so the worker threads meet in the same collectives
+		void Run()
+		{
+			while (true)
+			{
+				auto request = Request();
+				{
+					auto lock = std::unique_lock<std::mutex>(mutex);
+					condition.wait(lock, [this] { return stop || !queue.empty(); });
+
+					if (queue.empty())
+						return;
+
+					request = std::move(queue.front());
+					queue.pop_front();
+					busy = true;
+				}
+
+				try
+				{
+					Reduce(request.Buffers);
+					request.Done.set_value();
+				}
+				catch (...)
+				{
+					request.Done.set_exception(std::current_exception());
+				}
+
+				{
+					auto lock = std::lock_guard<std::mutex>(mutex);
+					busy = false;
+				}
+				idle.notify_all();
+			}
+		}
+
+		// the synchronous collectives use the segment too, they wait until the queued requests are reduced
+		void Drain()
+		{
+			auto lock = std::unique_lock<std::mutex>(mutex);
+			idle.wait(lock, [this] { return queue.empty() && !busy; });
+		}
+
+	public:
+		SharedMemoryCommunicator(const std::string& name, const UInt rank, const UInt worldSize, const UInt capacity = 4194304ull, const std::chrono::seconds timeout = std::chrono::seconds(60)) :
+			Communicator(rank, worldSize),
+			Name(name),
+			Capacity(capacity),
+			Size(HeaderSize + (worldSize + 2ull) * capacity * sizeof(Float)),
+			header(nullptr),
+			slots(nullptr),
+			results(nullptr),
+			parity(0),
+			queue(std::deque<Request>()),
+			busy(false),
+			stop(false)
+		{
+			void* memory = nullptr;
+
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			const auto segment = std::string("Local\\dnn-") + name;
+			handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(Size >> 32), static_cast<DWORD>(Size & 0xFFFFFFFFull), segment.c_str());
+			if (handle)
+				memory = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, Size);
+#else
+			const auto segment = std::string("/dnn-") + name;
+			if (Rank == 0)
+			{
+				// a segment left behind by a crashed run still holds its counters, rank 0 always starts from a new one
+				shm_unlink(segment.c_str());
+				handle = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+				if (handle >= 0 && ftruncate(handle, static_cast<off_t>(Size)) == 0)
+				{
+					memory = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+					if (memory == MAP_FAILED)
+						memory = nullptr;
+				}
+				if (memory)
+					static_cast<Header*>(memory)->Owner.store(static_cast<UInt>(getpid()), std::memory_order_release);
+			}
+			else
+			{
+				// the other ranks wait until rank 0 created the segment, a stale one has no living owner
+				for (auto attempt = 0; attempt < 600 && !memory; attempt++)
+				{
+					handle = shm_open(segment.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+					struct stat info;
+					if (handle >= 0 && fstat(handle, &info) == 0 && static_cast<UInt>(info.st_size) == Size)
+					{
+						memory = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+						if (memory == MAP_FAILED)
+							memory = nullptr;
+						else
+						{
+							const auto owner = static_cast<Header*>(memory)->Owner.load(std::memory_order_acquire);
+							if (owner == 0ull || (kill(static_cast<pid_t>(owner), 0) != 0 && errno != EPERM))
+							{
+								munmap(memory, Size);
+								memory = nullptr;
+							}
+						}
+					}
+
+					if (!memory)
+					{
+						if (handle >= 0)
+							close(handle);
+						std::this_thread::sleep_for(std::chrono::milliseconds(100));
+					}
+				}
+			}
+#endif
+			if (!memory)
+				throw std::runtime_error("Unable to map the shared memory segment " + segment);
+
+			// the mapping is zero filled when created, zero is a valid initial state for the atomics
+			header = static_cast<Header*>(memory);
+			slots = reinterpret_cast<Float*>(static_cast<Byte*>(memory) + HeaderSize);
+			results = slots + WorldSize * Capacity;
+
+			// a rank that never starts must not hang the others, the destructor does not run when the constructor throws
+			const auto deadline = std::chrono::steady_clock::now() + timeout;
+			header->Attached.fetch_add(1ull, std::memory_order_acq_rel);
+			while (header->Attached.load(std::memory_order_acquire) < WorldSize)
+			{
+				if (std::chrono::steady_clock::now() > deadline)
+				{
+					const auto attached = header->Attached.load(std::memory_order_acquire);
+					Unmap();
+					throw std::runtime_error("Only " + std::to_string(attached) + " of " + std::to_string(WorldSize) + " ranks attached to the shared memory segment " + segment);
+				}
+				std::this_thread::yield();
+			}
+
+			if (WorldSize > 1ull)
+				worker = std::thread([this] { Run(); });
+		}
+
+		~SharedMemoryCommunicator()
+		{
+			if (worker.joinable())
+			{
+				{
+					auto lock = std::lock_guard<std::mutex>(mutex);
+					stop = true;
+				}
+				condition.notify_one();
+				worker.join();
+			}
+
+			Unmap();
+		}
+
+		std::future<void> AllreduceAsync(const CommBuffers& buffers) final override
+		{
+			auto request = Request{ buffers, std::promise<void>() };
+			auto future = request.Done.get_future();
+
+			if (WorldSize == 1ull || TotalCount(buffers) == 0ull)
+			{
+				request.Done.set_value();
+				return future;
+			}
+
+			{
+				auto lock = std::lock_guard<std::mutex>(mutex);
+				queue.push_back(std::move(request));
+			}
+			condition.notify_one();
+
+			return future;
+		}
+
+		void Barrier() final override
+		{
+			Drain();
+			Synchronize();
+		}
+
+		void Allreduce(const CommBuffers& buffers) final override
+		{
+			if (WorldSize == 1ull)
+				return;
+
+			Drain();
+			Reduce(buffers);
+		}
+
+		void Broadcast(const CommBuffers& buffers) final override
+		{
+			if (WorldSize == 1ull)
+				return;
+
+			Drain();
+			const auto total = TotalCount(buffers);
+
+			for (auto offset = 0ull; offset < total; offset += Capacity)
+			{
+				const auto count = std::min<UInt>(Capacity, total - offset);
+				const auto result = results + parity * Capacity;
+				parity ^= 1ull;
+
+				if (Rank == 0)
+					CopyWindow(buffers, offset, count, result, false);
+				Synchronize();
+
+				if (Rank != 0)
+					CopyWindow(buffers, offset, count, result, true);
+				Synchronize();
+			}
+		}
+	};
+
+	// multi-node: the ranks form a ring of TCP connections (each one connects to the next rank and accepts the previous one),
+	// a background thread runs a bucketed ring allreduce (reduce-scatter and allgather in 2 * (WorldSize - 1) steps) on the queued
+	// gradients while the backward pass goes on, peers holds "host:port" for every rank
+	class TcpCommunicator final : public Communicator
+	{
+	private:
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+		typedef SOCKET Socket;
+		static constexpr auto InvalidSocket = INVALID_SOCKET;
+#else
+		typedef int Socket;
+		static constexpr auto InvalidSocket = -1;
+#endif
+		enum class Operations
+		{
+			Allreduce = 0,
+			Broadcast = 1
+		};
+
+		struct Request
+		{
+			Operations Operation;
+			CommBuffers Buffers;
+			UInt Count;
+			std::promise<void> Done;
+		};
+
+		const UInt BucketSize;
+		Socket next;
+		Socket prev;
+		std::deque<Request> queue;
+		UInt queuedCount;
+		bool flush;
+		bool stop;
+		std::mutex mutex;
+		std::condition_variable condition;
+		FloatVector bucket;
+		FloatVector chunk;
+		std::thread worker;
+
+		static void CloseSocket(Socket socket)
+		{
+			if (socket != InvalidSocket)
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+				closesocket(socket);
+#else
+				close(socket);
+#endif
+		}
+
+		static bool WouldBlock()
+		{
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+		}
+
+		static void Configure(Socket socket)
+		{
+			auto noDelay = 1;
+			setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			auto nonBlocking = u_long(1);
+			ioctlsocket(socket, FIONBIO, &nonBlocking);
+#else
+			fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+		}
+
+		static std::pair<std::string, std::string> SplitPeer(const std::string& peer)
+		{
+			const auto colon = peer.rfind(':');
+			if (colon == std::string::npos)
+				throw std::invalid_argument("Invalid peer " + peer + " in TcpCommunicator");
+
+			return { peer.substr(0, colon), peer.substr(colon + 1) };
+		}
+
+		static Socket Listen(const std::string& port)
+		{
+			addrinfo hints = {};
+			hints.ai_family = AF_INET;
+			hints.ai_socktype = SOCK_STREAM;
+			hints.ai_flags = AI_PASSIVE;
+
+			addrinfo* info = nullptr;
+			if (getaddrinfo(nullptr, port.c_str(), &hints, &info) != 0)
+				throw std::runtime_error("Unable to resolve port " + port + " in TcpCommunicator");
+
+			auto socket = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+			auto reuse = 1;
+			setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+			const auto bound = socket != InvalidSocket && bind(socket, info->ai_addr, static_cast<int>(info->ai_addrlen)) == 0 && listen(socket, 1) == 0;
+			freeaddrinfo(info);
+
+			if (!bound)
+			{
+				CloseSocket(socket);
+				throw std::runtime_error("Unable to listen on port " + port + " in TcpCommunicator");
+			}
+
+			return socket;
+		}
+
+		static Socket Connect(const std::string& host, const std::string& port)
+		{
+			addrinfo hints = {};
+			hints.ai_family = AF_INET;
+			hints.ai_socktype = SOCK_STREAM;
+
+			// the next rank may not be listening yet
+			for (auto attempt = 0; attempt < 600; attempt++)
+			{
+				addrinfo* info = nullptr;
+				if (getaddrinfo(host.c_str(), port.c_str(), &hints, &info) == 0)
+				{
+					auto socket = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+					const auto connected = socket != InvalidSocket && connect(socket, info->ai_addr, static_cast<int>(info->ai_addrlen)) == 0;
+					freeaddrinfo(info);
+
+					if (connected)
+						return socket;
+
+					CloseSocket(socket);
+				}
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+
+			throw std::runtime_error("Unable to connect to " + host + ":" + port + " in TcpCommunicator");
+		}
+
+		// sends and receives at the same time, otherwise every rank could block on a full send buffer
+		void SendRecv(const Float* sendData, const UInt sendCount, Float* recvData, const UInt recvCount)
+		{
+			const auto sendBytes = sendCount * sizeof(Float);
+			const auto recvBytes = recvCount * sizeof(Float);
+			const auto sendPtr = reinterpret_cast<const char*>(sendData);
+			const auto recvPtr = reinterpret_cast<char*>(recvData);
+			auto sent = 0ull;
+			auto received = 0ull;
+
+			while (sent < sendBytes || received < recvBytes)
+			{
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+				WSAPOLLFD fds[2] = { { next, POLLWRNORM, 0 }, { prev, POLLRDNORM, 0 } };
+				fds[0].events = sent < sendBytes ? POLLWRNORM : 0;
+				fds[1].events = received < recvBytes ? POLLRDNORM : 0;
+				if (WSAPoll(fds, 2, -1) < 0)
+					throw std::runtime_error("Poll failed in TcpCommunicator");
+				constexpr auto flags = 0;
+#else
+				pollfd fds[2] = { { next, POLLOUT, 0 }, { prev, POLLIN, 0 } };
+				fds[0].events = sent < sendBytes ? POLLOUT : 0;
+				fds[1].events = received < recvBytes ? POLLIN : 0;
+				if (poll(fds, 2, -1) < 0 && errno != EINTR)
+					throw std::runtime_error("Poll failed in TcpCommunicator");
+				constexpr auto flags = MSG_NOSIGNAL;
+#endif
+				if (sent < sendBytes && fds[0].revents != 0)
+				{
+					const auto bytes = send(next, sendPtr + sent, static_cast<int>(std::min<UInt>(sendBytes - sent, 1048576ull)), flags);
+					if (bytes > 0)
+						sent += static_cast<UInt>(bytes);
+					else if (!WouldBlock())
+						throw std::runtime_error("Send failed in TcpCommunicator");
+				}
+
+				if (received < recvBytes && fds[1].revents != 0)
+				{
+					const auto bytes = recv(prev, recvPtr + received, static_cast<int>(std::min<UInt>(recvBytes - received, 1048576ull)), 0);
+					if (bytes > 0)
+						received += static_cast<UInt>(bytes);
+					else if (bytes == 0 || !WouldBlock())
+						throw std::runtime_error("Receive failed in TcpCommunicator");
+				}
+			}
+		}
+
+		void RingAllreduce(Float* data, const UInt count)
+		{
+			const auto part = (count + WorldSize - 1ull) / WorldSize;
+			const auto begin = [&](const UInt index) { return std::min<UInt>(count, index * part); };
+			const auto size = [&](const UInt index) { return std::min<UInt>(count, (index + 1ull) * part) - begin(index); };
+
+			if (chunk.size() < part)
+				chunk.resize(part);
+
+			// reduce-scatter: after WorldSize - 1 steps rank r holds the complete sum of part (r + 1) % WorldSize
+			for (auto step = 0ull; step < WorldSize - 1ull; step++)
+			{
+				const auto sendIndex = (Rank + WorldSize - step) % WorldSize;
+				const auto recvIndex = (Rank + WorldSize - step - 1ull) % WorldSize;
+
+				SendRecv(data + begin(sendIndex), size(sendIndex), chunk.data(), size(recvIndex));
+
+				const auto dst = data + begin(recvIndex);
+				PRAGMA_OMP_SIMD()
+				for (auto i = 0ull; i < size(recvIndex); i++)
+					dst[i] += chunk[i];
+			}
+
+			// allgather
+			for (auto step = 0ull; step < WorldSize - 1ull; step++)
+			{
+				const auto sendIndex = (Rank + 1ull + WorldSize - step) % WorldSize;
+				const auto recvIndex = (Rank + WorldSize - step) % WorldSize;
+
+				SendRecv(data + begin(sendIndex), size(sendIndex), data + begin(recvIndex), size(recvIndex));
+			}
+
+			const auto scale = Float(1) / Float(WorldSize);
+			PRAGMA_OMP_SIMD()
+			for (auto i = 0ull; i < count; i++)
+				data[i] *= scale;
+		}
+
+		void RingBroadcast(Float* data, const UInt count)
+		{
+			const auto last = (Rank + 1ull) % WorldSize == 0ull;
+
+			if (Rank != 0ull)
+				SendRecv(nullptr, 0ull, data, count);
+			if (!last)
+				SendRecv(data, count, nullptr, 0ull);
+		}
+
+		// the buckets only depend on the order and sizes of the requests, so all ranks cut them the same way
+		void Run()
+		{
+			while (true)
+			{
+				auto requests = std::vector<Request>();
+				{
+					auto lock = std::unique_lock<std::mutex>(mutex);
+					condition.wait(lock, [this] { return stop || queuedCount >= BucketSize || (flush && !queue.empty()); });
+
+					if (stop && queue.empty())
+						return;
+
+					auto count = 0ull;
+					const auto operation = queue.front().Operation;
+					while (!queue.empty() && count < BucketSize && queue.front().Operation == operation)
+					{
+						count += queue.front().Count;
+						requests.push_back(std::move(queue.front()));
+						queue.pop_front();
+					}
+					queuedCount -= count;
+
+					if (queue.empty())
+						flush = false;
+				}
+
+				auto count = 0ull;
+				auto buffers = CommBuffers();
+				for (const auto& request : requests)
+				{
+					buffers.insert(buffers.end(), request.Buffers.begin(), request.Buffers.end());
+					count += request.Count;
+				}
+
+				if (bucket.size() < count)
+					bucket.resize(count);
+
+				try
+				{
+					CopyWindow(buffers, 0ull, count, bucket.data(), false);
+					if (requests.front().Operation == Operations::Allreduce)
+						RingAllreduce(bucket.data(), count);
+					else
+						RingBroadcast(bucket.data(), count);
+					CopyWindow(buffers, 0ull, count, bucket.data(), true);
+
+					for (auto& request : requests)
+						request.Done.set_value();
+				}
+				catch (...)
+				{
+					// the waiting training loop rethrows on get()
+					for (auto& request : requests)
+						request.Done.set_exception(std::current_exception());
+				}
+			}
+		}
+
+		std::future<void> Enqueue(const Operations operation, const CommBuffers& buffers)
+		{
+			auto request = Request{ operation, buffers, TotalCount(buffers), std::promise<void>() };
+			auto future = request.Done.get_future();
+
+			if (request.Count == 0ull || WorldSize == 1ull)
+			{
+				request.Done.set_value();
+				return future;
+			}
+
+			{
+				auto lock = std::lock_guard<std::mutex>(mutex);
+				queuedCount += request.Count;
+				queue.push_back(std::move(request));
+			}
+			condition.notify_one();
+
+			return future;
+		}
+
+	public:
+		TcpCommunicator(const std::vector<std::string>& peers, const UInt rank, const UInt bucketSize = 1048576ull) :
+			Communicator(rank, peers.size()),
+			BucketSize(bucketSize),
+			next(InvalidSocket),
+			prev(InvalidSocket),
+			queue(std::deque<Request>()),
+			queuedCount(0),
+			flush(false),
+			stop(false),
+			bucket(FloatVector()),
+			chunk(FloatVector())
+		{
+			if (WorldSize > 1ull)
+			{
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+				WSADATA data;
+				WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+				const auto [host, port] = SplitPeer(peers[Rank]);
+				const auto [nextHost, nextPort] = SplitPeer(peers[(Rank + 1ull) % WorldSize]);
+
+				// the destructor does not run when the constructor throws
+				auto listener = Listen(port);
+				try
+				{
+					next = Connect(nextHost, nextPort);
+				}
+				catch (...)
+				{
+					CloseSocket(listener);
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+					WSACleanup();
+#endif
+					throw;
+				}
+				prev = accept(listener, nullptr, nullptr);
+				CloseSocket(listener);
+
+				if (prev == InvalidSocket)
+				{
+					CloseSocket(next);
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+					WSACleanup();
+#endif
+					throw std::runtime_error("Unable to accept rank " + std::to_string((Rank + WorldSize - 1ull) % WorldSize) + " in TcpCommunicator");
+				}
+
+				Configure(next);
+				Configure(prev);
+
+				worker = std::thread([this] { Run(); });
+			}
+		}
+
+		~TcpCommunicator()
+		{
+			if (worker.joinable())
+			{
+				{
+					auto lock = std::lock_guard<std::mutex>(mutex);
+					stop = true;
+					flush = true;
+				}
+				condition.notify_one();
+				worker.join();
+			}
+
+			CloseSocket(next);
+			CloseSocket(prev);
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			if (WorldSize > 1ull)
+				WSACleanup();
+#endif
+		}
+
+		std::future<void> AllreduceAsync(const CommBuffers& buffers) final override
+		{
+			return Enqueue(Operations::Allreduce, buffers);
+		}
+
+		void Flush() final override
+		{
+			{
+				auto lock = std::lock_guard<std::mutex>(mutex);
+				flush = true;
+			}
+			condition.notify_one();
+		}
+
+		void Allreduce(const CommBuffers& buffers) final override
+		{
+			auto done = AllreduceAsync(buffers);
+			Flush();
+			done.get();
+		}
+
+		void Broadcast(const CommBuffers& buffers) final override
+		{
+			auto done = Enqueue(Operations::Broadcast, buffers);
+			Flush();
+			done.get();
+		}
+
+		void Barrier() final override
+		{
+			auto token = Float(0);
+			Allreduce({ { &token, 1ull } });
+		}
+	};
+}
@@ -50,6 +50,16 @@ namespace dnn
 			return 1;
 		}
 
+		bool AcceptsViews() const final override
+		{
+			return true;
+		}
+
+		bool OverwritesInputGradient(const Layer* inputLayer) const final override
+		{
+			return !Fused;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (InputLayer->DstMemDesc->get_ndims() == 2)
@@ -84,7 +94,14 @@ namespace dnn
 			srcsMemsDesc = std::vector<dnnl::memory::desc>();
 			for (auto i = 0ull; i < Inputs.size(); i++)
 			{
-				if (Inputs[i]->DstMemDesc->get_ndims() == 2)
+				if (Inputs[i]->View)
+				{
+					auto dims = Inputs[i]->DstMemDesc->get_dims();
+					auto offsets = dnnl::memory::dims(dims.size(), 0);
+					offsets[1] = dnnl::memory::dim(Inputs[i]->StorageChannel());
+					srcsMemsDesc.push_back(Inputs[i]->Storage()->DstMemDesc->submemory_desc(dims, offsets));
+				}
+				else if (Inputs[i]->DstMemDesc->get_ndims() == 2)
 					srcsMemsDesc.push_back(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(batchSize), dnnl::memory::dim(Inputs[i]->C) }), dnnl::memory::data_type::f32, ChosenFormat));
 				else
 					srcsMemsDesc.push_back(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(batchSize), dnnl::memory::dim(Inputs[i]->C), dnnl::memory::dim(Inputs[i]->H), dnnl::memory::dim(Inputs[i]->W) }), dnnl::memory::data_type::f32, ChosenFormat));
@@ -94,7 +111,7 @@ namespace dnn
 
 			fwdArgs = std::unordered_map<int, dnnl::memory>{ { DNNL_ARG_DST, dnnl::memory(*DstMemDesc, Device.engine, Neurons.data()) } };
 			for (auto i = 0ull; i < InputsFwd.size(); i++)
-				fwdArgs.insert({ DNNL_ARG_MULTIPLE_SRC + int(i), dnnl::memory(srcsMemsDesc[i], Device.engine, Inputs[i]->Neurons.data())});
+				fwdArgs.insert({ DNNL_ARG_MULTIPLE_SRC + int(i), dnnl::memory(srcsMemsDesc[i], Device.engine, Inputs[i]->Storage()->Neurons.data())});
 
 #ifdef DNN_CACHE_PRIMITIVES
 			fwd = std::make_unique<dnnl::concat>(dnnl::concat(*fwdDesc));
@@ -103,6 +120,9 @@ namespace dnn
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
+			if (Fused)
+				return;
+
 			if (training)
 			{
 #ifdef DNN_LEAN
@@ -132,16 +152,19 @@ namespace dnn
 							UInt inputIndex, outputIndex;
 							for (auto inputLayer = 0ull; inputLayer < Inputs.size(); inputLayer++)
 							{
+								const auto input = Inputs[inputLayer]->Storage();
+								const auto inputChannel = Inputs[inputLayer]->StorageChannel();
 								for (auto c = channelOffset; c < channelOffset + Inputs[inputLayer]->PaddedC; c += VectorSize)
 								{
-									inputIndex = (c - channelOffset) * HW();
+									inputIndex = (c - channelOffset + inputChannel) * HW();
 									outputIndex = c * HW();
 									for (auto w = 0ull; w < strideHW; w += VectorSize)
 									{
-										In.load_a(&Inputs[inputLayer]->Neurons[w + inputIndex]);
+										In.load_a(&input->Neurons[w + inputIndex]);
 										In.store_a(&Neurons[w + outputIndex]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[w + outputIndex]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[w + outputIndex]);
 #endif
 									}
 								}
@@ -154,16 +177,19 @@ namespace dnn
 							UInt inputIndex, outputIndex;
 							for (auto inputLayer = 0ull; inputLayer < Inputs.size(); inputLayer++)
 							{
+								const auto input = Inputs[inputLayer]->Storage();
+								const auto inputChannel = Inputs[inputLayer]->StorageChannel();
 								for (auto c = channelOffset; c < channelOffset + Inputs[inputLayer]->C; c++)
 								{
-									inputIndex = (c - channelOffset) * HW();
+									inputIndex = (c - channelOffset + inputChannel) * HW();
 									outputIndex = c * HW();
 									PRAGMA_OMP_SIMD()
 										for (auto hw = 0ull; hw < HW(); hw++)
 										{
-											Neurons[outputIndex + hw] = Inputs[inputLayer]->Neurons[inputIndex + hw];
+											Neurons[outputIndex + hw] = input->Neurons[inputIndex + hw];
 #ifndef DNN_LEAN
-											NeuronsD1[outputIndex + hw] = Float(0);
+											if (!GradientOverwritten)
+												NeuronsD1[outputIndex + hw] = Float(0);
 #endif
 										}
 								}
@@ -183,17 +209,20 @@ namespace dnn
 								VecFloat In;
 								for (auto inputLayer = 0ull; inputLayer < Inputs.size(); inputLayer++)
 								{
-									const auto inputSampleOffset = n * Inputs[inputLayer]->PaddedCDHW();
+									const auto input = Inputs[inputLayer]->Storage();
+									const auto inputChannel = Inputs[inputLayer]->StorageChannel();
+									const auto inputSampleOffset = n * input->PaddedCDHW();
 									for (auto c = channelOffset; c < channelOffset + Inputs[inputLayer]->PaddedC; c += VectorSize)
 									{
-										inputIndex = ((c - channelOffset) * HW()) + inputSampleOffset;
+										inputIndex = ((c - channelOffset + inputChannel) * HW()) + inputSampleOffset;
 										outputIndex = (c * HW()) + outputSampleOffset;
 										for (auto w = 0ull; w < strideHW; w += VectorSize)
 										{
-											In.load_a(&Inputs[inputLayer]->Neurons[w + inputIndex]);
+											In.load_a(&input->Neurons[w + inputIndex]);
 											In.store_a(&Neurons[w + outputIndex]);
 #ifndef DNN_LEAN
-											VecFloat(0).store_nt(&NeuronsD1[w + outputIndex]);
+											if (!GradientOverwritten)
+												VecFloat(0).store_nt(&NeuronsD1[w + outputIndex]);
 #endif
 										}
 									}
@@ -208,17 +237,20 @@ namespace dnn
 								UInt inputIndex, outputIndex;
 								for (auto inputLayer = 0ull; inputLayer < Inputs.size(); inputLayer++)
 								{
-									const auto inputSampleOffset = n * Inputs[inputLayer]->CDHW();
+									const auto input = Inputs[inputLayer]->Storage();
+									const auto inputChannel = Inputs[inputLayer]->StorageChannel();
+									const auto inputSampleOffset = n * input->CDHW();
 									for (auto c = channelOffset; c < channelOffset + Inputs[inputLayer]->C; c++)
 									{
-										inputIndex = ((c - channelOffset) * HW()) + inputSampleOffset;
+										inputIndex = ((c - channelOffset + inputChannel) * HW()) + inputSampleOffset;
 										outputIndex = (c * HW()) + outputSampleOffset;
 										PRAGMA_OMP_SIMD()
 										for (auto hw = 0ull; hw < HW(); hw++)
 										{
-											Neurons[outputIndex + hw] = Inputs[inputLayer]->Neurons[inputIndex + hw];
+											Neurons[outputIndex + hw] = input->Neurons[inputIndex + hw];
 #ifndef DNN_LEAN
-											NeuronsD1[outputIndex + hw] = Float(0);
+											if (!GradientOverwritten)
+												NeuronsD1[outputIndex + hw] = Float(0);
 #endif
 										}
 									}
@@ -238,7 +270,8 @@ namespace dnn
 #endif
 					Device.stream.wait();
 
-					InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
+					if (!GradientOverwritten)
+						InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 				}
 #endif
 			}
@@ -255,8 +288,15 @@ namespace dnn
 
 		void BackwardProp(const UInt batchSize) final override
 		{
+			if (Fused)
+				return;
+
 #ifdef DNN_LEAN
-			ZeroGradientMulti(batchSize);
+			for (auto& inputLayer : Inputs)
+			{
+				auto input = inputLayer->Storage();
+				input->NeuronsD1.resize(batchSize, input->C, input->H, input->W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine, Float(0), !input->GradientOverwritten);
+			}
 #endif // DNN_LEAN
 
 			const auto plain = IsPlainFormat();
@@ -273,16 +313,19 @@ namespace dnn
 					VecFloat inputD1, D1;
 					for (auto inputLayer = 0ull; inputLayer < Inputs.size(); inputLayer++)
 					{
+						const auto input = Inputs[inputLayer]->Storage();
+						const auto inputChannel = Inputs[inputLayer]->StorageChannel();
+						const auto overwrite = OverwritesInput(inputLayer);
 						for (auto c = channelOffset; c < channelOffset + Inputs[inputLayer]->PaddedC; c += VectorSize)
 						{
-							inputIndex = ((c - channelOffset) * HW());
+							inputIndex = ((c - channelOffset + inputChannel) * HW());
 							outputIndex = (c * HW());
 							for (auto w = 0ull; w < strideH; w += VectorSize)
 							{
-								inputD1.load_a(&Inputs[inputLayer]->NeuronsD1[w + inputIndex]);
+								inputD1 = overwrite ? VecFloat(0) : VecFloat().load_a(&input->NeuronsD1[w + inputIndex]);
 								D1.load_a(&NeuronsD1[w + outputIndex]);
 								inputD1 += D1;
-								inputD1.store_a(&Inputs[inputLayer]->NeuronsD1[w + inputIndex]);
+								inputD1.store_a(&input->NeuronsD1[w + inputIndex]);
 							}
 						}									
 						channelOffset += Inputs[inputLayer]->PaddedC;
@@ -294,13 +337,16 @@ namespace dnn
 					UInt inputIndex, outputIndex;
 					for (auto inputLayer = 0ull; inputLayer < Inputs.size(); inputLayer++)
 					{
+						const auto input = Inputs[inputLayer]->Storage();
+						const auto inputChannel = Inputs[inputLayer]->StorageChannel();
+						const auto overwrite = OverwritesInput(inputLayer);
 						for (auto c = channelOffset; c < channelOffset + Inputs[inputLayer]->C; c++)
 						{
-							inputIndex = ((c - channelOffset) * HW());
+							inputIndex = ((c - channelOffset + inputChannel) * HW());
 							outputIndex = (c * HW());
 							PRAGMA_OMP_SIMD()
 							for (auto hw = 0ull; hw < HW(); hw++)
-								Inputs[inputLayer]->NeuronsD1[inputIndex + hw] += NeuronsD1[outputIndex + hw];
+								input->NeuronsD1[inputIndex + hw] = (overwrite ? Float(0) : input->NeuronsD1[inputIndex + hw]) + NeuronsD1[outputIndex + hw];
 						}
 						channelOffset += Inputs[inputLayer]->C;
 					}
@@ -320,17 +366,20 @@ namespace dnn
 						VecFloat inputD1, D1;
 						for (auto inputLayer = 0ull; inputLayer < Inputs.size(); inputLayer++)
 						{
-							const auto inputSampleOffset = n * Inputs[inputLayer]->PaddedCDHW();
+							const auto input = Inputs[inputLayer]->Storage();
+							const auto inputChannel = Inputs[inputLayer]->StorageChannel();
+							const auto overwrite = OverwritesInput(inputLayer);
+							const auto inputSampleOffset = n * input->PaddedCDHW();
 							for (auto c = channelOffset; c < channelOffset + Inputs[inputLayer]->PaddedC; c += VectorSize)
 							{
-							    inputIndex = ((c - channelOffset) * HW()) + inputSampleOffset;
+							    inputIndex = ((c - channelOffset + inputChannel) * HW()) + inputSampleOffset;
 								outputIndex = (c * HW()) + outputSampleOffset;
 								for (auto w = 0ull; w < strideH; w += VectorSize)
 								{
-									inputD1.load_a(&Inputs[inputLayer]->NeuronsD1[w + inputIndex]);
+									inputD1 = overwrite ? VecFloat(0) : VecFloat().load_a(&input->NeuronsD1[w + inputIndex]);
 									D1.load_a(&NeuronsD1[w + outputIndex]);
 									inputD1 += D1;
-									inputD1.store_a(&Inputs[inputLayer]->NeuronsD1[w + inputIndex]);
+									inputD1.store_a(&input->NeuronsD1[w + inputIndex]);
 								}
 							}
 							channelOffset += Inputs[inputLayer]->PaddedC;
@@ -345,14 +394,17 @@ namespace dnn
 						UInt inputIndex, outputIndex;
 						for (auto inputLayer = 0ull; inputLayer < Inputs.size(); inputLayer++)
 						{
-							const auto inputSampleOffset = n * Inputs[inputLayer]->CDHW();
+							const auto input = Inputs[inputLayer]->Storage();
+							const auto inputChannel = Inputs[inputLayer]->StorageChannel();
+							const auto overwrite = OverwritesInput(inputLayer);
+							const auto inputSampleOffset = n * input->CDHW();
 							for (auto c = channelOffset; c < channelOffset + Inputs[inputLayer]->C; c++)
 							{
-								inputIndex = ((c - channelOffset) * HW()) + inputSampleOffset;
+								inputIndex = ((c - channelOffset + inputChannel) * HW()) + inputSampleOffset;
 								outputIndex = (c * HW()) + outputSampleOffset;
 								PRAGMA_OMP_SIMD()
 								for (auto hw = 0ull; hw < HW(); hw++)
-									Inputs[inputLayer]->NeuronsD1[inputIndex + hw] += NeuronsD1[outputIndex + hw];
+									input->NeuronsD1[inputIndex + hw] = (overwrite ? Float(0) : input->NeuronsD1[inputIndex + hw]) + NeuronsD1[outputIndex + hw];
 							}
 							channelOffset += Inputs[inputLayer]->C;
 						}
@@ -10,11 +10,16 @@ namespace dnn
 		std::unique_ptr<dnnl::convolution_backward_weights::primitive_desc> bwdWeightsDesc;
 		std::unique_ptr<dnnl::convolution_backward_data::primitive_desc> bwdDataDesc;
 		std::unique_ptr<dnnl::binary::primitive_desc> bwdAddDesc;
+		std::unique_ptr<dnnl::convolution_forward::primitive_desc> fwdQuantDesc;
+		dnnl::memory weightsQuantMem;
+		dnnl::memory srcScaleMem;
+		dnnl::memory weightsScalesMem;
 #ifdef DNN_CACHE_PRIMITIVES
 		std::unique_ptr<dnnl::convolution_forward> fwd;
 		std::unique_ptr<dnnl::convolution_backward_weights> bwdWeights;
 		std::unique_ptr<dnnl::convolution_backward_data> bwdData;
 		std::unique_ptr<dnnl::binary> bwdAdd;
+		std::unique_ptr<dnnl::convolution_forward> fwdQuant;
 #endif
 		bool reorderFwdSrc;
 		bool reorderBwdSrc;
@@ -22,6 +27,7 @@ namespace dnn
 		bool reorderBwdDiffDst;
 		bool reorderBwdWeights;
 		bool reorderBwdDiffWeights;
+		std::unordered_map<int, dnnl::memory> inferenceArgs;
 		
 	public:
 		const UInt Groups;
@@ -115,6 +121,11 @@ namespace dnn
 			return C / Groups * KernelH * KernelW / StrideH * StrideW;
 		}
 
+		bool OverwritesGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			std::vector<dnnl::memory::desc> memDesc;
@@ -150,7 +161,7 @@ namespace dnn
 
 			if (*WeightsMemDesc != fwdDesc->weights_desc())
 			{
-				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
 
 				auto weights = FloatVector(fwdDesc->weights_desc().get_size() / sizeof(Float));
 				auto weightsMem = dnnl::memory(fwdDesc->weights_desc(), Device.engine, weights.data());
@@ -160,6 +171,7 @@ namespace dnn
 				
 				Weights = weights;
 				WeightsMemDesc = std::make_unique<dnnl::memory::desc>(fwdDesc->weights_desc());
+				WeightsChanged();
 			}
 
 			DstMemDesc = std::make_unique<dnnl::memory::desc>(fwdDesc->dst_desc());
@@ -167,6 +179,7 @@ namespace dnn
 
 			ChosenFormat = GetDataFmt(*DstMemDesc);
 
+			inferenceArgs.clear();
 			reorderFwdSrc = fwdDesc->src_desc() != *InputLayer->DstMemDesc;
 			reorderBwdSrc = bwdWeightsDesc->src_desc() != *InputLayer->DstMemDesc;
 			reorderBwdDiffWeights = bwdWeightsDesc->diff_weights_desc() != *WeightsMemDesc;
@@ -179,12 +192,102 @@ namespace dnn
 			bwdWeights = std::make_unique<dnnl::convolution_backward_weights>(dnnl::convolution_backward_weights(*bwdWeightsDesc));
 			bwdData = std::make_unique<dnnl::convolution_backward_data>(dnnl::convolution_backward_data(*bwdDataDesc));
 			bwdAdd = std::make_unique<dnnl::binary>(dnnl::binary(*bwdAddDesc));
+#endif
+			if (Quantized)
+				InitializeQuantized(batchSize);
+		}
+
+		// latency mode: bind src, weights, bias and dst once so that ForwardProp only executes the primitive
+		void BindInference() final override
+		{
+			inferenceArgs.clear();
+			if (reorderFwdSrc || Quantized || InputLayer->Neurons.empty() || Neurons.empty())
+				return;
+
+			inferenceArgs = std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, dnnl::memory(*InputLayer->DstMemDesc, Device.engine, InputLayer->Neurons.data())}, { DNNL_ARG_WEIGHTS, dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData()) }, { DNNL_ARG_DST, dnnl::memory(*DstMemDesc, Device.engine, Neurons.data()) } };
+			if (HasBias)
+				inferenceArgs.insert({ DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, BiasesData()) });
+		}
+
+		bool Quantizable() const final override
+		{
+			return true;
+		}
+
+		void Quantize(const bool enable) final override
+		{
+			Quantized = enable && QuantSrcMin <= QuantSrcMax && DstMemDesc;
+			
+			if (Quantized)
+				InitializeQuantized(UInt(DstMemDesc->get_dims()[0]));
+			else
+			{
+				fwdQuantDesc.reset();
+				weightsQuantMem = dnnl::memory();
+				ReleaseQuantizeSrc();
+#ifdef DNN_CACHE_PRIMITIVES
+				fwdQuant.reset();
+#endif
+			}
+		}
+
+		void InitializeQuantized(const UInt batchSize)
+		{
+			auto attr = dnnl::primitive_attr();
+			attr.set_scales_mask(DNNL_ARG_SRC, 0);
+			attr.set_scales_mask(DNNL_ARG_WEIGHTS, Groups > 1 ? 3 : 1);
+
+			const auto srcDesc = dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(batchSize), dnnl::memory::dim(InputLayer->C), dnnl::memory::dim(InputLayer->H), dnnl::memory::dim(InputLayer->W) }), QuantSrcDataType(), dnnl::memory::format_tag::any);
+			const auto weightsDesc = dnnl::memory::desc(WeightsMemDesc->get_dims(), dnnl::memory::data_type::s8, dnnl::memory::format_tag::any);
+			const auto biasDesc = dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(C) }), dnnl::memory::data_type::f32, dnnl::memory::format_tag::x);
+
+			fwdQuantDesc = std::make_unique<dnnl::convolution_forward::primitive_desc>(HasBias ?
+				dnnl::convolution_forward::primitive_desc(Device.engine, dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_auto, srcDesc, weightsDesc, biasDesc, *DstMemDesc, Strides, Dilates, Padding, Padding, attr) :
+				dnnl::convolution_forward::primitive_desc(Device.engine, dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_auto, srcDesc, weightsDesc, *DstMemDesc, Strides, Dilates, Padding, Padding, attr));
+
+			weightsQuantMem = QuantizeWeights(fwdQuantDesc->weights_desc());
+			srcScaleMem = GetScalesMemory(FloatVector(1, QuantSrcScale()));
+			weightsScalesMem = GetScalesMemory(QuantWeightsScales);
+			InitializeQuantizeSrc(fwdQuantDesc->src_desc());
+
+#ifdef DNN_CACHE_PRIMITIVES
+			fwdQuant = std::make_unique<dnnl::convolution_forward>(dnnl::convolution_forward(*fwdQuantDesc));
 #endif
 		}
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
-		{	
-			auto memSrc = dnnl::memory(*InputLayer->DstMemDesc, Device.engine, InputLayer->Neurons.data());
+		{
+			if (Quantized && !training)
+			{
+				auto memSrc = dnnl::memory(*InputLayer->DstMemDesc, Device.engine, InputLayer->Neurons.data());
+				auto srcMem = QuantizeSrc(memSrc, srcScaleMem);
+				auto args = std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsQuantMem }, { DNNL_ARG_DST, dnnl::memory(*DstMemDesc, Device.engine, Neurons.data()) }, { DNNL_ARG_ATTR_SCALES | DNNL_ARG_SRC, srcScaleMem }, { DNNL_ARG_ATTR_SCALES | DNNL_ARG_WEIGHTS, weightsScalesMem } };
+				if (HasBias)
+					args.insert({ DNNL_ARG_BIAS, dnnl::memory(fwdQuantDesc->bias_desc(), Device.engine, BiasesData()) });
+#ifdef DNN_CACHE_PRIMITIVES
+				fwdQuant->execute(Device.stream, args);
+#else
+				dnnl::convolution_forward(*fwdQuantDesc).execute(Device.stream, args);
+#endif
+				Device.stream.wait();
+				
+				return;
+			}
+
+			if (!training && !inferenceArgs.empty())
+			{
+#ifdef DNN_CACHE_PRIMITIVES
+				fwd->execute(Device.stream, inferenceArgs);
+#else
+				dnnl::convolution_forward(*fwdDesc).execute(Device.stream, inferenceArgs);
+#endif
+				Device.stream.wait();
+
+				return;
+			}
+
+			const auto fakeQuant = FakeQuantization && training;
+			auto memSrc = dnnl::memory(*InputLayer->DstMemDesc, Device.engine, fakeQuant ? FakeQuantizeSrc(batchSize) : InputLayer->Neurons.data());
 			auto srcMem = reorderFwdSrc ? dnnl::memory(fwdDesc->src_desc(), Device.engine) : memSrc;
 			if (reorderFwdSrc)
 			{
@@ -192,20 +295,20 @@ namespace dnn
 				Device.stream.wait();
 			}
 
-			auto weightsMem = dnnl::memory(fwdDesc->weights_desc(), Device.engine, Weights.data());
+			auto weightsMem = dnnl::memory(fwdDesc->weights_desc(), Device.engine, fakeQuant ? FakeQuantizeWeights() : WeightsData());
 			auto dstMem = dnnl::memory(*DstMemDesc, Device.engine, Neurons.data());
 
 #ifdef DNN_CACHE_PRIMITIVES
-			HasBias ? fwd->execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, Biases.data()) }, { DNNL_ARG_DST, dstMem } }) :
+			HasBias ? fwd->execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, BiasesData()) }, { DNNL_ARG_DST, dstMem } }) :
 				fwd->execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_DST, dstMem } });
 #else
-			HasBias ? dnnl::convolution_forward(*fwdDesc).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, Biases.data()) }, { DNNL_ARG_DST, dstMem } }) :
+			HasBias ? dnnl::convolution_forward(*fwdDesc).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, BiasesData()) }, { DNNL_ARG_DST, dstMem } }) :
 				dnnl::convolution_forward(*fwdDesc).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_DST, dstMem } });
 #endif
 			Device.stream.wait();
 
 #ifndef DNN_LEAN
-			if (training)
+			if (training && !GradientOverwritten)
 				InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 #else
 			DNN_UNREF_PAR(batchSize);
@@ -228,7 +331,7 @@ namespace dnn
 				Device.stream.wait();
 			}
 
-			auto memSrc = dnnl::memory(*InputLayerFwd->DstMemDesc, Device.engine, InputLayerFwd->Neurons.data());
+			auto memSrc = dnnl::memory(*InputLayerFwd->DstMemDesc, Device.engine, FakeQuantization ? InputFakeQuant.data() : InputLayerFwd->Neurons.data());
 			auto srcMem = reorderBwdSrc ? dnnl::memory(bwdWeightsDesc->src_desc(), Device.engine) : memSrc;
 			if (reorderBwdSrc)
 			{
@@ -256,7 +359,7 @@ namespace dnn
 				Device.stream.wait();
 			}
 
-			auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+			auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, FakeQuantization ? WeightsFakeQuant.data() : WeightsData());
 			auto weightsMem = reorderBwdWeights ? dnnl::memory(bwdDataDesc->weights_desc(), Device.engine) : memWeights;
 			if (reorderBwdWeights)
 			{
@@ -305,7 +408,7 @@ namespace dnn
 			{
 				weights = FloatVector(WeightsMemDesc->get_size() / sizeof(Float));
 
-				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
 				auto weightsMem = dnnl::memory(*PersistWeightsMemDesc, Device.engine, weights.data());
 
 				dnnl::reorder(memWeights, weightsMem).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memWeights}, { DNNL_ARG_TO, weightsMem } });
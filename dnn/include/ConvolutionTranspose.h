@@ -100,6 +100,11 @@ namespace dnn
 			return C * (KernelH * StrideW) * (KernelH * StrideW);
 		}
 
+		bool OverwritesGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			std::vector<dnnl::memory::desc> memDesc = std::vector<dnnl::memory::desc>({
@@ -123,7 +128,7 @@ namespace dnn
 			if (*WeightsMemDesc != fwdDesc->weights_desc())
 			{
 				auto weights = FloatVector(fwdDesc->weights_desc().get_size() / sizeof(Float));
-				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
 				auto weightsMem = dnnl::memory(fwdDesc->weights_desc(), Device.engine, weights.data());
 
 				dnnl::reorder(memWeights, weightsMem).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memWeights}, { DNNL_ARG_TO, weightsMem } });
@@ -131,6 +136,7 @@ namespace dnn
 
 				Weights = weights;
 				WeightsMemDesc = std::make_unique<dnnl::memory::desc>(fwdDesc->weights_desc());
+				WeightsChanged();
 			}
 
 			DstMemDesc = std::make_unique<dnnl::memory::desc>(fwdDesc->dst_desc());
@@ -163,24 +169,24 @@ namespace dnn
 				Device.stream.wait();
 			}
 
-			auto weightsMem = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+			auto weightsMem = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
 
 			auto dstMem = dnnl::memory(*DstMemDesc, Device.engine, Neurons.data());
 
 #ifdef DNN_CACHE_PRIMITIVES
 			HasBias ?
-				fwd->execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, Biases.data()) }, { DNNL_ARG_DST, dstMem } }) :
+				fwd->execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, BiasesData()) }, { DNNL_ARG_DST, dstMem } }) :
 				fwd->execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_DST, dstMem } });
 #else
 			HasBias ?
-				dnnl::deconvolution_forward(*fwdDesc).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, Biases.data()) }, { DNNL_ARG_DST, dstMem } }) :
+				dnnl::deconvolution_forward(*fwdDesc).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, BiasesData()) }, { DNNL_ARG_DST, dstMem } }) :
 				dnnl::deconvolution_forward(*fwdDesc).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_DST, dstMem } });
 #endif
 
 			Device.stream.wait();
 
 #ifndef DNN_LEAN
-			if (training)
+			if (training && !GradientOverwritten)
 				InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 #else
 			DNN_UNREF_PAR(batchSize);
@@ -231,7 +237,7 @@ namespace dnn
 				Device.stream.wait();
 			}
 
-			auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+			auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
 			auto weightsMem = reorderBwdWeights ? dnnl::memory(bwdDataDesc->weights_desc(), Device.engine) : memWeights;
 			if (reorderBwdWeights)
 			{
@@ -280,7 +286,7 @@ namespace dnn
 			{
 				weights = FloatVector(WeightsMemDesc->get_size() / sizeof(Float));
 
-				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
 				auto weightsMem = dnnl::memory(*PersistWeightsMemDesc, Device.engine, weights.data());
 
 				dnnl::reorder(memWeights, weightsMem).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memWeights}, { DNNL_ARG_TO, weightsMem } });
@@ -1,5 +1,6 @@
 #pragma once
 #include "Layer.h"
+#include "TeacherLogits.h"
 
 namespace dnn
 {
@@ -10,7 +11,8 @@ namespace dnn
 		MeanAbsoluteEpsError = 2,
 		MeanAbsoluteError = 3,
 		MeanSquaredError = 4,
-		SmoothHinge = 5
+		SmoothHinge = 5,
+		Distillation = 6
 	};
 
 	class Cost : public Layer
@@ -18,7 +20,195 @@ namespace dnn
 	private:
 		std::vector<LabelInfo> sampleLabel;
 		std::vector<std::vector<LabelInfo>> sampleLabels;
-		
+		const TeacherLogits* teacherLogits;
+		std::vector<TeacherView> teacherViews;
+		FloatVector distillationRows;	// batchSize x 4 x C, the teacher, student, hard and mix targets of every row
+
+		inline const LabelInfo& GetLabel(const UInt n, const UInt batchSize) const
+		{
+#ifdef DNN_STOCHASTIC
+			if (batchSize == 1)
+				return sampleLabel[LabelIndex];
+#else
+			DNN_UNREF_PAR(batchSize);
+#endif
+			return sampleLabels[n][LabelIndex];
+		}
+
+		static void SoftmaxTemperature(const Float* logits, const UInt C, const Float temperature, Float* probabilities)
+		{
+			auto max = std::numeric_limits<Float>::lowest();
+			for (auto c = 0ull; c < C; c++)
+				max = std::max(max, logits[c]);
+
+			auto sum = Float(0);
+			for (auto c = 0ull; c < C; c++)
+			{
+				probabilities[c] = std::exp((logits[c] - max) / temperature);
+				sum += probabilities[c];
+			}
+
+			for (auto c = 0ull; c < C; c++)
+				probabilities[c] /= sum;
+		}
+
+		// soft teacher targets of row n at the temperature, CutMix rows blend both samples like their labels (mix holds C values of scratch)
+		void TeacherTargets(const UInt n, const UInt batchSize, Float* targets, Float* mix) const
+		{
+			const auto& view = teacherViews[n];
+			const auto lambda = GetLabel(n, batchSize).Lambda;
+
+			SoftmaxTemperature(teacherLogits->Get(view.Sample, view.Mirrored), C, Temperature, targets);
+
+			if (lambda != Float(1) && view.SampleMix != view.Sample)
+			{
+				SoftmaxTemperature(teacherLogits->Get(view.SampleMix, view.Mirrored), C, Temperature, mix);
+				for (auto c = 0ull; c < C; c++)
+					targets[c] = lambda * targets[c] + (Float(1) - lambda) * mix[c];
+			}
+		}
+
+		// hard label targets of row n: LabelFalse everywhere and LabelTrue on the label, CutMix rows split LabelTrue between both labels by Lambda,
+		// returns their sum
+		Float HardTargets(const UInt n, const UInt batchSize, Float* targets) const
+		{
+			const auto& label = GetLabel(n, batchSize);
+			const auto weightA = label.LabelA != label.LabelB ? label.Lambda : Float(1);
+
+			for (auto c = 0ull; c < C; c++)
+				targets[c] = LabelFalse;
+			targets[label.LabelA] += weightA * (LabelTrue - LabelFalse);
+			if (label.LabelA != label.LabelB)
+				targets[label.LabelB] += (Float(1) - weightA) * (LabelTrue - LabelFalse);
+
+			return LabelTrue + LabelFalse * Float(C - 1ull);
+		}
+
+		// index of the first largest value, 0 when there's none (NaN)
+		static UInt ArgMax(const Float* values, const UInt count) noexcept
+		{
+			const auto part = GetVectorPart(count);
+
+			auto maxValue = std::numeric_limits<Float>::lowest();
+			if (part > 0ull)
+			{
+				auto vecMax = VecFloat().load(values);
+				for (auto i = VectorSize; i < part; i += VectorSize)
+					vecMax = max(vecMax, VecFloat().load(values + i));
+				maxValue = horizontal_max(vecMax);
+			}
+			for (auto i = part; i < count; i++)
+				maxValue = std::max(maxValue, values[i]);
+
+			for (auto i = 0ull; i < part; i += VectorSize)
+			{
+				const auto found = VecFloat().load(values + i) == maxValue;
+				if (horizontal_or(found))
+					return i + horizontal_find_first(found);
+			}
+			for (auto i = part; i < count; i++)
+				if (values[i] == maxValue)
+					return i;
+
+			return 0ull;
+		}
+
+		// cross-entropy, loss and prediction of every row in one batch parallel pass
+		void ForwardPropCrossEntropy(const UInt batchSize)
+		{
+			const auto part = GetVectorPart(C);
+			const auto threads = GetThreads(batchSize * C, Float(0.25));
+
+			for_i(batchSize, threads, [=](UInt n)
+			{
+				const auto input = &InputLayer->Neurons[n * C];
+				const auto output = &Neurons[n * C];
+#ifndef DNN_LEAN
+				const auto zeroGradient = !GradientOverwritten;
+				const auto outputD1 = &NeuronsD1[n * C];
+#endif
+				for (auto c = 0ull; c < part; c += VectorSize)
+				{
+					VecFloat(0).store(output + c);
+#ifndef DNN_LEAN
+					if (zeroGradient)
+						VecFloat(0).store(outputD1 + c);
+#endif
+				}
+				for (auto c = part; c < C; c++)
+				{
+					output[c] = Float(0);
+#ifndef DNN_LEAN
+					if (zeroGradient)
+						outputD1[c] = Float(0);
+#endif
+				}
+
+				const auto label = GetLabel(n, batchSize).LabelA;
+				output[label] = IsLogSoftmax ? -input[label] : -std::log(input[label]);
+
+				BatchLoss[n] = output[label] * Weight;
+				BatchPrediction[n] = ArgMax(input, C);
+			});
+		}
+
+		void BackwardPropCrossEntropy(const UInt batchSize)
+		{
+			const auto part = GetVectorPart(C);
+			const auto threads = GetThreads(batchSize * C, Float(0.25));
+			const auto smoothing = Eps / C;
+			const auto target = (Float(1) - Eps) + (Eps / C);
+
+			for_i(batchSize, threads, [=](UInt n)
+			{
+				const auto input = &InputLayerFwd->Neurons[n * C];
+				const auto inputD1 = &InputLayer->NeuronsD1[n * C];
+
+				if (IsLogSoftmax)
+				{
+					for (auto c = 0ull; c < part; c += VectorSize)
+						(exp(VecFloat().load(input + c)) - smoothing).store(inputD1 + c);
+					for (auto c = part; c < C; c++)
+						inputD1[c] = std::exp(input[c]) - smoothing;
+				}
+				else
+				{
+					for (auto c = 0ull; c < part; c += VectorSize)
+						(VecFloat().load(input + c) - smoothing).store(inputD1 + c);
+					for (auto c = part; c < C; c++)
+						inputD1[c] = input[c] - smoothing;
+				}
+
+				const auto& label = GetLabel(n, batchSize);
+				const auto weightA = label.Lambda;
+				const auto weightB = ((weightA != Float(1)) && (label.LabelA != label.LabelB)) ? Float(1) - weightA : Float(1);
+				inputD1[label.LabelA] = (IsLogSoftmax ? std::exp(input[label.LabelA] * weightA) : input[label.LabelA] * weightA) - target;
+				inputD1[label.LabelB] = (IsLogSoftmax ? std::exp(input[label.LabelB] * weightB) : input[label.LabelB] * weightB) - target;
+			});
+		}
+
+		// loss and prediction of every row for the other cost functions
+		void RowStatistics(const UInt batchSize)
+		{
+			const auto part = GetVectorPart(C);
+			const auto threads = GetThreads(batchSize * C, Float(0.25));
+
+			for_i(batchSize, threads, [=](UInt n)
+			{
+				const auto output = &Neurons[n * C];
+
+				auto vecLoss = VecFloat(0);
+				for (auto c = 0ull; c < part; c += VectorSize)
+					vecLoss += VecFloat().load(output + c);
+				auto loss = horizontal_add(vecLoss);
+				for (auto c = part; c < C; c++)
+					loss += output[c];
+
+				BatchLoss[n] = loss * Weight;
+				BatchPrediction[n] = ArgMax(&InputLayer->Neurons[n * C], C);
+			});
+		}
+
 	public:
 		const Costs CostFunction;
 		const UInt GroupIndex;
@@ -27,6 +217,7 @@ namespace dnn
 		const Float LabelFalse;
 		const Float Weight;
 		const Float Eps;
+		const Float Temperature;
 		const bool IsLogSoftmax;
 		UInt TrainErrors;
 		Float TrainLoss;
@@ -37,9 +228,12 @@ namespace dnn
 		Float AvgTestLoss;
 		Float TestErrorPercentage;
 		std::vector<std::vector<UInt>> ConfusionMatrix;
+		std::vector<Float> BatchLoss;		// per row weighted loss of the last forward pass
+		std::vector<UInt> BatchPrediction;	// per row index of the largest input of the last forward pass
 
-		Cost(const dnn::Device& device, const dnnl::memory::format_tag format, const std::string& name, const Costs cost, const UInt groupIndex, const UInt labelIndex, const UInt c, const std::vector<Layer*>& inputs, const Float labelTrue, const Float labelFalse, const Float weight, const Float eps) :
+		Cost(const dnn::Device& device, const dnnl::memory::format_tag format, const std::string& name, const Costs cost, const UInt groupIndex, const UInt labelIndex, const UInt c, const std::vector<Layer*>& inputs, const Float labelTrue, const Float labelFalse, const Float weight, const Float eps, const Float temperature) :
 			Layer(device, format, name, LayerTypes::Cost, 0, 0, c, 1, 1, 1, 0, 0, 0, inputs),
+			teacherLogits(nullptr),
 			CostFunction(cost),
 			GroupIndex(groupIndex),
 			LabelIndex(labelIndex),
@@ -47,10 +241,14 @@ namespace dnn
 			LabelFalse(labelFalse),
 			Weight(weight),
 			Eps(eps),
+			Temperature(temperature),
 			IsLogSoftmax(inputs.size() == 1 && inputs[0]->LayerType == LayerTypes::LogSoftmax)
 		{
 			assert(Inputs.size() == 1);
 
+			if (CostFunction == Costs::Distillation && !IsLogSoftmax)
+				throw std::invalid_argument("Distillation needs a LogSoftmax input in " + std::string(magic_enum::enum_name<LayerTypes>(LayerType)) + " layer " + Name);
+
 			InputLayer->LayerBeforeCost = true;
 
 			TrainErrors = 0;
@@ -75,8 +273,10 @@ namespace dnn
 			description.append(nwl + std::string(" LabelTrue:") + tab + FloatToStringFixed(LabelTrue));
 			description.append(nwl + std::string(" LabelFalse:") + tab + FloatToStringFixed(LabelFalse));
 			description.append(nwl + std::string(" Weight:") + tab + FloatToStringFixed(Weight));
-			if (CostFunction == Costs::MeanAbsoluteEpsError || CostFunction == Costs::CategoricalCrossEntropy)
+			if (CostFunction == Costs::MeanAbsoluteEpsError || CostFunction == Costs::CategoricalCrossEntropy || CostFunction == Costs::Distillation)
 				description.append(nwl + std::string(" Epsilon:") + tab + FloatToStringFixed(Eps, 6));
+			if (CostFunction == Costs::Distillation)
+				description.append(nwl + std::string(" Temperature:") + tab + FloatToStringFixed(Temperature));
 
 			return description;
 		}
@@ -96,6 +296,12 @@ namespace dnn
 			ChosenFormat = dnnl::memory::format_tag::ab;
 			DstMemDesc = std::make_unique<dnnl::memory::desc>(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(batchSize), dnnl::memory::dim(C)}), dnnl::memory::data_type::f32, ChosenFormat));
 			DiffDstMemDesc = std::make_unique<dnnl::memory::desc>(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(batchSize), dnnl::memory::dim(C) }), dnnl::memory::data_type::f32, ChosenFormat));
+
+			BatchLoss = std::vector<Float>(batchSize, Float(0));
+			BatchPrediction = std::vector<UInt>(batchSize, 0ull);
+
+			if (CostFunction == Costs::Distillation)
+				distillationRows = FloatVector(batchSize * 4ull * C, Float(0));
 		}
 
 		void SetSampleLabel(const std::vector<LabelInfo>& label)
@@ -108,6 +314,16 @@ namespace dnn
 			sampleLabels = labels;
 		}
 
+		void SetTeacherLogits(const TeacherLogits* logits)
+		{
+			teacherLogits = logits;
+		}
+
+		void SetTeacherViews(const std::vector<TeacherView>& views)
+		{
+			teacherViews = views;
+		}
+
 		void Reset()
 		{
 			TrainErrors = 0;
@@ -125,8 +341,6 @@ namespace dnn
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
-			DNN_UNREF_PAR(training);
-
 			switch (CostFunction)
 			{
 			case Costs::BinaryCrossEntropy:
@@ -138,7 +352,8 @@ namespace dnn
 					{
 						Neurons[c] = -LabelFalse * std::log(InputLayer->Neurons[c]) - (Float(1) - LabelFalse) * std::log(Float(1) - InputLayer->Neurons[c]);
 #ifndef DNN_LEAN
-						NeuronsD1[c] = Float(0);
+						if (!GradientOverwritten)
+							NeuronsD1[c] = Float(0);
 #endif
 					}
 					const auto label = sampleLabel[LabelIndex].LabelA;
@@ -151,7 +366,8 @@ namespace dnn
 					{
 						Neurons[nc] = -LabelFalse * std::log(InputLayer->Neurons[nc]) - (Float(1) - LabelFalse) * std::log(Float(1) - InputLayer->Neurons[nc]);
 #ifndef DNN_LEAN
-						NeuronsD1[nc] = Float(0);
+						if (!GradientOverwritten)
+							NeuronsD1[nc] = Float(0);
 #endif
 					}
 					for (auto n = 0ull; n < batchSize; n++)
@@ -166,77 +382,8 @@ namespace dnn
 			break;
 
 			case Costs::CategoricalCrossEntropy:
-			{
-				if (IsLogSoftmax)
-				{
-#ifdef DNN_STOCHASTIC
-					if (batchSize == 1)
-					{
-						for (auto c = 0ull; c < C; c++)
-						{
-							Neurons[c] = Float(0);
-#ifndef DNN_LEAN
-							NeuronsD1[c] = Float(0);
-#endif
-						}
-						const auto label = sampleLabel[LabelIndex].LabelA;
-						Neurons[label] = -InputLayer->Neurons[label];
-					}
-					else
-					{
-#endif
-						for (auto nc = 0ull; nc < C * batchSize; nc++)
-						{
-							Neurons[nc] = Float(0);
-#ifndef DNN_LEAN
-							NeuronsD1[nc] = Float(0);
-#endif
-						}
-						for (auto n = 0ull; n < batchSize; n++)
-						{
-							const auto label = sampleLabels[n][LabelIndex].LabelA + (n * C);
-							Neurons[label] = -InputLayer->Neurons[label];
-						}
-#ifdef DNN_STOCHASTIC
-					}
-#endif
-				}
-				else
-				{
-#ifdef DNN_STOCHASTIC
-					if (batchSize == 1)
-					{
-						for (auto c = 0ull; c < C; c++)
-						{
-							Neurons[c] = Float(0);
-#ifndef DNN_LEAN
-							NeuronsD1[c] = Float(0);
-#endif
-						}
-						const auto label = sampleLabel[LabelIndex].LabelA;
-						Neurons[label] = -std::log(InputLayer->Neurons[label]);
-					}
-					else
-					{
-#endif
-						for (auto nc = 0ull; nc < C * batchSize; nc++)
-						{
-							Neurons[nc] = Float(0);
-#ifndef DNN_LEAN
-							NeuronsD1[nc] = Float(0);
-#endif
-						}
-						for (auto n = 0ull; n < batchSize; n++)
-						{
-							const auto label = sampleLabels[n][LabelIndex].LabelA + (n * C);
-							Neurons[label] = -std::log(InputLayer->Neurons[label]);
-						}
-#ifdef DNN_STOCHASTIC
-					}
-#endif
-				}
-			}
-			break;
+				ForwardPropCrossEntropy(batchSize);
+				return;
 
 			case Costs::MeanAbsoluteError:
 			{
@@ -338,7 +485,8 @@ namespace dnn
 						const auto ty = LabelFalse * InputLayer->Neurons[c];
 						Neurons[c] = ty <= 0 ? Float(0.5) - ty : ty < Float(1) ? Square<Float>(1 - ty) * Float(0.5) : Float(0);
 #ifndef DNN_LEAN
-						NeuronsD1[c] = Float(0);
+						if (!GradientOverwritten)
+							NeuronsD1[c] = Float(0);
 #endif
 					}
 					const auto label = sampleLabel[LabelIndex].LabelA;
@@ -353,7 +501,8 @@ namespace dnn
 						const auto ty = LabelFalse * InputLayer->Neurons[nc];
 						Neurons[nc] = ty <= 0 ? Float(0.5) - ty : ty < Float(1) ? Square<Float>(1 - ty) * Float(0.5) : Float(0);
 #ifndef DNN_LEAN
-						NeuronsD1[nc] = Float(0);
+						if (!GradientOverwritten)
+							NeuronsD1[nc] = Float(0);
 #endif
 					}
 					for (auto n = 0ull; n < batchSize; n++)
@@ -367,7 +516,55 @@ namespace dnn
 #endif
 			}
 			break;
+
+			case Costs::Distillation:
+			{
+				const auto threads = GetThreads(batchSize * C, Float(0.25));
+
+				// no teacher for the testing samples, the test loss is the plain cross-entropy
+				if (!training)
+				{
+					for_i(batchSize, threads, [=](UInt n)
+					{
+						for (auto c = 0ull; c < C; c++)
+							Neurons[n * C + c] = Float(0);
+
+						const auto label = GetLabel(n, batchSize).LabelA;
+						Neurons[n * C + label] = -InputLayer->Neurons[n * C + label];
+					});
+					break;
+				}
+
+				if (!teacherLogits || teacherViews.size() < batchSize)
+					throw std::invalid_argument("Teacher logits not set in " + std::string(magic_enum::enum_name<LayerTypes>(LayerType)) + " layer " + Name);
+
+				// (1 - Eps) T^2 KL(teacher_T || student_T) + Eps cross-entropy with the hard label targets
+				const auto factor = (Float(1) - Eps) * Temperature * Temperature;
+
+				for_i(batchSize, threads, [=](UInt n)
+				{
+					const auto logits = &InputLayer->Neurons[n * C];
+					const auto targets = &distillationRows[n * 4ull * C];
+					const auto student = targets + C;
+					const auto hard = targets + 2ull * C;
+					TeacherTargets(n, batchSize, targets, targets + 3ull * C);
+					SoftmaxTemperature(logits, C, Temperature, student);
+					HardTargets(n, batchSize, hard);
+
+					for (auto c = 0ull; c < C; c++)
+					{
+						Neurons[n * C + c] = (targets[c] > Float(0) ? factor * targets[c] * (std::log(targets[c]) - std::log(std::max(student[c], std::numeric_limits<Float>::min()))) : Float(0)) - Eps * hard[c] * logits[c];
+#ifndef DNN_LEAN
+						if (!GradientOverwritten)
+							NeuronsD1[n * C + c] = Float(0);
+#endif
+					}
+				});
 			}
+			break;
+			}
+
+			RowStatistics(batchSize);
 		}
 
 		void BackwardProp(const UInt batchSize) final override
@@ -407,77 +604,8 @@ namespace dnn
 			break;
 
 			case Costs::CategoricalCrossEntropy:
-			{
-				if (IsLogSoftmax)
-				{
-#ifdef DNN_STOCHASTIC
-					if (batchSize == 1)
-					{
-						for (auto c = 0ull; c < C; c++)
-							InputLayer->NeuronsD1[c] = std::exp(InputLayerFwd->Neurons[c]) - (Eps / C);
-
-						const auto labelA = sampleLabel[LabelIndex].LabelA;
-						const auto labelB = sampleLabel[LabelIndex].LabelB;
-						const auto weightA = sampleLabel[LabelIndex].Lambda;
-						const auto weightB = ((weightA != Float(1)) && (sampleLabel[LabelIndex].LabelA != sampleLabel[LabelIndex].LabelB)) ? Float(1) - weightA : Float(1);
-						InputLayer->NeuronsD1[labelA] = std::exp(InputLayerFwd->Neurons[labelA] * weightA) - ((Float(1) - Eps) + (Eps / C));
-						InputLayer->NeuronsD1[labelB] = std::exp(InputLayerFwd->Neurons[labelB] * weightB) - ((Float(1) - Eps) + (Eps / C));
-					}
-					else
-					{
-#endif
-						for (auto nc = 0ull; nc < C * batchSize; nc++)
-							InputLayer->NeuronsD1[nc] = std::exp(InputLayerFwd->Neurons[nc]) - (Eps / C);
-
-						for (auto n = 0ull; n < batchSize; n++)
-						{
-							const auto labelA = sampleLabels[n][LabelIndex].LabelA + (n * C);
-							const auto labelB = sampleLabels[n][LabelIndex].LabelB + (n * C);
-							const auto weightA = sampleLabels[n][LabelIndex].Lambda;
-							const auto weightB = ((weightA != Float(1)) && (sampleLabels[n][LabelIndex].LabelA != sampleLabels[n][LabelIndex].LabelB)) ? Float(1) - weightA : Float(1);
-							InputLayer->NeuronsD1[labelA] = std::exp(InputLayerFwd->Neurons[labelA] * weightA) - ((Float(1) - Eps) + (Eps / C));
-							InputLayer->NeuronsD1[labelB] = std::exp(InputLayerFwd->Neurons[labelB] * weightB) - ((Float(1) - Eps) + (Eps / C));
-						}
-#ifdef DNN_STOCHASTIC
-					}
-#endif
-				}
-				else
-				{
-#ifdef DNN_STOCHASTIC
-					if (batchSize == 1)
-					{
-						for (auto c = 0ull; c < C; c++)
-							InputLayer->NeuronsD1[c] = InputLayerFwd->Neurons[c] - (Eps / C);
-
-						const auto labelA = sampleLabel[LabelIndex].LabelA;
-						const auto labelB = sampleLabel[LabelIndex].LabelB;
-						const auto weightA = sampleLabel[LabelIndex].Lambda;
-						const auto weightB = ((weightA != Float(1)) && (sampleLabel[LabelIndex].LabelA != sampleLabel[LabelIndex].LabelB)) ? Float(1) - weightA : Float(1);
-						InputLayer->NeuronsD1[labelA] = (InputLayerFwd->Neurons[labelA] * weightA) - ((Float(1) - Eps) + (Eps / C));
-						InputLayer->NeuronsD1[labelB] = (InputLayerFwd->Neurons[labelB] * weightB) - ((Float(1) - Eps) + (Eps / C));
-					}
-					else
-					{
-#endif
-						for (auto nc = 0ull; nc < C * batchSize; nc++)
-							InputLayer->NeuronsD1[nc] = InputLayerFwd->Neurons[nc] - (Eps / C);
-
-						for (auto n = 0ull; n < batchSize; n++)
-						{
-							const auto labelA = sampleLabels[n][LabelIndex].LabelA + (n * C);
-							const auto labelB = sampleLabels[n][LabelIndex].LabelB + (n * C);
-							const auto weightA = sampleLabels[n][LabelIndex].Lambda;
-							const auto weightB = ((weightA != Float(1)) && (sampleLabels[n][LabelIndex].LabelA != sampleLabels[n][LabelIndex].LabelB)) ? Float(1) - weightA : Float(1);
-							InputLayer->NeuronsD1[labelA] = (InputLayerFwd->Neurons[labelA] * weightA) - ((Float(1) - Eps) + (Eps / C));
-							InputLayer->NeuronsD1[labelB] = (InputLayerFwd->Neurons[labelB] * weightB) - ((Float(1) - Eps) + (Eps / C));
-						}
-#ifdef DNN_STOCHASTIC
-					}
-#endif
-				}
-			}
-			break;
+				BackwardPropCrossEntropy(batchSize);
+				break;
 
 			case Costs::MeanAbsoluteError:
 			{
@@ -616,6 +744,27 @@ namespace dnn
 #endif
 			}
 			break;
+
+			case Costs::Distillation:
+			{
+				// gradient at the logits, the LogSoftmax backward passes it unchanged as each row sums to zero
+				const auto factor = (Float(1) - Eps) * Temperature;
+
+				for_i(batchSize, GetThreads(batchSize * C, Float(0.25)), [=](UInt n)
+				{
+					const auto logits = &InputLayerFwd->Neurons[n * C];
+					const auto targets = &distillationRows[n * 4ull * C];
+					const auto student = targets + C;
+					const auto hard = targets + 2ull * C;
+					TeacherTargets(n, batchSize, targets, targets + 3ull * C);
+					SoftmaxTemperature(logits, C, Temperature, student);
+					const auto hardSum = HardTargets(n, batchSize, hard);
+
+					for (auto c = 0ull; c < C; c++)
+						InputLayer->NeuronsD1[n * C + c] = factor * (student[c] - targets[c]) + Eps * (std::exp(logits[c]) * hardSum - hard[c]);
+				});
+			}
+			break;
 			}
 
 #ifdef DNN_LEAN
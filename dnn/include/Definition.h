@@ -63,6 +63,7 @@ namespace dnn
 		defNorm = CaseInsensitiveReplace(defNorm.begin(), defNorm.end(), "LabelIndex=", "LabelIndex=");
 		defNorm = CaseInsensitiveReplace(defNorm.begin(), defNorm.end(), "LabelTrue=", "LabelTrue=");
 		defNorm = CaseInsensitiveReplace(defNorm.begin(), defNorm.end(), "LabelFalse=", "LabelFalse=");
+		defNorm = CaseInsensitiveReplace(defNorm.begin(), defNorm.end(), "Temperature=", "Temperature=");
 		defNorm = CaseInsensitiveReplace(defNorm.begin(), defNorm.end(), "Weight=", "Weight=");
 
 		auto types = magic_enum::enum_names<LayerTypes>();
@@ -176,6 +177,7 @@ namespace dnn
 		auto weight = Float(1);
 		auto labelTrue = Float(0.9);
 		auto labelFalse = Float(0.1);
+		auto temperature = Float(4);
 		auto costFunction = Costs::CategoricalCrossEntropy;
 		auto activationFunction = Activations::Linear;
 		auto kernelH = UInt(1);
@@ -522,7 +524,7 @@ namespace dnn
 							model->Layers[model->Layers.size() - 1]->SetParameters(useDefaultParams, weightsFiller, weightsFillerMode, weightsGain, weightsScale, weightsLRM, weightsWDM, biasesFiller, biasesFillerMode, biasesGain, biasesScale, biasesLRM, biasesWDM);
 							break;
 						case LayerTypes::Cost:
-							model->Layers.push_back(std::make_unique<Cost>(model->Device, model->Format, name, costFunction, groupIndex, labelIndex, c, inputs, labelTrue, labelFalse, weight, epsSpecified ? eps : Float(0)));
+							model->Layers.push_back(std::make_unique<Cost>(model->Device, model->Format, name, costFunction, groupIndex, labelIndex, c, inputs, labelTrue, labelFalse, weight, epsSpecified ? eps : Float(0), temperature));
 							model->CostLayers.push_back(dynamic_cast<Cost*>(model->Layers[model->Layers.size() - 1].get()));
 							model->CostFuction = costFunction;
 							break;
@@ -644,6 +646,7 @@ namespace dnn
 					k = Float(1);
 					labelTrue = Float(0.9);
 					labelFalse = Float(0.1);
+					temperature = Float(4);
 					
 				}
 			}
@@ -2201,6 +2204,44 @@ namespace dnn
 					goto FAIL;
 				}
 			}
+			else if (strLine.rfind("Temperature=") == 0)
+			{
+				if (isModel)
+				{
+					msg = CheckMsg(line, col, "Temperature cannot be specified in a model.");
+					goto FAIL;
+				}
+
+				if (layerType != LayerTypes::Cost)
+				{
+					msg = CheckMsg(line, col, "Temperature cannot be specified in a " + std::string(magic_enum::enum_name<LayerTypes>(layerType)) + " layer.");
+					goto FAIL;
+				}
+
+				params = strLine.erase(0, 12);
+
+				if (params.find_first_not_of(".eE0123456789") != std::string::npos)
+				{
+					msg = CheckMsg(line, col, "Temperature contains illegal characters.");
+					goto FAIL;
+				}
+
+				try
+				{
+					temperature = std::stof(params);
+				}
+				catch (std::exception exception)
+				{
+					msg = CheckMsg(line, col, "Temperature value not recognized." + nwl + exception.what());
+					goto FAIL;
+				}
+
+				if (temperature <= 0.0f || temperature > 20.0f)
+				{
+					msg = CheckMsg(line, col, "Temperature value must be in the range ]0-20]");
+					goto FAIL;
+				}
+			}
 			else if (strLine.rfind("Cost=") == 0)
 			{
 				if (isModel)
@@ -2236,6 +2277,13 @@ namespace dnn
 					msg = CheckMsg(line, col, "Cost is not recognized.");
 					goto FAIL;
 				}
+
+				// the hard label targets of Distillation are one-hot unless LabelTrue and LabelFalse follow
+				if (costFunction == Costs::Distillation)
+				{
+					labelTrue = Float(1);
+					labelFalse = Float(0);
+				}
 			}
 			else if (strLine.rfind("Activation=") == 0)
 			{
@@ -2512,7 +2560,7 @@ namespace dnn
 				goto FAIL;
 			}
 
-			model->Layers.push_back(std::make_unique<Cost>(model->Device, model->Format, layerNames[model->Layers.size()].first, costFunction, groupIndex, labelIndex, c, model->GetLayerInputs(inputsStr), labelTrue, labelFalse, weight, epsSpecified ? eps : Float(0)));
+			model->Layers.push_back(std::make_unique<Cost>(model->Device, model->Format, layerNames[model->Layers.size()].first, costFunction, groupIndex, labelIndex, c, model->GetLayerInputs(inputsStr), labelTrue, labelFalse, weight, epsSpecified ? eps : Float(0), temperature));
 			model->CostLayers.push_back(dynamic_cast<Cost*>(model->Layers[model->Layers.size() - 1].get()));
 			model->CostFuction = costFunction;
 		}
@@ -2631,5 +2679,16 @@ namespace dnn
 		}
 
 		return model;
+	}
+
+	// every context owns its Neurons, so each one can run Inference on its own thread while sharing the weights of model
+	Model* CreateInferenceContext(Model& model, const UInt batchSize, CheckMsg& checkMsg)
+	{
+		Model* context = Read(model.Definition, nullptr, checkMsg);
+
+		if (context)
+			context->ShareWeights(model, batchSize);
+
+		return context;
 	}	
 }
\ No newline at end of file
@@ -1,5 +1,5 @@
 #pragma once
-#include "Layer.h"
+#include "BatchNormActivation.h"
 
 namespace dnn
 {
@@ -10,11 +10,16 @@ namespace dnn
 		std::unique_ptr<dnnl::convolution_backward_weights::primitive_desc> bwdWeightsDesc;
 		std::unique_ptr<dnnl::convolution_backward_data::primitive_desc> bwdDataDesc;
 		std::unique_ptr<dnnl::binary::primitive_desc> bwdAddDesc;
+		std::unique_ptr<dnnl::convolution_forward::primitive_desc> fwdQuantDesc;
+		dnnl::memory weightsQuantMem;
+		dnnl::memory srcScaleMem;
+		dnnl::memory weightsScalesMem;
 #ifdef DNN_CACHE_PRIMITIVES
 		std::unique_ptr<dnnl::convolution_forward> fwd;
 		std::unique_ptr<dnnl::convolution_backward_weights> bwdWeights;
 		std::unique_ptr<dnnl::convolution_backward_data> bwdData;
 		std::unique_ptr<dnnl::binary> bwdAdd;
+		std::unique_ptr<dnnl::convolution_forward> fwdQuant;
 #endif
 		bool reorderFwdSrc;
 		bool reorderBwdSrc;
@@ -22,6 +27,205 @@ namespace dnn
 		bool reorderBwdDiffDst;
 		bool reorderBwdWeights;
 		bool reorderBwdDiffWeights;
+		std::unordered_map<int, dnnl::memory> inferenceArgs;
+		bool direct;
+		FloatVector directWeights;	// PaddedC / VectorSize x KernelH x KernelW x VectorSize
+		FloatVector directBiases;
+		FloatVector epilogueScale;
+		FloatVector epilogueShift;
+		std::vector<Welford<VecFloat>> partialStatistics;	// PaddedC / VectorSize x batchSize, the training statistics of each block and sample
+		UInt packedVersion;
+		const BatchNormActivation* foldedEpilogue;
+		UInt foldedVersion;
+		bool foldedStale;
+
+		// the direct kernel: blocked layout in and out, one output channel per input channel, no dilation, square 3x3, 5x5 or 7x7 kernel with stride 1 or 2
+		bool DirectKernel() const
+		{
+			return Multiplier == 1ull && DilationH == 1ull && DilationW == 1ull && KernelH == KernelW && (KernelH == 3ull || KernelH == 5ull || KernelH == 7ull) && StrideH == StrideW && (StrideH == 1ull || StrideH == 2ull) &&
+				D == 1ull && InputLayer->PaddedC == PaddedC && ChosenFormat == BlockedFmt && GetDataFmt(*InputLayer->DstMemDesc) == BlockedFmt;
+		}
+
+		// packs the weights and biases only after they changed
+		void PackDirect()
+		{
+			if (packedVersion == CurrentWeightsVersion())
+				return;
+
+			auto weights = FloatVector();
+			if (*WeightsMemDesc != *PersistWeightsMemDesc)
+			{
+				weights = FloatVector(PersistWeightsMemDesc->get_size() / sizeof(Float));
+
+				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
+				auto weightsMem = dnnl::memory(*PersistWeightsMemDesc, Device.engine, weights.data());
+
+				dnnl::reorder(memWeights, weightsMem).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memWeights}, { DNNL_ARG_TO, weightsMem } });
+				Device.stream.wait();
+			}
+			const auto src = weights.empty() ? WeightsData() : weights.data();
+			const auto biases = BiasesData();
+			const auto taps = KernelH * KernelW;
+
+			for (auto c = 0ull; c < C; c++)
+			{
+				const auto offset = (c / VectorSize) * taps * VectorSize + (c % VectorSize);
+				for (auto k = 0ull; k < taps; k++)
+					directWeights[offset + k * VectorSize] = src[c * taps + k];
+				directBiases[c] = HasBias ? biases[c] : Float(0);
+			}
+
+			packedVersion = CurrentWeightsVersion();
+		}
+
+		// folds the running statistics, scale and shift of the BatchNormActivation, again only after a training pass or a change of its weights
+		void FoldEpilogue()
+		{
+			if (!foldedStale && foldedEpilogue == Epilogue && foldedVersion == Epilogue->CurrentWeightsVersion())
+				return;
+
+			const auto weights = Epilogue->WeightsData();
+			const auto biases = Epilogue->BiasesData();
+			for (auto c = 0ull; c < C; c++)
+			{
+				const auto invStdDev = Float(1) / std::sqrt(Epilogue->RunningVariance[c] + Epilogue->Eps);
+				epilogueScale[c] = Epilogue->Scaling ? weights[c] * invStdDev : invStdDev;
+				epilogueShift[c] = (Epilogue->Scaling && Epilogue->HasBias ? biases[c] : Float(0)) - Epilogue->RunningMean[c] * epilogueScale[c];
+			}
+
+			foldedEpilogue = Epilogue;
+			foldedVersion = Epilogue->CurrentWeightsVersion();
+			foldedStale = false;
+		}
+
+		void InvalidateDirect() noexcept
+		{
+			packedVersion = std::numeric_limits<UInt>::max();
+			foldedStale = true;
+		}
+
+		// sample n, channel block of the output, Neurons or with the epilogue the Neurons of the BatchNormActivation,
+		// in training the statistics of the block's outputs for the BatchNormActivation, shifted by the first output like BlockStatistics
+		template<UInt Kernel, UInt Stride>
+		void ForwardDirectBlock(const UInt n, const UInt block, const bool epilogue, Welford<VecFloat>* statistics)
+		{
+			const auto inputH = static_cast<long long>(InputLayer->H);
+			const auto inputW = static_cast<long long>(InputLayer->W);
+			const auto input = &InputLayer->Neurons[n * InputLayer->PaddedCDHW() + block * VectorSize * InputLayer->HW()];
+			auto output = (epilogue ? Epilogue->Neurons.data() : Neurons.data()) + n * PaddedCDHW() + block * VectorSize * HW();
+
+			VecFloat weights[Kernel * Kernel];
+			for (auto k = 0ull; k < Kernel * Kernel; k++)
+				weights[k].load_a(&directWeights[(block * Kernel * Kernel + k) * VectorSize]);
+			const auto bias = VecFloat().load_a(&directBiases[block * VectorSize]);
+			const auto scale = epilogue ? VecFloat().load_a(&epilogueScale[block * VectorSize]) : VecFloat(1);
+			const auto shift = epilogue ? VecFloat().load_a(&epilogueShift[block * VectorSize]) : VecFloat(0);
+
+			auto first = VecFloat(0);
+			auto sum = VecFloat(0);
+			auto squareSum = VecFloat(0);
+
+			for (auto h = 0ull; h < H; h++)
+			{
+				const auto top = static_cast<long long>(h * Stride) - static_cast<long long>(PadH);
+				const auto kernelTop = static_cast<UInt>(std::max(0ll, -top));
+				const auto kernelBottom = static_cast<UInt>(std::min(static_cast<long long>(Kernel), inputH - top));
+
+				for (auto w = 0ull; w < W; w++)
+				{
+					const auto left = static_cast<long long>(w * Stride) - static_cast<long long>(PadW);
+					const auto kernelLeft = static_cast<UInt>(std::max(0ll, -left));
+					const auto kernelRight = static_cast<UInt>(std::min(static_cast<long long>(Kernel), inputW - left));
+
+					auto value = bias;
+					for (auto kh = kernelTop; kh < kernelBottom; kh++)
+					{
+						const auto row = input + ((top + static_cast<long long>(kh)) * inputW + left) * static_cast<long long>(VectorSize);
+						for (auto kw = kernelLeft; kw < kernelRight; kw++)
+							value = mul_add(VecFloat().load_a(row + kw * VectorSize), weights[kh * Kernel + kw], value);
+					}
+
+					if (epilogue)
+						Epilogue->Func.fVec(mul_add(value, scale, shift), Epilogue->Alpha, Epilogue->Beta).store_a(output + (h * W + w) * VectorSize);
+					else
+					{
+						value.store_a(output + (h * W + w) * VectorSize);
+						if (statistics)
+						{
+							if (h == 0ull && w == 0ull)
+								first = value;
+
+							const auto shifted = value - first;
+							sum += shifted;
+							squareSum = mul_add(shifted, shifted, squareSum);
+						}
+					}
+				}
+			}
+
+			if (statistics)
+			{
+				const auto mean = sum / Float(HW());
+				*statistics = Welford<VecFloat>(Float(HW()), first + mean, max(VecFloat(0), squareSum - sum * mean));
+			}
+		}
+
+		template<UInt Kernel, UInt Stride>
+		void ForwardDirect(const UInt batchSize, const bool training)
+		{
+			const auto blocks = PaddedC / VectorSize;
+			const auto epilogue = !training && Epilogue;
+			const auto statistics = training && Epilogue;
+
+			PackDirect();
+			if (epilogue)
+				FoldEpilogue();
+
+			const auto threads = GetThreads(batchSize * PaddedCDHW() * Kernel * Kernel, Float(0.1));
+			if (statistics)
+			{
+				// the statistics of every sample and block first, so all threads work on the whole batch, then a merge tree over the samples per block
+				if (partialStatistics.size() < batchSize * blocks)
+					partialStatistics.resize(batchSize * blocks);
+
+				for_i(batchSize * blocks, threads, [=](UInt i)
+				{
+					const auto n = i / blocks;
+					const auto block = i % blocks;
+					ForwardDirectBlock<Kernel, Stride>(n, block, false, &partialStatistics[block * batchSize + n]);
+				});
+
+				for_i(blocks, std::min<UInt>(threads, blocks), [=](UInt block)
+				{
+					const auto statistics = &partialStatistics[block * batchSize];
+					MergeTree(statistics, batchSize);
+					Epilogue->InputBlockStatistics[block] = *statistics;
+				});
+				Epilogue->InputStatistics = true;
+			}
+			else
+			{
+				for_i(batchSize * blocks, threads, [=](UInt i)
+				{
+					ForwardDirectBlock<Kernel, Stride>(i / blocks, i % blocks, epilogue, nullptr);
+				});
+				if (epilogue)
+					Epilogue->InputFolded = true;
+			}
+		}
+
+		void ForwardDirect(const UInt batchSize, const bool training)
+		{
+			switch (KernelH * 10ull + StrideH)
+			{
+			case 31ull: ForwardDirect<3ull, 1ull>(batchSize, training); break;
+			case 32ull: ForwardDirect<3ull, 2ull>(batchSize, training); break;
+			case 51ull: ForwardDirect<5ull, 1ull>(batchSize, training); break;
+			case 52ull: ForwardDirect<5ull, 2ull>(batchSize, training); break;
+			case 71ull: ForwardDirect<7ull, 1ull>(batchSize, training); break;
+			case 72ull: ForwardDirect<7ull, 2ull>(batchSize, training); break;
+			}
+		}
 		
 	public:
 		const UInt Multiplier;
@@ -36,6 +240,7 @@ namespace dnn
 		const dnnl::memory::dims Strides;
 		const dnnl::memory::dims Dilates;
 		const dnnl::memory::dims Padding;
+		BatchNormActivation* Epilogue;	// the only consumer when Model::SetDepthwiseEpilogue folds it into the direct kernel
 				
 		DepthwiseConvolution(const dnn::Device& device, const dnnl::memory::format_tag format, const std::string& name, const std::vector<Layer*>& inputs, const UInt kernelH, const UInt kernelW, const UInt strideH, const UInt strideW, const UInt dilationH, const UInt dilationW, const UInt padH, const UInt padW, const UInt multiplier, const bool hasBias) :
 			Layer(device, format, name, LayerTypes::DepthwiseConvolution, multiplier * inputs[0]->C * kernelH * kernelW, multiplier * inputs[0]->C, multiplier * inputs[0]->C, inputs[0]->D, ((((inputs[0]->H - (1 + (kernelH - 1) * dilationH)) + (padH * 2)) / strideH) + 1), ((((inputs[0]->W - (1 + (kernelW - 1) * dilationW)) + (padW * 2)) / strideW) + 1), 0, padH, padW, inputs, hasBias),
@@ -56,7 +261,13 @@ namespace dnn
 			reorderBwdDiffSrc(false),
 			reorderBwdDiffDst(false),
 			reorderBwdWeights(false),
-			reorderBwdDiffWeights(false)
+			reorderBwdDiffWeights(false),
+			direct(false),
+			packedVersion(std::numeric_limits<UInt>::max()),
+			foldedEpilogue(nullptr),
+			foldedVersion(0),
+			foldedStale(true),
+			Epilogue(nullptr)
 		{
 			assert(Inputs.size() == 1);
 
@@ -89,6 +300,8 @@ namespace dnn
 				description.append(nwl + std::string(" Stride:") + tab + std::to_string(StrideH) + std::string("x") + std::to_string(StrideW));
 			if (HasPadding)
 				description.append(nwl + std::string(" Padding:") + tab + std::to_string(PadH) + std::string("x") + std::to_string(PadW));
+			if (direct)
+				description.append(nwl + std::string(" Direct:") + tab + std::string(Epilogue ? Epilogue->Name : "yes"));
 
 			description.append(GetWeightsDescription());
 
@@ -107,6 +320,11 @@ namespace dnn
 			return Multiplier * KernelH * KernelW / StrideH * StrideW;
 		}
 
+		bool OverwritesGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			std::vector<dnnl::memory::desc> memDesc = std::vector<dnnl::memory::desc>({
@@ -130,7 +348,7 @@ namespace dnn
 			if (*WeightsMemDesc != fwdDesc->weights_desc())
 			{
 				auto weights = FloatVector(fwdDesc->weights_desc().get_size() / sizeof(Float));
-				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
 				auto weightsMem = dnnl::memory(fwdDesc->weights_desc(), Device.engine, weights.data());
 
 				dnnl::reorder(memWeights, weightsMem).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memWeights}, { DNNL_ARG_TO, weightsMem } });
@@ -138,13 +356,26 @@ namespace dnn
 
 				Weights = weights;
 				WeightsMemDesc = std::make_unique<dnnl::memory::desc>(fwdDesc->weights_desc());
+				WeightsChanged();
 			}
 
 			DstMemDesc = std::make_unique<dnnl::memory::desc>(fwdDesc->dst_desc());
 			DiffDstMemDesc = std::make_unique<dnnl::memory::desc>(fwdDesc->dst_desc());
 
 			ChosenFormat = GetDataFmt(*DstMemDesc);
+
+			direct = DirectKernel();
+			if (direct)
+			{
+				directWeights = FloatVector(PaddedC * KernelH * KernelW, Float(0));
+				directBiases = FloatVector(PaddedC, Float(0));
+				epilogueScale = FloatVector(PaddedC, Float(0));
+				epilogueShift = FloatVector(PaddedC, Float(0));
+				partialStatistics = std::vector<Welford<VecFloat>>();
+				InvalidateDirect();
+			}
 			
+			inferenceArgs.clear();
 			reorderFwdSrc = fwdDesc->src_desc() != *InputLayer->DstMemDesc;
 			reorderBwdSrc = bwdWeightsDesc->src_desc() != *InputLayer->DstMemDesc;
 			reorderBwdDiffDst = bwdWeightsDesc->diff_dst_desc() != *DiffDstMemDesc;
@@ -157,12 +388,119 @@ namespace dnn
 			bwdWeights = std::make_unique<dnnl::convolution_backward_weights>(dnnl::convolution_backward_weights(*bwdWeightsDesc));
 			bwdData = std::make_unique<dnnl::convolution_backward_data>(dnnl::convolution_backward_data(*bwdDataDesc));
 			bwdAdd = std::make_unique<dnnl::binary>(dnnl::binary(*bwdAddDesc));
+#endif
+			if (Quantized)
+				InitializeQuantized(batchSize);
+		}
+
+		// latency mode: bind src, weights, bias and dst once so that ForwardProp only executes the primitive
+		void BindInference() final override
+		{
+			inferenceArgs.clear();
+			if (reorderFwdSrc || Quantized || InputLayer->Neurons.empty() || Neurons.empty())
+				return;
+
+			inferenceArgs = std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, dnnl::memory(*InputLayer->DstMemDesc, Device.engine, InputLayer->Neurons.data())}, { DNNL_ARG_WEIGHTS, dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData()) }, { DNNL_ARG_DST, dnnl::memory(*DstMemDesc, Device.engine, Neurons.data()) } };
+			if (HasBias)
+				inferenceArgs.insert({ DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, BiasesData()) });
+		}
+
+		bool Quantizable() const final override
+		{
+			return true;
+		}
+
+		void Quantize(const bool enable) final override
+		{
+			Quantized = enable && QuantSrcMin <= QuantSrcMax && DstMemDesc;
+			InvalidateDirect();
+			
+			if (Quantized)
+				InitializeQuantized(UInt(DstMemDesc->get_dims()[0]));
+			else
+			{
+				fwdQuantDesc.reset();
+				weightsQuantMem = dnnl::memory();
+				ReleaseQuantizeSrc();
+#ifdef DNN_CACHE_PRIMITIVES
+				fwdQuant.reset();
+#endif
+			}
+		}
+
+		void InitializeQuantized(const UInt batchSize)
+		{
+			auto attr = dnnl::primitive_attr();
+			attr.set_scales_mask(DNNL_ARG_SRC, 0);
+			attr.set_scales_mask(DNNL_ARG_WEIGHTS, 3);
+
+			const auto srcDesc = dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(batchSize), dnnl::memory::dim(InputLayer->C), dnnl::memory::dim(InputLayer->H), dnnl::memory::dim(InputLayer->W) }), QuantSrcDataType(), dnnl::memory::format_tag::any);
+			const auto weightsDesc = dnnl::memory::desc(WeightsMemDesc->get_dims(), dnnl::memory::data_type::s8, dnnl::memory::format_tag::any);
+			const auto biasDesc = dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(C) }), dnnl::memory::data_type::f32, dnnl::memory::format_tag::x);
+
+			fwdQuantDesc = std::make_unique<dnnl::convolution_forward::primitive_desc>(HasBias ?
+				dnnl::convolution_forward::primitive_desc(Device.engine, dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_auto, srcDesc, weightsDesc, biasDesc, *DstMemDesc, Strides, Dilates, Padding, Padding, attr) :
+				dnnl::convolution_forward::primitive_desc(Device.engine, dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_auto, srcDesc, weightsDesc, *DstMemDesc, Strides, Dilates, Padding, Padding, attr));
+
+			weightsQuantMem = QuantizeWeights(fwdQuantDesc->weights_desc());
+			srcScaleMem = GetScalesMemory(FloatVector(1, QuantSrcScale()));
+			weightsScalesMem = GetScalesMemory(QuantWeightsScales);
+			InitializeQuantizeSrc(fwdQuantDesc->src_desc());
+
+#ifdef DNN_CACHE_PRIMITIVES
+			fwdQuant = std::make_unique<dnnl::convolution_forward>(dnnl::convolution_forward(*fwdQuantDesc));
 #endif
 		}
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
-			auto memSrc = dnnl::memory(*InputLayer->DstMemDesc, Device.engine, InputLayer->Neurons.data());
+			if (Quantized && !training)
+			{
+				auto memSrc = dnnl::memory(*InputLayer->DstMemDesc, Device.engine, InputLayer->Neurons.data());
+				auto srcMem = QuantizeSrc(memSrc, srcScaleMem);
+				auto args = std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsQuantMem }, { DNNL_ARG_DST, dnnl::memory(*DstMemDesc, Device.engine, Neurons.data()) }, { DNNL_ARG_ATTR_SCALES | DNNL_ARG_SRC, srcScaleMem }, { DNNL_ARG_ATTR_SCALES | DNNL_ARG_WEIGHTS, weightsScalesMem } };
+				if (HasBias)
+					args.insert({ DNNL_ARG_BIAS, dnnl::memory(fwdQuantDesc->bias_desc(), Device.engine, BiasesData()) });
+#ifdef DNN_CACHE_PRIMITIVES
+				fwdQuant->execute(Device.stream, args);
+#else
+				dnnl::convolution_forward(*fwdQuantDesc).execute(Device.stream, args);
+#endif
+				Device.stream.wait();
+				
+				return;
+			}
+
+			// a training pass moves the running statistics of the epilogue
+			if (training)
+				foldedStale = true;
+
+			// the direct kernel reads the input in place, it replaces the grouped convolution of oneDNN except with fake quantization
+			if (direct && !(FakeQuantization && training))
+			{
+				ForwardDirect(batchSize, training);
+
+#ifndef DNN_LEAN
+				if (training && !GradientOverwritten)
+					InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
+#endif // DNN_LEAN
+				return;
+			}
+
+			if (!training && !inferenceArgs.empty())
+			{
+#ifdef DNN_CACHE_PRIMITIVES
+				fwd->execute(Device.stream, inferenceArgs);
+#else
+				dnnl::convolution_forward(*fwdDesc).execute(Device.stream, inferenceArgs);
+#endif
+				Device.stream.wait();
+
+				return;
+			}
+
+			const auto fakeQuant = FakeQuantization && training;
+			auto memSrc = dnnl::memory(*InputLayer->DstMemDesc, Device.engine, fakeQuant ? FakeQuantizeSrc(batchSize) : InputLayer->Neurons.data());
 			auto srcMem = reorderFwdSrc ? dnnl::memory(fwdDesc->src_desc(), Device.engine) : memSrc;
 			if (reorderFwdSrc)
 			{
@@ -170,22 +508,22 @@ namespace dnn
 				Device.stream.wait();
 			}
 
-			auto weightsMem = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+			auto weightsMem = dnnl::memory(*WeightsMemDesc, Device.engine, fakeQuant ? FakeQuantizeWeights() : WeightsData());
 
 			auto dstMem = dnnl::memory(*DstMemDesc, Device.engine, Neurons.data());
 
 #ifdef DNN_CACHE_PRIMITIVES
 			HasBias ?
-				fwd->execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, Biases.data()) }, { DNNL_ARG_DST, dstMem } }) :
+				fwd->execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, BiasesData()) }, { DNNL_ARG_DST, dstMem } }) :
 				fwd->execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_DST, dstMem } });
 #else
-			HasBias ? dnnl::convolution_forward(*fwdDesc).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, Biases.data()) }, { DNNL_ARG_DST, dstMem } }) :
+			HasBias ? dnnl::convolution_forward(*fwdDesc).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_BIAS, dnnl::memory(fwdDesc->bias_desc(), Device.engine, BiasesData()) }, { DNNL_ARG_DST, dstMem } }) :
 				dnnl::convolution_forward(*fwdDesc).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_SRC, srcMem}, { DNNL_ARG_WEIGHTS, weightsMem }, { DNNL_ARG_DST, dstMem } });
 #endif
 			Device.stream.wait();
 
 #ifndef DNN_LEAN
-			if (training)
+			if (training && !GradientOverwritten)
 				InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 #else
 			DNN_UNREF_PAR(batchSize);
@@ -208,7 +546,7 @@ namespace dnn
 				Device.stream.wait();
 			}
 
-			auto memSrc = dnnl::memory(*InputLayerFwd->DstMemDesc, Device.engine, InputLayerFwd->Neurons.data());
+			auto memSrc = dnnl::memory(*InputLayerFwd->DstMemDesc, Device.engine, FakeQuantization ? InputFakeQuant.data() : InputLayerFwd->Neurons.data());
 			auto srcMem = reorderBwdSrc ? dnnl::memory(bwdWeightsDesc->src_desc(), Device.engine) : memSrc;
 			if (reorderBwdSrc)
 			{
@@ -236,7 +574,7 @@ namespace dnn
 				Device.stream.wait();
 			}
 
-			auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+			auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, FakeQuantization ? WeightsFakeQuant.data() : WeightsData());
 			auto weightsMem = reorderBwdWeights ? dnnl::memory(bwdDataDesc->weights_desc(), Device.engine) : memWeights;
 			if (reorderBwdWeights)
 			{
@@ -293,7 +631,7 @@ namespace dnn
 			{
 				weights = FloatVector(WeightsMemDesc->get_size() / sizeof(Float));
 
-				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, Weights.data());
+				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
 				auto weightsMem = dnnl::memory(*PersistWeightsMemDesc, Device.engine, weights.data());
 
 				dnnl::reorder(memWeights, weightsMem).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memWeights}, { DNNL_ARG_TO, weightsMem } });
@@ -1,5 +1,5 @@
 #pragma once
-#include "Layer.h"
+#include "ElementwiseChain.h"
 
 namespace dnn
 {
@@ -51,6 +51,12 @@ namespace dnn
 			return 1;
 		}
 
+		// a broadcast input is summed into over H x W, only the other one has its gradient written whole
+		bool OverwritesInputGradient(const Layer* inputLayer) const final override
+		{
+			return !Fused && !Chain && (EqualDimensions(InputsFwd) || inputLayer == InputsFwd[first]);
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (Inputs[first]->DstMemDesc->get_ndims() == 2)
@@ -88,6 +94,15 @@ namespace dnn
 		}
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
+			if (Fused)	// computed by the root of its elementwise chain
+				return;
+
+			if (Chain)
+			{
+				Chain->ForwardProp(batchSize, training);
+				return;
+			}
+
 			const auto fullDepth = true; // SurvivalProbability[0] == Float(1) && SurvivalProbability[1] == Float(1);
 			scales[0] = fullDepth ? Float(1) : (Inputs[0]->Skip ? Float(0) : Float(1));
 			scales[1] = fullDepth ? Float(1) : (Inputs[1]->Skip ? Float(0) : Float(1));
@@ -114,14 +129,16 @@ namespace dnn
 								{
 									(VecFloat().load_a(&Inputs[0]->Neurons[cdhw]) / VecFloat().load_a(&Inputs[1]->Neurons[cdhw])).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 								}
 								for (auto cdhw = part; cdhw < size; cdhw++)
 								{
 									Neurons[cdhw] = Inputs[0]->Neurons[cdhw] / Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							}
@@ -137,14 +154,16 @@ namespace dnn
 									In1.load_a(&Inputs[1]->Neurons[cdhw]);
 									((In0 * scales0) / (In1 * scales1)).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 								}
 								for (auto cdhw = part; cdhw < size; cdhw++)
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) / (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							}
@@ -161,7 +180,8 @@ namespace dnn
 									{
 										(VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) / VecFloat().load_a(&Inputs[second]->Neurons[c])).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -179,7 +199,8 @@ namespace dnn
 									{
 										((VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) * scales0) / (VecFloat().load_a(&Inputs[second]->Neurons[c]) * scales1)).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -197,7 +218,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = Inputs[0]->Neurons[cdhw] / Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							}
@@ -210,7 +232,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) / (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							}
@@ -227,7 +250,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = Inputs[first]->Neurons[hw + outputOffset] / Inputs[second]->Neurons[c];
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -244,7 +268,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = (Inputs[first]->Neurons[hw + outputOffset] * scales0) / (Inputs[second]->Neurons[c] * scales1);
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -268,14 +293,16 @@ namespace dnn
 									{
 										(VecFloat().load_a(&Inputs[0]->Neurons[cdhw]) / VecFloat().load_a(&Inputs[1]->Neurons[cdhw])).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 									}
 									for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 									{
 										Neurons[cdhw] = Inputs[0]->Neurons[cdhw] / Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-										NeuronsD1[cdhw] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[cdhw] = 0;
 #endif
 									}
 								});
@@ -295,14 +322,16 @@ namespace dnn
 										In1.load_a(&Inputs[1]->Neurons[cdhw]);
 										((In0 * scales0) / (In1 * scales1)).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 									}
 									for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 									{
 										Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) / (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-										NeuronsD1[cdhw] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[cdhw] = 0;
 #endif
 									}
 								});
@@ -322,7 +351,8 @@ namespace dnn
 										{
 											(VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) / VecFloat().load_a(&Inputs[second]->Neurons[channelOffset])).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+											if (!GradientOverwritten)
+												VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 										}
 									}
@@ -343,7 +373,8 @@ namespace dnn
 										{
 											((VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) * scales0) / (VecFloat().load_a(&Inputs[second]->Neurons[channelOffset]) * scales1)).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+											if (!GradientOverwritten)
+												VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 										}
 									}
@@ -366,7 +397,8 @@ namespace dnn
 									{
 										Neurons[cdhw] = Inputs[0]->Neurons[cdhw] / Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-										NeuronsD1[cdhw] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[cdhw] = 0;
 #endif
 									}
 								});
@@ -384,7 +416,8 @@ namespace dnn
 									{
 										Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) / (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-										NeuronsD1[cdhw] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[cdhw] = 0;
 #endif
 									}
 								});
@@ -405,7 +438,8 @@ namespace dnn
 										{
 											Neurons[hw + outputOffset] = Inputs[first]->Neurons[hw + outputOffset] / Inputs[second]->Neurons[channelOffset];
 #ifndef DNN_LEAN
-											NeuronsD1[hw + outputOffset] = 0;
+											if (!GradientOverwritten)
+												NeuronsD1[hw + outputOffset] = 0;
 #endif
 										}
 									}
@@ -426,7 +460,8 @@ namespace dnn
 										{
 											Neurons[hw + outputOffset] = ((Inputs[first]->Neurons[hw + outputOffset] * scales0)  / (Inputs[second]->Neurons[channelOffset] * scales1));
 #ifndef DNN_LEAN
-											NeuronsD1[hw + outputOffset] = 0;
+											if (!GradientOverwritten)
+												NeuronsD1[hw + outputOffset] = 0;
 #endif
 										}
 									}
@@ -451,10 +486,23 @@ namespace dnn
 
 		void BackwardProp(const UInt batchSize) final override
 		{
+			if (Fused)
+				return;
+
+			if (Chain)
+			{
+				Chain->BackwardProp(batchSize);
+				return;
+			}
+
 #ifdef DNN_LEAN
 			ZeroGradientMulti(batchSize);
 #endif // DNN_LEAN
 
+			const auto overwrite0 = OverwritesInput(0);
+			const auto overwrite1 = OverwritesInput(1);
+			const auto overwriteFirst = OverwritesInput(first);
+
 			const auto plain = IsPlainFormat();
 			const auto size = plain ? CDHW() : PaddedCDHW();
 			const auto threads = batchSize == 1 ? 1ull : GetThreads(batchSize * size, Float(4));
@@ -468,8 +516,8 @@ namespace dnn
 					{
 						for (auto cdhw = 0ull; cdhw < PaddedCDHW(); cdhw += VectorSize)
 						{
-							mul_add(approx_recipr(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw])), VecFloat().load_a(&NeuronsD1[cdhw]), VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-							mul_add(VecFloat().load_a(&Inputs[0]->Neurons[cdhw]) * VecFloat().load_a(&NeuronsD1[cdhw]), approx_recipr(square(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw]))), VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+							mul_add(approx_recipr(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw])), VecFloat().load_a(&NeuronsD1[cdhw]), (overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]))).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+							nmul_add(VecFloat().load_a(&Inputs[0]->Neurons[cdhw]) * VecFloat().load_a(&NeuronsD1[cdhw]), approx_recipr(square(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw]))), (overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]))).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 						}
 					}
 					else
@@ -477,8 +525,8 @@ namespace dnn
 						PRAGMA_OMP_SIMD()
 						for (auto cdhw = 0ull; cdhw < CDHW(); cdhw++)
 						{
-							Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] / InputsFwd[1]->Neurons[cdhw];
-							Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * InputsFwd[0]->Neurons[cdhw] / Square<Float>(InputsFwd[1]->Neurons[cdhw]);
+							Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] / InputsFwd[1]->Neurons[cdhw];
+							Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) - NeuronsD1[cdhw] * InputsFwd[0]->Neurons[cdhw] / Square<Float>(InputsFwd[1]->Neurons[cdhw]);
 						}
 					}
 				}
@@ -495,8 +543,8 @@ namespace dnn
 							for (auto hw = 0ull; hw < strideHW; hw += VectorSize)
 							{
 								neuronsD1.load_a(&NeuronsD1[hw + outputOffset]);
-								mul_add(neuronsD1, approx_recipr(VecFloat().load_a(&InputsFwd[second]->Neurons[c])), VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
-								mul_add(neuronsD1 * VecFloat().load_a(&InputsFwd[first]->Neurons[hw + outputOffset]), approx_recipr(square(VecFloat().load_a(&InputsFwd[second]->NeuronsD1[c]))), VecFloat().load_a(&Inputs[second]->NeuronsD1[c])).store_a(&Inputs[second]->NeuronsD1[c]);
+								mul_add(neuronsD1, approx_recipr(VecFloat().load_a(&InputsFwd[second]->Neurons[c])), (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+								nmul_add(neuronsD1 * VecFloat().load_a(&InputsFwd[first]->Neurons[hw + outputOffset]), approx_recipr(square(VecFloat().load_a(&InputsFwd[second]->Neurons[c]))), VecFloat().load_a(&Inputs[second]->NeuronsD1[c])).store_a(&Inputs[second]->NeuronsD1[c]);
 							}
 						}
 					}
@@ -508,8 +556,8 @@ namespace dnn
 							PRAGMA_OMP_SIMD()
 							for (auto hw = 0ull; hw < HW(); hw++)
 							{
-								Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset] / InputsFwd[second]->Neurons[c];
-								Inputs[second]->NeuronsD1[c] += NeuronsD1[hw + outputOffset] * InputsFwd[first]->Neurons[hw + outputOffset] / Square<Float>(InputsFwd[second]->Neurons[c]);
+								Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset] / InputsFwd[second]->Neurons[c];
+								Inputs[second]->NeuronsD1[c] -= NeuronsD1[hw + outputOffset] * InputsFwd[first]->Neurons[hw + outputOffset] / Square<Float>(InputsFwd[second]->Neurons[c]);
 							}
 						}
 						
@@ -529,8 +577,8 @@ namespace dnn
 							const auto end = start + PaddedCDHW();
 							for (auto cdhw = start; cdhw < end; cdhw += VectorSize)
 							{
-								mul_add(approx_recipr(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw])), VecFloat().load_a(&NeuronsD1[cdhw]), VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-								mul_add(VecFloat().load_a(&InputsFwd[0]->Neurons[cdhw]) * VecFloat().load_a(&NeuronsD1[cdhw]), approx_recipr(square(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw]))), VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+								mul_add(approx_recipr(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw])), VecFloat().load_a(&NeuronsD1[cdhw]), (overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]))).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+								nmul_add(VecFloat().load_a(&InputsFwd[0]->Neurons[cdhw]) * VecFloat().load_a(&NeuronsD1[cdhw]), approx_recipr(square(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw]))), (overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]))).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 							}
 						});
 					}
@@ -544,8 +592,8 @@ namespace dnn
 							PRAGMA_OMP_SIMD()
 							for (auto cdhw = start; cdhw < end; cdhw++)
 							{
-								Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] / InputsFwd[1]->Neurons[cdhw];
-								Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * InputsFwd[0]->Neurons[cdhw] / Square<Float>(InputsFwd[1]->Neurons[cdhw]);
+								Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] / InputsFwd[1]->Neurons[cdhw];
+								Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) - NeuronsD1[cdhw] * InputsFwd[0]->Neurons[cdhw] / Square<Float>(InputsFwd[1]->Neurons[cdhw]);
 							}
 						});
 					}
@@ -566,8 +614,8 @@ namespace dnn
 								for (auto hw = 0ull; hw < strideHW; hw += VectorSize)
 								{
 									neuronsD1.load_a(&NeuronsD1[hw + outputOffset]);
-									mul_add(neuronsD1, approx_recipr(VecFloat().load_a(&InputsFwd[second]->Neurons[channelOffset])), VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
-									mul_add(neuronsD1 * VecFloat().load_a(&InputsFwd[first]->Neurons[hw + outputOffset]), approx_recipr(square(VecFloat().load_a(&InputsFwd[second]->NeuronsD1[channelOffset]))), VecFloat().load_a(&Inputs[second]->NeuronsD1[channelOffset])).store_a(&Inputs[second]->NeuronsD1[channelOffset]);
+									mul_add(neuronsD1, approx_recipr(VecFloat().load_a(&InputsFwd[second]->Neurons[channelOffset])), (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+									nmul_add(neuronsD1 * VecFloat().load_a(&InputsFwd[first]->Neurons[hw + outputOffset]), approx_recipr(square(VecFloat().load_a(&InputsFwd[second]->Neurons[channelOffset]))), VecFloat().load_a(&Inputs[second]->NeuronsD1[channelOffset])).store_a(&Inputs[second]->NeuronsD1[channelOffset]);
 								}
 							}
 						});
@@ -582,8 +630,8 @@ namespace dnn
 								const auto channelOffset = n * C + c;
 								for (auto hw = 0ull; hw < HW(); hw++)
 								{
-									Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset] / InputsFwd[second]->Neurons[channelOffset];
-									Inputs[second]->NeuronsD1[channelOffset] += NeuronsD1[hw + outputOffset] * InputsFwd[first]->Neurons[hw + outputOffset] / Square<Float>(InputsFwd[second]->Neurons[channelOffset]);
+									Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset] / InputsFwd[second]->Neurons[channelOffset];
+									Inputs[second]->NeuronsD1[channelOffset] -= NeuronsD1[hw + outputOffset] * InputsFwd[first]->Neurons[hw + outputOffset] / Square<Float>(InputsFwd[second]->Neurons[channelOffset]);
 								}
 							}
 						});
@@ -57,6 +57,16 @@ namespace dnn
 			return 1;
 		}
 
+		bool Recomputable() const final override
+		{
+			return false;
+		}
+
+		bool OverwritesGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			DNN_UNREF_PAR(batchSize);
@@ -101,7 +111,8 @@ namespace dnn
 						mask.store_a(&NeuronsActive[i]);
 						(mask * Scale * VecFloat().load_a(&InputLayer->Neurons[i])).store_a(&Neurons[i]);
 #ifndef DNN_LEAN
-						VecFloat(0).store_nt(&NeuronsD1[i]);
+						if (!GradientOverwritten)
+							VecFloat(0).store_nt(&NeuronsD1[i]);
 #endif
 					}
 					for (auto i = part; i < size; i++)
@@ -109,7 +120,8 @@ namespace dnn
 						NeuronsActive[i] = Bernoulli<Float>(Keep);
 						Neurons[i] = NeuronsActive[i] * Scale * InputLayer->Neurons[i];
 #ifndef DNN_LEAN
-						NeuronsD1[i] = Float(0);
+						if (!GradientOverwritten)
+							NeuronsD1[i] = Float(0);
 #endif
 					}
 				}
@@ -126,7 +138,8 @@ namespace dnn
 							mask.store_a(&NeuronsActive[i]);
 							(mask * Scale * VecFloat().load_a(&InputLayer->Neurons[i])).store_a(&Neurons[i]);
 #ifndef DNN_LEAN
-							VecFloat(0).store_nt(&NeuronsD1[i]);
+							if (!GradientOverwritten)
+								VecFloat(0).store_nt(&NeuronsD1[i]);
 #endif
 						}
 						for (auto i = end; i < start + size; i++)
@@ -134,7 +147,8 @@ namespace dnn
 							NeuronsActive[i] = Bernoulli<Float>(Keep);
 							Neurons[i] = NeuronsActive[i] * Scale * InputLayer->Neurons[i];
 #ifndef DNN_LEAN
-							NeuronsD1[i] = Float(0);
+							if (!GradientOverwritten)
+								NeuronsD1[i] = Float(0);
 #endif
 						}
 					});
@@ -172,6 +186,8 @@ namespace dnn
 			const auto size = IsPlainFormat() ? CDHW() : PaddedCDHW();
 			const auto part = GetVectorPart(size);
 			const auto threads = GetThreads(batchSize * size);
+			// the gradient of the input is written, and only added to when the input is shared
+			const auto accumulate = SharesInput;
 			
 			if (Enabled)
 			{
@@ -179,9 +195,9 @@ namespace dnn
 				if (batchSize == 1)
 				{
 					for (auto i = 0ull; i < part; i += VectorSize)
-						mul_add(VecFloat().load_a(&NeuronsActive[i]), VecFloat().load_a(&NeuronsD1[i]), VecFloat().load_a(&InputLayer->NeuronsD1[i])).store_a(&InputLayer->NeuronsD1[i]);
+						(accumulate ? mul_add(VecFloat().load_a(&NeuronsActive[i]), VecFloat().load_a(&NeuronsD1[i]), VecFloat().load_a(&InputLayer->NeuronsD1[i])) : VecFloat().load_a(&NeuronsActive[i]) * VecFloat().load_a(&NeuronsD1[i])).store_a(&InputLayer->NeuronsD1[i]);
 					for (auto i = part; i < size; i++)
-						InputLayer->NeuronsD1[i] += NeuronsActive[i] * NeuronsD1[i];
+						InputLayer->NeuronsD1[i] = (accumulate ? InputLayer->NeuronsD1[i] : Float(0)) + NeuronsActive[i] * NeuronsD1[i];
 				}
 				else
 #endif
@@ -190,9 +206,9 @@ namespace dnn
 						const auto start = b * size;
 						const auto end = start + part;
 						for (auto i = start; i < end; i += VectorSize)
-							mul_add(VecFloat().load_a(&NeuronsActive[i]), VecFloat().load_a(&NeuronsD1[i]), VecFloat().load_a(&InputLayer->NeuronsD1[i])).store_a(&InputLayer->NeuronsD1[i]);
+							(accumulate ? mul_add(VecFloat().load_a(&NeuronsActive[i]), VecFloat().load_a(&NeuronsD1[i]), VecFloat().load_a(&InputLayer->NeuronsD1[i])) : VecFloat().load_a(&NeuronsActive[i]) * VecFloat().load_a(&NeuronsD1[i])).store_a(&InputLayer->NeuronsD1[i]);
 						for (auto i = end; i < start + size; i++)
-							InputLayer->NeuronsD1[i] += NeuronsActive[i] * NeuronsD1[i];
+							InputLayer->NeuronsD1[i] = (accumulate ? InputLayer->NeuronsD1[i] : Float(0)) + NeuronsActive[i] * NeuronsD1[i];
 					});
 			}
 			else
@@ -201,9 +217,9 @@ namespace dnn
 				if (batchSize == 1)
 				{
 					for (auto i = 0ull; i < part; i += VectorSize)
-						(VecFloat().load_a(&InputLayer->NeuronsD1[i]) + VecFloat().load_a(&NeuronsD1[i])).store_a(&InputLayer->NeuronsD1[i]);
+						(accumulate ? VecFloat().load_a(&InputLayer->NeuronsD1[i]) + VecFloat().load_a(&NeuronsD1[i]) : VecFloat().load_a(&NeuronsD1[i])).store_a(&InputLayer->NeuronsD1[i]);
 					for (auto i = part; i < size; i++)
-						InputLayer->NeuronsD1[i] += NeuronsD1[i];
+						InputLayer->NeuronsD1[i] = (accumulate ? InputLayer->NeuronsD1[i] : Float(0)) + NeuronsD1[i];
 				}
 				else
 #endif
@@ -212,9 +228,9 @@ namespace dnn
 						const auto start = b * size;
 						const auto end = start + part;
 						for (auto i = start; i < end; i += VectorSize)
-							(VecFloat().load_a(&InputLayer->NeuronsD1[i]) + VecFloat().load_a(&NeuronsD1[i])).store_a(&InputLayer->NeuronsD1[i]);
+							(accumulate ? VecFloat().load_a(&InputLayer->NeuronsD1[i]) + VecFloat().load_a(&NeuronsD1[i]) : VecFloat().load_a(&NeuronsD1[i])).store_a(&InputLayer->NeuronsD1[i]);
 						for (auto i = end; i < start + size; i++)
-							InputLayer->NeuronsD1[i] += NeuronsD1[i];
+							InputLayer->NeuronsD1[i] = (accumulate ? InputLayer->NeuronsD1[i] : Float(0)) + NeuronsD1[i];
 					});
 			}
 #ifdef DNN_LEAN
@@ -0,0 +1,388 @@
+#pragma once
+#include "Layer.h"
+
+namespace dnn
+{
+	enum class ElementwiseOps
+	{
+		Input = 0,
+		Sum = 1,			// Add, Substract and Average
+		Multiply = 2,
+		Divide = 3,
+		Max = 4,
+		Min = 5,
+		Activation = 6
+	};
+
+	// one step of an elementwise chain, the steps only read earlier ones and the last one is the root of the chain:
+	// Input reads Owner->InputsFwd[Index[0]] (Broadcast: an N x C x 1 x 1 input spread over D x H x W) and hands its gradient to Owner->Inputs[Index[0]],
+	// the other steps compute the chain layer Owner from the steps Operands[0] and Operands[1] (its inputs Index[0] and Index[1], first and second)
+	struct ElementwiseNode
+	{
+		typedef Float(*FloatFuncPtrType)(const Float&, const Float&, const Float&);
+		typedef VecFloat(*VecFloatFuncPtrType)(const VecFloat&, const Float&, const Float&);
+
+		ElementwiseOps Op;
+		Layer* Owner;
+		std::array<Byte, 2> Index;
+		std::array<UInt, 2> Operands;
+		bool Broadcast;
+		// Sum: a * Weights[0] + b * Weights[1], with stochastic depth (SurvivalProbability not 1) a skipped input weighs 0 and the other +1 or -1 like in the layer
+		std::array<Float, 2> Weights;
+		std::array<Float, 2> Scales;
+		const FloatVector* SurvivalProbability;
+		// Activation
+		FloatFuncPtrType f, df;
+		VecFloatFuncPtrType fVec, dfVec;
+		Float Alpha, Beta;
+
+		ElementwiseNode(const ElementwiseOps op, Layer* owner) :
+			Op(op),
+			Owner(owner),
+			Index({ Byte(0), Byte(0) }),
+			Operands({ 0ull, 0ull }),
+			Broadcast(false),
+			Weights({ Float(1), Float(1) }),
+			Scales({ Float(1), Float(1) }),
+			SurvivalProbability(nullptr),
+			f(nullptr),
+			df(nullptr),
+			fVec(nullptr),
+			dfVec(nullptr),
+			Alpha(Float(0)),
+			Beta(Float(0))
+		{
+		}
+
+		inline Layer* Fwd() const noexcept { return Owner->InputsFwd[Index[0]]; }
+
+		inline Layer* Bwd() const noexcept { return Owner->Inputs[Index[0]]; }
+	};
+
+	inline Float Apply(const ElementwiseNode& node, const Float x) { return node.f(x, node.Alpha, node.Beta); }
+	inline VecFloat Apply(const ElementwiseNode& node, const VecFloat& x) { return node.fVec(x, node.Alpha, node.Beta); }
+	inline Float Derivative(const ElementwiseNode& node, const Float x) { return node.df(x, node.Alpha, node.Beta); }
+	inline VecFloat Derivative(const ElementwiseNode& node, const VecFloat& x) { return node.dfVec(x, node.Alpha, node.Beta); }
+	inline Float Maximum(const Float a, const Float b) { return std::max(a, b); }
+	inline VecFloat Maximum(const VecFloat& a, const VecFloat& b) { return max(a, b); }
+	inline Float Minimum(const Float a, const Float b) { return std::min(a, b); }
+	inline VecFloat Minimum(const VecFloat& a, const VecFloat& b) { return min(a, b); }
+	inline Float Choose(const bool condition, const Float a, const Float b) { return condition ? a : b; }
+	inline VecFloat Choose(const VecFloatBool& condition, const VecFloat& a, const VecFloat& b) { return select(condition, a, b); }
+
+	// a maximal subgraph of elementwise layers (Model::FuseElementwiseChains) computed by its root in one pass over its inputs: the Neurons of the
+	// inputs outside the chain are read once, the steps are evaluated a vector at a time in registers and only the root writes its Neurons,
+	// backprop evaluates the steps again and takes the gradient of the root back through them (reverse mode) straight into the gradients of the inputs.
+	// A row is a channel of a plain sample or a channel block of a blocked sample, so a broadcast input holds one value (vector) per row
+	// and its gradient is summed over the row before it's added once
+	class ElementwiseChain final
+	{
+	private:
+		template<typename T, typename Input>
+		inline void Values(T* values, const Input& input) const
+		{
+			for (auto i = 0ull; i < Nodes.size(); i++)
+			{
+				const auto& node = Nodes[i];
+				switch (node.Op)
+				{
+				case ElementwiseOps::Input:
+					values[i] = input(i);
+					break;
+				case ElementwiseOps::Sum:
+					values[i] = values[node.Operands[0]] * node.Scales[0] + values[node.Operands[1]] * node.Scales[1];
+					break;
+				case ElementwiseOps::Multiply:
+					values[i] = values[node.Operands[0]] * values[node.Operands[1]];
+					break;
+				case ElementwiseOps::Divide:
+					values[i] = values[node.Operands[0]] / values[node.Operands[1]];
+					break;
+				case ElementwiseOps::Max:
+					values[i] = Maximum(values[node.Operands[0]], values[node.Operands[1]]);
+					break;
+				case ElementwiseOps::Min:
+					values[i] = Minimum(values[node.Operands[0]], values[node.Operands[1]]);
+					break;
+				case ElementwiseOps::Activation:
+					values[i] = Apply(node, values[node.Operands[0]]);
+					break;
+				}
+			}
+		}
+
+		// gradients[i] holds the gradient of step i once the steps reading it are done, Max (Min) hands it to the first input on ties like the layers
+		template<typename T>
+		inline void Gradients(const T* values, T* gradients) const
+		{
+			for (auto i = Nodes.size(); i-- > 0ull;)
+			{
+				const auto& node = Nodes[i];
+				const auto& gradient = gradients[i];
+				const auto& a = values[node.Operands[0]];
+				const auto& b = values[node.Operands[1]];
+				switch (node.Op)
+				{
+				case ElementwiseOps::Input:
+					break;
+				case ElementwiseOps::Sum:
+					gradients[node.Operands[0]] += gradient * node.Scales[0];
+					gradients[node.Operands[1]] += gradient * node.Scales[1];
+					break;
+				case ElementwiseOps::Multiply:
+					gradients[node.Operands[0]] += gradient * b;
+					gradients[node.Operands[1]] += gradient * a;
+					break;
+				case ElementwiseOps::Divide:
+					gradients[node.Operands[0]] += gradient / b;
+					gradients[node.Operands[1]] -= gradient * a / (b * b);
+					break;
+				case ElementwiseOps::Max:
+					gradients[node.Operands[0]] += Choose(a >= b, gradient, T(0));
+					gradients[node.Operands[1]] += Choose(a >= b, T(0), gradient);
+					break;
+				case ElementwiseOps::Min:
+					gradients[node.Operands[0]] += Choose(a <= b, gradient, T(0));
+					gradients[node.Operands[1]] += Choose(a <= b, T(0), gradient);
+					break;
+				case ElementwiseOps::Activation:
+					gradients[node.Operands[0]] += gradient * Derivative(node, a);
+					break;
+				}
+			}
+		}
+
+		// the weights of the sums for this pass, the layers decide on stochastic depth the same way
+		void Prepare()
+		{
+			for (auto& node : Nodes)
+				if (node.Op == ElementwiseOps::Sum)
+				{
+					const auto fullDepth = !node.SurvivalProbability || ((*node.SurvivalProbability)[0] == Float(1) && (*node.SurvivalProbability)[1] == Float(1));
+					for (auto i = 0ull; i < 2ull; i++)
+						node.Scales[i] = fullDepth ? node.Weights[i] : (node.Owner->InputsFwd[node.Index[i]]->Skip ? Float(0) : (node.Weights[i] < Float(0) ? Float(-1) : Float(1)));
+				}
+		}
+
+		// the values of the inputs in row (n, c): where a full input starts, the value of a broadcast input
+		void Row(const UInt n, const UInt c, const UInt start, const Float** sources, VecFloat* broadcasts) const
+		{
+			const auto plain = Root->IsPlainFormat();
+
+			for (auto i = 0ull; i < Nodes.size(); i++)
+			{
+				const auto& node = Nodes[i];
+				if (node.Op != ElementwiseOps::Input)
+					continue;
+
+				const auto input = node.Fwd();
+				if (!node.Broadcast)
+					sources[i] = input->Neurons.data() + start;
+				else if (plain)
+					broadcasts[i] = VecFloat(input->Neurons[n * (input->IsPlainFormat() ? input->C : input->PaddedC) + c]);
+				else if (input->IsPlainFormat())
+					broadcasts[i] = VecFloat().load_partial(static_cast<int>(std::min<UInt>(VectorSize, input->C - c * VectorSize)), input->Neurons.data() + n * input->C + c * VectorSize);
+				else
+					broadcasts[i] = VecFloat().load_a(input->Neurons.data() + n * input->PaddedC + c * VectorSize);
+			}
+		}
+
+		// the row state of a pass, kept per thread and grown to the largest chain the thread ran so a pass doesn't allocate
+		struct Scratch
+		{
+			std::vector<const Float*> Sources;
+			std::vector<VecFloat> Broadcasts;
+			std::vector<VecFloat> Values;
+			std::vector<VecFloat> Gradients;
+			std::vector<VecFloat> Sums;
+			std::vector<Float> ScalarValues;
+			std::vector<Float> ScalarGradients;
+			std::vector<Float> ScalarSums;
+		};
+
+		static Scratch& ThreadScratch(const UInt nodes)
+		{
+			static thread_local auto scratch = Scratch();
+
+			if (scratch.Values.size() < nodes)
+			{
+				scratch.Sources.resize(nodes, nullptr);
+				scratch.Broadcasts.resize(nodes, VecFloat(0));
+				scratch.Values.resize(nodes);
+				scratch.Gradients.resize(nodes);
+				scratch.Sums.resize(nodes);
+				scratch.ScalarValues.resize(nodes);
+				scratch.ScalarGradients.resize(nodes);
+				scratch.ScalarSums.resize(nodes);
+			}
+
+			return scratch;
+		}
+
+		const dnn::Device Device;
+
+	public:
+		Layer* Root;
+		std::vector<ElementwiseNode> Nodes;
+
+		ElementwiseChain(const dnn::Device& device, Layer* root) :
+			Device(device),
+			Root(root),
+			Nodes(std::vector<ElementwiseNode>())
+		{
+		}
+
+		void ForwardProp(const UInt batchSize, const bool training)
+		{
+			Prepare();
+
+			const auto plain = Root->IsPlainFormat();
+			const auto size = plain ? Root->CDHW() : Root->PaddedCDHW();
+			const auto rows = plain ? Root->C : Root->PaddedC / VectorSize;
+			const auto length = plain ? Root->DHW() : Root->DHW() * VectorSize;
+			const auto part = plain ? GetVectorPart(length) : length;
+			const auto threads = batchSize == 1ull ? 1ull : GetThreads(batchSize * size, Float(10));
+#ifndef DNN_LEAN
+			const auto zeroGradient = training && !Root->GradientOverwritten;
+#else
+			DNN_UNREF_PAR(training);
+#endif // DNN_LEAN
+
+			for_i(batchSize, threads, [=](UInt n)
+			{
+				auto& scratch = ThreadScratch(Nodes.size());
+				const auto sources = scratch.Sources.data();
+				const auto broadcasts = scratch.Broadcasts.data();
+				const auto values = scratch.Values.data();
+				const auto scalarValues = scratch.ScalarValues.data();
+				const auto nodes = Nodes.size();
+
+				for (auto c = 0ull; c < rows; c++)
+				{
+					const auto start = n * size + c * length;
+					Row(n, c, start, sources, broadcasts);
+
+					for (auto i = 0ull; i < part; i += VectorSize)
+					{
+						Values(values, [&](const UInt node) { return Nodes[node].Broadcast ? broadcasts[node] : VecFloat().load(sources[node] + i); });
+						values[nodes - 1ull].store(Root->Neurons.data() + start + i);
+#ifndef DNN_LEAN
+						if (zeroGradient)
+							VecFloat(0).store(Root->NeuronsD1.data() + start + i);
+#endif // DNN_LEAN
+					}
+					for (auto i = part; i < length; i++)
+					{
+						Values(scalarValues, [&](const UInt node) { return Nodes[node].Broadcast ? broadcasts[node][0] : sources[node][i]; });
+						Root->Neurons[start + i] = scalarValues[nodes - 1ull];
+#ifndef DNN_LEAN
+						if (zeroGradient)
+							Root->NeuronsD1[start + i] = Float(0);
+#endif // DNN_LEAN
+					}
+				}
+			});
+		}
+
+		void BackwardProp(const UInt batchSize)
+		{
+			Prepare();
+
+#ifdef DNN_LEAN
+			for (const auto& node : Nodes)
+				if (node.Op == ElementwiseOps::Input)
+					node.Bwd()->NeuronsD1.resize(batchSize, node.Bwd()->C, node.Bwd()->H, node.Bwd()->W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
+#endif // DNN_LEAN
+
+			const auto plain = Root->IsPlainFormat();
+			const auto size = plain ? Root->CDHW() : Root->PaddedCDHW();
+			const auto rows = plain ? Root->C : Root->PaddedC / VectorSize;
+			const auto length = plain ? Root->DHW() : Root->DHW() * VectorSize;
+			const auto part = plain ? GetVectorPart(length) : length;
+			const auto threads = batchSize == 1ull ? 1ull : GetThreads(batchSize * size, Float(10));
+
+			for_i(batchSize, threads, [=](UInt n)
+			{
+				auto& scratch = ThreadScratch(Nodes.size());
+				const auto sources = scratch.Sources.data();
+				const auto broadcasts = scratch.Broadcasts.data();
+				const auto values = scratch.Values.data();
+				const auto gradients = scratch.Gradients.data();
+				const auto sums = scratch.Sums.data();
+				const auto scalarValues = scratch.ScalarValues.data();
+				const auto scalarGradients = scratch.ScalarGradients.data();
+				const auto scalarSums = scratch.ScalarSums.data();
+				const auto nodes = Nodes.size();
+
+				for (auto c = 0ull; c < rows; c++)
+				{
+					const auto start = n * size + c * length;
+					Row(n, c, start, sources, broadcasts);
+					std::fill_n(sums, nodes, VecFloat(0));
+					std::fill_n(scalarSums, nodes, Float(0));
+
+					for (auto i = 0ull; i < part; i += VectorSize)
+					{
+						Values(values, [&](const UInt node) { return Nodes[node].Broadcast ? broadcasts[node] : VecFloat().load(sources[node] + i); });
+						std::fill_n(gradients, nodes, VecFloat(0));
+						gradients[nodes - 1ull].load(Root->NeuronsD1.data() + start + i);
+						Gradients(values, gradients);
+
+						for (auto node = 0ull; node < Nodes.size(); node++)
+							if (Nodes[node].Op == ElementwiseOps::Input)
+							{
+								if (Nodes[node].Broadcast)
+									sums[node] += gradients[node];
+								else
+								{
+									const auto inputD1 = Nodes[node].Bwd()->NeuronsD1.data() + start + i;
+									(VecFloat().load(inputD1) + gradients[node]).store(inputD1);
+								}
+							}
+					}
+					for (auto i = part; i < length; i++)
+					{
+						Values(scalarValues, [&](const UInt node) { return Nodes[node].Broadcast ? broadcasts[node][0] : sources[node][i]; });
+						std::fill_n(scalarGradients, nodes, Float(0));
+						scalarGradients[nodes - 1ull] = Root->NeuronsD1[start + i];
+						Gradients(scalarValues, scalarGradients);
+
+						for (auto node = 0ull; node < Nodes.size(); node++)
+							if (Nodes[node].Op == ElementwiseOps::Input)
+							{
+								if (Nodes[node].Broadcast)
+									scalarSums[node] += scalarGradients[node];
+								else
+									Nodes[node].Bwd()->NeuronsD1[start + i] += scalarGradients[node];
+							}
+					}
+
+					for (auto node = 0ull; node < Nodes.size(); node++)
+					{
+						if (Nodes[node].Op != ElementwiseOps::Input || !Nodes[node].Broadcast)
+							continue;
+
+						const auto input = Nodes[node].Bwd();
+						if (plain)
+							input->NeuronsD1[n * (input->IsPlainFormat() ? input->C : input->PaddedC) + c] += horizontal_add(sums[node]) + scalarSums[node];
+						else if (input->IsPlainFormat())
+						{
+							const auto count = static_cast<int>(std::min<UInt>(VectorSize, input->C - c * VectorSize));
+							const auto inputD1 = input->NeuronsD1.data() + n * input->C + c * VectorSize;
+							(VecFloat().load_partial(count, inputD1) + sums[node]).store_partial(count, inputD1);
+						}
+						else
+						{
+							const auto inputD1 = input->NeuronsD1.data() + n * input->PaddedC + c * VectorSize;
+							(VecFloat().load_a(inputD1) + sums[node]).store_a(inputD1);
+						}
+					}
+				}
+			});
+
+#ifdef DNN_LEAN
+			Root->ReleaseGradient();
+#endif // DNN_LEAN
+		}
+	};
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include "MappedFile.h"
+#include "Model.h"
+
+namespace dnn
+{
+	// feature file: FeatureFileHeader, Layers x FeatureLayerRecord, then Samples rows of RowBytes at DataOffset,
+	// a row holds the features of the layers in the requested order, C x H x W values each (C with global pooling) in fp32 or fp16
+	struct FeatureFileHeader
+	{
+		char Magic[8];
+		std::uint64_t Version;
+		std::uint64_t Samples;
+		std::uint64_t Layers;
+		std::uint64_t HalfPrecision;
+		std::uint64_t RowBytes;
+		std::uint64_t DataOffset;
+	};
+
+	struct FeatureLayerRecord
+	{
+		char Name[64];
+		std::uint64_t C;
+		std::uint64_t H;
+		std::uint64_t W;
+	};
+
+	// forward-only pass over a dataset split streaming the Neurons of named layers into a mapped file:
+	// batch k + 1 is read while batch k is forwarded and batch k - 1 is written, so only two batches of features are held in memory
+	class FeatureExtractor final
+	{
+	private:
+		Model& model;
+		std::vector<Layer*> layers;
+		UInt lastLayer;
+		std::vector<UInt> blockOffsets;		// per layer offset of its N x C x H x W block in a gathered batch
+		std::vector<UInt> rowOffsets;		// per layer byte offset in a row
+		UInt gatheredSize;
+		UInt rowBytes;
+		FloatVector input[2];
+		FloatVector gathered[2];
+
+		// the Neurons of the layers in plain layout, ready to be overwritten by the next forward pass
+		void Gather(FloatVector& dst)
+		{
+			const auto N = model.BatchSize;
+
+			for (auto l = 0ull; l < layers.size(); l++)
+			{
+				auto layer = layers[l];
+				if (layer->IsPlainFormat())
+					std::copy_n(layer->Neurons.data(), N * layer->CDHW(), dst.data() + blockOffsets[l]);
+				else
+				{
+					const auto& desc = *layer->DstMemDesc;
+					const auto ndims = desc.get_ndims();
+					const auto tag = ndims == 2 ? dnnl::memory::format_tag::nc : ndims == 5 ? dnnl::memory::format_tag::ncdhw : dnnl::memory::format_tag::nchw;
+					auto srcMem = dnnl::memory(desc, model.Device.engine, layer->Neurons.data());
+					auto dstMem = dnnl::memory(dnnl::memory::desc(desc.get_dims(), dnnl::memory::data_type::f32, tag), model.Device.engine, dst.data() + blockOffsets[l]);
+					dnnl::reorder(srcMem, dstMem).execute(model.Device.stream, std::unordered_map<int, dnnl::memory>{ { DNNL_ARG_FROM, srcMem }, { DNNL_ARG_TO, dstMem } });
+					model.Device.stream.wait();
+				}
+			}
+		}
+
+		void Write(const FloatVector& src, Byte* rows, const UInt samples, const bool globalPooling, const bool halfPrecision) const
+		{
+			for (auto n = 0ull; n < samples; n++)
+			{
+				auto row = rows + n * rowBytes;
+
+				for (auto l = 0ull; l < layers.size(); l++)
+				{
+					const auto layer = layers[l];
+					const auto C = layer->C;
+					const auto HW = layer->D * layer->H * layer->W;
+					const auto values = src.data() + blockOffsets[l] + n * C * HW;
+					const auto count = globalPooling ? C : C * HW;
+
+					auto pooled = FloatVector();
+					auto features = values;
+					if (globalPooling && HW > 1ull)
+					{
+						pooled = FloatVector(C);
+						for (auto c = 0ull; c < C; c++)
+						{
+							auto sum = Float(0);
+							for (auto hw = 0ull; hw < HW; hw++)
+								sum += values[c * HW + hw];
+							pooled[c] = sum / Float(HW);
+						}
+						features = pooled.data();
+					}
+
+					if (halfPrecision)
+					{
+						auto dst = reinterpret_cast<std::uint16_t*>(row + rowOffsets[l]);
+						for (auto i = 0ull; i < count; i++)
+							dst[i] = FloatToHalf(features[i]);
+					}
+					else
+						std::memcpy(row + rowOffsets[l], features, count * sizeof(Float));
+				}
+			}
+		}
+
+	public:
+		FeatureExtractor(Model& model, const std::vector<std::string>& layerNames) :
+			model(model),
+			layers(model.GetLayerInputs(layerNames)),
+			lastLayer(0),
+			gatheredSize(0),
+			rowBytes(0)
+		{
+			if (layers.empty())
+				throw std::invalid_argument("No layers in FeatureExtractor");
+
+			for (auto layer : layers)
+			{
+				if (!layer->Materialized())
+					throw std::invalid_argument("Layer " + layer->Name + " has no Neurons of its own in FeatureExtractor");
+
+				// at inference a depthwise epilogue writes the BatchNormActivation's Neurons instead of its own
+				const auto depthwise = dynamic_cast<const DepthwiseConvolution*>(layer);
+				if (depthwise && depthwise->Epilogue)
+					throw std::invalid_argument("Layer " + layer->Name + " computes " + depthwise->Epilogue->Name + " in its epilogue in FeatureExtractor");
+			}
+
+			for (auto i = 0ull; i < model.Layers.size(); i++)
+				for (auto layer : layers)
+					if (model.Layers[i].get() == layer)
+						lastLayer = std::max<UInt>(lastLayer, i);
+		}
+
+		// returns the number of samples written to fileName, the model keeps its batch size and resolution
+		UInt Extract(const std::string& fileName, const bool trainingSplit, const bool globalPooling, const bool halfPrecision)
+		{
+			if (!model.DataProv || model.Layers[0]->Neurons.empty())
+				throw std::invalid_argument("Model not ready in FeatureExtractor");
+
+			const auto& samples = trainingSplit ? model.DataProv->TrainingSamples : model.DataProv->TestingSamples;
+			const auto count = trainingSplit ? model.DataProv->TrainingSamplesCount : model.DataProv->TestingSamplesCount;
+			const auto N = model.BatchSize;
+			const auto elementSize = halfPrecision ? sizeof(std::uint16_t) : sizeof(Float);
+			const auto inputSize = N * model.Layers[0]->CDHW();
+
+			blockOffsets = std::vector<UInt>(layers.size());
+			rowOffsets = std::vector<UInt>(layers.size());
+			gatheredSize = 0ull;
+			rowBytes = 0ull;
+			for (auto l = 0ull; l < layers.size(); l++)
+			{
+				blockOffsets[l] = gatheredSize;
+				rowOffsets[l] = rowBytes;
+				gatheredSize += DivUp(N * layers[l]->CDHW());
+				rowBytes += (globalPooling ? layers[l]->C : layers[l]->CDHW()) * elementSize;
+			}
+
+			const auto headerSize = sizeof(FeatureFileHeader) + layers.size() * sizeof(FeatureLayerRecord);
+			const auto dataOffset = ((headerSize + 4095ull) / 4096ull) * 4096ull;
+			auto file = MappedFile(fileName, dataOffset + count * rowBytes);
+
+			auto header = FeatureFileHeader{ { 'D', 'N', 'N', 'F', 'E', 'A', 'T', '\0' }, 1ull, count, layers.size(), halfPrecision ? 1ull : 0ull, rowBytes, dataOffset };
+			std::memcpy(file.Data(), &header, sizeof(header));
+			for (auto l = 0ull; l < layers.size(); l++)
+			{
+				auto record = FeatureLayerRecord{ {}, layers[l]->C, globalPooling ? 1ull : layers[l]->H, globalPooling ? 1ull : layers[l]->W };
+				std::strncpy(record.Name, layers[l]->Name.c_str(), sizeof(record.Name) - 1ull);
+				std::memcpy(file.Data() + sizeof(header) + l * sizeof(record), &record, sizeof(record));
+			}
+
+			for (auto& buffer : input)
+				buffer = FloatVector(inputSize);
+			for (auto& buffer : gathered)
+				buffer = FloatVector(gatheredSize);
+
+			model.SwitchInplaceBwd(false);
+
+			auto reader = std::async(std::launch::async, [&] { model.PlainBatch(samples, count, 0ull, N, input[0].data()); });
+			auto writer = std::future<void>();
+
+			for (auto index = 0ull, batch = 0ull; index < count; index += N, batch++)
+			{
+				reader.get();
+				std::copy_n(input[batch % 2ull].data(), inputSize, model.Layers[0]->Neurons.data());
+				if (index + N < count)
+					reader = std::async(std::launch::async, [&, index, batch] { model.PlainBatch(samples, count, index + N, N, input[(batch + 1ull) % 2ull].data()); });
+
+				for (auto i = 1ull; i <= lastLayer; i++)
+					model.Layers[i]->ForwardProp(N, false);
+
+				Gather(gathered[batch % 2ull]);
+
+				if (writer.valid())
+					writer.get();
+				writer = std::async(std::launch::async, [&, index, batch] { Write(gathered[batch % 2ull], file.Data() + dataOffset + index * rowBytes, std::min<UInt>(N, count - index), globalPooling, halfPrecision); });
+			}
+
+			if (writer.valid())
+				writer.get();
+			file.Flush();
+
+			for (auto& buffer : input)
+				buffer = FloatVector();
+			for (auto& buffer : gathered)
+				buffer = FloatVector();
+
+			return count;
+		}
+	};
+}
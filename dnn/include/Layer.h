@@ -4,6 +4,7 @@
 namespace dnn
 {
 	class Model;
+	class ElementwiseChain;
 	
 	enum class Optimizers
 	{
@@ -311,6 +312,10 @@ namespace dnn
 		bool SharesInput;
 		bool SharesInputOriginal;
 		bool SharesInputInplace;
+		bool GradientOverwritten;
+		bool View;
+		bool Fused;
+		std::shared_ptr<ElementwiseChain> Chain;
 		dnnl::memory::format_tag Format;
 		const bool Scaling;
 		const bool HasBias;
@@ -358,6 +363,28 @@ namespace dnn
 		std::unique_ptr<dnnl::memory::desc> DiffDstMemDesc;
 		std::unique_ptr<dnnl::memory::desc> WeightsMemDesc;
 		std::unique_ptr<dnnl::memory::desc> PersistWeightsMemDesc;
+		bool Quantized;
+		Float QuantSrcMin;
+		Float QuantSrcMax;
+		FloatVector QuantWeightsScales;
+		std::unique_ptr<dnnl::reorder::primitive_desc> QuantSrcReorderDesc;
+		dnnl::memory QuantSrcMem;
+#ifdef DNN_CACHE_PRIMITIVES
+		std::unique_ptr<dnnl::reorder> QuantSrcReorder;
+#endif
+		bool FakeQuantization;
+		Float FakeQuantMomentum;
+		FloatVector InputFakeQuant;
+		FloatVector WeightsFakeQuant;
+		UInt WeightsFakeQuantVersion;
+		bool Checkpoint;
+		bool Recomputing;
+		std::shared_ptr<FloatArray> NeuronsPool;
+		UInt NeuronsPoolOffset;
+		FloatVector WeightsD1Sum;
+		FloatVector BiasesD1Sum;
+		Layer* SharedLayer;
+		UInt WeightsVersion;
 		
 
 		Layer(const dnn::Device& device, const dnnl::memory::format_tag format, const std::string& name, const LayerTypes layerType, const UInt weightCount, const UInt biasCount, const UInt c, const UInt d, const UInt h, const UInt w, const UInt padD, const UInt padH, const UInt padW, const std::vector<Layer*>& inputs, const bool hasBias = false, const bool scaling = false, const bool enabled = true) :
@@ -422,6 +449,9 @@ namespace dnn
 			SharesInput(false),
 			SharesInputOriginal(false),
 			SharesInputInplace(false),
+			GradientOverwritten(false),
+			View(false),
+			Fused(false),
 			Fwd(false),
 			Bwd(false),
 			NeuronsStats(Stats()),
@@ -429,7 +459,26 @@ namespace dnn
 			BiasesStats(Stats()),
 			fpropTime(std::chrono::duration<Float>(Float(0))),
 			bpropTime(std::chrono::duration<Float>(Float(0))),
-			updateTime(std::chrono::duration<Float>(Float(0)))
+			updateTime(std::chrono::duration<Float>(Float(0))),
+			Quantized(false),
+			QuantSrcMin(std::numeric_limits<Float>::max()),
+			QuantSrcMax(std::numeric_limits<Float>::lowest()),
+			QuantWeightsScales(FloatVector()),
+			QuantSrcReorderDesc(nullptr),
+			QuantSrcMem(),
+			FakeQuantization(false),
+			FakeQuantMomentum(Float(0.99)),
+			InputFakeQuant(FloatVector()),
+			WeightsFakeQuant(FloatVector()),
+			WeightsFakeQuantVersion(std::numeric_limits<UInt>::max()),
+			Checkpoint(true),
+			Recomputing(false),
+			NeuronsPool(nullptr),
+			NeuronsPoolOffset(0),
+			WeightsD1Sum(FloatVector()),
+			BiasesD1Sum(FloatVector()),
+			SharedLayer(nullptr),
+			WeightsVersion(0)
 		{
 		}
 
@@ -440,6 +489,14 @@ namespace dnn
 		inline auto CDHW() const noexcept { return C * D * H * W; }
 		inline auto PaddedCDHW() const noexcept { return LayerType == LayerTypes::Input ? (C * D * H * W) : (PaddedC * D * H * W); }
 
+		// inference contexts read the Weights and Biases of the layer they share them with, unless their own descriptors needed a reordered copy
+		inline Float* WeightsData() noexcept { return SharedLayer && Weights.empty() ? SharedLayer->Weights.data() : Weights.data(); }
+		inline Float* BiasesData() noexcept { return SharedLayer && Biases.empty() ? SharedLayer->Biases.data() : Biases.data(); }
+		
+		// counts the changes of the weights, biases and running statistics, so caches derived from them are rebuilt only after a change
+		inline UInt CurrentWeightsVersion() const noexcept { return SharedLayer && Weights.empty() ? SharedLayer->WeightsVersion : WeightsVersion; }
+		inline void WeightsChanged() noexcept { WeightsVersion++; }
+
 		virtual void UpdateResolution()	{ }
 
 		void SetParameters(const bool useDefaults, const Fillers weightsFiller, const FillerModes weightsFillerMode, const Float weightsGain, const Float weightsScale, const Float weightsLRM, const Float weightsWDM, const Fillers biasesFiller, const FillerModes biasesFillerMode, const Float biasesGain, const Float biasesScale, const Float biasesLRM, const Float biasesWDM)
@@ -494,6 +551,20 @@ namespace dnn
 			description.append(nwl + std::string(" Neurons:") + tab + std::to_string(CDHW()));
 			description.append(nwl + std::string(" Format:") + tab + std::string(dnnl_fmt_tag2str(static_cast<dnnl_format_tag_t>(ChosenFormat))));
 
+			if (View)
+			{
+				description.append(nwl + std::string(" View:") + dtab + InputLayer->Name + std::string("[") + std::to_string(ViewChannel()) + std::string("-") + std::to_string(ViewChannel() + C - 1ull) + std::string("]"));
+				description.append(nwl + std::string("  memory saved:") + tab + std::to_string(ViewBytesSaved(1ull, false)) + std::string(" bytes/sample"));
+				description.append(nwl + std::string("  traffic saved:") + tab + std::to_string(ViewBytesSaved(1ull, true)) + std::string(" bytes/sample"));
+			}
+
+			if (Fused)
+			{
+				description.append(nwl + std::string(" Fused:") + dtab + Outputs[0]->Name);
+				description.append(nwl + std::string("  memory saved:") + tab + std::to_string(ViewBytesSaved(1ull, false)) + std::string(" bytes/sample"));
+				description.append(nwl + std::string("  traffic saved:") + tab + std::to_string(ViewBytesSaved(1ull, true)) + std::string(" bytes/sample"));
+			}
+
 			return description;
 		}
 
@@ -529,18 +600,93 @@ namespace dnn
 			return WeightCount > 0;
 		}
 
+		// true when BackwardProp writes the gradient of its input (if not SharesInput) and its weights instead of accumulating
+		virtual bool OverwritesGradients() const
+		{
+			return false;
+		}
+
+		// true when BackwardProp writes the whole gradient of that input instead of accumulating, asked once fusion is determined
+		virtual bool OverwritesInputGradient(const Layer* inputLayer) const
+		{
+			return false;
+		}
+
+		// the gradient of the input at index is written (=) instead of accumulated (+=) in BackwardProp: this layer is its first consumer in backprop,
+		// reads it directly (not through an InplaceBwd layer) and doesn't write to it through an earlier index
+		inline bool OverwritesInput(const UInt index) const
+		{
+			const auto inputLayer = Inputs[index];
+			return inputLayer->GradientOverwritten && inputLayer == InputsFwd[index] && !inputLayer->Outputs.empty() && inputLayer->Outputs.back() == this && std::find(Inputs.begin(), Inputs.begin() + index, inputLayer) == Inputs.begin() + index;
+		}
+
+		// true when BackwardProp writes WeightsD1 and BiasesD1 instead of accumulating into them, so ResetGradients has nothing to zero
+		virtual bool OverwritesWeightsGradients() const
+		{
+			return OverwritesGradients();
+		}
+
+		// tensor views: a View keeps no Neurons and NeuronsD1 of its own, its values and gradient are the channels [ViewChannel(), ViewChannel() + C)
+		// of InputLayer, read and accumulated in place by its consumers (Model::SetRelations only makes a Viewable layer a View when all of them AcceptsViews)
+		virtual bool Viewable() const
+		{
+			return false;
+		}
+
+		virtual bool AcceptsViews() const
+		{
+			return false;
+		}
+
+		virtual UInt ViewChannel() const
+		{
+			return 0;
+		}
+
+		// a Fused layer is computed by its only consumer (see Shuffle) or the root of its ElementwiseChain straight from their inputs, like a View it keeps no Neurons and NeuronsD1
+		inline bool Materialized() const noexcept
+		{
+			return !View && !Fused;
+		}
+
+		// the layer holding the values of an input and the first of its channels there
+		inline Layer* Storage() const noexcept
+		{
+			return View ? InputLayer : const_cast<Layer*>(this);
+		}
+
+		inline UInt StorageChannel() const noexcept
+		{
+			return View ? ViewChannel() : 0ull;
+		}
+
+		// the Neurons and NeuronsD1 a View or Fused layer doesn't allocate or, with traffic, the bytes its forward copy and backward accumulation don't move per training step
+		inline UInt ViewBytesSaved(const UInt batchSize, const bool traffic) const noexcept
+		{
+			if (Materialized())
+				return 0ull;
+
+			const auto size = batchSize * (IsPlainFormat() ? CDHW() : PaddedCDHW()) * sizeof(Float);
+#ifndef DNN_LEAN
+			return traffic ? size * 6ull : size * 2ull;
+#else
+			return traffic ? size * 5ull : size;
+#endif // DNN_LEAN
+		}
+
 		virtual void InitializeDescriptors(const UInt) = 0;
 
 #ifdef DNN_LEAN
+		// the first consumer in backprop allocates the gradient of its input, zeroed unless that consumer overwrites it (GradientOverwritten)
 		inline void ZeroGradient(const UInt batchSize)
 		{
-			InputLayer->NeuronsD1.resize(batchSize, InputLayer->C, InputLayer->H, InputLayer->W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
+			InputLayer->NeuronsD1.resize(batchSize, InputLayer->C, InputLayer->H, InputLayer->W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine, Float(0), !InputLayer->GradientOverwritten);
 		}
 
 		inline void ZeroGradientMulti(const UInt batchSize)
 		{
 			for (auto& inputLayer : Inputs)
-				inputLayer->NeuronsD1.resize(batchSize, inputLayer->C, inputLayer->H, inputLayer->W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
+				inputLayer->NeuronsD1.resize(batchSize, inputLayer->C, inputLayer->H, inputLayer->W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine, Float(0), !inputLayer->GradientOverwritten);
 		}
 
 		inline void ReleaseGradient()
@@ -558,20 +704,311 @@ namespace dnn
 				std::this_thread::yield();
 			}
 			
-			Neurons.resize(batchSize, C, H, W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
+			if (!Materialized())
+			{
+				Neurons.release();
+				NeuronsD1.release();
+			}
+			else
+			{
+				if (NeuronsPool)
+					Neurons.share(*NeuronsPool, NeuronsPoolOffset, dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(batchSize), dnnl::memory::dim(C), dnnl::memory::dim(H), dnnl::memory::dim(W) }), dnnl::memory::data_type::f32, BlockedFmt));
+				else
+					Neurons.resize(batchSize, C, H, W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
 #ifndef DNN_LEAN
-			if (!InplaceBwd)
-				NeuronsD1.resize(batchSize, C, H, W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
+				if (!InplaceBwd)
+					NeuronsD1.resize(batchSize, C, H, W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
 #else
-			ReleaseGradient();
+				ReleaseGradient();
 #endif // DNN_LEAN
+			}
 
 			InitializeDescriptors(batchSize);
 		}
 
+		// gradient checkpointing: layers without a checkpoint share their Neurons with the other segments (NeuronsPool) and run ForwardProp again (with Recomputing set) in backprop
+		virtual bool Recomputable() const
+		{
+			return true;
+		}
+
 		virtual void ForwardProp(const UInt batchSize, const bool training) = 0;
 
 		virtual void BackwardProp(const UInt batchSize) = 0;
+
+		// int8 inference: Convolution, Dense and DepthwiseConvolution quantize their input per tensor and their weights per output channel
+		virtual bool Quantizable() const 
+		{ 
+			return false;
+		}
+
+		virtual void Quantize(const bool enable)
+		{
+			DNN_UNREF_PAR(enable);
+			Quantized = false;
+		}
+
+		// latency mode: Convolution, Dense and DepthwiseConvolution bind their inference memory once
+		virtual void BindInference()
+		{
+		}
+
+		void ResetCalibration()
+		{
+			QuantSrcMin = std::numeric_limits<Float>::max();
+			QuantSrcMax = std::numeric_limits<Float>::lowest();
+		}
+
+		// the padded channels of a blocked input hold zeros, they are not part of its range
+		std::pair<Float, Float> GetInputRange(const UInt batchSize) const
+		{
+			const auto plain = InputLayer->IsPlainFormat();
+			const auto elements = plain ? InputLayer->CDHW() : InputLayer->PaddedCDHW();
+			const auto blocks = plain ? elements : (InputLayer->C / VectorSize) * VectorSize * InputLayer->DHW();
+			const auto tail = plain ? 0ull : InputLayer->C % VectorSize;
+			const auto threads = std::min<UInt>(GetThreads(batchSize * elements), batchSize);
+
+			auto vMin = FloatVector(batchSize, std::numeric_limits<Float>::max());
+			auto vMax = FloatVector(batchSize, std::numeric_limits<Float>::lowest());
+
+			for_i(batchSize, threads, [&](UInt n)
+			{
+				const auto offset = n * elements;
+				auto min = std::numeric_limits<Float>::max();
+				auto max = std::numeric_limits<Float>::lowest();
+				for (auto i = offset; i < offset + blocks; i++)
+				{
+					min = std::min(min, InputLayer->Neurons[i]);
+					max = std::max(max, InputLayer->Neurons[i]);
+				}
+				if (tail > 0ull)
+					for (auto dhw = 0ull; dhw < InputLayer->DHW(); dhw++)
+						for (auto i = offset + blocks + dhw * VectorSize; i < offset + blocks + dhw * VectorSize + tail; i++)
+						{
+							min = std::min(min, InputLayer->Neurons[i]);
+							max = std::max(max, InputLayer->Neurons[i]);
+						}
+				vMin[n] = min;
+				vMax[n] = max;
+			});
+
+			auto range = std::make_pair(std::numeric_limits<Float>::max(), std::numeric_limits<Float>::lowest());
+			for (auto n = 0ull; n < batchSize; n++)
+			{
+				range.first = std::min(range.first, vMin[n]);
+				range.second = std::max(range.second, vMax[n]);
+			}
+
+			return range;
+		}
+
+		// collects the range of the input activations, must be called before ForwardProp
+		void Calibrate(const UInt batchSize)
+		{
+			const auto [min, max] = GetInputRange(batchSize);
+
+			QuantSrcMin = std::min(QuantSrcMin, min);
+			QuantSrcMax = std::max(QuantSrcMax, max);
+		}
+
+		inline auto QuantSrcDataType() const noexcept
+		{
+			return QuantSrcMin >= Float(0) ? dnnl::memory::data_type::u8 : dnnl::memory::data_type::s8;
+		}
+
+		// dequantization scale of the input: real = scale * int
+		inline auto QuantSrcScale() const noexcept
+		{
+			const auto range = std::max(std::abs(QuantSrcMin), std::abs(QuantSrcMax));
+			const auto scale = range / (QuantSrcMin >= Float(0) ? Float(255) : Float(127));
+
+			return (scale > Float(0) && std::isfinite(scale)) ? scale : Float(1);
+		}
+
+		// the weights of an inference context are read from its SharedLayer
+		FloatVector GetPlainWeights()
+		{
+			if (*WeightsMemDesc != *PersistWeightsMemDesc)
+			{
+				auto weights = FloatVector(PersistWeightsMemDesc->get_size() / sizeof(Float));
+				auto memWeights = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsData());
+				auto weightsMem = dnnl::memory(*PersistWeightsMemDesc, Device.engine, weights.data());
+
+				dnnl::reorder(memWeights, weightsMem).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memWeights}, { DNNL_ARG_TO, weightsMem } });
+				Device.stream.wait();
+
+				return weights;
+			}
+			
+			return SharedLayer && Weights.empty() ? SharedLayer->Weights : Weights;
+		}
+
+		// symmetric per output channel scales, the weights of an output channel are contiguous in the plain layout
+		void GetWeightsScales(const FloatVector& weights)
+		{
+			const auto perChannel = weights.size() / C;
+			QuantWeightsScales = FloatVector(C, Float(1));
+
+			for_i(C, [&](UInt c)
+			{
+				auto range = Float(0);
+				for (auto i = c * perChannel; i < (c + 1) * perChannel; i++)
+					range = std::max(range, std::abs(weights[i]));
+
+				QuantWeightsScales[c] = range > Float(0) ? range / Float(127) : Float(1);
+			});
+		}
+
+		// symmetric per output channel quantization of the weights into the layout the int8 primitive prefers
+		dnnl::memory QuantizeWeights(const dnnl::memory::desc& weightsDesc)
+		{
+			const auto weights = GetPlainWeights();
+			GetWeightsScales(weights);
+
+			const auto dims = weightsDesc.get_dims();
+			const auto plainFmt = dims.size() == 2 ? dnnl::memory::format_tag::ab : dims.size() == 4 ? dnnl::memory::format_tag::abcd : dnnl::memory::format_tag::abcde;
+			auto memWeightsInt8 = dnnl::memory(dnnl::memory::desc(dims, dnnl::memory::data_type::s8, plainFmt), Device.engine);
+			auto weightsInt8 = static_cast<int8_t*>(memWeightsInt8.get_data_handle());
+
+			const auto perChannel = weights.size() / C;
+			for_i(C, [&](UInt c)
+			{
+				const auto scale = QuantWeightsScales[c];
+				for (auto i = c * perChannel; i < (c + 1) * perChannel; i++)
+					weightsInt8[i] = static_cast<int8_t>(Clamp<Float>(std::nearbyint(weights[i] / scale), Float(-127), Float(127)));
+			});
+
+			auto weightsMem = dnnl::memory(weightsDesc, Device.engine);
+			dnnl::reorder(memWeightsInt8, weightsMem).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memWeightsInt8}, { DNNL_ARG_TO, weightsMem } });
+			Device.stream.wait();
+
+			return weightsMem;
+		}
+
+		// disabling keeps the tracked ranges, Quantize uses them
+		void SetFakeQuantization(const bool enable)
+		{
+			const auto enabling = enable && Quantizable() && !FakeQuantization;
+			FakeQuantization = enable && Quantizable();
+			if (enabling)
+				ResetCalibration();
+
+			InputFakeQuant = FloatVector();
+			WeightsFakeQuant = FloatVector();
+		}
+
+		// quantization-aware training: the input is rounded to the int8 grid of its moving average range (straight-through estimator in backprop)
+		Float* FakeQuantizeSrc(const UInt batchSize)
+		{
+			const auto [min, max] = GetInputRange(batchSize);
+			
+			if (QuantSrcMin > QuantSrcMax)
+			{
+				QuantSrcMin = min;
+				QuantSrcMax = max;
+			}
+			else if (!Recomputing)
+			{
+				QuantSrcMin = FakeQuantMomentum * QuantSrcMin + (Float(1) - FakeQuantMomentum) * min;
+				QuantSrcMax = FakeQuantMomentum * QuantSrcMax + (Float(1) - FakeQuantMomentum) * max;
+			}
+
+			const auto scale = QuantSrcScale();
+			const auto lower = QuantSrcMin >= Float(0) ? Float(0) : Float(-127);
+			const auto upper = QuantSrcMin >= Float(0) ? Float(255) : Float(127);
+			const auto elements = InputLayer->IsPlainFormat() ? InputLayer->CDHW() : InputLayer->PaddedCDHW();
+			
+			if (InputFakeQuant.size() != batchSize * elements)
+				InputFakeQuant = FloatVector(batchSize * elements);
+
+			for_i(batchSize, std::min<UInt>(GetThreads(batchSize * elements), batchSize), [&](UInt n)
+			{
+				const auto offset = n * elements;
+				PRAGMA_OMP_SIMD()
+				for (auto i = offset; i < offset + elements; i++)
+					InputFakeQuant[i] = Clamp<Float>(std::nearbyint(InputLayer->Neurons[i] / scale), lower, upper) * scale;
+			});
+
+			return InputFakeQuant.data();
+		}
+
+		// the weights are rounded per output channel, the gradients update the fp32 weights (straight-through estimator),
+		// they are only rounded again after the weights changed
+		Float* FakeQuantizeWeights()
+		{
+			if (!WeightsFakeQuant.empty() && WeightsFakeQuantVersion == CurrentWeightsVersion())
+				return WeightsFakeQuant.data();
+
+			auto weights = GetPlainWeights();
+			GetWeightsScales(weights);
+
+			const auto perChannel = weights.size() / C;
+			for_i(C, [&](UInt c)
+			{
+				const auto scale = QuantWeightsScales[c];
+				for (auto i = c * perChannel; i < (c + 1) * perChannel; i++)
+					weights[i] = Clamp<Float>(std::nearbyint(weights[i] / scale), Float(-127), Float(127)) * scale;
+			});
+
+			if (*WeightsMemDesc != *PersistWeightsMemDesc)
+			{
+				WeightsFakeQuant.resize(WeightsMemDesc->get_size() / sizeof(Float));
+				
+				auto memWeights = dnnl::memory(*PersistWeightsMemDesc, Device.engine, weights.data());
+				auto weightsMem = dnnl::memory(*WeightsMemDesc, Device.engine, WeightsFakeQuant.data());
+
+				dnnl::reorder(memWeights, weightsMem).execute(Device.stream, std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memWeights}, { DNNL_ARG_TO, weightsMem } });
+				Device.stream.wait();
+			}
+			else
+				WeightsFakeQuant = weights;
+
+			WeightsFakeQuantVersion = CurrentWeightsVersion();
+
+			return WeightsFakeQuant.data();
+		}
+
+		dnnl::memory GetScalesMemory(const FloatVector& scales) const
+		{
+			auto scalesMem = dnnl::memory(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(scales.size()) }), dnnl::memory::data_type::f32, dnnl::memory::format_tag::x), Device.engine);
+			std::copy(scales.begin(), scales.end(), static_cast<Float*>(scalesMem.get_data_handle()));
+
+			return scalesMem;
+		}
+
+		// the reorder that converts the fp32 input to int8 with the input scale fused and its int8 buffer, created with the int8 primitive
+		void InitializeQuantizeSrc(const dnnl::memory::desc& srcDesc)
+		{
+			auto attr = dnnl::primitive_attr();
+			attr.set_scales_mask(DNNL_ARG_DST, 0);
+
+			QuantSrcMem = dnnl::memory(srcDesc, Device.engine);
+			QuantSrcReorderDesc = std::make_unique<dnnl::reorder::primitive_desc>(dnnl::reorder::primitive_desc(Device.engine, *InputLayer->DstMemDesc, Device.engine, srcDesc, attr));
+#ifdef DNN_CACHE_PRIMITIVES
+			QuantSrcReorder = std::make_unique<dnnl::reorder>(dnnl::reorder(*QuantSrcReorderDesc));
+#endif
+		}
+
+		void ReleaseQuantizeSrc()
+		{
+			QuantSrcMem = dnnl::memory();
+			QuantSrcReorderDesc.reset();
+#ifdef DNN_CACHE_PRIMITIVES
+			QuantSrcReorder.reset();
+#endif
+		}
+
+		// the stream is in order, the int8 primitive that follows waits for the reorder
+		const dnnl::memory& QuantizeSrc(const dnnl::memory& memSrc, const dnnl::memory& srcScaleMem)
+		{
+			const auto args = std::unordered_map<int, dnnl::memory>{ {DNNL_ARG_FROM, memSrc}, { DNNL_ARG_TO, QuantSrcMem }, { DNNL_ARG_ATTR_SCALES | DNNL_ARG_DST, srcScaleMem } };
+#ifdef DNN_CACHE_PRIMITIVES
+			QuantSrcReorder->execute(Device.stream, args);
+#else
+			dnnl::reorder(*QuantSrcReorderDesc).execute(Device.stream, args);
+#endif
+			return QuantSrcMem;
+		}
 		
 		bool RefreshStatistics(const UInt batchSize)
 		{
@@ -1253,11 +1690,64 @@ namespace dnn
 
 		void ResetGradients()
 		{
+			if (OverwritesWeightsGradients())
+				return;
+
 			std::fill(WeightsD1.begin(), WeightsD1.end(), Float(0));
 			if (HasBias)
 				std::fill_n(BiasesD1.begin(), BiasCount, Float(0));
 		}
 
+		// gradient accumulation: the weight gradients of the micro-batches are summed, after the last one WeightsD1 and BiasesD1 hold the total
+		void AccumulateGradients(const bool first, const bool last, const bool skipped = false)
+		{
+			if (first && last)
+				return;
+
+			if (skipped)
+			{
+				if (first)
+				{
+					WeightsD1Sum = FloatVector(WeightsD1.size(), Float(0));
+					BiasesD1Sum = FloatVector(BiasesD1.size(), Float(0));
+				}
+				else if (last)
+				{
+					WeightsD1 = WeightsD1Sum;
+					BiasesD1 = BiasesD1Sum;
+				}
+			}
+			else if (first)
+			{
+				WeightsD1Sum = WeightsD1;
+				BiasesD1Sum = BiasesD1;
+			}
+			else if (!last)
+			{
+				PRAGMA_OMP_SIMD()
+				for (auto i = 0ull; i < WeightsD1.size(); i++)
+					WeightsD1Sum[i] += WeightsD1[i];
+				if (HasBias)
+				{
+					PRAGMA_OMP_SIMD()
+					for (auto i = 0ull; i < BiasesD1.size(); i++)
+						BiasesD1Sum[i] += BiasesD1[i];
+				}
+			}
+			else
+			{
+				PRAGMA_OMP_SIMD()
+				for (auto i = 0ull; i < WeightsD1.size(); i++)
+					WeightsD1[i] += WeightsD1Sum[i];
+				if (HasBias)
+				{
+					PRAGMA_OMP_SIMD()
+					for (auto i = 0ull; i < BiasesD1.size(); i++)
+						BiasesD1[i] += BiasesD1Sum[i];
+				}
+			}
+		}
+
 		void UpdateWeights(const TrainingRate& rate, const Optimizers optimizer, const bool disableLocking)
 		{
 			if (HasWeights && (disableLocking || (!disableLocking && !LockUpdate.load())))
@@ -1307,6 +1797,8 @@ namespace dnn
 					SGDW(rate);
 					break;
 				}
+
+				WeightsChanged();
 			}
 		}
 
@@ -2276,6 +2768,9 @@ namespace dnn
 					
 		virtual UInt GetNeuronsSize(const UInt batchSize) const
 		{
+			if (!Materialized())
+				return 0ull;
+
 #ifndef DNN_LEAN
 			return batchSize * PaddedCDHW() * sizeof(Float) * (InplaceBwd ? 1ull : 2ull);
 #else
@@ -84,6 +84,11 @@ namespace dnn
 			return 1;
 		}
 
+		bool OverwritesWeightsGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (InputLayer->DstMemDesc->get_ndims() == 2)
@@ -249,7 +254,7 @@ namespace dnn
 					Device.stream.wait();
 				}
 #ifndef DNN_LEAN
-				if (!InplaceBwd)
+				if (!InplaceBwd && !GradientOverwritten)
 					InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 #else
 				DNN_UNREF_PAR(batchSize);
@@ -47,6 +47,11 @@ namespace dnn
 			return 1;
 		}
 
+		bool OverwritesGradients() const final override
+		{
+			return true;
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			std::unique_ptr<dnnl::memory::desc> InputLayerDstMemDesc;
@@ -110,7 +115,7 @@ namespace dnn
 			Device.stream.wait();
 
 #ifndef DNN_LEAN
-			if (training)
+			if (training && !GradientOverwritten)
 				InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 #endif
 		}
@@ -0,0 +1,167 @@
+#pragma once
+#include "Utils.h"
+
+#if !defined(_WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dnn
+{
+	// a whole file mapped into memory: an existing file read-only, or a new file of a given size read/write
+	class MappedFile final
+	{
+	private:
+		Byte* data;
+		UInt size;
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+		HANDLE file;
+		HANDLE mapping;
+#else
+		int file;
+#endif
+
+		void Map(const bool writable)
+		{
+			void* memory = nullptr;
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFFull), nullptr);
+			if (mapping)
+				memory = MapViewOfFile(mapping, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, size);
+#else
+			memory = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+			if (memory == MAP_FAILED)
+				memory = nullptr;
+#endif
+			if (!memory)
+			{
+				Close();
+				throw std::runtime_error("Unable to map " + FileName);
+			}
+
+			data = static_cast<Byte*>(memory);
+		}
+
+		void Close()
+		{
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			if (data)
+				UnmapViewOfFile(data);
+			if (mapping)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+			mapping = nullptr;
+			file = INVALID_HANDLE_VALUE;
+#else
+			if (data)
+				munmap(data, size);
+			if (file >= 0)
+				close(file);
+			file = -1;
+#endif
+			data = nullptr;
+		}
+
+	public:
+		const std::string FileName;
+		const bool Writable;
+
+		MappedFile(const std::string& fileName) :
+			data(nullptr),
+			size(0),
+			FileName(fileName),
+			Writable(false)
+		{
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			mapping = nullptr;
+			file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			LARGE_INTEGER fileSize;
+			if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+			{
+				Close();
+				throw std::runtime_error("Unable to open " + fileName);
+			}
+			size = static_cast<UInt>(fileSize.QuadPart);
+#else
+			file = open(fileName.c_str(), O_RDONLY);
+			struct stat info;
+			if (file < 0 || fstat(file, &info) != 0)
+			{
+				Close();
+				throw std::runtime_error("Unable to open " + fileName);
+			}
+			size = static_cast<UInt>(info.st_size);
+#endif
+			if (size == 0ull)
+			{
+				Close();
+				throw std::runtime_error("Empty file " + fileName);
+			}
+
+			Map(false);
+		}
+
+		MappedFile(const std::string& fileName, const UInt fileSize) :
+			data(nullptr),
+			size(fileSize),
+			FileName(fileName),
+			Writable(true)
+		{
+			if (size == 0ull)
+				throw std::invalid_argument("Size cannot be zero in MappedFile");
+
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			mapping = nullptr;
+			file = CreateFileA(fileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				Close();
+				throw std::runtime_error("Unable to create " + fileName);
+			}
+#else
+			file = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+			if (file < 0 || ftruncate(file, static_cast<off_t>(size)) != 0)
+			{
+				Close();
+				throw std::runtime_error("Unable to create " + fileName);
+			}
+#endif
+			Map(true);
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile()
+		{
+			if (Writable)
+				Flush();
+			Close();
+		}
+
+		inline Byte* Data() const noexcept
+		{
+			return data;
+		}
+
+		inline UInt Size() const noexcept
+		{
+			return size;
+		}
+
+		// writes the dirty pages back to the file
+		void Flush()
+		{
+			if (!data)
+				return;
+#if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
+			FlushViewOfFile(data, 0);
+#else
+			msync(data, size, MS_SYNC);
+#endif
+		}
+	};
+}
@@ -1,5 +1,5 @@
 #pragma once
-#include "Layer.h"
+#include "ElementwiseChain.h"
 
 namespace dnn
 {
@@ -51,6 +51,11 @@ namespace dnn
 			return 1;
 		}
 
+		bool OverwritesInputGradient(const Layer* inputLayer) const final override
+		{
+			return !Fused && !Chain && EqualDimensions(InputsFwd);
+		}
+
 		void InitializeDescriptors(const UInt batchSize) final override
 		{
 			if (Inputs[first]->DstMemDesc->get_ndims() == 2)
@@ -89,6 +94,15 @@ namespace dnn
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
+			if (Fused)	// computed by the root of its elementwise chain
+				return;
+
+			if (Chain)
+			{
+				Chain->ForwardProp(batchSize, training);
+				return;
+			}
+
 			const auto fullDepth = SurvivalProbability[0] == Float(1) && SurvivalProbability[1] == Float(1);
 			scales[0] = fullDepth ? Float(1) : (Inputs[0]->Skip ? Float(0) : Float(1));
 			scales[1] = fullDepth ? Float(1) : (Inputs[1]->Skip ? Float(0) : Float(1));
@@ -117,7 +131,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = std::max(Inputs[0]->Neurons[cdhw], Inputs[1]->Neurons[cdhw]);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -135,7 +150,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = std::max(Inputs[0]->Neurons[cdhw] * scales0, Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -156,7 +172,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = std::max(Inputs[first]->Neurons[hw + outputOffset], Inputs[second]->Neurons[channelOffset]);
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -178,7 +195,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = std::max(Inputs[first]->Neurons[hw + outputOffset] * scales0, Inputs[second]->Neurons[channelOffset] * scales1);
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -198,13 +216,15 @@ namespace dnn
 								for (auto cdhw = start; cdhw < start + part; cdhw += VectorSize)
 								{
 									(max(VecFloat().load_a(&Inputs[0]->Neurons[cdhw]), VecFloat().load_a(&Inputs[1]->Neurons[cdhw]))).store_a(&Neurons[cdhw]);
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
 									Neurons[cdhw] = std::max(Inputs[0]->Neurons[cdhw], Inputs[1]->Neurons[cdhw]);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -223,13 +243,15 @@ namespace dnn
 									In0.load_a(&Inputs[0]->Neurons[cdhw]);
 									In1.load_a(&Inputs[1]->Neurons[cdhw]);
 									(max(In0 * scales0, In1 * scales1)).store_a(&Neurons[cdhw]);
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 								}
 								for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 								{
 									Neurons[cdhw] = std::max(Inputs[0]->Neurons[cdhw] * scales0, Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							});
@@ -249,7 +271,8 @@ namespace dnn
 									{
 										(max(VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]), VecFloat().load_a(&Inputs[second]->Neurons[channelOffset]))).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -270,7 +293,8 @@ namespace dnn
 									{
 										(max(VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) * scales0, VecFloat().load_a(&Inputs[second]->Neurons[channelOffset]) * scales1)).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -292,9 +316,22 @@ namespace dnn
 
 		void BackwardProp(const UInt batchSize) final override
 		{
+			if (Fused)
+				return;
+
+			if (Chain)
+			{
+				Chain->BackwardProp(batchSize);
+				return;
+			}
+
 #ifdef DNN_LEAN
 			ZeroGradientMulti(batchSize);
 #endif
+
+			const auto overwrite0 = OverwritesInput(0);
+			const auto overwrite1 = OverwritesInput(1);
+
 			const auto size = IsPlainFormat() ? CDHW() : PaddedCDHW();
 			const auto part = GetVectorPart(size);
 			const auto threads = GetThreads(batchSize * size);
@@ -308,13 +345,13 @@ namespace dnn
 					In0.load_a(&InputsFwd[0]->Neurons[cdhw]);
 					In1.load_a(&InputsFwd[1]->Neurons[cdhw]);
 					D1.load_a(&NeuronsD1[cdhw]);
-					if_add(In0 >= In1, VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]), D1).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-					if_add(In0 < In1, VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]), D1).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+					if_add(In0 >= In1, (overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])), D1).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+					if_add(In0 < In1, (overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])), D1).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 				}
 				for (auto cdhw = part; cdhw < size; cdhw++)
 				{
-					Inputs[0]->NeuronsD1[cdhw] += InputsFwd[0]->Neurons[cdhw] >= InputsFwd[1]->Neurons[cdhw] ? NeuronsD1[cdhw] : 0;
-					Inputs[1]->NeuronsD1[cdhw] += InputsFwd[0]->Neurons[cdhw] >= InputsFwd[1]->Neurons[cdhw] ? 0 : NeuronsD1[cdhw];
+					Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + (InputsFwd[0]->Neurons[cdhw] >= InputsFwd[1]->Neurons[cdhw] ? NeuronsD1[cdhw] : 0);
+					Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + (InputsFwd[0]->Neurons[cdhw] >= InputsFwd[1]->Neurons[cdhw] ? 0 : NeuronsD1[cdhw]);
 				}
 			}
 			else
@@ -332,13 +369,13 @@ namespace dnn
 						In1.load_a(&InputsFwd[1]->Neurons[cdhw]);
 						D1.load_a(&NeuronsD1[cdhw]);
 
-						if_add(In0 >= In1, VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]), D1).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-						if_add(In0 < In1, VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]), D1).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+						if_add(In0 >= In1, (overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])), D1).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+						if_add(In0 < In1, (overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])), D1).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 					}
 					for (auto cdhw = end; cdhw < start + size; cdhw++)
 					{
-						Inputs[0]->NeuronsD1[cdhw] += InputsFwd[0]->Neurons[cdhw] >= InputsFwd[1]->Neurons[cdhw] ? NeuronsD1[cdhw] : 0;
-						Inputs[1]->NeuronsD1[cdhw] += InputsFwd[0]->Neurons[cdhw] >= InputsFwd[1]->Neurons[cdhw] ? 0 : NeuronsD1[cdhw];
+						Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + (InputsFwd[0]->Neurons[cdhw] >= InputsFwd[1]->Neurons[cdhw] ? NeuronsD1[cdhw] : 0);
+						Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + (InputsFwd[0]->Neurons[cdhw] >= InputsFwd[1]->Neurons[cdhw] ? 0 : NeuronsD1[cdhw]);
 					}
 				});
 #ifdef DNN_STOCHASTIC
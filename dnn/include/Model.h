@@ -12,6 +12,7 @@
 #include "Concat.h"
 #include "Convolution.h"
 #include "ConvolutionTranspose.h"
+#include "ActivationCache.h"
 #include "Cost.h"
 #include "Dense.h"
 #include "DepthwiseConvolution.h"
@@ -33,6 +34,7 @@
 #include "Softmax.h"
 #include "Substract.h"
 #include "Resampling.h"
+#include "Communicator.h"
 
 
 namespace dnn
@@ -44,6 +46,12 @@ namespace dnn
 		Stopped = 2
 	};
 
+	enum class BatchNormStatistics
+	{
+		MicroBatch = 0,
+		EffectiveBatch = 1
+	};
+
 	enum class States
 	{
 		Idle = 0,
@@ -200,6 +208,7 @@ namespace dnn
 		Float TestErrorPercentage;
 		UInt TestErrors;
 		Float SampleSpeed;
+		Float ScalingEfficiency;
 		States State;
 		TaskStates TaskState;
 	};
@@ -303,6 +312,30 @@ namespace dnn
 		Float TestErrorPercentage;
 	};
 
+	struct QuantizationInfo
+	{
+		UInt CalibrationSamples;
+		UInt QuantizedLayers;
+		Float Fp32Accuracy;
+		Float Int8Accuracy;
+		Float Fp32SampleSpeed;
+		Float Int8SampleSpeed;
+	};
+
+	struct EpochProgress
+	{
+		UInt Epoch;
+		UInt TrainedSamples;	// rows the backward pass trained on
+		Float Seconds;		// since the start of the training run
+		Float TestErrorPercentage;
+	};
+
+	enum class SampleSelections
+	{
+		Percentile = 0,		// the hardest fraction of the samples
+		Probabilistic = 1	// loss percentile to the power beta
+	};
+
 	struct StatsInfo
 	{
 		std::string Description;
@@ -329,6 +362,16 @@ namespace dnn
 		std::vector<bool> TrainingSamplesVFlip;
 		std::vector<bool> TestingSamplesHFlip;
 		std::vector<bool> TestingSamplesVFlip;
+		std::vector<TeacherView> TeacherViews;
+		std::unique_ptr<ActivationCache> PrefixCache;
+		UInt PrefixEnd;
+		bool PrefixCaching;
+		std::string PrefixCacheFile;
+		bool PrefixCacheHalf;
+		std::vector<Float> LossHistory;
+		UInt LossHistoryIndex;
+		std::vector<UInt> SelectedSamples;
+		UInt BackpropSamples;
 		
 	public:
 		const std::string Name;
@@ -350,6 +393,7 @@ namespace dnn
 		UInt CurrentCycle;
 		UInt CurrentEpoch;
 		UInt SampleIndex;
+		UInt ShardStart;
 		//UInt LogInterval;
 		UInt BatchSize;
 		UInt GoToEpoch;
@@ -408,8 +452,35 @@ namespace dnn
 		std::vector<TrainingRate> TrainingRates;
 		std::vector<TrainingStrategy> TrainingStrategies;
 		bool UseTrainingStrategy;
+		bool FakeQuantization;
+		bool Checkpointing;
+		UInt CheckpointBudget;
+		std::vector<bool> SegmentEnds;
+		UInt RequestedEffectiveBatchSize;
+		UInt MicroBatches;
+		BatchNormStatistics BatchNormStats;
+		std::unique_ptr<Communicator> Comm;
+		std::string CommunicationError;
+		bool SyncBatchNormStatistics;
+		Float ScalingEfficiency;
+		bool LatencyMode;
+		bool DepthwiseEpilogue;
+		bool InPlaceBatchNorm;
+		bool MaskBackward;
+		bool ElementwiseFusion;
+		UInt LatencyHeavyThreshold;
+		std::vector<int> LatencyThreads;
+		std::vector<std::chrono::duration<Float>> LatencyTotals;
+		UInt LatencySamples;
+		UInt LatencyBatchSize;
 		std::vector<std::unique_ptr<Layer>> Layers;
 		std::vector<Cost*> CostLayers;
+		std::unique_ptr<TeacherLogits> Teacher;
+		bool SelectiveBackprop;
+		SampleSelections Selection;
+		Float SelectionValue;
+		UInt SelectionHistory;
+		std::vector<EpochProgress> Progress;
 		std::chrono::duration<Float> fpropTime;
 		std::chrono::duration<Float> bpropTime;
 		std::chrono::duration<Float> updateTime;
@@ -482,6 +553,7 @@ namespace dnn
 			GoToEpoch(1),
 			CurrentEpoch(1),
 			SampleIndex(0),
+			ShardStart(0),
 			BatchSize(1),
 			Rate(Float(0)),
 			TrainLoss(Float(0)),
@@ -515,6 +587,34 @@ namespace dnn
 			ResettingWeights(false),
 			FirstUnlockedLayer(1),
 			UseTrainingStrategy(false),
+			FakeQuantization(false),
+			Checkpointing(false),
+			CheckpointBudget(0),
+			SegmentEnds(),
+			RequestedEffectiveBatchSize(0),
+			MicroBatches(1),
+			BatchNormStats(BatchNormStatistics::MicroBatch),
+			Comm(nullptr),
+			CommunicationError(),
+			SyncBatchNormStatistics(false),
+			ScalingEfficiency(Float(1)),
+			LatencyMode(false),
+			DepthwiseEpilogue(false),
+			InPlaceBatchNorm(false),
+			MaskBackward(false),
+			ElementwiseFusion(false),
+			LatencyHeavyThreshold(2097152ull),
+			LatencySamples(0),
+			LatencyBatchSize(0),
+			PrefixEnd(1),
+			PrefixCaching(false),
+			PrefixCacheHalf(false),
+			LossHistoryIndex(0),
+			BackpropSamples(0),
+			SelectiveBackprop(false),
+			Selection(SampleSelections::Percentile),
+			SelectionValue(Float(0.5)),
+			SelectionHistory(1024),
 			TrainingStrategies(std::vector<TrainingStrategy>())
 			//LogInterval(10000)
 		{
@@ -524,19 +624,25 @@ namespace dnn
 			dnnl_set_verbose(0);
 #endif
 
+			// oneDNN only accepts the isa settings before its first primitive, later models (inference contexts) keep them
+			static const auto isaSet = []()
+			{
 #if defined(DNN_AVX512BW) || defined(DNN_AVX512)
-			dnnl::set_max_cpu_isa(dnnl::cpu_isa::all);
-			dnnl::set_cpu_isa_hints(dnnl::cpu_isa_hints::prefer_ymm);
+				dnnl::set_max_cpu_isa(dnnl::cpu_isa::all);
+				dnnl::set_cpu_isa_hints(dnnl::cpu_isa_hints::prefer_ymm);
 #elif defined(DNN_AVX2)
-			dnnl::set_max_cpu_isa(dnnl::cpu_isa::avx2);
-			dnnl::set_cpu_isa_hints(dnnl::cpu_isa_hints::prefer_ymm);
+				dnnl::set_max_cpu_isa(dnnl::cpu_isa::avx2);
+				dnnl::set_cpu_isa_hints(dnnl::cpu_isa_hints::prefer_ymm);
 #elif defined(DNN_AVX)
-			dnnl::set_max_cpu_isa(dnnl::cpu_isa::avx);
-			dnnl::set_cpu_isa_hints(dnnl::cpu_isa_hints::prefer_ymm);
+				dnnl::set_max_cpu_isa(dnnl::cpu_isa::avx);
+				dnnl::set_cpu_isa_hints(dnnl::cpu_isa_hints::prefer_ymm);
 #elif defined(DNN_SSE42) || defined(DNN_SSE41)
-			dnnl::set_max_cpu_isa(dnnl::cpu_isa::sse41);
-			dnnl::set_cpu_isa_hints(dnnl::cpu_isa_hints::no_hints);
+				dnnl::set_max_cpu_isa(dnnl::cpu_isa::sse41);
+				dnnl::set_cpu_isa_hints(dnnl::cpu_isa_hints::no_hints);
 #endif
+				return true;
+			}();
+			DNN_UNREF_PAR(isaSet);
 			//dnnl::set_primitive_cache_capacity(1000);
 			//dnnl::set_default_fpmath_mode(dnnl::fpmath_mode::any);
 		}
@@ -560,6 +666,14 @@ namespace dnn
 			for (const auto& layer : Layers)
 				neuronsSize += layer->GetNeuronsSize(batchSize);
 
+			// the layers in a pool share its buffer
+			for (const auto& pool : NeuronsPools(batchSize))
+			{
+				for (const auto& [layer, offset] : pool)
+					neuronsSize -= batchSize * layer->PaddedCDHW() * sizeof(Float);
+				neuronsSize += PoolSize(batchSize, pool) * sizeof(Float);
+			}
+
 			return neuronsSize;
 		}
 
@@ -615,6 +729,9 @@ namespace dnn
 					layer->UpdateResolution();
 			}
 
+			if (Checkpointing)
+				SelectCheckpoints(batchSize);
+
 			if (batchSize * h * w > BatchSize * H * W)
 			{
 				auto requestedSize = GetNeuronsSize(batchSize) + GetWeightsSize(PersistOptimizer, Optimizer);
@@ -628,12 +745,16 @@ namespace dnn
 					for (auto& layer : Layers)
 						layer->UpdateResolution();
 
+					if (Checkpointing)
+						SelectCheckpoints(BatchSize);
+
 					BatchSizeChanging.store(false);
 
 					return false;
 				}
 			}
 
+			AssignNeuronsPools(batchSize);
 			for (auto& layer : Layers)
 				layer->SetBatchSize(batchSize);
 				
@@ -650,11 +771,282 @@ namespace dnn
 			PadH = padH;
 			PadW = padW;
 
+			UpdateMicroBatches();
+
 			BatchSizeChanging.store(false);
 
 			return true;
 		}
 
+		// gradient accumulation: the physical batch stays at BatchSize, the weights are updated once per effectiveBatchSize samples,
+		// which must be a multiple of BatchSize (zero disables it)
+		bool SetGradientAccumulation(const UInt effectiveBatchSize, const BatchNormStatistics statistics = BatchNormStatistics::MicroBatch)
+		{
+			if (TaskState.load() != TaskStates::Stopped || BatchSizeChanging.load() || ResettingWeights.load() || effectiveBatchSize % BatchSize != 0ull)
+				return false;
+
+			RequestedEffectiveBatchSize = effectiveBatchSize;
+			BatchNormStats = statistics;
+
+			UpdateMicroBatches();
+
+			return true;
+		}
+
+		// the micro-batches follow RequestedEffectiveBatchSize through every batch size change, a batch size it isn't a multiple of is reported
+		void UpdateMicroBatches()
+		{
+			MicroBatches = RequestedEffectiveBatchSize > BatchSize ? RequestedEffectiveBatchSize / BatchSize : 1ull;
+			if (RequestedEffectiveBatchSize > 0ull && RequestedEffectiveBatchSize % BatchSize != 0ull)
+				std::cout << std::string("Effective batch size ") << std::to_string(RequestedEffectiveBatchSize) << std::string(" is not a multiple of batch size ") << std::to_string(BatchSize) << std::string(", the weights are updated every ") << std::to_string(MicroBatches * BatchSize) << std::string(" samples") << std::endl << std::endl;
+
+			for (auto& layer : Layers)
+			{
+				if (MicroBatches == 1ull)
+				{
+					layer->WeightsD1Sum = FloatVector();
+					layer->BiasesD1Sum = FloatVector();
+				}
+
+				const auto microBatches = BatchNormStats == BatchNormStatistics::EffectiveBatch ? MicroBatches : 1ull;
+
+				switch (layer->LayerType)
+				{
+				case LayerTypes::BatchNorm:
+				{
+					auto bn = dynamic_cast<BatchNorm*>(layer.get());
+					if (bn)
+						bn->UpdateMicroBatches(microBatches);
+				}
+				break;
+
+				case LayerTypes::BatchNormActivation:
+				{
+					auto bn = dynamic_cast<BatchNormActivation*>(layer.get());
+					if (bn)
+						bn->UpdateMicroBatches(microBatches);
+				}
+				break;
+
+				case LayerTypes::BatchNormActivationDropout:
+				{
+					auto bn = dynamic_cast<BatchNormActivationDropout*>(layer.get());
+					if (bn)
+						bn->UpdateMicroBatches(microBatches);
+				}
+				break;
+
+				case LayerTypes::BatchNormRelu:
+				{
+					auto bn = dynamic_cast<BatchNormRelu*>(layer.get());
+					if (bn)
+						bn->UpdateMicroBatches(microBatches);
+				}
+				break;
+
+				default:
+					break;
+				}
+			}
+		}
+
+		// the training rate of a weights update over microBatches accumulated micro-batches
+		TrainingRate UpdateRate(const UInt microBatches) const
+		{
+			auto rate = CurrentTrainingRate;
+			rate.BatchSize = BatchSize * microBatches;
+
+			return rate;
+		}
+
+		// data-parallel training: this process is worker rank out of worldSize, each one trains on its own shard of the training samples,
+		// the batch norm layers normalize with the statistics of the local batch only (no synchronized batch norm), syncBatchNormStatistics
+		// averages their running statistics over the workers once per epoch before testing
+		bool SetDataParallel(const UInt rank, const UInt worldSize, const bool syncBatchNormStatistics = false)
+		{
+			if (TaskState.load() != TaskStates::Stopped || BatchSizeChanging.load() || ResettingWeights.load())
+				return false;
+
+			Comm.reset();
+			CommunicationError.clear();
+			SyncBatchNormStatistics = syncBatchNormStatistics;
+			ScalingEfficiency = Float(1);
+
+			if (worldSize > 1ull)
+			{
+				PinToCores(rank, worldSize);
+				Comm = std::make_unique<SharedMemoryCommunicator>(Name, rank, worldSize);
+			}
+
+			return true;
+		}
+
+		// peers: comma separated host:port of every rank, e.g. "10.0.0.1:29500,10.0.0.2:29500" or "localhost:29500,localhost:29501"
+		bool SetDistributed(const UInt rank, const std::string& peers, const bool syncBatchNormStatistics = false)
+		{
+			if (TaskState.load() != TaskStates::Stopped || BatchSizeChanging.load() || ResettingWeights.load())
+				return false;
+
+			auto addresses = std::vector<std::string>();
+			auto stream = std::istringstream(peers);
+			auto address = std::string();
+			while (std::getline(stream, address, ','))
+				if (!address.empty())
+					addresses.push_back(address);
+
+			if (addresses.empty() || rank >= addresses.size())
+				return false;
+
+			Comm.reset();
+			CommunicationError.clear();
+			SyncBatchNormStatistics = syncBatchNormStatistics;
+			ScalingEfficiency = Float(1);
+
+			if (addresses.size() > 1ull)
+				Comm = std::make_unique<TcpCommunicator>(addresses, rank);
+
+			return true;
+		}
+
+		CommBuffers GetBatchNormStatistics() const
+		{
+			auto buffers = CommBuffers();
+
+			for (const auto& layer : Layers)
+			{
+				switch (layer->LayerType)
+				{
+				case LayerTypes::BatchNorm:
+				{
+					auto bn = dynamic_cast<BatchNorm*>(layer.get());
+					if (bn)
+					{
+						buffers.emplace_back(bn->RunningMean.data(), bn->RunningMean.size());
+						buffers.emplace_back(bn->RunningVariance.data(), bn->RunningVariance.size());
+					}
+				}
+				break;
+
+				case LayerTypes::BatchNormActivation:
+				{
+					auto bn = dynamic_cast<BatchNormActivation*>(layer.get());
+					if (bn)
+					{
+						buffers.emplace_back(bn->RunningMean.data(), bn->RunningMean.size());
+						buffers.emplace_back(bn->RunningVariance.data(), bn->RunningVariance.size());
+					}
+				}
+				break;
+
+				case LayerTypes::BatchNormActivationDropout:
+				{
+					auto bn = dynamic_cast<BatchNormActivationDropout*>(layer.get());
+					if (bn)
+					{
+						buffers.emplace_back(bn->RunningMean.data(), bn->RunningMean.size());
+						buffers.emplace_back(bn->RunningVariance.data(), bn->RunningVariance.size());
+					}
+				}
+				break;
+
+				case LayerTypes::BatchNormRelu:
+				{
+					auto bn = dynamic_cast<BatchNormRelu*>(layer.get());
+					if (bn)
+					{
+						buffers.emplace_back(bn->RunningMean.data(), bn->RunningMean.size());
+						buffers.emplace_back(bn->RunningVariance.data(), bn->RunningVariance.size());
+					}
+				}
+				break;
+
+				default:
+					break;
+				}
+			}
+
+			return buffers;
+		}
+
+		// a failed collective (a lost worker or connection) stops the task instead of escaping the training thread
+		bool CommunicationFailed(const std::exception& exception)
+		{
+			CommunicationError = exception.what();
+			TaskState.store(TaskStates::Stopped);
+
+			return false;
+		}
+
+		// all replicas start from the weights and running statistics of rank 0
+		bool SynchronizeWeights()
+		{
+			auto buffers = GetBatchNormStatistics();
+			for (auto& layer : Layers)
+			{
+				buffers.emplace_back(layer->Weights.data(), layer->Weights.size());
+				buffers.emplace_back(layer->Biases.data(), layer->Biases.size());
+			}
+
+			try
+			{
+				Comm->Broadcast(buffers);
+			}
+			catch (const std::exception& exception)
+			{
+				return CommunicationFailed(exception);
+			}
+
+			for (auto& layer : Layers)
+				layer->WeightsChanged();
+
+			return true;
+		}
+
+		// sums the loss and errors of the shards, after training optionally averages the batch norm running statistics,
+		// the batch statistics of every step stay per worker
+		bool SynchronizeStatistics(const States state)
+		{
+			const auto training = state == States::Training;
+
+			auto stats = FloatVector();
+			for (auto cost : CostLayers)
+			{
+				stats.push_back(training ? cost->TrainLoss : cost->TestLoss);
+				stats.push_back(Float(training ? cost->TrainErrors : cost->TestErrors));
+			}
+
+			try
+			{
+				Comm->Allreduce({ { stats.data(), stats.size() } });
+
+				if (training && SyncBatchNormStatistics)
+					Comm->Allreduce(GetBatchNormStatistics());
+			}
+			catch (const std::exception& exception)
+			{
+				return CommunicationFailed(exception);
+			}
+
+			const auto worldSize = Float(Comm->WorldSize);
+			for (auto c = 0ull; c < CostLayers.size(); c++)
+			{
+				const auto loss = stats[c * 2ull] * worldSize;
+				const auto errors = static_cast<UInt>(std::round(stats[c * 2ull + 1ull] * worldSize));
+				if (training)
+				{
+					CostLayers[c]->TrainLoss = loss;
+					CostLayers[c]->TrainErrors = errors;
+				}
+				else
+				{
+					CostLayers[c]->TestLoss = loss;
+					CostLayers[c]->TestErrors = errors;
+				}
+			}
+
+			return true;
+		}
+
 		void ChangeDropout(const Float dropout, const UInt batchSize)
 		{
 			if (dropout < 0 || dropout >= 1)
@@ -721,6 +1113,7 @@ namespace dnn
 
 					layer->ResetWeights(WeightsFiller, WeightsFillerMode, WeightsGain, WeightsScale, BiasesFiller, BiasesFillerMode, BiasesGain, BiasesScale);
 					layer->ResetOptimizer(Optimizer);
+					layer->WeightsChanged();
 				}
 
 				ResettingWeights.store(false);
@@ -1123,65 +1516,49 @@ namespace dnn
 		}
 #endif
 
+		// sums the loss of the valid rows of the batch, the per row loss comes from the forward pass of the cost layers (Cost::BatchLoss)
 		void CostFunctionBatch(const States state, const UInt batchSize, const bool overflow, const UInt skipCount)
 		{
+			const auto rows = overflow ? std::min(batchSize, skipCount) : batchSize;
+
 			for (auto cost : CostLayers)
 			{
-				for (auto b = 0ull; b < batchSize; b++)
-				{
-					if (overflow && b >= skipCount)
-						return;
-
-					const auto batchOffset = b * cost->C;
-					auto loss = Float(0);
-
-					for (auto i = 0ull; i < cost->C; i++)
-						loss += cost->Neurons[batchOffset + i] * cost->Weight;
+				auto loss = Float(0);
+				for (auto b = 0ull; b < rows; b++)
+					loss += cost->BatchLoss[b];
 
-					if (state == States::Training)
-						cost->TrainLoss += loss;
-					else
-						cost->TestLoss += loss;
-				}
+				if (state == States::Training)
+					cost->TrainLoss += loss;
+				else
+					cost->TestLoss += loss;
 			}
 		}
 
 		void RecognizedBatch(const States state, const UInt batchSize, const bool overflow, const UInt skipCount, const std::vector<std::vector<LabelInfo>>& sampleLabels)
 		{
+			const auto rows = overflow ? std::min(batchSize, skipCount) : batchSize;
+
 			for (auto cost : CostLayers)
 			{
-				const auto &inputLayer = cost->InputLayer;
 				const auto labelIndex = cost->LabelIndex;
 
-				for (auto b = 0ull; b < batchSize; b++)
+				auto errors = 0ull;
+				for (auto b = 0ull; b < rows; b++)
 				{
-					if (overflow && b >= skipCount)
-						return;
-
-					const auto sampleOffset = b * inputLayer->C;
-
-					auto hotIndex = 0ull;
-					auto maxValue = std::numeric_limits<Float>::lowest();
-					for (auto i = 0ull; i < inputLayer->C; i++)
-					{
-						if (inputLayer->Neurons[i + sampleOffset] > maxValue)
-						{
-							maxValue = inputLayer->Neurons[i + sampleOffset];
-							hotIndex = i;
-						}
-					}
+					const auto hotIndex = cost->BatchPrediction[b];
+					const auto label = sampleLabels[b][labelIndex].LabelA;
 
-					if (hotIndex != sampleLabels[b][labelIndex].LabelA)
-					{
-						if (state == States::Training)
-							cost->TrainErrors++;
-						else
-							cost->TestErrors++;
-					}
+					if (hotIndex != label)
+						errors++;
 
 					if (state == States::Testing)
-						cost->ConfusionMatrix[hotIndex][sampleLabels[b][labelIndex].LabelA]++;
+						cost->ConfusionMatrix[hotIndex][label]++;
 				}
+
+				if (state == States::Training)
+					cost->TrainErrors += errors;
+				else
+					cost->TestErrors += errors;
 			}
 		}
 
@@ -1230,6 +1607,11 @@ namespace dnn
 			}
 		}
 
+		auto IsWeightsShareable(const Layer& layer) const
+		{
+			return layer.LayerType == LayerTypes::Convolution || layer.LayerType == LayerTypes::ConvolutionTranspose || layer.LayerType == LayerTypes::Dense || layer.LayerType == LayerTypes::DepthwiseConvolution || layer.LayerType == LayerTypes::PartialDepthwiseConvolution;
+		}
+
 		auto IsSkippable(const Layer& layer) const
 		{
 			return layer.LayerType == LayerTypes::Add || layer.LayerType == LayerTypes::Average || layer.LayerType == LayerTypes::Substract; // || layer.LayerType == LayerTypes::Multiply || layer.LayerType == LayerTypes::Divide;
@@ -1347,59 +1729,278 @@ namespace dnn
 			return outputs;
 		}
 
-		std::vector<Layer*> SetRelations()
+		// the consumers of the inputs of a layer add to their gradients (and that of the layer an InplaceBwd input shares), so a fused consumer
+		// adding to them in its own backprop order gives the same sums, unless the first one in backprop order overwrites a gradient instead
+		// (a Fused input, a step of the same elementwise chain, has no gradient of its own)
+		static bool GradientsAccumulated(const Layer* layer)
 		{
-			// This determines how the backprop step correctly flows
-			// When SharesInput is true we have to add our diff vector instead of just copying it because there's more than one layer involved
+			const auto accumulated = [](const Layer* inputLayer)
+			{
+				return inputLayer->Outputs.empty() || !inputLayer->Outputs.back()->OverwritesGradients() || inputLayer->Outputs.back()->SharesInput;
+			};
 
-			// determine SharesInputOriginal and SharesInput
-			for (auto& layer : Layers)
-				layer->SharesInput = false;
-			
-			auto unreferencedLayers = std::vector<Layer*>();
+			return std::all_of(layer->InputsFwd.begin(), layer->InputsFwd.end(), [&](const Layer* inputLayer) { return inputLayer->Fused || (accumulated(inputLayer->Storage()) && (!inputLayer->InplaceBwd || accumulated(inputLayer->InputLayerFwd))); });
+		}
 
+		// a Concat only read by a Shuffle isn't materialized, the Shuffle writes the concatenated and shuffled tensor once and scatters its gradient once,
+		// likewise an Add only read by an Activation (same format, same dimensions) is summed by the Activation, which splits its gradient in one pass,
+		// and a squeeze-and-excitation Multiply (gate broadcast over H x W) only read by such a Concat is applied by the Shuffle while gathering,
+		// with ElementwiseFusion the Add + Activation pairs become elementwise chains instead
+		void DetermineFused()
+		{
+			for (auto& layer : Layers)
+				layer->Fused = false;
 			for (auto& layer : Layers)
 			{
-				layer->Outputs = GetLayerOutputs(layer.get());
-				auto outputsCount = layer->Outputs.size();
+				auto input = layer->InputLayerFwd;
+				if (!input || input->Outputs.size() != 1ull || layer->InplaceBwd || layer->InputLayerFwd != layer->InputLayerBwd)
+					continue;
 
-				if (outputsCount > 1)
-				{
-					for (auto& l : Layers)
-					{
-						if (l->Name == layer->Name)
-							continue;
+				if (layer->LayerType == LayerTypes::Shuffle && input->LayerType == LayerTypes::Concat)
+					input->Fused = GradientsAccumulated(input);
 
-						for (auto input : l->InputsFwd)
-						{
-							if (input->Name == layer->Name)
-							{
-								l->SharesInput = l->InplaceBwd ? false : true;
-								l->SharesInputOriginal = l->InplaceBwd ? false : true;
-								outputsCount--;
-								break;
-							}
-						}
-						
-						if (outputsCount == 1)
-							break;
-					}
-				}
-				else
+				if (layer->LayerType == LayerTypes::Activation && input->LayerType == LayerTypes::Add && !ElementwiseFusion && !Checkpointing && !layer->LayerBeforeCost && layer->Format == input->Format)
+					input->Fused = GradientsAccumulated(input) && static_cast<Activation*>(layer.get())->FusesAdd() && input->InputsFwd[0]->H == input->InputsFwd[1]->H && input->InputsFwd[0]->W == input->InputsFwd[1]->W && input->InputsFwd[0]->C == input->InputsFwd[1]->C;
+			}
+			for (auto& layer : Layers)
+			{
+				const auto multiply = dynamic_cast<Multiply*>(layer.get());
+				if (multiply && multiply->Outputs.size() == 1ull && multiply->Outputs[0]->LayerType == LayerTypes::Concat && multiply->Outputs[0]->Fused && multiply->first != multiply->second)
 				{
-					if (outputsCount == 0 && layer->LayerType != LayerTypes::Cost)
-						unreferencedLayers.push_back(layer.get());
+					const auto gate = multiply->InputsFwd[multiply->second];
+					multiply->Fused = gate->H == 1ull && gate->W == 1ull && gate->D == 1ull && GradientsAccumulated(multiply);
 				}
 			}
 
-			// determine SharesInputInplace
 			for (auto& layer : Layers)
+				layer->Chain = nullptr;
+			if (ElementwiseFusion && !Checkpointing)
+				FuseElementwiseChains();
+		}
+
+		// the layers an elementwise chain can hold: Add, Substract, Multiply, Divide, Max, Min, Average and the Activations computed with Func (FusesAdd),
+		// PRelu has weights of its own, a masked Activation keeps its bits and an InplaceBwd one shares the gradient of its input
+		static bool Chainable(const Layer* layer)
+		{
+			switch (layer->LayerType)
 			{
-				auto outputsCount = GetLayerOutputs(layer.get(), true).size();
+			case LayerTypes::Add:
+			case LayerTypes::Average:
+			case LayerTypes::Divide:
+			case LayerTypes::Max:
+			case LayerTypes::Min:
+			case LayerTypes::Multiply:
+			case LayerTypes::Substract:
+				return !layer->InplaceBwd;
+			case LayerTypes::Activation:
+			{
+				const auto activation = static_cast<const Activation*>(layer);
+				return !activation->InplaceBwd && !activation->MaskBackward && activation->FusesAdd();
+			}
+			default:
+				return false;
+			}
+		}
 
-				if (outputsCount > 1)
-				{
-					for (auto& l : Layers)
+		// an elementwise layer only read by an elementwise layer in the same format and with the same dimensions is a Fused step of the chain of its consumer,
+		// the layer a chain ends in (its root) computes it (ElementwiseChain.h), the inputs of the steps must have their gradients accumulated
+		// as the root adds to them in its own backprop order, a Concat or Multiply fused for a Shuffle is never read by an elementwise layer
+		void FuseElementwiseChains()
+		{
+			for (auto& layer : Layers)
+			{
+				const auto output = layer->Outputs.size() == 1ull ? layer->Outputs[0] : nullptr;
+				if (output && !layer->Fused && !output->Fused && !output->LayerBeforeCost && Chainable(layer.get()) && Chainable(output) && layer->Format == output->Format && layer->IsPlainFormat() == output->IsPlainFormat())
+					layer->Fused = layer->C == output->C && layer->D == output->D && layer->H == output->H && layer->W == output->W && GradientsAccumulated(layer.get());
+			}
+
+			for (auto& layer : Layers)
+				if (!layer->Fused && Chainable(layer.get()) && std::any_of(layer->InputsFwd.begin(), layer->InputsFwd.end(), [](const Layer* input) { return input->Fused; }))
+				{
+					auto chain = std::make_shared<ElementwiseChain>(Device, layer.get());
+					auto steps = std::unordered_map<const Layer*, UInt>();
+					ChainStep(*chain, steps, layer.get());
+					layer->Chain = chain;
+				}
+		}
+
+		// appends the steps computing layer after the ones of its inputs, every layer in or read by the chain is one step
+		UInt ChainStep(ElementwiseChain& chain, std::unordered_map<const Layer*, UInt>& steps, Layer* layer)
+		{
+			const auto operand = [&](const Byte index)
+			{
+				const auto input = layer->InputsFwd[index];
+				if (steps.count(input) == 0ull)
+				{
+					if (input->Fused)
+						ChainStep(chain, steps, input);
+					else
+					{
+						auto step = ElementwiseNode(ElementwiseOps::Input, layer);
+						step.Index[0] = index;
+						step.Broadcast = input->DHW() == 1ull && chain.Root->DHW() > 1ull;
+						chain.Nodes.push_back(step);
+						steps[input] = chain.Nodes.size() - 1ull;
+					}
+				}
+
+				return steps[input];
+			};
+
+			auto step = ElementwiseNode(ElementwiseOps::Sum, layer);
+			switch (layer->LayerType)
+			{
+			case LayerTypes::Activation:
+			{
+				const auto activation = static_cast<const Activation*>(layer);
+				step.Op = ElementwiseOps::Activation;
+				step.f = activation->Func.f;
+				step.df = activation->Func.df;
+				step.fVec = activation->Func.fVec;
+				step.dfVec = activation->Func.dfVec;
+				step.Alpha = activation->Alpha;
+				step.Beta = activation->Beta;
+				break;
+			}
+			case LayerTypes::Add:
+			{
+				auto add = static_cast<Add*>(layer);
+				step.Index = { add->first, add->second };
+				step.SurvivalProbability = &add->SurvivalProbability;
+				break;
+			}
+			case LayerTypes::Average:
+			{
+				auto average = static_cast<Average*>(layer);
+				step.Index = { average->first, average->second };
+				step.Weights = { Float(0.5), Float(0.5) };
+				step.SurvivalProbability = &average->SurvivalProbability;
+				break;
+			}
+			case LayerTypes::Substract:
+			{
+				auto substract = static_cast<Substract*>(layer);
+				step.Index = { substract->first, substract->second };
+				step.Weights = { Float(1), Float(-1) };
+				step.SurvivalProbability = &substract->SurvivalProbability;
+				break;
+			}
+			case LayerTypes::Multiply:
+				step.Op = ElementwiseOps::Multiply;
+				step.Index = { static_cast<Multiply*>(layer)->first, static_cast<Multiply*>(layer)->second };
+				break;
+			case LayerTypes::Divide:
+				step.Op = ElementwiseOps::Divide;
+				step.Index = { static_cast<Divide*>(layer)->first, static_cast<Divide*>(layer)->second };
+				break;
+			case LayerTypes::Max:
+				step.Op = ElementwiseOps::Max;
+				step.Index = { static_cast<Max*>(layer)->first, static_cast<Max*>(layer)->second };
+				break;
+			case LayerTypes::Min:
+				step.Op = ElementwiseOps::Min;
+				step.Index = { static_cast<Min*>(layer)->first, static_cast<Min*>(layer)->second };
+				break;
+			default:
+				throw std::invalid_argument("Layer " + layer->Name + " can't be a step of an elementwise chain");
+			}
+
+			step.Operands[0] = operand(step.Index[0]);
+			step.Operands[1] = step.Op == ElementwiseOps::Activation ? step.Operands[0] : operand(step.Index[1]);
+			chain.Nodes.push_back(step);
+			steps[layer] = chain.Nodes.size() - 1ull;
+
+			return steps[layer];
+		}
+
+		// the first layer in backprop order writing to the gradient of a layer overwrites it when it doesn't share its input, so zeroing NeuronsD1 in ForwardProp isn't needed,
+		// once fusion is known an unfused multi-input layer first in backprop order writes the gradient of its input as well, unless a consumer of that input
+		// adds to the gradient out of backprop order (a View, a Fused layer or an elementwise chain) or through an InplaceBwd layer
+		void DetermineGradientOverwritten(const bool fused)
+		{
+			for (auto& layer : Layers)
+			{
+				const auto& outputs = layer->Outputs;
+				layer->GradientOverwritten = !layer->InplaceBwd && !outputs.empty() && outputs.back()->OverwritesGradients() && !outputs.back()->SharesInput;
+
+				if (fused && !layer->GradientOverwritten && !layer->InplaceBwd && !layer->View && !layer->Fused && !outputs.empty() && outputs.back()->OverwritesInputGradient(layer.get()) &&
+					std::none_of(outputs.begin(), outputs.end(), [](const Layer* output) { return output->View || output->Fused || output->InplaceBwd || output->Chain; }))
+					layer->GradientOverwritten = true;
+			}
+		}
+
+		// Fused again after a setting it depends on changed, a layer gaining or losing its Neurons gets its buffers and descriptors again, like its consumers
+		void UpdateFused()
+		{
+			auto fused = std::vector<bool>();
+			for (const auto& layer : Layers)
+				fused.push_back(layer->Fused);
+
+			DetermineFused();
+			DetermineGradientOverwritten(true);
+
+			for (auto i = 0ull; i < Layers.size(); i++)
+				if (Layers[i]->Fused != fused[i])
+				{
+					Layers[i]->SetBatchSize(BatchSize);
+					for (auto output : Layers[i]->Outputs)
+						output->SetBatchSize(BatchSize);
+				}
+		}
+
+		std::vector<Layer*> SetRelations()
+		{
+			// This determines how the backprop step correctly flows
+			// When SharesInput is true we have to add our diff vector instead of just copying it because there's more than one layer involved
+
+			// determine SharesInputOriginal and SharesInput
+			for (auto& layer : Layers)
+				layer->SharesInput = false;
+			
+			auto unreferencedLayers = std::vector<Layer*>();
+
+			for (auto& layer : Layers)
+			{
+				layer->Outputs = GetLayerOutputs(layer.get());
+				auto outputsCount = layer->Outputs.size();
+
+				if (outputsCount > 1)
+				{
+					for (auto& l : Layers)
+					{
+						if (l->Name == layer->Name)
+							continue;
+
+						for (auto input : l->InputsFwd)
+						{
+							if (input->Name == layer->Name)
+							{
+								l->SharesInput = l->InplaceBwd ? false : true;
+								l->SharesInputOriginal = l->InplaceBwd ? false : true;
+								outputsCount--;
+								break;
+							}
+						}
+						
+						if (outputsCount == 1)
+							break;
+					}
+				}
+				else
+				{
+					if (outputsCount == 0 && layer->LayerType != LayerTypes::Cost)
+						unreferencedLayers.push_back(layer.get());
+				}
+			}
+
+			// determine SharesInputInplace
+			for (auto& layer : Layers)
+			{
+				auto outputsCount = GetLayerOutputs(layer.get(), true).size();
+
+				if (outputsCount > 1)
+				{
+					for (auto& l : Layers)
 					{
 						if (l->Name == layer->Name)
 							continue;
@@ -1420,6 +2021,25 @@ namespace dnn
 				}
 			}
 
+			// determine GradientOverwritten
+			DetermineGradientOverwritten(false);
+
+			// determine View
+			// a Viewable layer only read by layers accepting views aliases its channels in its input, which must not be shared in place
+			// and must have its gradient accumulated (not overwritten) because its consumers add to it directly and in their own backprop order
+			for (auto& layer : Layers)
+			{
+				layer->View = false;
+				if (layer->Viewable() && !layer->Outputs.empty() && !layer->InplaceBwd && !layer->InputLayerFwd->InplaceBwd && !layer->InputLayerFwd->GradientOverwritten && layer->InputLayerFwd == layer->InputLayerBwd)
+					layer->View = std::all_of(layer->Outputs.begin(), layer->Outputs.end(), [](const Layer* output) { return output->AcceptsViews(); });
+			}
+
+			// determine Fused
+			DetermineFused();
+
+			// determine GradientOverwritten again, for the consumers writing their input gradients once fusion is known
+			DetermineGradientOverwritten(true);
+
 			return unreferencedLayers;
 		}
 	
@@ -1430,6 +2050,10 @@ namespace dnn
 				TaskState.store(TaskStates::Running);
 				State.store(States::Idle);
 
+				for (auto& layer : Layers)
+					if (layer->Quantized)
+						layer->Quantize(false);
+
 				auto msg = std::string();
 				if (!Activation::CheckActivations(msg))
 				{
@@ -1508,6 +2132,22 @@ namespace dnn
 						break;
 					}
 
+				if (Comm && !SynchronizeWeights())
+				{
+					State.store(States::Completed);
+					return;
+				}
+
+				ResetPrefixCache();
+
+				LossHistory.clear();
+				LossHistoryIndex = 0ull;
+				SelectedSamples.clear();
+				ShardStart = 0ull;
+				Progress.clear();
+				Progress.reserve(TotalEpochs);
+				const auto trainingStart = timer.now();
+
 				while (CurrentEpoch < TotalEpochs)
 				{
 					if (CurrentEpoch - (GoToEpoch - 1) == learningRateEpochs)
@@ -1522,6 +2162,8 @@ namespace dnn
 						if (Dropout != CurrentTrainingRate.Dropout)
 							ChangeDropout(CurrentTrainingRate.Dropout, BatchSize);
 
+						ResetPrefixCache();
+
 						learningRateEpochs += CurrentTrainingRate.Epochs;
 
 						if (CurrentTrainingRate.Optimizer != Optimizer)
@@ -1551,9 +2193,19 @@ namespace dnn
 					{
 						State.store(States::Training);
 
-						const auto shuffleCount = UniformInt<UInt>(DataProv->ShuffleCount / 2ull, DataProv->ShuffleCount);
-						for (auto shuffle = 0ull; shuffle < shuffleCount; shuffle++)
-							std::shuffle(std::begin(RandomTrainingSamples), std::end(RandomTrainingSamples), std::mt19937(Seed<unsigned>()));
+						if (Comm)
+						{
+							// every worker draws the same permutation, so the shards are disjoint
+							std::shuffle(std::begin(RandomTrainingSamples), std::end(RandomTrainingSamples), std::mt19937(static_cast<unsigned>(CurrentEpoch)));
+						}
+						else
+						{
+							const auto shuffleCount = UniformInt<UInt>(DataProv->ShuffleCount / 2ull, DataProv->ShuffleCount);
+							for (auto shuffle = 0ull; shuffle < shuffleCount; shuffle++)
+								std::shuffle(std::begin(RandomTrainingSamples), std::end(RandomTrainingSamples), std::mt19937(Seed<unsigned>()));
+						}
+
+						BackpropSamples = 0ull;
 
 						for (auto cost : CostLayers)
 							cost->Reset();
@@ -1572,7 +2224,10 @@ namespace dnn
 								Layers[0]->fpropTime = timer.now() - timePointGlobal;
 
 								for (auto cost : CostLayers)
+								{
 									cost->SetSampleLabel(SampleLabel);
+									cost->SetTeacherViews(TeacherViews);
+								}
 
 								for (auto i = 1ull; i < Layers.size(); i++)
 								{
@@ -1628,8 +2283,33 @@ namespace dnn
 						{
 #endif
 							auto overflow = false;
-							for (SampleIndex = 0; SampleIndex < AdjustedTrainingSamplesCount; SampleIndex += BatchSize)
+							auto microBatch = 0ull;
+							auto pendingUpdates = std::vector<std::pair<UInt, std::future<void>>>();
+							auto commTimeCount = std::chrono::duration<Float>(Float(0));
+							const auto shardSize = Comm ? ((AdjustedTrainingSamplesCount / BatchSize) / Comm->WorldSize) * BatchSize : AdjustedTrainingSamplesCount;
+							const auto shardStart = Comm ? Comm->Rank * shardSize : 0ull;
+							ShardStart = shardStart;
+							// selective backpropagation trains on the batches gathered from the candidates, the workers of a data parallel run must take the same number of steps
+							const auto selective = SelectiveBackprop && !Comm;
+							auto candidateIndex = shardStart;
+							SelectedSamples.clear();
+							for (SampleIndex = shardStart; SampleIndex < shardStart + shardSize; SampleIndex += BatchSize)
 							{
+								auto selectTime = std::chrono::duration<Float>(Float(0));
+								if (selective)
+								{
+									// a batch ahead is selected so the last micro-batch of the epoch is known
+									timePoint = timer.now();
+									candidateIndex = SelectSamples(candidateIndex, shardStart + shardSize, 2ull * BatchSize);
+									if (SelectedSamples.size() < BatchSize)
+										break;
+
+									// fewer samples are selected than examined, so the batch only overwrites candidates already examined and never runs past the valid samples
+									std::copy_n(SelectedSamples.begin(), BatchSize, RandomTrainingSamples.begin() + SampleIndex);
+									SelectedSamples.erase(SelectedSamples.begin(), SelectedSamples.begin() + BatchSize);
+									selectTime = timer.now() - timePoint;
+								}
+
 								// Forward
 								if (DepthDrop > 0)
 									StochasticDepth(totalSkipConnections, DepthDrop, FixedDepthDrop);
@@ -1637,14 +2317,35 @@ namespace dnn
 								while (Layers[0]->RefreshingStats.load()) {	std::this_thread::yield(); }
 								Layers[0]->Fwd.store(true);
 								timePointGlobal = timer.now();
-								auto SampleLabels = TrainBatch(SampleIndex, BatchSize);
+								const auto prefixRows = PrefixCache ? PrefixCacheRows(SampleIndex, BatchSize) : std::vector<UInt>();
+								const auto prefixCached = PrefixCache && PrefixCache->Filled(prefixRows);
+								auto SampleLabels = TrainBatch(SampleIndex, BatchSize, prefixCached);
 								Layers[0]->fpropTime = timer.now() - timePointGlobal;
 								Layers[0]->Fwd.store(false);
 
 								for (auto cost : CostLayers)
+								{
 									cost->SetSampleLabels(SampleLabels);
+									cost->SetTeacherViews(TeacherViews);
+								}
 
-								for (auto i = 1ull; i < Layers.size(); i++)
+								if (PrefixCache)
+								{
+									timePoint = timer.now();
+									if (prefixCached)
+										PrefixCache->Load(prefixRows);
+									else
+									{
+										for (auto i = 1ull; i < PrefixEnd; i++)
+											Layers[i]->ForwardProp(BatchSize, false);
+										PrefixCache->Store(prefixRows);
+									}
+									for (auto i = 1ull; i < PrefixEnd; i++)
+										Layers[i]->fpropTime = std::chrono::duration<Float>(Float(0));
+									Layers[0]->fpropTime += timer.now() - timePoint;
+								}
+
+								for (auto i = PrefixCache ? PrefixEnd : 1ull; i < Layers.size(); i++)
 								{
 									if (!Layers[i]->Skip && TaskState.load() == TaskStates::Running)
 									{
@@ -1659,14 +2360,25 @@ namespace dnn
 										Layers[i]->fpropTime = std::chrono::duration<Float>(Float(0));
 								}
 								
-								overflow = SampleIndex >= TrainOverflowCount;
-								CostFunctionBatch(State.load(), BatchSize, overflow, TrainSkipCount);
-								RecognizedBatch(State.load(), BatchSize, overflow, TrainSkipCount, SampleLabels);
-								fpropTime = timer.now() - timePointGlobal;
+								// the candidates already counted the loss and errors of the selected samples
+								overflow = !selective && SampleIndex >= TrainOverflowCount;
+								if (!selective)
+								{
+									CostFunctionBatch(State.load(), BatchSize, overflow, TrainSkipCount);
+									RecognizedBatch(State.load(), BatchSize, overflow, TrainSkipCount, SampleLabels);
+								}
+								BackpropSamples += overflow ? std::min(BatchSize, TrainSkipCount) : BatchSize;
+								fpropTime = selectTime + (timer.now() - timePointGlobal);
 
 								// Backward
+								const auto firstMicroBatch = microBatch == 0ull;
+								const auto lastMicroBatch = microBatch + 1ull >= MicroBatches || SampleIndex + BatchSize >= shardStart + shardSize || (selective && SelectedSamples.size() < BatchSize);
+								const auto updateRate = UpdateRate(microBatch + 1ull);
+								microBatch = lastMicroBatch ? 0ull : microBatch + 1ull;
+
 								bpropTimeCount = std::chrono::duration<Float>(Float(0));
 								updateTimeCount = std::chrono::duration<Float>(Float(0));
+								commTimeCount = std::chrono::duration<Float>(Float(0));
 								SwitchInplaceBwd(true);
 								for (auto i = Layers.size() - 1; i >= FirstUnlockedLayer.load(); --i)
 								{
@@ -1675,6 +2387,9 @@ namespace dnn
 										Layers[i]->bpropTime = std::chrono::duration<Float>(Float(0));
 										Layers[i]->updateTime = std::chrono::duration<Float>(Float(0));
 
+										if (Checkpointing && SegmentEnds[i])
+											RecomputeSegment(i);
+
 										if (!Layers[i]->Skip)
 										{
 											while (Layers[i]->RefreshingStats.load()) { std::this_thread::yield(); }
@@ -1685,13 +2400,26 @@ namespace dnn
 											{
 												Layers[i]->ResetGradients();
 												Layers[i]->BackwardProp(BatchSize);
+												if (MicroBatches > 1ull)
+													Layers[i]->AccumulateGradients(firstMicroBatch, lastMicroBatch);
 												Layers[i]->bpropTime = timer.now() - timePoint;
 
-												timePoint = timer.now();
-												Layers[i]->UpdateWeights(CurrentTrainingRate, Optimizer, DisableLocking);
-												Layers[i]->updateTime = timer.now() - timePoint;
-									     
-												updateTimeCount += Layers[i]->updateTime;
+												if (lastMicroBatch)
+												{
+													timePoint = timer.now();
+													if (Comm)
+													{
+														pendingUpdates.emplace_back(i, Comm->AllreduceAsync({ { Layers[i]->WeightsD1.data(), Layers[i]->WeightsD1.size() }, { Layers[i]->BiasesD1.data(), Layers[i]->BiasesD1.size() } }));
+														commTimeCount += timer.now() - timePoint;
+													}
+													else
+													{
+														Layers[i]->UpdateWeights(updateRate, Optimizer, DisableLocking);
+														Layers[i]->updateTime = timer.now() - timePoint;
+
+														updateTimeCount += Layers[i]->updateTime;
+													}
+												}
 											}
 											else
 											{
@@ -1701,15 +2429,63 @@ namespace dnn
 
 											bpropTimeCount += Layers[i]->bpropTime;
 											Layers[i]->Bwd.store(false);
-										}										
+										}
+										else if (Layers[i]->HasWeights && (MicroBatches > 1ull || Comm))
+										{
+											// a layer dropped by stochastic depth still has to hand over the gradients of the other micro-batches and workers
+											if (MicroBatches > 1ull)
+												Layers[i]->AccumulateGradients(firstMicroBatch, lastMicroBatch, true);
+
+											if (lastMicroBatch && Comm)
+											{
+												if (firstMicroBatch)
+												{
+													std::fill(Layers[i]->WeightsD1.begin(), Layers[i]->WeightsD1.end(), Float(0));
+													std::fill(Layers[i]->BiasesD1.begin(), Layers[i]->BiasesD1.end(), Float(0));
+												}
+
+												timePoint = timer.now();
+												pendingUpdates.emplace_back(i, Comm->AllreduceAsync({ { Layers[i]->WeightsD1.data(), Layers[i]->WeightsD1.size() }, { Layers[i]->BiasesD1.data(), Layers[i]->BiasesD1.size() } }));
+												commTimeCount += timer.now() - timePoint;
+											}
+											else if (lastMicroBatch && !firstMicroBatch)
+												Layers[i]->UpdateWeights(updateRate, Optimizer, DisableLocking);
+										}
 									}
 								}
 								SwitchInplaceBwd(false);
+
+								if (Comm)
+									Comm->Flush();
+
+								for (auto& [index, reduced] : pendingUpdates)
+								{
+									timePoint = timer.now();
+									try
+									{
+										reduced.get();
+									}
+									catch (const std::exception& exception)
+									{
+										CommunicationFailed(exception);
+										break;
+									}
+									commTimeCount += timer.now() - timePoint;
+
+									timePoint = timer.now();
+									Layers[index]->UpdateWeights(updateRate, Optimizer, DisableLocking);
+									Layers[index]->updateTime = timer.now() - timePoint;
+									updateTimeCount += Layers[index]->updateTime;
+								}
+								pendingUpdates.clear();
+
 								bpropTime = bpropTimeCount;
 								updateTime = updateTimeCount;
 
-								elapsedTime = timer.now() - timePointGlobal;
+								elapsedTime = selectTime + (timer.now() - timePointGlobal);
 								SampleSpeed = BatchSize / (Float(std::chrono::duration_cast<std::chrono::microseconds>(elapsedTime).count()) / 1000000);
+								// the share of the step not spent waiting on the other workers
+								ScalingEfficiency = Comm ? Float(1) - commTimeCount.count() / std::max(elapsedTime.count(), std::numeric_limits<Float>::epsilon()) : Float(1);
 
 								if (TaskState.load() != TaskStates::Running && !CheckTaskState())
 									break;
@@ -1724,6 +2500,9 @@ namespace dnn
 					if (CheckTaskState())
 					{
 						State.store(States::Testing);
+
+						if (Comm && !SynchronizeStatistics(States::Training))
+							break;
 #ifdef DNN_STOCHASTIC	
 						if (BatchSize == 1)
 						{
@@ -1747,8 +2526,14 @@ namespace dnn
 						else
 						{
 #endif
+							// every worker tests a contiguous range of the batches, the last batch stays the overflow one
 							auto overflow = false;
-							for (SampleIndex = 0; SampleIndex < AdjustedTestingSamplesCount; SampleIndex += BatchSize)
+							const auto testBatches = AdjustedTestingSamplesCount / BatchSize;
+							const auto testPart = Comm ? (testBatches + Comm->WorldSize - 1ull) / Comm->WorldSize : testBatches;
+							const auto testStart = Comm ? std::min<UInt>(testBatches, Comm->Rank * testPart) * BatchSize : 0ull;
+							const auto testEnd = Comm ? std::min<UInt>(testBatches, (Comm->Rank + 1ull) * testPart) * BatchSize : AdjustedTestingSamplesCount;
+							ShardStart = testStart;
+							for (SampleIndex = testStart; SampleIndex < testEnd; SampleIndex += BatchSize)
 							{
 								timePointGlobal = timer.now();
 
@@ -1787,13 +2572,19 @@ namespace dnn
 #ifdef DNN_STOCHASTIC
 						}
 #endif
+						if (CheckTaskState() && Comm && !SynchronizeStatistics(States::Testing))
+							break;
+
 						if (CheckTaskState())
 						{
+							// the workers together train all whole shards
+							const auto shardSamples = Comm ? ((AdjustedTrainingSamplesCount / BatchSize) / Comm->WorldSize) * BatchSize * Comm->WorldSize : AdjustedTrainingSamplesCount;
+							const auto trainedSamples = std::min<UInt>(shardSamples, DataProv->TrainingSamplesCount);
 							for (auto cost : CostLayers)
 							{
-								cost->AvgTrainLoss = cost->TrainLoss / DataProv->TrainingSamplesCount;
+								cost->AvgTrainLoss = cost->TrainLoss / trainedSamples;
 								cost->AvgTestLoss = cost->TestLoss / DataProv->TestingSamplesCount;
-								cost->TrainErrorPercentage = cost->TrainErrors / Float(DataProv->TrainingSamplesCount / 100);
+								cost->TrainErrorPercentage = cost->TrainErrors / Float(trainedSamples / 100);
 								cost->TestErrorPercentage = cost->TestErrors / Float(DataProv->TestingSamplesCount / 100);
 							}
 
@@ -1807,6 +2598,8 @@ namespace dnn
 							TestErrorPercentage = CostLayers[CostIndex]->TestErrorPercentage;
 							Accuracy = Float(100) - TestErrorPercentage;
 
+							Progress.push_back(EpochProgress{ CurrentEpoch, Comm ? BackpropSamples * Comm->WorldSize : BackpropSamples, std::chrono::duration<Float>(timer.now() - trainingStart).count(), TestErrorPercentage });
+
 							// save the weights and definition
 							State.store(States::SaveWeights);
 							const auto fileName = PersistOptimizer ? (std::string("(") + StringToLower(std::string(magic_enum::enum_name<Datasets>(Dataset))) + std::string(")(") + StringToLower(std::string(magic_enum::enum_name<Optimizers>(Optimizer))) + std::string(").bin")) : (std::string("(") + StringToLower(std::string(magic_enum::enum_name<Datasets>(Dataset))) + std::string(").bin"));
@@ -1814,10 +2607,13 @@ namespace dnn
 							std::filesystem::create_directories(dir);
 							const auto epoch = std::string("(") + StringToLower(std::string(magic_enum::enum_name<Datasets>(Dataset))) + std::string(")(") + StringToLower(std::string(magic_enum::enum_name<Optimizers>(Optimizer))) + std::string(")") + std::to_string(CurrentEpoch) + std::string("-") + std::to_string(CurrentCycle) + std::string("-") + std::to_string(TrainErrors) + std::string("-") + std::to_string(TestErrors);
 							const auto subdir = dir / epoch;
-							std::filesystem::current_path(dir);
-							std::filesystem::create_directories(subdir);
-							SaveWeights((subdir / fileName).string(), PersistOptimizer);
-							SaveDefinition((subdir / std::string("model.txt")).string());
+							if (!Comm || Comm->Rank == 0)
+							{
+								std::filesystem::current_path(dir);
+								std::filesystem::create_directories(subdir);
+								SaveWeights((subdir / fileName).string(), PersistOptimizer);
+								SaveDefinition((subdir / std::string("model.txt")).string());
+							}
 
 							State.store(States::NewEpoch);
 							NewEpoch(CurrentCycle, CurrentEpoch, TotalEpochs, static_cast<UInt>(CurrentTrainingRate.Optimizer), CurrentTrainingRate.Beta2, CurrentTrainingRate.Gamma, CurrentTrainingRate.Eps, CurrentTrainingRate.HorizontalFlip, CurrentTrainingRate.VerticalFlip, CurrentTrainingRate.InputDropout, CurrentTrainingRate.Cutout, CurrentTrainingRate.CutMix, CurrentTrainingRate.AutoAugment, CurrentTrainingRate.ColorCast, CurrentTrainingRate.ColorAngle, CurrentTrainingRate.Distortion, static_cast<UInt>(CurrentTrainingRate.Interpolation), CurrentTrainingRate.Scaling, CurrentTrainingRate.Rotation, CurrentTrainingRate.MaximumRate, CurrentTrainingRate.BatchSize, CurrentTrainingRate.Height, CurrentTrainingRate.Width, CurrentTrainingRate.Momentum, CurrentTrainingRate.L2Penalty, CurrentTrainingRate.Dropout, AvgTrainLoss, TrainErrorPercentage, Float(100) - TrainErrorPercentage, TrainErrors, AvgTestLoss, TestErrorPercentage, Float(100) - TestErrorPercentage, TestErrors);
@@ -1829,6 +2625,8 @@ namespace dnn
 						break;
 				}
 
+				PrefixCache.reset();
+
 				State.store(States::Completed);
 			}
 		}
@@ -2022,6 +2820,7 @@ namespace dnn
 			{
 				TaskState.store(TaskStates::Running);
 				State.store(States::Idle);
+				ShardStart = 0ull;
 
 				auto timer = std::chrono::high_resolution_clock();
 				auto timePoint = timer.now();
@@ -2152,85 +2951,301 @@ namespace dnn
 			}
 		}
 
-		bool GetInputSnapShot(std::vector<Float>* snapshot, std::vector<UInt>* label)
+		// collects the input ranges of the quantizable layers over the first testing samples (fp32, no augmentation)
+		void Calibrate(const UInt calibrationSamples)
 		{
-			if (!Layers[0]->Neurons.empty() && !BatchSizeChanging.load() && !ResettingWeights.load() && !Layers[0]->Fwd.load())
+			const auto samples = std::min(calibrationSamples, DataProv->TestingSamplesCount);
+
+			for (auto& layer : Layers)
 			{
-				const auto idx = UniformInt<UInt>(0ull, BatchSize - 1ull) + SampleIndex;
-				const auto size = Layers[0]->CDHW();
-				const auto offset = (idx - SampleIndex) * size;
+				if (layer->Quantized)
+					layer->Quantize(false);
+				layer->ResetCalibration();
+			}
 
-				if (State.load() == States::Training && idx < DataProv->TrainingSamplesCount)
-				{
-					*label = DataProv->TrainingLabels[RandomTrainingSamples[idx]];
-					
-					for (auto i = 0ull; i < size; i++)
-						(*snapshot)[i] = Layers[0]->Neurons[i + offset];
+			SwitchInplaceBwd(false);
 
-					return true;
-				}
-				else if (State.load() == States::Testing && idx < DataProv->TestingSamplesCount)
+			for (SampleIndex = 0; SampleIndex < samples; SampleIndex += BatchSize)
+			{
+				TestBatch(SampleIndex, BatchSize);
+
+				for (auto i = 1ull; i < Layers.size(); i++)
 				{
-					*label = DataProv->TestingLabels[idx];
-					
-					for (auto i = 0ull; i < size; i++)
-						(*snapshot)[i] = Layers[0]->Neurons[i + offset];
+					if (Layers[i]->Quantizable())
+						Layers[i]->Calibrate(BatchSize);
 
-					return true;
+					Layers[i]->ForwardProp(BatchSize, false);
 				}
 			}
-
-			return false;
 		}
 
-		std::vector<LabelInfo> GetLabelInfo(std::vector<UInt> labels)
+		// quantization-aware training, the tracked ranges are used by Quantize when no calibration samples are given
+		bool SetFakeQuantization(const bool enable)
 		{
-			const auto hierarchies = DataProv->Hierarchies;
-			auto SampleLabels = std::vector<LabelInfo>(hierarchies);
+			if (TaskState.load() != TaskStates::Stopped || BatchSizeChanging.load() || ResettingWeights.load())
+				return false;
 
-			for (auto hierarchie = 0ull; hierarchie < hierarchies; hierarchie++)
-			{
-				SampleLabels[hierarchie].LabelA = labels[hierarchie];
-				SampleLabels[hierarchie].LabelB = labels[hierarchie];
-				SampleLabels[hierarchie].Lambda = Float(1);				
-			}
+			FakeQuantization = enable;
 
-			return SampleLabels;
+			for (auto& layer : Layers)
+				layer->SetFakeQuantization(enable);
+
+			return true;
 		}
 
-		std::vector<LabelInfo> GetCutMixLabelInfo(std::vector<UInt> labels, std::vector<UInt> mixLabels, double lambda)
+		// gradient checkpointing: only the checkpoint layers keep their Neurons through backprop, the segments in between are recomputed
+		// memoryBudget (MB) bounds the Neurons kept at once, with zero the checkpoints minimizing it are chosen
+		bool SetCheckpointing(const bool enable, const UInt memoryBudget = 0)
 		{
-			const auto hierarchies = DataProv->Hierarchies;
-			auto SampleLabels = std::vector<LabelInfo>(hierarchies);
+			if (TaskState.load() != TaskStates::Stopped || BatchSizeChanging.load() || ResettingWeights.load())
+				return false;
 
-			for (auto hierarchie = 0ull; hierarchie < hierarchies; hierarchie++)
+			// recomputing a segment reads the inputs an in-place BatchNormActivation or a masked Activation released
+			if (enable && InPlaceBatchNorm)
+				SetInPlaceBatchNorm(false);
+			if (enable && MaskBackward)
+				SetMaskBackward(false);
+
+			Checkpointing = enable;
+			CheckpointBudget = memoryBudget;
+
+			// a fused Add + Activation or an elementwise chain reads its inputs again in backprop, which may be overwritten by another segment by then
+			UpdateFused();
+
+			if (Checkpointing)
+				SelectCheckpoints(BatchSize);
+			else
 			{
-				SampleLabels[hierarchie].LabelA = labels[hierarchie];
-				SampleLabels[hierarchie].LabelB = mixLabels[hierarchie];
-				SampleLabels[hierarchie].Lambda = Float(lambda);
+				for (auto& layer : Layers)
+					layer->Checkpoint = true;
+				SegmentEnds.clear();
 			}
 
-			return SampleLabels;
+			AssignNeuronsPools(BatchSize);
+			for (auto& layer : Layers)
+				layer->SetBatchSize(BatchSize);
+
+			return true;
 		}
 
-#ifdef DNN_STOCHASTIC
-		std::vector<LabelInfo> TrainSample(const UInt index)
+		void SelectCheckpoints(const UInt batchSize)
 		{
-			const auto rndIndex = RandomTrainingSamples[index];
-			auto imgByte = DataProv->TrainingSamples[rndIndex];
+			const auto count = Layers.size();
 
-			const auto rndIndexMix = (index + 1 >= DataProv->TrainingSamplesCount) ? RandomTrainingSamples[1] : RandomTrainingSamples[index + 1];
-			auto imgByteMix = Image<Byte>(DataProv->TrainingSamples[rndIndexMix]);
+			auto index = std::unordered_map<const Layer*, UInt>();
+			for (auto i = 0ull; i < count; i++)
+				index[Layers[i].get()] = i;
 
-			auto label = DataProv->TrainingLabels[rndIndex];
-			auto labelMix = DataProv->TrainingLabels[rndIndexMix];
-			
-			std::vector<LabelInfo> SampleLabel;
-		
-			auto cutout = false;
-			if (Bernoulli<bool>(CurrentTrainingRate.Cutout))
+			// a segment can end at a layer when no layer after it reads from a layer before it
+			auto boundary = std::vector<bool>(count, false);
+			auto lowestInput = count;
+			for (auto i = count - 1; i > 0ull; --i)
 			{
-				if (CurrentTrainingRate.CutMix)
+				boundary[i] = lowestInput >= i;
+				for (auto input : Layers[i]->InputsFwd)
+					lowestInput = std::min(lowestInput, index[input]);
+				for (auto input : Layers[i]->InputsBwd)
+					lowestInput = std::min(lowestInput, index[input]);
+			}
+
+			auto sizes = std::vector<UInt>(count);
+			auto totalSize = UInt(0);
+			for (auto i = 0ull; i < count; i++)
+			{
+				sizes[i] = Layers[i]->Materialized() ? batchSize * Layers[i]->PaddedCDHW() * sizeof(Float) : 0ull;
+				totalSize += sizes[i];
+			}
+
+			// greedily close a segment at the first boundary after collecting segmentSize bytes, only a boundary ends a segment:
+			// the layers kept inside one (not Recomputable) may be followed by layers reading from before them
+			const auto select = [&](const UInt segmentSize, std::vector<bool>& checkpoint, std::vector<bool>& ends, UInt& peakSize, UInt& recomputeSize)
+			{
+				checkpoint.assign(count, true);
+				ends.assign(count, false);
+				auto keptSize = sizes[0];
+				auto maxSegmentSize = UInt(0);
+				auto segment = UInt(0);
+				auto last = UInt(0);
+				recomputeSize = 0;
+
+				for (auto i = 1ull; i < count; i++)
+				{
+					if (boundary[i] && segment > 0 && segment >= segmentSize)
+					{
+						for (auto j = last + 1; j < i; j++)
+							if (Layers[j]->Recomputable())
+								checkpoint[j] = false;
+
+						ends[i] = true;
+						maxSegmentSize = std::max(maxSegmentSize, segment);
+						recomputeSize += segment;
+						keptSize += sizes[i];
+						segment = 0;
+						last = i;
+					}
+					else if (Layers[i]->Recomputable())
+						segment += sizes[i];
+					else
+						keptSize += sizes[i];
+				}
+
+				peakSize = keptSize + segment + maxSegmentSize;
+			};
+
+			auto best = std::vector<bool>(count, true);
+			auto bestEnds = std::vector<bool>(count, false);
+			auto bestPeakSize = totalSize;
+			auto bestRecomputeSize = UInt(0);
+			const auto budget = CheckpointBudget * UInt(1024) * UInt(1024);
+
+			auto checkpoint = std::vector<bool>();
+			auto ends = std::vector<bool>();
+			auto peakSize = UInt(0);
+			auto recomputeSize = UInt(0);
+			for (auto segmentSize = totalSize; segmentSize > 0ull; segmentSize /= 2ull)
+			{
+				select(segmentSize, checkpoint, ends, peakSize, recomputeSize);
+
+				const auto better = budget > 0 && bestPeakSize <= budget ?
+					(peakSize <= budget && recomputeSize < bestRecomputeSize) :
+					(peakSize < bestPeakSize);
+
+				if (better)
+				{
+					best = checkpoint;
+					bestEnds = ends;
+					bestPeakSize = peakSize;
+					bestRecomputeSize = recomputeSize;
+				}
+			}
+
+			for (auto i = 0ull; i < count; i++)
+				Layers[i]->Checkpoint = best[i];
+			SegmentEnds = bestEnds;
+		}
+
+		// int8 quantization, the accuracy is verified against the fp32 model on the testing set
+		bool Quantize(const UInt calibrationSamples, QuantizationInfo* info)
+		{
+			if (TaskState.load() != TaskStates::Stopped || BatchSizeChanging.load() || ResettingWeights.load() || (calibrationSamples == 0 && !FakeQuantization))
+				return false;
+
+			for (auto& layer : Layers)
+				if (layer->Quantized)
+					layer->Quantize(false);
+
+			auto timer = std::chrono::high_resolution_clock();
+			auto timePoint = timer.now();
+			
+			Testing();
+			TaskState.store(TaskStates::Stopped);
+
+			info->Fp32Accuracy = Accuracy;
+			info->Fp32SampleSpeed = Float(DataProv->TestingSamplesCount) / std::chrono::duration<Float>(timer.now() - timePoint).count();
+
+			if (calibrationSamples > 0)
+				Calibrate(calibrationSamples);
+
+			info->CalibrationSamples = std::min(calibrationSamples, DataProv->TestingSamplesCount);
+			info->QuantizedLayers = 0;
+			for (auto& layer : Layers)
+				if (layer->Quantizable())
+				{
+					layer->Quantize(true);
+					if (layer->Quantized)
+						info->QuantizedLayers++;
+				}
+
+			timePoint = timer.now();
+
+			Testing();
+			TaskState.store(TaskStates::Stopped);
+
+			info->Int8Accuracy = Accuracy;
+			info->Int8SampleSpeed = Float(DataProv->TestingSamplesCount) / std::chrono::duration<Float>(timer.now() - timePoint).count();
+
+			return info->QuantizedLayers > 0;
+		}
+
+		bool GetInputSnapShot(std::vector<Float>* snapshot, std::vector<UInt>* label)
+		{
+			if (!Layers[0]->Neurons.empty() && !BatchSizeChanging.load() && !ResettingWeights.load() && !Layers[0]->Fwd.load())
+			{
+				const auto idx = UniformInt<UInt>(0ull, BatchSize - 1ull) + SampleIndex;
+				const auto size = Layers[0]->CDHW();
+				const auto offset = (idx - SampleIndex) * size;
+
+				if (State.load() == States::Training && idx < DataProv->TrainingSamplesCount)
+				{
+					*label = DataProv->TrainingLabels[RandomTrainingSamples[idx]];
+					
+					for (auto i = 0ull; i < size; i++)
+						(*snapshot)[i] = Layers[0]->Neurons[i + offset];
+
+					return true;
+				}
+				else if (State.load() == States::Testing && idx < DataProv->TestingSamplesCount)
+				{
+					*label = DataProv->TestingLabels[idx];
+					
+					for (auto i = 0ull; i < size; i++)
+						(*snapshot)[i] = Layers[0]->Neurons[i + offset];
+
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		std::vector<LabelInfo> GetLabelInfo(std::vector<UInt> labels)
+		{
+			const auto hierarchies = DataProv->Hierarchies;
+			auto SampleLabels = std::vector<LabelInfo>(hierarchies);
+
+			for (auto hierarchie = 0ull; hierarchie < hierarchies; hierarchie++)
+			{
+				SampleLabels[hierarchie].LabelA = labels[hierarchie];
+				SampleLabels[hierarchie].LabelB = labels[hierarchie];
+				SampleLabels[hierarchie].Lambda = Float(1);				
+			}
+
+			return SampleLabels;
+		}
+
+		std::vector<LabelInfo> GetCutMixLabelInfo(std::vector<UInt> labels, std::vector<UInt> mixLabels, double lambda)
+		{
+			const auto hierarchies = DataProv->Hierarchies;
+			auto SampleLabels = std::vector<LabelInfo>(hierarchies);
+
+			for (auto hierarchie = 0ull; hierarchie < hierarchies; hierarchie++)
+			{
+				SampleLabels[hierarchie].LabelA = labels[hierarchie];
+				SampleLabels[hierarchie].LabelB = mixLabels[hierarchie];
+				SampleLabels[hierarchie].Lambda = Float(lambda);
+			}
+
+			return SampleLabels;
+		}
+
+#ifdef DNN_STOCHASTIC
+		std::vector<LabelInfo> TrainSample(const UInt index)
+		{
+			const auto rndIndex = RandomTrainingSamples[index];
+			auto imgByte = DataProv->TrainingSamples[rndIndex];
+
+			const auto rndIndexMix = (index + 1 >= DataProv->TrainingSamplesCount) ? RandomTrainingSamples[1] : RandomTrainingSamples[index + 1];
+			auto imgByteMix = Image<Byte>(DataProv->TrainingSamples[rndIndexMix]);
+
+			auto label = DataProv->TrainingLabels[rndIndex];
+			auto labelMix = DataProv->TrainingLabels[rndIndexMix];
+			
+			std::vector<LabelInfo> SampleLabel;
+		
+			auto cutout = false;
+			if (Bernoulli<bool>(CurrentTrainingRate.Cutout))
+			{
+				if (CurrentTrainingRate.CutMix)
 				{
 					double lambda = BetaDistribution<double>(1, 1);
 					Image<Byte>::RandomCutMix(imgByte, imgByteMix, &lambda);
@@ -2245,6 +3260,9 @@ namespace dnn
 			else
 				SampleLabel = GetLabelInfo(label);
 
+			if (Teacher)
+				TeacherViews = std::vector<TeacherView>(1, TeacherView{ rndIndex, SampleLabel[0].Lambda != Float(1) ? rndIndexMix : rndIndex, CurrentTrainingRate.HorizontalFlip && TrainingSamplesHFlip[rndIndex] });
+
 			if (CurrentTrainingRate.HorizontalFlip && TrainingSamplesHFlip[rndIndex])
 				Image<Byte>::HorizontalMirror(imgByte);
 
@@ -2408,7 +3426,8 @@ namespace dnn
 			return SampleLabels;
 		}
 
-		std::vector<std::vector<LabelInfo>> TrainBatch(const UInt index, const UInt batchSize)
+		// labelsOnly skips the images when the frozen prefix comes from the PrefixCache
+		std::vector<std::vector<LabelInfo>> TrainBatch(const UInt index, const UInt batchSize, const bool labelsOnly = false)
 		{
 			const auto hierarchies = DataProv->Hierarchies;
 			auto SampleLabels = std::vector<std::vector<LabelInfo>>(batchSize, std::vector<LabelInfo>(hierarchies));
@@ -2417,9 +3436,22 @@ namespace dnn
 			const auto elements = batchSize * C * D * H * W;
 			const auto threads = GetThreads(elements, Float(10));
 
+			if (Teacher)
+				TeacherViews.resize(batchSize);
+
 			for_i_dynamic(batchSize, threads, [=, &SampleLabels](const UInt batchIndex)
 			{
 				const auto randomIndex = (index + batchIndex >= DataProv->TrainingSamplesCount) ? RandomTrainingSamples[batchIndex] : RandomTrainingSamples[index + batchIndex];
+
+				// the PrefixCache only runs without Cutout and CutMix
+				if (labelsOnly)
+				{
+					SampleLabels[batchIndex] = GetLabelInfo(DataProv->TrainingLabels[randomIndex]);
+					if (Teacher)
+						TeacherViews[batchIndex] = TeacherView{ randomIndex, randomIndex, CurrentTrainingRate.HorizontalFlip && TrainingSamplesHFlip[randomIndex] };
+					return;
+				}
+
 				auto imgByte = DataProv->TrainingSamples[randomIndex];
 
 				const auto randomIndexMix = (index + batchSize - (batchIndex + 1) >= DataProv->TrainingSamplesCount) ? RandomTrainingSamples[batchSize - (batchIndex + 1)] : RandomTrainingSamples[index + batchSize - (batchIndex + 1)];
@@ -2445,6 +3477,10 @@ namespace dnn
 				}
 				else
 					SampleLabels[batchIndex] = GetLabelInfo(labels);
+
+				// the teacher saw the deterministic views only: the flip is matched, the random crop, color and distortion are not
+				if (Teacher)
+					TeacherViews[batchIndex] = TeacherView{ randomIndex, SampleLabels[batchIndex][0].Lambda != Float(1) ? randomIndexMix : randomIndex, CurrentTrainingRate.HorizontalFlip && TrainingSamplesHFlip[randomIndex] };
 				
 				if (CurrentTrainingRate.HorizontalFlip && TrainingSamplesHFlip[randomIndex])
 					Image<Byte>::HorizontalMirror(imgByte);
@@ -2493,19 +3529,34 @@ namespace dnn
 		std::vector<std::vector<LabelInfo>> TestBatch(const UInt index, const UInt batchSize)
 		{
 			auto SampleLabels = std::vector<std::vector<LabelInfo>>(batchSize, std::vector<LabelInfo>(DataProv->Hierarchies));
+
+			for (auto batchIndex = 0ull; batchIndex < batchSize; batchIndex++)
+			{
+				const auto sampleIndex = ((index + batchIndex) >= DataProv->TestingSamplesCount) ? batchIndex : index + batchIndex;
+				SampleLabels[batchIndex] = GetLabelInfo(DataProv->TestingLabels[sampleIndex]);
+			}
+
+			PlainBatch(DataProv->TestingSamples, DataProv->TestingSamplesCount, index, batchSize, Layers[0]->Neurons.data());
+
+			return SampleLabels;
+		}
+
+		// center crop without augmentation of batchSize samples from index into input (batchSize x C x D x H x W), wrapping around at count
+		void PlainBatch(const ImageByteVector& samples, const UInt count, const UInt index, const UInt batchSize, Float* input, const bool mirror = false)
+		{
 			const auto resize = DataProv->D != D || DataProv->H != H || DataProv->W != W;
 
 			const auto elements = batchSize * C * D * H * W;
 			const auto threads = GetThreads(elements, Float(10));
 
-			for_i_dynamic(batchSize, threads, [=, &SampleLabels](const UInt batchIndex)
+			for_i_dynamic(batchSize, threads, [=, &samples](const UInt batchIndex)
 			{
-				const auto sampleIndex = ((index + batchIndex) >= DataProv->TestingSamplesCount) ? batchIndex : index + batchIndex;
+				const auto sampleIndex = ((index + batchIndex) >= count) ? batchIndex : index + batchIndex;
 
-				auto labels = DataProv->TestingLabels[sampleIndex];
-				SampleLabels[batchIndex] = GetLabelInfo(labels);
+				auto imgByte = samples[sampleIndex];
 
-				auto imgByte = DataProv->TestingSamples[sampleIndex];
+				if (mirror)
+					Image<Byte>::HorizontalMirror(imgByte);
 
 				if (resize)
 					Image<Byte>::Resize(imgByte, D, H, W, Interpolations(CurrentTrainingRate.Interpolation));
@@ -2522,11 +3573,9 @@ namespace dnn
 					for (auto d = 0u; d < imgByte.D(); d++)
 						for (auto h = 0u; h < imgByte.H(); h++)
 							for (auto w = 0u; w < imgByte.W(); w++)
-								Layers[0]->Neurons[batchIndex * imgByte.Size() + (c * imgByte.ChannelSize()) + (d * imgByte.Area()) + (h * imgByte.W()) + w] = (imgByte(c, d, h, w) - mean) / stddev;
+								input[batchIndex * imgByte.Size() + (c * imgByte.ChannelSize()) + (d * imgByte.Area()) + (h * imgByte.W()) + w] = (imgByte(c, d, h, w) - mean) / stddev;
 				}
 			});
-
-			return SampleLabels;
 		}
 
 		std::vector<std::vector<LabelInfo>> TestAugmentedBatch(const UInt index, const UInt batchSize)
@@ -2590,6 +3639,722 @@ namespace dnn
 			return SampleLabels;
 		}
 			
+		// the layers of the segment ending at end that don't keep their Neurons get them back in the pool the segments share,
+		// the ones kept inside the segment (not Recomputable) aren't run again
+		void RecomputeSegment(const UInt end)
+		{
+			auto first = end;
+			while (first > 1ull && !SegmentEnds[first - 1])
+				first--;
+
+			SwitchInplaceBwd(false);
+			for (auto i = first; i < end; i++)
+				if (!Layers[i]->Checkpoint && !Layers[i]->Skip)
+				{
+					Layers[i]->Recomputing = true;
+					Layers[i]->ForwardProp(BatchSize, true);
+					Layers[i]->Recomputing = false;
+				}
+			SwitchInplaceBwd(true);
+		}
+
+		// the layers whose Neurons are never live at the same time share a buffer (Layer::NeuronsPool), per pool the layers and their offsets:
+		// with Checkpointing the layers recomputed in backprop are laid out per segment in one pool sized for the largest segment,
+		// the pointers don't change during training so the memory the primitives were bound to stays valid (every kernel writes the
+		// channels padding the last block, a pooled layer never shows another one's values there)
+		std::vector<std::vector<std::pair<Layer*, UInt>>> NeuronsPools(const UInt batchSize) const
+		{
+			auto pools = std::vector<std::vector<std::pair<Layer*, UInt>>>();
+
+			if (Checkpointing && SegmentEnds.size() == Layers.size())
+			{
+				auto pool = std::vector<std::pair<Layer*, UInt>>();
+				auto offset = UInt(0);
+				for (auto i = 1ull; i < Layers.size(); i++)
+				{
+					if (SegmentEnds[i])
+						offset = 0;
+					else if (!Layers[i]->Checkpoint && Layers[i]->Materialized())
+					{
+						pool.emplace_back(Layers[i].get(), offset);
+						offset += PoolSize(batchSize, Layers[i].get());
+					}
+				}
+				if (!pool.empty())
+					pools.push_back(pool);
+			}
+			else if (ReleasesInputs())
+			{
+				// an input released by its only reader isn't read after the reader's forward pass, the inputs whose ranges from
+				// their own to their reader's forward pass don't overlap take turns in one pool, per pool the last reader and the inputs
+				auto slots = std::vector<std::pair<UInt, std::vector<Layer*>>>();
+				for (auto i = 1ull; i < Layers.size(); i++)
+				{
+					const auto input = ReleasedInput(Layers[i].get());
+					if (!input)
+						continue;
+
+					const auto first = UInt(std::find_if(Layers.begin(), Layers.end(), [=](const auto& layer) { return layer.get() == input; }) - Layers.begin());
+					auto slot = std::find_if(slots.begin(), slots.end(), [=](const auto& slot) { return slot.first < first; });
+					if (slot != slots.end())
+					{
+						slot->first = i;
+						slot->second.push_back(input);
+					}
+					else
+						slots.emplace_back(i, std::vector<Layer*>{ input });
+				}
+
+				for (const auto& slot : slots)
+					if (slot.second.size() > 1ull)
+					{
+						auto pool = std::vector<std::pair<Layer*, UInt>>();
+						for (const auto input : slot.second)
+							pool.emplace_back(input, UInt(0));
+						pools.push_back(pool);
+					}
+			}
+
+			return pools;
+		}
+
+		// the elements a layer takes in a pool, rounded up to a cache line
+		static inline UInt PoolSize(const UInt batchSize, const Layer* layer)
+		{
+			return ((batchSize * layer->PaddedCDHW() + 15ull) / 16ull) * 16ull;
+		}
+
+		static UInt PoolSize(const UInt batchSize, const std::vector<std::pair<Layer*, UInt>>& pool)
+		{
+			auto size = UInt(0);
+			for (const auto& [layer, offset] : pool)
+				size = std::max(size, offset + PoolSize(batchSize, layer));
+
+			return size;
+		}
+
+		// the pools are allocated once, the layers in them borrow their Neurons in SetBatchSize
+		void AssignNeuronsPools(const UInt batchSize)
+		{
+			for (auto& layer : Layers)
+			{
+				layer->NeuronsPool = nullptr;
+				layer->NeuronsPoolOffset = 0;
+			}
+
+			for (const auto& pool : NeuronsPools(batchSize))
+			{
+				auto buffer = std::make_shared<FloatArray>();
+				buffer->resize(1, PoolSize(batchSize, pool), dnnl::memory::data_type::f32, dnnl::memory::format_tag::nc, Device.engine);
+				for (const auto& [layer, offset] : pool)
+				{
+					layer->NeuronsPool = buffer;
+					layer->NeuronsPoolOffset = offset;
+				}
+			}
+		}
+
+		// serving without a Dataprovider: allocates the Neurons and chooses the weights layout for batchSize
+		void SetInferenceBatchSize(const UInt batchSize)
+		{
+			if (batchSize < 1)
+				throw std::invalid_argument("BatchSize cannot be zero in SetInferenceBatchSize");
+
+			AssignNeuronsPools(batchSize);
+			for (auto& layer : Layers)
+				layer->SetBatchSize(batchSize);
+
+			BatchSize = batchSize;
+		}
+
+		// inference context: this model was parsed from the same definition as source and owns its Neurons and stream,
+		// the Weights and Biases of Convolution, Dense and friends are read from source (which must stay unchanged while contexts exist),
+		// the per-channel parameters and statistics of the other layers are copied, the layers source runs in int8 are quantized too
+		void ShareWeights(Model& source, const UInt batchSize)
+		{
+			if (source.Layers.size() != Layers.size())
+				throw std::invalid_argument("Definition mismatch in ShareWeights");
+
+			for (auto i = 0ull; i < Layers.size(); i++)
+			{
+				auto& layer = Layers[i];
+				auto& shared = source.Layers[i];
+
+				if (!layer->HasWeights)
+					continue;
+
+				if (layer->LayerType != shared->LayerType || layer->WeightCount != shared->WeightCount || layer->BiasCount != shared->BiasCount)
+					throw std::invalid_argument("Definition mismatch in ShareWeights");
+
+				if (IsWeightsShareable(*layer))
+				{
+					layer->WeightsMemDesc = std::make_unique<dnnl::memory::desc>(*shared->WeightsMemDesc);
+					FloatVector().swap(layer->Weights);
+					FloatVector().swap(layer->Biases);
+					layer->SharedLayer = shared.get();
+				}
+				else
+				{
+					auto stream = std::stringstream();
+					shared->Save(stream);
+					layer->Load(stream);
+					layer->WeightsChanged();
+				}
+
+				FloatVector().swap(layer->WeightsD1);
+				FloatVector().swap(layer->BiasesD1);
+
+				layer->QuantSrcMin = shared->QuantSrcMin;
+				layer->QuantSrcMax = shared->QuantSrcMax;
+			}
+
+			CostIndex = source.CostIndex;
+			SetInferenceBatchSize(batchSize);
+
+			for (auto i = 0ull; i < Layers.size(); i++)
+				if (source.Layers[i]->Quantized)
+					Layers[i]->Quantize(true);
+		}
+
+		// int8 serving without a Dataprovider: calibrates on count plain samples and quantizes, returns the number of quantized layers
+		UInt QuantizeInference(const Float* samples, const UInt count)
+		{
+			if (!samples || count < 1 || Layers[0]->Neurons.empty())
+				return 0ull;
+
+			for (auto& layer : Layers)
+			{
+				if (layer->Quantized)
+					layer->Quantize(false);
+				layer->ResetCalibration();
+			}
+
+			SwitchInplaceBwd(false);
+
+			const auto inputSize = Layers[0]->CDHW();
+			for (auto sample = 0ull; sample < count; sample += BatchSize)
+			{
+				const auto batchSize = std::min(BatchSize, count - sample);
+				std::copy_n(samples + sample * inputSize, batchSize * inputSize, Layers[0]->Neurons.data());
+				if (batchSize < BatchSize)
+					std::fill_n(Layers[0]->Neurons.data() + batchSize * inputSize, (BatchSize - batchSize) * inputSize, Float(0));
+
+				for (auto i = 1ull; i < Layers.size(); i++)
+				{
+					if (Layers[i]->LayerType == LayerTypes::Cost)
+						continue;
+
+					if (Layers[i]->Quantizable())
+						Layers[i]->Calibrate(batchSize);
+
+					Layers[i]->ForwardProp(BatchSize, false);
+				}
+			}
+
+			auto quantized = 0ull;
+			for (auto& layer : Layers)
+				if (layer->Quantizable())
+				{
+					layer->Quantize(true);
+					if (layer->Quantized)
+						quantized++;
+				}
+
+			return quantized;
+		}
+
+		// forward only on caller buffers: input holds batchSize plain C x D x H x W samples, output receives batchSize plain C x D x H x W (InferenceOutputSize())
+		// samples of the CostIndex cost layer input, a blocked output is reordered by skipping its padded channels
+		bool Inference(const Float* input, const UInt batchSize, Float* output)
+		{
+			if (!input || !output || batchSize < 1 || batchSize > BatchSize || Layers[0]->Neurons.empty())
+				return false;
+
+			const auto inputSize = Layers[0]->CDHW();
+			std::copy_n(input, batchSize * inputSize, Layers[0]->Neurons.data());
+			if (batchSize < BatchSize)
+				std::fill_n(Layers[0]->Neurons.data() + batchSize * inputSize, (BatchSize - batchSize) * inputSize, Float(0));
+
+			if (LatencyMode)
+			{
+				auto timer = std::chrono::high_resolution_clock();
+				auto threads = omp_get_max_threads();
+				for (auto i = 1ull; i < Layers.size(); i++)
+				{
+					if (Layers[i]->LayerType == LayerTypes::Cost)
+						continue;
+
+					if (LatencyThreads[i] != threads)
+					{
+						threads = LatencyThreads[i];
+						omp_set_num_threads(threads);
+						LatencyThreadsCap = static_cast<UInt>(threads);
+					}
+
+					const auto timePoint = timer.now();
+					Layers[i]->ForwardProp(BatchSize, false);
+					LatencyTotals[i] += timer.now() - timePoint;
+				}
+				if (threads != static_cast<int>(MAX_THREADS))
+					omp_set_num_threads(static_cast<int>(MAX_THREADS));
+				LatencyThreadsCap = 0ull;
+				LatencySamples++;
+			}
+			else
+				for (auto i = 1ull; i < Layers.size(); i++)
+					if (Layers[i]->LayerType != LayerTypes::Cost)
+						Layers[i]->ForwardProp(BatchSize, false);
+
+			const auto outputLayer = CostLayers[CostIndex]->InputLayer;
+			const auto outputSize = outputLayer->CDHW();
+			if (outputLayer->IsPlainFormat())
+				std::copy_n(outputLayer->Neurons.data(), batchSize * outputSize, output);
+			else
+			{
+				const auto DHW = outputLayer->DHW();
+				const auto paddedSize = outputLayer->PaddedCDHW();
+				for (auto n = 0ull; n < batchSize; n++)
+					for (auto c = 0ull; c < outputLayer->C; c++)
+						for (auto dhw = 0ull; dhw < DHW; dhw++)
+							output[n * outputSize + c * DHW + dhw] = outputLayer->Neurons[n * paddedSize + (c / VectorSize) * VectorSize * DHW + dhw * VectorSize + c % VectorSize];
+			}
+
+			return true;
+		}
+
+		// a DepthwiseConvolution read only by a BatchNormActivation computes it in the epilogue of its direct kernel at inference
+		// and hands it the sums of its output in training, a depthwise convolution whose Neurons the frozen prefix caches keeps them
+		void SetDepthwiseEpilogue(const bool enable)
+		{
+			DepthwiseEpilogue = enable;
+
+			for (auto i = 0ull; i < Layers.size(); i++)
+			{
+				auto depthwise = dynamic_cast<DepthwiseConvolution*>(Layers[i].get());
+				if (!depthwise)
+					continue;
+
+				depthwise->Epilogue = nullptr;
+				if (!DepthwiseEpilogue || depthwise->Outputs.size() != 1ull)
+					continue;
+
+				auto batchNorm = dynamic_cast<BatchNormActivation*>(depthwise->Outputs[0]);
+				if (!batchNorm || batchNorm->InputLayerFwd != depthwise)
+					continue;
+
+				const auto output = std::find_if(Layers.begin(), Layers.end(), [=](const std::unique_ptr<Layer>& layer) { return layer.get() == batchNorm; });
+				if (PrefixCache && i < PrefixEnd && UInt(output - Layers.begin()) >= PrefixEnd)
+					continue;
+
+				depthwise->Epilogue = batchNorm;
+			}
+		}
+
+		// BatchNormActivation and BatchNormActivationDropout take their training batch statistics from one parallel single pass
+		// over the samples and channels (ChannelStatistics.h) instead of the per channel Kahan sums
+		void SetWelfordStatistics(const bool enable)
+		{
+			for (auto& layer : Layers)
+			{
+				if (auto batchNorm = dynamic_cast<BatchNormActivation*>(layer.get()))
+					batchNorm->WelfordStatistics = enable;
+				else if (auto batchNormDropout = dynamic_cast<BatchNormActivationDropout*>(layer.get()))
+					batchNormDropout->WelfordStatistics = enable;
+			}
+		}
+
+		// the only input of reader is read by nothing else and its backprop doesn't need its own Neurons, so reader may release them after its forward pass
+		bool InputReleasable(const Layer* reader) const
+		{
+			const auto input = reader->InputLayerFwd;
+
+			return input && input->Outputs.size() == 1ull && input->Materialized() && !input->InplaceBwd &&
+				(input->LayerType == LayerTypes::Convolution || input->LayerType == LayerTypes::DepthwiseConvolution || input->LayerType == LayerTypes::ConvolutionTranspose || input->LayerType == LayerTypes::Dense);
+		}
+
+		inline bool ReleasesInputs() const noexcept
+		{
+			return InPlaceBatchNorm || MaskBackward;
+		}
+
+		// the input an in-place BatchNormActivation or a masked Activation doesn't read in backprop
+		static Layer* ReleasedInput(const Layer* layer)
+		{
+			if (const auto batchNorm = dynamic_cast<const BatchNormActivation*>(layer))
+				return batchNorm->InPlace ? batchNorm->InputLayerFwd : nullptr;
+
+			if (layer->LayerType == LayerTypes::Activation)
+				return static_cast<const Activation*>(layer)->MaskBackward ? layer->InputLayerFwd : nullptr;
+
+			return nullptr;
+		}
+
+		// in-place activated batch norm: a BatchNormActivation with an invertible activation, the only reader of a convolution or dense layer, doesn't
+		// read that layer's Neurons in backprop, it reconstructs its normalized input from its output, the released inputs share their Neurons (NeuronsPools),
+		// which saves an activation sized buffer per layer from the forward pass to backprop (not combined with Checkpointing)
+		bool SetInPlaceBatchNorm(const bool enable)
+		{
+			if (TaskState.load() != TaskStates::Stopped || BatchSizeChanging.load() || (enable && Checkpointing))
+				return false;
+
+			InPlaceBatchNorm = enable && !Reference && !TestBatchNormalization;
+
+			for (auto& layer : Layers)
+			{
+				auto batchNorm = dynamic_cast<BatchNormActivation*>(layer.get());
+				if (batchNorm)
+					batchNorm->InPlace = InPlaceBatchNorm && BatchNormActivation::Invertible(batchNorm->ActivationFunction, batchNorm->Alpha) && InputReleasable(batchNorm);
+			}
+
+			AssignNeuronsPools(BatchSize);
+			for (auto& layer : Layers)
+				layer->SetBatchSize(BatchSize);
+
+			return true;
+		}
+
+		// an Activation whose derivative only depends on the range of its input (Relu, BoundedRelu, HardSigmoid), the only reader of a convolution
+		// or dense layer, keeps one bit per value in training and shares that layer's Neurons with the other released inputs (not combined with Checkpointing)
+		bool SetMaskBackward(const bool enable)
+		{
+			if (TaskState.load() != TaskStates::Stopped || BatchSizeChanging.load() || (enable && Checkpointing))
+				return false;
+
+			MaskBackward = enable;
+
+			for (auto& layer : Layers)
+				if (layer->LayerType == LayerTypes::Activation)
+				{
+					auto activation = static_cast<Activation*>(layer.get());
+					activation->MaskBackward = MaskBackward && !activation->Fused && !activation->Chain && Activation::Maskable(activation->ActivationFunction) && InputReleasable(activation);
+				}
+
+			AssignNeuronsPools(BatchSize);
+			for (auto& layer : Layers)
+				layer->SetBatchSize(BatchSize);
+
+			return true;
+		}
+
+		// maximal chains of elementwise layers are computed by the layer they end in, in one vectorized pass over the chain inputs forward and backward
+		// (ElementwiseChain.h), the layers in between keep no Neurons and NeuronsD1, with Checkpointing the chains are left unfused
+		bool SetElementwiseFusion(const bool enable)
+		{
+			if (TaskState.load() != TaskStates::Stopped || BatchSizeChanging.load())
+				return false;
+
+			ElementwiseFusion = enable;
+			UpdateFused();
+
+			return true;
+		}
+
+		// batch size 1 serving: light layers run on one thread (no fork/join overhead), Convolution, DepthwiseConvolution and Dense
+		// with at least LatencyHeavyThreshold multiply-adds per sample keep all threads and execute on memory bound up front,
+		// disabling restores the batch size the model had before
+		void SetLatencyMode(const bool enable)
+		{
+			LatencyThreads = std::vector<int>(Layers.size(), static_cast<int>(MAX_THREADS));
+			LatencyTotals = std::vector<std::chrono::duration<Float>>(Layers.size(), std::chrono::duration<Float>(Float(0)));
+			LatencySamples = 0ull;
+
+			if (enable)
+			{
+				if (!LatencyMode)
+					LatencyBatchSize = BatchSize;
+
+				SetInferenceBatchSize(1ull);
+
+				for (auto i = 0ull; i < Layers.size(); i++)
+				{
+					auto& layer = Layers[i];
+					
+					auto macs = 0ull;
+					switch (layer->LayerType)
+					{
+					case LayerTypes::Convolution:
+					case LayerTypes::DepthwiseConvolution:
+						macs = layer->WeightCount * layer->H * layer->W;
+						break;
+					case LayerTypes::Dense:
+						macs = layer->WeightCount;
+						break;
+					default:
+						break;
+					}
+					if (macs >= LatencyHeavyThreshold)
+						layer->BindInference();
+					else
+						LatencyThreads[i] = 1;
+				}
+			}
+			else if (LatencyMode)
+				SetInferenceBatchSize(LatencyBatchSize > 0ull ? LatencyBatchSize : BatchSize);
+
+			LatencyMode = enable;
+		}
+
+		// mean forward time in microseconds of every layer over the Inference calls since SetLatencyMode
+		std::vector<Float> GetLayerLatencies() const
+		{
+			auto latencies = std::vector<Float>(LatencyTotals.size(), Float(0));
+			if (LatencySamples > 0ull)
+				for (auto i = 0ull; i < LatencyTotals.size(); i++)
+					latencies[i] = std::chrono::duration<Float, std::micro>(LatencyTotals[i]).count() / Float(LatencySamples);
+
+			return latencies;
+		}
+
+		// one forward pass of this (teacher) model over the training set in sample order, storing the logits of its output layer for
+		// Distillation costs, mirroredView adds the horizontal mirror of every sample as a second view, returns the number of samples
+		UInt CacheTeacherLogits(const std::string& fileName, const bool mirroredView)
+		{
+			if (!DataProv || CostLayers.empty() || Layers[0]->Neurons.empty())
+				throw std::invalid_argument("Model not ready in CacheTeacherLogits");
+
+			const auto outputLayer = CostLayers[CostIndex]->InputLayer;
+			auto lastLayer = 0ull;
+			for (auto i = 0ull; i < Layers.size(); i++)
+				if (Layers[i].get() == outputLayer)
+					lastLayer = i;
+
+			const auto count = DataProv->TrainingSamplesCount;
+			const auto classes = outputLayer->C;
+			const auto views = mirroredView ? 2ull : 1ull;
+			const auto dataOffset = 4096ull;
+
+			auto file = MappedFile(fileName, dataOffset + count * views * classes * sizeof(Float));
+			const auto header = TeacherLogitsHeader{ { 'D', 'N', 'N', 'T', 'L', 'O', 'G', '\0' }, 1ull, count, classes, views, dataOffset };
+			std::memcpy(file.Data(), &header, sizeof(header));
+			auto logits = reinterpret_cast<Float*>(file.Data() + dataOffset);
+
+			SwitchInplaceBwd(false);
+
+			for (auto view = 0ull; view < views; view++)
+				for (auto index = 0ull; index < count; index += BatchSize)
+				{
+					PlainBatch(DataProv->TrainingSamples, count, index, BatchSize, Layers[0]->Neurons.data(), view == 1ull);
+
+					for (auto i = 1ull; i <= lastLayer; i++)
+						Layers[i]->ForwardProp(BatchSize, false);
+
+					for (auto n = 0ull; n < std::min<UInt>(BatchSize, count - index); n++)
+					{
+						const auto src = outputLayer->Neurons.data() + n * classes;
+						auto dst = logits + ((index + n) * views + view) * classes;
+
+						if (outputLayer->LayerType == LayerTypes::Softmax)
+							for (auto c = 0ull; c < classes; c++)
+								dst[c] = std::log(std::max(src[c], std::numeric_limits<Float>::min()));
+						else
+							std::copy_n(src, classes, dst);
+					}
+				}
+
+			file.Flush();
+
+			return count;
+		}
+
+		// with locked leading layers the layers they hand to the trainable part are cached per sample during a rate phase with a deterministic
+		// input per sample (a flip is a separate view), later epochs start forward from the cache, an empty fileName keeps it in RAM
+		void SetPrefixCache(const bool enable, const std::string& fileName, const bool halfPrecision)
+		{
+			PrefixCaching = enable;
+			PrefixCacheFile = fileName;
+			PrefixCacheHalf = halfPrecision;
+		}
+
+		// the frozen prefix runs in inference mode, so its BatchNorm layers use their running statistics
+		void ResetPrefixCache()
+		{
+			PrefixCache.reset();
+			PrefixEnd = 1ull;
+			SetDepthwiseEpilogue(DepthwiseEpilogue);
+
+			const auto& rate = CurrentTrainingRate;
+			const auto deterministic = rate.Cutout <= Float(0) && rate.AutoAugment <= Float(0) && rate.ColorCast <= Float(0) && rate.Distortion <= Float(0) && rate.InputDropout <= Float(0) && (!RandomCrop || (PadD == 0 && PadH == 0 && PadW == 0));
+			const auto end = FirstUnlockedLayer.load();
+
+			if (!PrefixCaching || !deterministic || DepthDrop > Float(0) || Checkpointing || end < 2ull || end >= Layers.size())
+				return;
+
+			auto frontier = std::vector<Layer*>();
+			for (auto i = end; i < Layers.size(); i++)
+				for (const auto& inputs : { Layers[i]->Inputs, Layers[i]->InputsFwd })
+					for (auto input : inputs)
+						for (auto j = 0ull; j < end; j++)
+							if (Layers[j].get() == input)
+							{
+								// fused layers hand over the layers they're computed from
+								auto pending = std::vector<Layer*>{ input };
+								while (!pending.empty())
+								{
+									auto layer = pending.back();
+									pending.pop_back();
+									if (layer->Fused)
+										pending.insert(pending.end(), layer->InputsFwd.begin(), layer->InputsFwd.end());
+									else if (std::find(frontier.begin(), frontier.end(), layer->Storage()) == frontier.end())
+										frontier.push_back(layer->Storage());
+								}
+							}
+
+			const auto views = (rate.HorizontalFlip ? 2ull : 1ull) * (rate.VerticalFlip ? 2ull : 1ull);
+			PrefixCache = std::make_unique<ActivationCache>(frontier, DataProv->TrainingSamplesCount * views, PrefixCacheHalf, PrefixCacheFile);
+			PrefixEnd = end;
+
+			SetDepthwiseEpilogue(DepthwiseEpilogue);
+		}
+
+		// the training sample of every batch row as TrainBatch picks it
+		std::vector<UInt> TrainBatchSamples(const UInt index, const UInt batchSize) const
+		{
+			auto samples = std::vector<UInt>(batchSize);
+			for (auto batchIndex = 0ull; batchIndex < batchSize; batchIndex++)
+				samples[batchIndex] = (index + batchIndex >= DataProv->TrainingSamplesCount) ? RandomTrainingSamples[batchIndex] : RandomTrainingSamples[index + batchIndex];
+
+			return samples;
+		}
+
+		// the cache row of every batch row: its sample and the view its flips select
+		std::vector<UInt> PrefixCacheRows(const UInt index, const UInt batchSize) const
+		{
+			const auto hflip = CurrentTrainingRate.HorizontalFlip;
+			const auto vflip = CurrentTrainingRate.VerticalFlip;
+			const auto views = (hflip ? 2ull : 1ull) * (vflip ? 2ull : 1ull);
+
+			auto rows = TrainBatchSamples(index, batchSize);
+			for (auto& row : rows)
+			{
+				const auto view = ((hflip && TrainingSamplesHFlip[row]) ? 1ull : 0ull) + ((vflip && TrainingSamplesVFlip[row]) ? (hflip ? 2ull : 1ull) : 0ull);
+				row = row * views + view;
+			}
+
+			return rows;
+		}
+
+		// Selective-Backprop: the candidate batches are forwarded in inference mode and only the samples whose loss ranks high among the last history
+		// sample losses are gathered into the batches of the training pass, Percentile keeps a sample in the top value fraction, Probabilistic keeps it
+		// with the probability of its percentile to the power value (beta), a data parallel run trains on every sample
+		void SetSelectiveBackprop(const bool enable, const SampleSelections selection, const Float value, const UInt history)
+		{
+			if (enable && (value <= Float(0) || (selection == SampleSelections::Percentile && value > Float(1)) || history < 2ull))
+				throw std::invalid_argument("Invalid parameters in SetSelectiveBackprop");
+
+			SelectiveBackprop = enable;
+			Selection = selection;
+			SelectionValue = value;
+			SelectionHistory = history;
+
+			LossHistory.clear();
+			LossHistoryIndex = 0ull;
+			SelectedSamples.clear();
+		}
+
+		// forwards the candidate batches from candidateIndex on until count samples are selected or end is reached and returns the next candidate,
+		// the candidates make up the train loss and errors of the epoch, the batch statistics and running averages see only the training pass
+		UInt SelectSamples(UInt candidateIndex, const UInt end, const UInt count)
+		{
+			while (SelectedSamples.size() < count && candidateIndex < end && TaskState.load() == TaskStates::Running)
+			{
+				while (Layers[0]->RefreshingStats.load()) { std::this_thread::yield(); }
+				Layers[0]->Fwd.store(true);
+				auto SampleLabels = TrainBatch(candidateIndex, BatchSize);
+				Layers[0]->Fwd.store(false);
+
+				for (auto cost : CostLayers)
+				{
+					cost->SetSampleLabels(SampleLabels);
+					cost->SetTeacherViews(TeacherViews);
+				}
+
+				for (auto i = 1ull; i < Layers.size(); i++)
+				{
+					while (Layers[i]->RefreshingStats.load()) { std::this_thread::yield(); }
+					Layers[i]->Fwd.store(true);
+					Layers[i]->ForwardProp(BatchSize, false);
+					Layers[i]->Fwd.store(false);
+				}
+
+				const auto overflow = candidateIndex >= TrainOverflowCount;
+				CostFunctionBatch(States::Training, BatchSize, overflow, TrainSkipCount);
+				RecognizedBatch(States::Training, BatchSize, overflow, TrainSkipCount, SampleLabels);
+
+				const auto rows = overflow ? std::min(BatchSize, TrainSkipCount) : BatchSize;
+				const auto samples = TrainBatchSamples(candidateIndex, BatchSize);
+
+				auto losses = std::vector<Float>(rows, Float(0));
+				for (auto cost : CostLayers)
+					for (auto b = 0ull; b < rows; b++)
+						losses[b] += cost->BatchLoss[b];
+
+				for (auto b = 0ull; b < rows; b++)
+				{
+					// the first batch has no history and keeps every sample
+					const auto percentile = LossHistory.empty() ? Float(1) : Float(std::count_if(LossHistory.begin(), LossHistory.end(), [&](const Float loss) { return loss < losses[b]; })) / Float(LossHistory.size());
+					if (Selection == SampleSelections::Percentile ? (percentile >= Float(1) - SelectionValue) : Bernoulli<bool>(std::pow(percentile, SelectionValue)))
+						SelectedSamples.push_back(samples[b]);
+				}
+
+				for (const auto loss : losses)
+				{
+					if (LossHistory.size() < SelectionHistory)
+						LossHistory.push_back(loss);
+					else
+					{
+						LossHistory[LossHistoryIndex] = loss;
+						LossHistoryIndex = (LossHistoryIndex + 1ull) % SelectionHistory;
+					}
+				}
+
+				candidateIndex += BatchSize;
+			}
+
+			return candidateIndex;
+		}
+
+		// seconds from the start of the training run to the first epoch that reached testErrorPercentage, negative when none did
+		Float TimeToAccuracy(const Float testErrorPercentage) const
+		{
+			for (const auto& progress : Progress)
+				if (progress.TestErrorPercentage <= testErrorPercentage)
+					return progress.Seconds;
+
+			return Float(-1);
+		}
+
+		// maps a file written by CacheTeacherLogits for the Distillation costs of this model, an empty fileName releases it
+		void SetTeacherLogits(const std::string& fileName)
+		{
+			auto teacher = fileName.empty() ? std::unique_ptr<TeacherLogits>() : std::make_unique<TeacherLogits>(fileName);
+
+			if (teacher)
+			{
+				if (!DataProv || teacher->Samples() != DataProv->TrainingSamplesCount)
+					throw std::invalid_argument("Teacher logits don't match the training samples in " + fileName);
+
+				for (auto cost : CostLayers)
+					if (cost->CostFunction == Costs::Distillation && teacher->Classes() != cost->C)
+						throw std::invalid_argument("Teacher logits don't match the classes of " + cost->Name + " in " + fileName);
+			}
+
+			for (auto cost : CostLayers)
+				cost->SetTeacherLogits(teacher.get());
+
+			Teacher = std::move(teacher);
+			TeacherViews = std::vector<TeacherView>();
+		}
+
+		UInt InferenceInputSize() const
+		{
+			return Layers[0]->CDHW();
+		}
+
+		UInt InferenceOutputSize() const
+		{
+			return CostLayers[CostIndex]->InputLayer->CDHW();
+		}
+
 		void ForwardProp(const UInt batchSize)
 		{
 			for (auto &layer : Layers)
@@ -2648,7 +4413,10 @@ namespace dnn
 				if (!is.bad() && is.is_open())
 				{
 					for (auto& layer : Layers)
+					{
 						layer->Load(is, persistOptimizer, Optimizer);
+						layer->WeightsChanged();
+					}
 
 					is.close();
 
@@ -2684,6 +4452,7 @@ namespace dnn
 				if (!is.bad() && is.is_open())
 				{
 					Layers[layerIndex]->Load(is, persistOptimizer, Optimizer);
+					Layers[layerIndex]->WeightsChanged();
 
 					is.close();
 
@@ -1,5 +1,5 @@
 #pragma once
-#include "Layer.h"
+#include "ElementwiseChain.h"
 
 namespace dnn
 {
@@ -51,6 +51,12 @@ namespace dnn
 			return 1;
 		}
 
+		// a broadcast input is summed into over H x W, only the other one has its gradient written whole
+		bool OverwritesInputGradient(const Layer* inputLayer) const final override
+		{
+			return !Fused && !Chain && (EqualDimensions(InputsFwd) || inputLayer == InputsFwd[first]);
+		}
+
 		void InitializeDescriptors(const UInt batchSize)  final override
 		{
 			if (Inputs[first]->DstMemDesc->get_ndims() == 2)
@@ -89,6 +95,15 @@ namespace dnn
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
+			if (Fused)	// a gate applied where the consumer reads the channels or a step of an elementwise chain
+				return;
+
+			if (Chain)
+			{
+				Chain->ForwardProp(batchSize, training);
+				return;
+			}
+
 			const auto fullDepth = true; // SurvivalProbability[0] == Float(1) && SurvivalProbability[1] == Float(1);
 			scales[0] = fullDepth ? Float(1) : (Inputs[0]->Skip ? Float(0) : Float(1));
 			scales[1] = fullDepth ? Float(1) : (Inputs[1]->Skip ? Float(0) : Float(1));
@@ -115,14 +130,16 @@ namespace dnn
 								{
 									(VecFloat().load_a(&Inputs[0]->Neurons[cdhw]) * VecFloat().load_a(&Inputs[1]->Neurons[cdhw])).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 								}
 								for (auto cdhw = part; cdhw < size; cdhw++)
 								{
 									Neurons[cdhw] = Inputs[0]->Neurons[cdhw] * Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							}
@@ -138,14 +155,16 @@ namespace dnn
 									In1.load_a(&Inputs[1]->Neurons[cdhw]);
 									((In0 * scales0) * (In1 * scales1)).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-									VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+									if (!GradientOverwritten)
+										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 								}
 								for (auto cdhw = part; cdhw < size; cdhw++)
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) * (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							}
@@ -162,7 +181,8 @@ namespace dnn
 									{
 										(VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) * VecFloat().load_a(&Inputs[second]->Neurons[c])).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -180,7 +200,8 @@ namespace dnn
 									{
 										((VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) * scales0) * (VecFloat().load_a(&Inputs[second]->Neurons[c]) * scales1)).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 									}
 								}
@@ -198,7 +219,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = Inputs[0]->Neurons[cdhw] * Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							}
@@ -211,7 +233,8 @@ namespace dnn
 								{
 									Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) * (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-									NeuronsD1[cdhw] = 0;
+									if (!GradientOverwritten)
+										NeuronsD1[cdhw] = 0;
 #endif
 								}
 							}
@@ -228,7 +251,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = Inputs[first]->Neurons[hw + outputOffset] * Inputs[second]->Neurons[c];
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -245,7 +269,8 @@ namespace dnn
 									{
 										Neurons[hw + outputOffset] = ((Inputs[first]->Neurons[hw + outputOffset] * scales0) * (Inputs[second]->Neurons[c] * scales1));
 #ifndef DNN_LEAN
-										NeuronsD1[hw + outputOffset] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[hw + outputOffset] = 0;
 #endif
 									}
 								}
@@ -269,14 +294,16 @@ namespace dnn
 									{
 										(VecFloat().load_a(&Inputs[0]->Neurons[cdhw]) * VecFloat().load_a(&Inputs[1]->Neurons[cdhw])).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 									}
 									for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 									{
 										Neurons[cdhw] = Inputs[0]->Neurons[cdhw] * Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-										NeuronsD1[cdhw] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[cdhw] = 0;
 #endif
 									}
 								});
@@ -296,14 +323,16 @@ namespace dnn
 										In1.load_a(&Inputs[1]->Neurons[cdhw]);
 										((In0 * scales0) * (In1 * scales1)).store_a(&Neurons[cdhw]);
 #ifndef DNN_LEAN
-										VecFloat(0).store_nt(&NeuronsD1[cdhw]);
+										if (!GradientOverwritten)
+											VecFloat(0).store_nt(&NeuronsD1[cdhw]);
 #endif
 									}
 									for (auto cdhw = start + part; cdhw < start + size; cdhw++)
 									{
 										Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) * (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-										NeuronsD1[cdhw] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[cdhw] = 0;
 #endif
 									}
 								});
@@ -323,7 +352,8 @@ namespace dnn
 										{
 											(VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) * VecFloat().load_a(&Inputs[second]->Neurons[channelOffset])).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+											if (!GradientOverwritten)
+												VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 										}
 									}
@@ -344,7 +374,8 @@ namespace dnn
 										{
 											((VecFloat().load_a(&Inputs[first]->Neurons[hw + outputOffset]) * scales0) * (VecFloat().load_a(&Inputs[second]->Neurons[channelOffset]) * scales1)).store_a(&Neurons[hw + outputOffset]);
 #ifndef DNN_LEAN
-											VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
+											if (!GradientOverwritten)
+												VecFloat(0).store_nt(&NeuronsD1[hw + outputOffset]);
 #endif
 										}
 									}
@@ -367,7 +398,8 @@ namespace dnn
 									{
 										Neurons[cdhw] = Inputs[0]->Neurons[cdhw] * Inputs[1]->Neurons[cdhw];
 #ifndef DNN_LEAN
-										NeuronsD1[cdhw] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[cdhw] = 0;
 #endif
 									}
 								});
@@ -385,7 +417,8 @@ namespace dnn
 									{
 										Neurons[cdhw] = (Inputs[0]->Neurons[cdhw] * scales0) * (Inputs[1]->Neurons[cdhw] * scales1);
 #ifndef DNN_LEAN
-										NeuronsD1[cdhw] = 0;
+										if (!GradientOverwritten)
+											NeuronsD1[cdhw] = 0;
 #endif
 									}
 								});
@@ -406,7 +439,8 @@ namespace dnn
 										{
 											Neurons[hw + outputOffset] = Inputs[first]->Neurons[hw + outputOffset] * Inputs[second]->Neurons[channelOffset];
 #ifndef DNN_LEAN
-											NeuronsD1[hw + outputOffset] = 0;
+											if (!GradientOverwritten)
+												NeuronsD1[hw + outputOffset] = 0;
 #endif
 										}
 									}
@@ -427,7 +461,8 @@ namespace dnn
 										{
 											Neurons[hw + outputOffset] = ((Inputs[first]->Neurons[hw + outputOffset] * scales0) * (Inputs[second]->Neurons[channelOffset] * scales1));
 #ifndef DNN_LEAN
-											NeuronsD1[hw + outputOffset] = 0;
+											if (!GradientOverwritten)
+												NeuronsD1[hw + outputOffset] = 0;
 #endif
 										}
 									}
@@ -452,10 +487,23 @@ namespace dnn
 
 		void BackwardProp(const UInt batchSize)  final override
 		{
+			if (Fused)
+				return;
+
+			if (Chain)
+			{
+				Chain->BackwardProp(batchSize);
+				return;
+			}
+
 #ifdef DNN_LEAN
 			ZeroGradientMulti(batchSize);
 #endif // DNN_LEAN
 
+			const auto overwrite0 = OverwritesInput(0);
+			const auto overwrite1 = OverwritesInput(1);
+			const auto overwriteFirst = OverwritesInput(first);
+
 			const auto plain = IsPlainFormat();
 			const auto elements = batchSize * (plain ? CDHW() : PaddedCDHW());
 			const auto threads = batchSize == 1 ? 1ull : GetThreads(elements, Float(10));
@@ -469,8 +517,8 @@ namespace dnn
 					{
 						for (auto cdhw = 0ull; cdhw < PaddedCDHW(); cdhw += VectorSize)
 						{
-							mul_add(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw]), VecFloat().load_a(&NeuronsD1[cdhw]), VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-							mul_add(VecFloat().load_a(&InputsFwd[0]->Neurons[cdhw]), VecFloat().load_a(&NeuronsD1[cdhw]), VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+							mul_add(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw]), VecFloat().load_a(&NeuronsD1[cdhw]), (overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]))).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+							mul_add(VecFloat().load_a(&InputsFwd[0]->Neurons[cdhw]), VecFloat().load_a(&NeuronsD1[cdhw]), (overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]))).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 						}
 					}
 					else
@@ -478,8 +526,8 @@ namespace dnn
 						PRAGMA_OMP_SIMD()
 						for (auto cdhw = 0ull; cdhw < CDHW(); cdhw++)
 						{
-							Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * InputsFwd[1]->Neurons[cdhw];
-							Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * InputsFwd[0]->Neurons[cdhw];
+							Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * InputsFwd[1]->Neurons[cdhw];
+							Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * InputsFwd[0]->Neurons[cdhw];
 						}
 					}
 				}
@@ -494,8 +542,8 @@ namespace dnn
 							const auto end = start + PaddedCDHW();
 							for (auto cdhw = start; cdhw < end; cdhw += VectorSize)
 							{
-								mul_add(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw]), VecFloat().load_a(&NeuronsD1[cdhw]), VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw])).store_a(&Inputs[0]->NeuronsD1[cdhw]);
-								mul_add(VecFloat().load_a(&InputsFwd[0]->Neurons[cdhw]), VecFloat().load_a(&NeuronsD1[cdhw]), VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw])).store_a(&Inputs[1]->NeuronsD1[cdhw]);
+								mul_add(VecFloat().load_a(&InputsFwd[1]->Neurons[cdhw]), VecFloat().load_a(&NeuronsD1[cdhw]), (overwrite0 ? VecFloat(0) : VecFloat().load_a(&Inputs[0]->NeuronsD1[cdhw]))).store_a(&Inputs[0]->NeuronsD1[cdhw]);
+								mul_add(VecFloat().load_a(&InputsFwd[0]->Neurons[cdhw]), VecFloat().load_a(&NeuronsD1[cdhw]), (overwrite1 ? VecFloat(0) : VecFloat().load_a(&Inputs[1]->NeuronsD1[cdhw]))).store_a(&Inputs[1]->NeuronsD1[cdhw]);
 							}
 						});
 					}
@@ -508,8 +556,8 @@ namespace dnn
 							PRAGMA_OMP_SIMD()
 							for (auto cdhw = start; cdhw < end; cdhw++)
 							{
-								Inputs[0]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * InputsFwd[1]->Neurons[cdhw];
-								Inputs[1]->NeuronsD1[cdhw] += NeuronsD1[cdhw] * InputsFwd[0]->Neurons[cdhw];
+								Inputs[0]->NeuronsD1[cdhw] = (overwrite0 ? Float(0) : Inputs[0]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * InputsFwd[1]->Neurons[cdhw];
+								Inputs[1]->NeuronsD1[cdhw] = (overwrite1 ? Float(0) : Inputs[1]->NeuronsD1[cdhw]) + NeuronsD1[cdhw] * InputsFwd[0]->Neurons[cdhw];
 							}
 						});
 					}
@@ -526,16 +574,19 @@ namespace dnn
 				{
 					if (!plain)
 					{
-						VecFloat neuronsD1;
+						VecFloat neuronsD1, gate, gateD1;
 						for (auto c = 0ull; c < PaddedC; c += VectorSize)
 						{
 							const auto outputOffset = c * HW();
+							gate.load_a(&InputsFwd[second]->Neurons[c]);
+							gateD1 = VecFloat(0);
 							for (auto hw = 0ull; hw < strideHW; hw += VectorSize)
 							{
 								neuronsD1.load_a(&NeuronsD1[hw + outputOffset]);
-								mul_add(neuronsD1, VecFloat().load_a(&InputsFwd[second]->Neurons[c]), VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
-								mul_add(neuronsD1, VecFloat().load_a(&InputsFwd[first]->Neurons[hw + outputOffset]), VecFloat().load_a(&Inputs[second]->NeuronsD1[c])).store_a(&Inputs[second]->NeuronsD1[c]);
+								mul_add(neuronsD1, gate, (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+								gateD1 = mul_add(neuronsD1, VecFloat().load_a(&InputsFwd[first]->Neurons[hw + outputOffset]), gateD1);
 							}
+							(gateD1 + VecFloat().load_a(&Inputs[second]->NeuronsD1[c])).store_a(&Inputs[second]->NeuronsD1[c]);
 						}
 					}
 					else
@@ -543,12 +594,15 @@ namespace dnn
 						for (auto c = 0ull; c < C; c++)
 						{
 							const auto outputOffset = c * HW();
-							PRAGMA_OMP_SIMD()
+							const auto gate = InputsFwd[second]->Neurons[c];
+							auto gateD1 = Float(0);
+							PRAGMA_OMP_SIMD(reduction(+:gateD1))
 							for (auto hw = 0ull; hw < HW(); hw++)
 							{
-								Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset] * InputsFwd[second]->Neurons[c];
-								Inputs[second]->NeuronsD1[c] += NeuronsD1[hw + outputOffset] * InputsFwd[first]->Neurons[hw + outputOffset];
+								Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset] * gate;
+								gateD1 += NeuronsD1[hw + outputOffset] * InputsFwd[first]->Neurons[hw + outputOffset];
 							}
+							Inputs[second]->NeuronsD1[c] += gateD1;
 						}
 					}
 				}
@@ -559,17 +613,20 @@ namespace dnn
 					{
 						for_i(batchSize, threads, [=](UInt n)
 						{
-							VecFloat neuronsD1;
+							VecFloat neuronsD1, gate, gateD1;
 							for (auto c = 0ull; c < PaddedC; c += VectorSize)
 							{
 								const auto outputOffset = n * PaddedCDHW() + c * HW();
 								const auto channelOffset = n * PaddedC + c;
+								gate.load_a(&InputsFwd[second]->Neurons[channelOffset]);
+								gateD1 = VecFloat(0);
 								for (auto hw = 0ull; hw < strideHW; hw += VectorSize)
 								{
 									neuronsD1.load_a(&NeuronsD1[hw + outputOffset]);
-									mul_add(neuronsD1, VecFloat().load_a(&InputsFwd[second]->Neurons[channelOffset]), VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset])).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
-									mul_add(neuronsD1, VecFloat().load_a(&InputsFwd[first]->Neurons[hw + outputOffset]), VecFloat().load_a(&Inputs[second]->NeuronsD1[channelOffset])).store_a(&Inputs[second]->NeuronsD1[channelOffset]);
+									mul_add(neuronsD1, gate, (overwriteFirst ? VecFloat(0) : VecFloat().load_a(&Inputs[first]->NeuronsD1[hw + outputOffset]))).store_a(&Inputs[first]->NeuronsD1[hw + outputOffset]);
+									gateD1 = mul_add(neuronsD1, VecFloat().load_a(&InputsFwd[first]->Neurons[hw + outputOffset]), gateD1);
 								}
+								(gateD1 + VecFloat().load_a(&Inputs[second]->NeuronsD1[channelOffset])).store_a(&Inputs[second]->NeuronsD1[channelOffset]);
 							}
 						});
 					}
@@ -581,12 +638,15 @@ namespace dnn
 							{
 								const auto outputOffset = n * CDHW() + c * HW();
 								const auto channelOffset = n * C + c;
-								PRAGMA_OMP_SIMD()
+								const auto gate = InputsFwd[second]->Neurons[channelOffset];
+								auto gateD1 = Float(0);
+								PRAGMA_OMP_SIMD(reduction(+:gateD1))
 								for (auto hw = 0ull; hw < HW(); hw++)
 								{
-									Inputs[first]->NeuronsD1[hw + outputOffset] += NeuronsD1[hw + outputOffset] * InputsFwd[second]->Neurons[channelOffset];
-									Inputs[second]->NeuronsD1[channelOffset] += NeuronsD1[hw + outputOffset] * InputsFwd[first]->Neurons[hw + outputOffset];
+									Inputs[first]->NeuronsD1[hw + outputOffset] = (overwriteFirst ? Float(0) : Inputs[first]->NeuronsD1[hw + outputOffset]) + NeuronsD1[hw + outputOffset] * gate;
+									gateD1 += NeuronsD1[hw + outputOffset] * InputsFwd[first]->Neurons[hw + outputOffset];
 								}
+								Inputs[second]->NeuronsD1[channelOffset] += gateD1;
 							}
 						});
 					}
@@ -0,0 +1,250 @@
+#pragma once
+#include "Model.h"
+
+namespace dnn
+{
+	// lock-free multi-producer single-consumer queue (Vyukov): producers only exchange head, the single consumer follows the Next links from tail
+	template<typename T>
+	class MPSCQueue final
+	{
+	private:
+		struct Node
+		{
+			std::atomic<Node*> Next;
+			T Value;
+
+			Node() : Next(nullptr), Value() { }
+			Node(T&& value) : Next(nullptr), Value(std::move(value)) { }
+		};
+
+		std::atomic<Node*> head;
+		Node* tail;
+
+	public:
+		MPSCQueue() :
+			head(new Node()),
+			tail(head.load())
+		{
+		}
+
+		MPSCQueue(const MPSCQueue&) = delete;
+		MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+		~MPSCQueue()
+		{
+			auto value = T();
+			while (Pop(value)) { }
+			delete tail;
+		}
+
+		void Push(T&& value)
+		{
+			auto node = new Node(std::move(value));
+			auto prev = head.exchange(node, std::memory_order_acq_rel);
+			prev->Next.store(node, std::memory_order_release);
+		}
+
+		// consumer only, false when empty (or while a producer is between its exchange and its store)
+		bool Pop(T& value)
+		{
+			auto next = tail->Next.load(std::memory_order_acquire);
+			if (next == nullptr)
+				return false;
+
+			value = std::move(next->Value);
+			delete tail;
+			tail = next;
+
+			return true;
+		}
+	};
+
+	struct ServingInfo
+	{
+		UInt Requests;
+		UInt Batches;
+		Float AvgBatchFill;
+		Float LatencyP50;	// milliseconds, queueing included
+		Float LatencyP99;
+		std::vector<UInt> BatchFill;	// BatchFill[n] = number of batches with n requests
+	};
+
+	// dynamic batching on an inference context: requests wait until MaxBatch of them are queued or the oldest one waited MaxWait,
+	// then a single Inference runs for the whole batch and every caller gets its own output through its future
+	class BatchingServer final
+	{
+	private:
+		typedef std::chrono::high_resolution_clock Clock;
+
+		struct Request
+		{
+			std::vector<Float> Input;
+			std::promise<std::vector<Float>> Output;
+			Clock::time_point Arrival;
+		};
+
+		// 8 buckets per power of two microseconds, about 9% resolution up to 2^24 us
+		static constexpr auto LatencyBucketsPerOctave = 8ull;
+		static constexpr auto LatencyBuckets = 24ull * LatencyBucketsPerOctave;
+
+		Model& Context;
+		MPSCQueue<Request> queue;
+		std::atomic<bool> stop;
+		std::vector<std::atomic<UInt>> latencies;
+		std::vector<std::atomic<UInt>> batchFill;
+		FloatVector input;
+		FloatVector output;
+		std::thread worker;
+
+		static UInt LatencyBucket(const Float microseconds)
+		{
+			const auto bucket = microseconds > Float(1) ? UInt(std::log2(microseconds) * Float(LatencyBucketsPerOctave)) : 0ull;
+			return std::min(bucket, LatencyBuckets - 1ull);
+		}
+
+		void Run(std::vector<Request>& batch)
+		{
+			const auto inputSize = InputSize;
+			const auto outputSize = OutputSize;
+
+			for (auto n = 0ull; n < batch.size(); n++)
+				std::copy(batch[n].Input.begin(), batch[n].Input.end(), input.begin() + n * inputSize);
+
+			if (!Context.Inference(input.data(), batch.size(), output.data()))
+			{
+				for (auto& request : batch)
+					request.Output.set_exception(std::make_exception_ptr(std::runtime_error("Inference failed in BatchingServer")));
+				return;
+			}
+
+			const auto done = Clock::now();
+			for (auto n = 0ull; n < batch.size(); n++)
+			{
+				batch[n].Output.set_value(std::vector<Float>(output.begin() + n * outputSize, output.begin() + (n + 1ull) * outputSize));
+
+				const auto latency = std::chrono::duration<Float, std::micro>(done - batch[n].Arrival).count();
+				latencies[LatencyBucket(latency)].fetch_add(1ull, std::memory_order_relaxed);
+			}
+			batchFill[batch.size()].fetch_add(1ull, std::memory_order_relaxed);
+		}
+
+		void Serve()
+		{
+			auto batch = std::vector<Request>();
+			batch.reserve(MaxBatch);
+			auto request = Request();
+
+			while (!stop.load(std::memory_order_acquire))
+			{
+				if (!queue.Pop(request))
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(20));
+					continue;
+				}
+
+				const auto deadline = request.Arrival + MaxWait;
+				batch.push_back(std::move(request));
+
+				while (batch.size() < MaxBatch)
+				{
+					if (queue.Pop(request))
+						batch.push_back(std::move(request));
+					else if (Clock::now() >= deadline || stop.load(std::memory_order_acquire))
+						break;
+					else
+						std::this_thread::yield();
+				}
+
+				Run(batch);
+				batch.clear();
+			}
+
+			while (queue.Pop(request))
+				request.Output.set_exception(std::make_exception_ptr(std::runtime_error("BatchingServer stopped")));
+		}
+
+	public:
+		const UInt MaxBatch;
+		const std::chrono::microseconds MaxWait;
+		const UInt InputSize;
+		const UInt OutputSize;
+
+		BatchingServer(Model& context, const UInt maxBatch, const std::chrono::microseconds maxWait) :
+			Context(context),
+			stop(false),
+			latencies(LatencyBuckets),
+			batchFill(maxBatch + 1ull),
+			input(FloatVector(maxBatch * context.InferenceInputSize())),
+			output(FloatVector(maxBatch * context.InferenceOutputSize())),
+			MaxBatch(maxBatch),
+			MaxWait(maxWait),
+			InputSize(context.InferenceInputSize()),
+			OutputSize(context.InferenceOutputSize())
+		{
+			if (MaxBatch < 1 || MaxBatch > Context.BatchSize)
+				throw std::invalid_argument("MaxBatch out of range in BatchingServer");
+
+			worker = std::thread([this] { Serve(); });
+		}
+
+		BatchingServer(const BatchingServer&) = delete;
+		BatchingServer& operator=(const BatchingServer&) = delete;
+
+		~BatchingServer()
+		{
+			stop.store(true, std::memory_order_release);
+			if (worker.joinable())
+				worker.join();
+		}
+
+		// callable from any number of threads
+		std::future<std::vector<Float>> Submit(std::vector<Float> sample)
+		{
+			if (sample.size() != InputSize)
+				throw std::invalid_argument("Sample size mismatch in BatchingServer");
+
+			auto request = Request{ std::move(sample), std::promise<std::vector<Float>>(), Clock::now() };
+			auto future = request.Output.get_future();
+			queue.Push(std::move(request));
+
+			return future;
+		}
+
+		ServingInfo GetInfo() const
+		{
+			auto info = ServingInfo{ 0ull, 0ull, Float(0), Float(0), Float(0), std::vector<UInt>(batchFill.size()) };
+
+			for (auto n = 0ull; n < batchFill.size(); n++)
+			{
+				info.BatchFill[n] = batchFill[n].load(std::memory_order_relaxed);
+				info.Batches += info.BatchFill[n];
+				info.Requests += n * info.BatchFill[n];
+			}
+			if (info.Batches > 0ull)
+				info.AvgBatchFill = Float(info.Requests) / Float(info.Batches);
+
+			auto histogram = std::vector<UInt>(LatencyBuckets);
+			auto total = 0ull;
+			for (auto i = 0ull; i < LatencyBuckets; i++)
+				total += histogram[i] = latencies[i].load(std::memory_order_relaxed);
+
+			// upper edge of the bucket holding the percentile
+			const auto percentile = [&](const Float p)
+			{
+				const auto target = UInt(std::ceil(p * Float(total)));
+				auto count = 0ull;
+				for (auto i = 0ull; i < LatencyBuckets; i++)
+				{
+					count += histogram[i];
+					if (count >= target && count > 0ull)
+						return std::exp2(Float(i + 1ull) / Float(LatencyBucketsPerOctave)) / Float(1000);
+				}
+				return Float(0);
+			};
+			info.LatencyP50 = percentile(Float(0.5));
+			info.LatencyP99 = percentile(Float(0.99));
+
+			return info;
+		}
+	};
+}
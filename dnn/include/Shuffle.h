@@ -1,5 +1,5 @@
 #pragma once
-#include "Layer.h"
+#include "Multiply.h"
 
 namespace dnn
 {
@@ -12,6 +12,61 @@ namespace dnn
 		std::unique_ptr<dnnl::shuffle_forward> fwd;
 		std::unique_ptr<dnnl::shuffle_backward> bwd;
 #endif
+		// with a Fused Concat input: per output channel the layers holding its value and its gradient and the channel there,
+		// a Fused Multiply input of the Concat (squeeze-and-excitation) adds the N x C gate scaling the channel
+		struct Source
+		{
+			Layer* Fwd;
+			Layer* Bwd;
+			UInt Channel;
+			Layer* GateFwd;
+			Layer* GateBwd;
+			UInt GateChannel;
+		};
+		std::vector<Source> sources;
+
+		// output channel c is channel (c % Groups) * GroupSize + c / Groups of the concatenated input (dnnl::shuffle_forward with GroupSize),
+		// an InplaceBwd input has its values in InputsFwd and its gradient in InputsBwd
+		void InitializeSources()
+		{
+			sources.clear();
+			if (!InputLayer->Fused)
+				return;
+
+			auto concatenated = std::vector<Source>();
+			for (auto i = 0ull; i < InputLayer->InputsFwd.size(); i++)
+			{
+				auto inputFwd = InputLayer->InputsFwd[i];
+				auto inputBwd = InputLayer->InputsBwd[i];
+				auto gateFwd = static_cast<Layer*>(nullptr);
+				auto gateBwd = static_cast<Layer*>(nullptr);
+
+				auto multiply = dynamic_cast<Multiply*>(inputFwd);
+				if (multiply && multiply->Fused)
+				{
+					inputFwd = multiply->InputsFwd[multiply->first];
+					inputBwd = multiply->InputsBwd[multiply->first];
+					gateFwd = multiply->InputsFwd[multiply->second];
+					gateBwd = multiply->InputsBwd[multiply->second];
+				}
+
+				for (auto c = 0ull; c < inputFwd->C; c++)
+					concatenated.push_back(Source{ inputFwd->Storage(), inputBwd->Storage(), inputFwd->StorageChannel() + c, gateFwd, gateBwd, c });
+			}
+
+			for (auto c = 0ull; c < C; c++)
+				sources.push_back(concatenated[(c % Groups) * GroupSize + c / Groups]);
+		}
+
+		inline UInt Offset(const bool plain, const UInt c, const UInt hw) const noexcept
+		{
+			return plain ? c * HW() + hw : (c / VectorSize) * HW() * VectorSize + hw * VectorSize + (c % VectorSize);
+		}
+
+		static inline UInt SampleSize(const Layer* layer, const bool plain) noexcept
+		{
+			return plain ? layer->CDHW() : layer->PaddedCDHW();
+		}
 
 	public:
 	    const UInt Groups;
@@ -40,6 +95,12 @@ namespace dnn
 			description.append(nwl + std::string(" Groups:") + tab + std::to_string(Groups));
 			description.append(nwl + std::string(" GroupSize:") + tab + std::to_string(GroupSize));
 			description.append(nwl + std::string(" Connections:") + tab + std::to_string(InputLayer->C / Groups));
+			if (InputLayer->Fused)
+			{
+				description.append(nwl + std::string(" Concat:") + tab + std::string("fused"));
+				if (std::any_of(InputLayer->InputsFwd.begin(), InputLayer->InputsFwd.end(), [](const Layer* input) { return input->Fused; }))
+					description.append(nwl + std::string(" Multiply:") + tab + std::string("fused"));
+			}
 
 			return description;
 		}
@@ -85,10 +146,48 @@ namespace dnn
 			fwd = std::make_unique<dnnl::shuffle_forward>(dnnl::shuffle_forward(*fwdDesc));
 			bwd = std::make_unique<dnnl::shuffle_backward>(dnnl::shuffle_backward(*bwdDesc));
 #endif
+
+			InitializeSources();
 		}
 
 		void ForwardProp(const UInt batchSize, const bool training) final override
 		{
+			if (InputLayer->Fused)
+			{
+				const auto plain = IsPlainFormat();
+				const auto threads = GetThreads(batchSize * SampleSize(this, plain));
+
+				for_i(batchSize, threads, [=](UInt n)
+				{
+					const auto dst = Neurons.data() + n * SampleSize(this, plain);
+					for (auto c = 0ull; c < C; c++)
+					{
+						const auto& source = sources[c];
+						const auto src = source.Fwd->Neurons.data() + n * SampleSize(source.Fwd, plain);
+						if (source.GateFwd)
+						{
+							const auto gate = source.GateFwd->Neurons[n * (source.GateFwd->IsPlainFormat() ? source.GateFwd->C : source.GateFwd->PaddedC) + source.GateChannel];
+							for (auto hw = 0ull; hw < HW(); hw++)
+								dst[Offset(plain, c, hw)] = src[Offset(plain, source.Channel, hw)] * gate;
+						}
+						else
+							for (auto hw = 0ull; hw < HW(); hw++)
+								dst[Offset(plain, c, hw)] = src[Offset(plain, source.Channel, hw)];
+					}
+					// the channels padding the last block stay zero, the Neurons may be shared with another layer (NeuronsPool)
+					if (!plain)
+						for (auto c = C; c < PaddedC; c++)
+							for (auto hw = 0ull; hw < HW(); hw++)
+								dst[Offset(plain, c, hw)] = Float(0);
+#ifndef DNN_LEAN
+					if (training && !GradientOverwritten)
+						InitArray<Float>(NeuronsD1.data() + n * SampleSize(this, plain), SampleSize(this, plain));
+#endif // DNN_LEAN
+				});
+
+				return;
+			}
+
 			auto srcMem = dnnl::memory(*InputLayer->DstMemDesc, Device.engine, InputLayer->Neurons.data());
 			auto dstMem = dnnl::memory(*DstMemDesc, Device.engine, Neurons.data());
 
@@ -100,7 +199,7 @@ namespace dnn
 			Device.stream.wait();
 
 #ifndef DNN_LEAN
-			if (training)
+			if (training && !GradientOverwritten)
 				InitArray<Float>(NeuronsD1.data(), batchSize * PaddedCDHW());
 #else
 			DNN_UNREF_PAR(batchSize);
@@ -109,6 +208,52 @@ namespace dnn
 
 		void BackwardProp(const UInt batchSize) final override
 		{
+			if (InputLayer->Fused)
+			{
+				const auto plain = IsPlainFormat();
+				const auto threads = GetThreads(batchSize * SampleSize(this, plain));
+
+#ifdef DNN_LEAN
+				for (auto& source : sources)
+					for (auto layer : { source.Bwd, source.GateBwd })
+						if (layer)
+							layer->NeuronsD1.resize(batchSize, layer->C, layer->H, layer->W, dnnl::memory::data_type::f32, BlockedFmt, Device.engine);
+#endif // DNN_LEAN
+
+				for_i(batchSize, threads, [=](UInt n)
+				{
+					const auto srcD1 = NeuronsD1.data() + n * SampleSize(this, plain);
+					for (auto c = 0ull; c < C; c++)
+					{
+						const auto& source = sources[c];
+						auto dstD1 = source.Bwd->NeuronsD1.data() + n * SampleSize(source.Bwd, plain);
+						if (source.GateFwd)
+						{
+							// one pass gives the gradient of the scaled channel and the gate's, the gate's is summed in a register and stored once
+							const auto src = source.Fwd->Neurons.data() + n * SampleSize(source.Fwd, plain);
+							const auto gateOffset = n * (source.GateFwd->IsPlainFormat() ? source.GateFwd->C : source.GateFwd->PaddedC) + source.GateChannel;
+							const auto gate = source.GateFwd->Neurons[gateOffset];
+							auto gateD1 = Float(0);
+							for (auto hw = 0ull; hw < HW(); hw++)
+							{
+								const auto d1 = srcD1[Offset(plain, c, hw)];
+								dstD1[Offset(plain, source.Channel, hw)] += d1 * gate;
+								gateD1 += d1 * src[Offset(plain, source.Channel, hw)];
+							}
+							source.GateBwd->NeuronsD1[gateOffset] += gateD1;
+						}
+						else
+							for (auto hw = 0ull; hw < HW(); hw++)
+								dstD1[Offset(plain, source.Channel, hw)] += srcD1[Offset(plain, c, hw)];
+					}
+				});
+
+#ifdef DNN_LEAN
+				ReleaseGradient();
+#endif // DNN_LEAN
+				return;
+			}
+
 #ifdef DNN_LEAN
 			ZeroGradient(batchSize);
 #else
@@ -0,0 +1,76 @@
+#pragma once
+#include "MappedFile.h"
+
+namespace dnn
+{
+	// teacher logits file: TeacherLogitsHeader, then Samples x Views x Classes fp32 values at DataOffset in training sample order,
+	// view 0 is the center crop of the sample, view 1 (with Views == 2) its horizontal mirror
+	struct TeacherLogitsHeader
+	{
+		char Magic[8];
+		std::uint64_t Version;
+		std::uint64_t Samples;
+		std::uint64_t Classes;
+		std::uint64_t Views;
+		std::uint64_t DataOffset;
+	};
+
+	// the cached views standing in for the teacher on an augmented training row,
+	// a CutMix row blends Sample and SampleMix with the Lambda of its label
+	struct TeacherView
+	{
+		UInt Sample;
+		UInt SampleMix;
+		bool Mirrored;
+	};
+
+	// read-only mapping of a teacher logits file, the values are log-probabilities up to a per-row constant
+	class TeacherLogits final
+	{
+	private:
+		MappedFile file;
+		TeacherLogitsHeader header;
+
+		static TeacherLogitsHeader ReadHeader(const MappedFile& file)
+		{
+			auto header = TeacherLogitsHeader();
+			if (file.Size() < sizeof(header))
+				throw std::invalid_argument("Invalid teacher logits file " + file.FileName);
+
+			std::memcpy(&header, file.Data(), sizeof(header));
+			if (std::memcmp(header.Magic, "DNNTLOG", 8) != 0 || header.Version != 1ull || header.Views < 1ull || header.Views > 2ull || header.DataOffset + header.Samples * header.Views * header.Classes * sizeof(Float) > file.Size())
+				throw std::invalid_argument("Invalid teacher logits file " + file.FileName);
+
+			return header;
+		}
+
+	public:
+		TeacherLogits(const std::string& fileName) :
+			file(fileName),
+			header(ReadHeader(file))
+		{
+		}
+
+		inline UInt Samples() const noexcept
+		{
+			return header.Samples;
+		}
+
+		inline UInt Classes() const noexcept
+		{
+			return header.Classes;
+		}
+
+		inline UInt Views() const noexcept
+		{
+			return header.Views;
+		}
+
+		// a mirrored row falls back to the center crop when the mirror wasn't cached
+		inline const Float* Get(const UInt sample, const bool mirrored) const noexcept
+		{
+			const auto view = (mirrored && header.Views > 1ull) ? 1ull : 0ull;
+			return reinterpret_cast<const Float*>(file.Data() + header.DataOffset) + (sample * header.Views + view) * header.Classes;
+		}
+	};
+}
@@ -124,6 +124,8 @@ namespace
 	typedef unsigned char Byte;
 	
 	static const auto MAX_THREADS = static_cast<UInt>(omp_get_max_threads());
+	// the thread budget the latency mode gives the layer running on this thread, zero outside of it
+	thread_local UInt LatencyThreadsCap = 0;
 	auto GetThreads(const UInt elements, const Float weight = Float(1)) NOEXCEPT
 	{
 		const auto load = static_cast<UInt>(Float(elements) * weight);
@@ -140,12 +142,14 @@ namespace
 		const auto HEAVY      = MAX_THREADS >= 32ull ? 16ull : MAX_THREADS >= 24ull ?  16ll : MAX_THREADS >= 16ull ? 16ull : MAX_THREADS >= 12ull ? 12ull : MAX_THREADS >= 8ull ? 8ull : MAX_THREADS >= 6ull ? 6ull : MAX_THREADS >= 4ull ? 4ull : 2ull;
 		const auto ULTRAHEAVY = MAX_THREADS >= 32ull ? 32ull : MAX_THREADS >= 24ull ? 24ull : MAX_THREADS >= 16ull ? 16ull : MAX_THREADS >= 12ull ? 12ull : MAX_THREADS >= 8ull ? 8ull : MAX_THREADS >= 6ull ? 6ull : MAX_THREADS >= 4ull ? 4ull : 2ull;
 
-		return
+		const auto threads =
 			load < ULTRALIGHT_THRESHOLD ? ULTRALIGHT :
 			load < LIGHT_THRESHOLD ?           LIGHT :
 			load < MEDIUM_THRESHOLD ?         MEDIUM :
 			load < HEAVY_THRESHOLD ?           HEAVY :
 			load < MAXIMUM_THRESHOLD ?    ULTRAHEAVY : MAX_THREADS;
+
+		return LatencyThreadsCap > 0ull ? std::min<UInt>(threads, LatencyThreadsCap) : threads;
 	}
 	
 	struct LabelInfo
@@ -431,11 +435,11 @@ namespace
 		inline const auto data() const noexcept { return dataPtr; }
 		inline auto size() const noexcept { return nelems; }
 		auto desc() { return description; }
-		void resizeMem(const dnnl::memory::desc& md, const dnnl::engine& engine, const T value = T()) NOEXCEPT
+		void resizeMem(const dnnl::memory::desc& md, const dnnl::engine& engine, const T value = T(), const bool initialize = true) NOEXCEPT
 		{
 			if (md)
 			{
-				if (md.get_size() / sizeof(T) == nelems)
+				if (md.get_size() / sizeof(T) == nelems && (arrPtr || nelems == 0))
 					return;
 
 				AlignedMemory::release();
@@ -447,24 +451,36 @@ namespace
 					{
 						dataPtr = static_cast<T*>(arrPtr->get_data_handle());
 						nelems = md.get_size() / sizeof(T);
-						if constexpr (std::is_floating_point_v<T>)
+						if (initialize)
 						{
-							if (value == T(0))
-								InitArray<T>(dataPtr, nelems, 0);
+							if constexpr (std::is_floating_point_v<T>)
+							{
+								if (value == T(0))
+									InitArray<T>(dataPtr, nelems, 0);
+								else
+									PRAGMA_OMP_SIMD()
+									for (auto i = 0ull; i < nelems; i++)
+										dataPtr[i] = value;
+							}
 							else
-								PRAGMA_OMP_SIMD()
 								for (auto i = 0ull; i < nelems; i++)
 									dataPtr[i] = value;
 						}
-						else
-							for (auto i = 0ull; i < nelems; i++)
-								dataPtr[i] = value;
 
 						description = md;
 					}
 				}
 			}
 		}
+		// borrows the elements of md at offset in pool (a buffer shared by arrays that are never live at the same time), release() drops the reference
+		void share(AlignedMemory& pool, const size_type offset, const dnnl::memory::desc& md) NOEXCEPT
+		{
+			AlignedMemory::release();
+
+			dataPtr = pool.data() + offset;
+			nelems = md.get_size() / sizeof(T);
+			description = md;
+		}
 		void resize(const size_type n, const size_type c, const dnnl::memory::data_type dtype, const dnnl::memory::format_tag format, const dnnl::engine& engine, const T value = T()) NOEXCEPT
 		{
 			AlignedMemory::resizeMem(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(n), dnnl::memory::dim(c) }), dtype, format), engine, value);
@@ -473,9 +489,9 @@ namespace
 		{
 			AlignedMemory::resizeMem(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(n), dnnl::memory::dim(c), dnnl::memory::dim(w) }), dtype, format), engine, value);
 		}
-		void resize(const size_type n, const size_type c, const size_type h, const size_type w, const dnnl::memory::data_type dtype, const dnnl::memory::format_tag format, const dnnl::engine& engine, const T value = T()) NOEXCEPT
+		void resize(const size_type n, const size_type c, const size_type h, const size_type w, const dnnl::memory::data_type dtype, const dnnl::memory::format_tag format, const dnnl::engine& engine, const T value = T(), const bool initialize = true) NOEXCEPT
 		{
-			AlignedMemory::resizeMem(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(n), dnnl::memory::dim(c), dnnl::memory::dim(h), dnnl::memory::dim(w) }), dtype, format), engine, value);
+			AlignedMemory::resizeMem(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(n), dnnl::memory::dim(c), dnnl::memory::dim(h), dnnl::memory::dim(w) }), dtype, format), engine, value, initialize);
 		}
 		void resize(const size_type n, const size_type c, const size_type d, const size_type h, const size_type w, const dnnl::memory::data_type dtype, const dnnl::memory::format_tag format, const dnnl::engine& engine, const T value = T()) NOEXCEPT
 		{
@@ -518,6 +534,67 @@ namespace
 		else
 			sum += value;
 	}
+
+	// IEEE binary16, round to nearest even, overflow to infinity
+	inline std::uint16_t FloatToHalf(const Float value) NOEXCEPT
+	{
+		std::uint32_t x;
+		std::memcpy(&x, &value, sizeof(x));
+
+		const auto sign = (x >> 16) & 0x8000u;
+		const auto abs = x & 0x7FFFFFFFu;
+
+		if (abs >= 0x7F800000u)
+			return static_cast<std::uint16_t>(sign | 0x7C00u | (abs > 0x7F800000u ? 0x200u : 0u));
+		if (abs >= 0x477FF000u)
+			return static_cast<std::uint16_t>(sign | 0x7C00u);
+		if (abs < 0x38800000u)
+		{
+			if (abs < 0x33000000u)
+				return static_cast<std::uint16_t>(sign);
+
+			const auto mantissa = (abs & 0x7FFFFFu) | 0x800000u;
+			const auto shift = 126u - (abs >> 23);
+			const auto half = mantissa >> shift;
+			const auto rest = mantissa & ((1u << shift) - 1u);
+			const auto middle = 1u << (shift - 1u);
+
+			return static_cast<std::uint16_t>(sign | (half + ((rest > middle || (rest == middle && (half & 1u))) ? 1u : 0u)));
+		}
+
+		const auto half = (abs - 0x38000000u) >> 13;
+		const auto rest = abs & 0x1FFFu;
+
+		return static_cast<std::uint16_t>(sign | (half + ((rest > 0x1000u || (rest == 0x1000u && (half & 1u))) ? 1u : 0u)));
+	}
+
+	inline Float HalfToFloat(const std::uint16_t value) NOEXCEPT
+	{
+		const auto sign = static_cast<std::uint32_t>(value & 0x8000u) << 16;
+		const auto exponent = static_cast<std::uint32_t>(value >> 10) & 0x1Fu;
+		auto mantissa = static_cast<std::uint32_t>(value & 0x3FFu);
+
+		auto x = sign;
+		if (exponent == 0x1Fu)
+			x |= 0x7F800000u | (mantissa << 13);
+		else if (exponent != 0u)
+			x |= ((exponent + 112u) << 23) | (mantissa << 13);
+		else if (mantissa != 0u)
+		{
+			auto e = 113u;
+			while (!(mantissa & 0x400u))
+			{
+				mantissa <<= 1;
+				e--;
+			}
+			x |= (e << 23) | ((mantissa & 0x3FFu) << 13);
+		}
+
+		Float result;
+		std::memcpy(&result, &x, sizeof(result));
+
+		return result;
+	}
 	
 #if defined(_WIN32) || defined(__CYGWIN__) || defined(__MINGW32__)
 	const auto nwl = std::string("\r\n");
@@ -1,4 +1,6 @@
+#include "CodeGenerator.h"
 #include "Definition.h"
+#include "FeatureExtractor.h"
 
 using namespace dnn;
 
@@ -260,7 +262,10 @@ extern "C" DNN_API void DNNResetWeights()
 extern "C" DNN_API void DNNResetLayerWeights(const UInt layerIndex)
 {
 	if (model && layerIndex < model->Layers.size())
+	{
 		model->Layers[layerIndex]->ResetWeights(model->WeightsFiller, model->WeightsFillerMode, model->WeightsGain, model->WeightsScale, model->BiasesFiller, model->BiasesFillerMode, model->BiasesGain, model->BiasesScale);
+		model->Layers[layerIndex]->WeightsChanged();
+	}
 }
 
 extern "C" DNN_API void DNNGetImage(const UInt layerIndex, const Byte fillColor, Byte* image)
@@ -357,6 +362,355 @@ extern "C" DNN_API void DNNTesting()
 	}
 }
 
+extern "C" DNN_API bool DNNSetFakeQuantization(const bool enable)
+{
+	if (model)
+		return model->SetFakeQuantization(enable);
+
+	return false;
+}
+
+extern "C" DNN_API bool DNNSetCheckpointing(const bool enable, const UInt memoryBudget)
+{
+	if (model)
+		return model->SetCheckpointing(enable, memoryBudget);
+
+	return false;
+}
+
+extern "C" DNN_API bool DNNSetGradientAccumulation(const UInt effectiveBatchSize, const BatchNormStatistics statistics)
+{
+	if (model)
+		return model->SetGradientAccumulation(effectiveBatchSize, statistics);
+
+	return false;
+}
+
+// the number of samples a weights update averages over: BatchSize times the micro-batches
+extern "C" DNN_API UInt DNNGetEffectiveBatchSize()
+{
+	if (model)
+		return model->MicroBatches * model->BatchSize;
+
+	return 0;
+}
+
+extern "C" DNN_API bool DNNSetDataParallel(const UInt rank, const UInt worldSize, const bool syncBatchNormStatistics)
+{
+	if (model)
+	{
+		try
+		{
+			return model->SetDataParallel(rank, worldSize, syncBatchNormStatistics);
+		}
+		catch (const std::exception& exception)
+		{
+			model->CommunicationError = exception.what();
+		}
+	}
+
+	return false;
+}
+
+extern "C" DNN_API bool DNNSetDistributed(const UInt rank, const char* peers, const bool syncBatchNormStatistics)
+{
+	if (model && peers)
+	{
+		try
+		{
+			return model->SetDistributed(rank, std::string(peers), syncBatchNormStatistics);
+		}
+		catch (const std::exception& exception)
+		{
+			model->CommunicationError = exception.what();
+		}
+	}
+
+	return false;
+}
+
+// the reason the last DNNSetDataParallel or DNNSetDistributed failed or the training stopped on a failed collective, empty if none
+extern "C" DNN_API void DNNGetCommunicationError(std::string& message)
+{
+	message = model ? model->CommunicationError : std::string();
+}
+
+// handle based inference, independent of the global model: a context may be used by one thread at a time,
+// all contexts of a handle share its weights and must be disposed before it
+extern "C" DNN_API Model* DNNModelCreate(const char* definition, const char* weightsFileName, const UInt batchSize)
+{
+	if (!definition || batchSize < 1)
+		return nullptr;
+
+	auto checkMsg = CheckMsg();
+	auto handle = std::unique_ptr<Model>(Read(std::string(definition), nullptr, checkMsg));
+
+	if (!handle || (weightsFileName && handle->LoadWeights(std::string(weightsFileName)) != 0))
+		return nullptr;
+
+	handle->SetInferenceBatchSize(batchSize);
+
+	return handle.release();
+}
+
+extern "C" DNN_API void DNNModelDestroy(Model* handle)
+{
+	delete handle;
+}
+
+// calibrates the handle on count plain samples and runs its quantizable layers in int8, the contexts created afterwards are quantized too
+extern "C" DNN_API UInt DNNModelQuantize(Model* handle, const Float* samples, const UInt count)
+{
+	if (handle)
+		return handle->QuantizeInference(samples, count);
+
+	return 0;
+}
+
+extern "C" DNN_API Model* DNNInferenceContextCreate(Model* handle, const UInt batchSize)
+{
+	if (!handle || batchSize < 1)
+		return nullptr;
+
+	auto checkMsg = CheckMsg();
+
+	return CreateInferenceContext(*handle, batchSize, checkMsg);
+}
+
+extern "C" DNN_API void DNNInferenceContextDestroy(Model* context)
+{
+	delete context;
+}
+
+extern "C" DNN_API bool DNNInference(Model* context, const Float* input, const UInt batchSize, Float* output)
+{
+	if (context)
+		return context->Inference(input, batchSize, output);
+
+	return false;
+}
+
+extern "C" DNN_API UInt DNNGetInferenceInputSize(Model* handle)
+{
+	if (handle)
+		return handle->InferenceInputSize();
+
+	return 0;
+}
+
+extern "C" DNN_API UInt DNNGetInferenceOutputSize(Model* handle)
+{
+	if (handle)
+		return handle->InferenceOutputSize();
+
+	return 0;
+}
+
+extern "C" DNN_API bool DNNSetLatencyMode(Model* context, const bool enable)
+{
+	if (context)
+	{
+		context->SetLatencyMode(enable);
+		return true;
+	}
+
+	return false;
+}
+
+extern "C" DNN_API Float DNNGetLayerLatency(Model* context, const UInt layerIndex)
+{
+	if (context && layerIndex < context->Layers.size())
+	{
+		const auto latencies = context->GetLayerLatencies();
+		if (layerIndex < latencies.size())
+			return latencies[layerIndex];
+	}
+
+	return Float(0);
+}
+
+extern "C" DNN_API bool DNNGenerateCode(const char* fileName, const bool embedParameters, CheckMsg& checkMsg)
+{
+	if (model && fileName)
+	{
+		try
+		{
+			CodeGenerator(*model).Generate(std::string(fileName), embedParameters);
+			return true;
+		}
+		catch (const std::exception& exception)
+		{
+			checkMsg = CheckMsg(0, 0, exception.what());
+		}
+	}
+
+	return false;
+}
+
+// layers is a comma separated list of layer names, returns the number of samples written (zero on failure)
+extern "C" DNN_API UInt DNNExtractFeatures(const char* fileName, const char* layers, const bool trainingSplit, const bool globalPooling, const bool halfPrecision, CheckMsg& checkMsg)
+{
+	if (!model || !fileName || !layers || model->TaskState.load() != TaskStates::Stopped)
+		return 0;
+
+	auto names = std::vector<std::string>();
+	auto stream = std::istringstream(std::string(layers));
+	auto name = std::string();
+	while (std::getline(stream, name, ','))
+		if (!name.empty())
+			names.push_back(name);
+
+	try
+	{
+		return FeatureExtractor(*model, names).Extract(std::string(fileName), trainingSplit, globalPooling, halfPrecision);
+	}
+	catch (const std::exception& exception)
+	{
+		checkMsg = CheckMsg(0, 0, exception.what());
+	}
+
+	return 0;
+}
+
+// run on the teacher model, returns the number of training samples cached (zero on failure)
+extern "C" DNN_API UInt DNNCacheTeacherLogits(const char* fileName, const bool mirroredView, CheckMsg& checkMsg)
+{
+	if (!model || !fileName || model->TaskState.load() != TaskStates::Stopped)
+		return 0;
+
+	try
+	{
+		return model->CacheTeacherLogits(std::string(fileName), mirroredView);
+	}
+	catch (const std::exception& exception)
+	{
+		checkMsg = CheckMsg(0, 0, exception.what());
+	}
+
+	return 0;
+}
+
+// run on the student model, a null fileName releases the teacher logits
+extern "C" DNN_API bool DNNSetTeacherLogits(const char* fileName, CheckMsg& checkMsg)
+{
+	if (!model || model->TaskState.load() != TaskStates::Stopped)
+		return false;
+
+	try
+	{
+		model->SetTeacherLogits(fileName ? std::string(fileName) : std::string());
+		return true;
+	}
+	catch (const std::exception& exception)
+	{
+		checkMsg = CheckMsg(0, 0, exception.what());
+	}
+
+	return false;
+}
+
+// applies from the next training run, a null fileName keeps the cache in RAM
+extern "C" DNN_API bool DNNSetPrefixCache(const bool enable, const char* fileName, const bool halfPrecision)
+{
+	if (!model || model->TaskState.load() != TaskStates::Stopped)
+		return false;
+
+	model->SetPrefixCache(enable, fileName ? std::string(fileName) : std::string(), halfPrecision);
+
+	return true;
+}
+
+extern "C" DNN_API bool DNNSetDepthwiseEpilogue(const bool enable)
+{
+	if (!model || model->TaskState.load() != TaskStates::Stopped)
+		return false;
+
+	model->SetDepthwiseEpilogue(enable);
+
+	return true;
+}
+
+extern "C" DNN_API bool DNNSetWelfordStatistics(const bool enable)
+{
+	if (!model || model->TaskState.load() != TaskStates::Stopped)
+		return false;
+
+	model->SetWelfordStatistics(enable);
+
+	return true;
+}
+
+extern "C" DNN_API bool DNNSetInPlaceBatchNorm(const bool enable)
+{
+	if (model)
+		return model->SetInPlaceBatchNorm(enable);
+
+	return false;
+}
+
+extern "C" DNN_API bool DNNSetMaskBackward(const bool enable)
+{
+	if (model)
+		return model->SetMaskBackward(enable);
+
+	return false;
+}
+
+extern "C" DNN_API bool DNNSetElementwiseFusion(const bool enable)
+{
+	if (model)
+		return model->SetElementwiseFusion(enable);
+
+	return false;
+}
+
+extern "C" DNN_API bool DNNSetSelectiveBackprop(const bool enable, const SampleSelections selection, const Float value, const UInt history, CheckMsg& checkMsg)
+{
+	if (!model || model->TaskState.load() != TaskStates::Stopped)
+		return false;
+
+	try
+	{
+		model->SetSelectiveBackprop(enable, selection, value, history);
+		return true;
+	}
+	catch (const std::exception& exception)
+	{
+		checkMsg = CheckMsg(0, 0, exception.what());
+	}
+
+	return false;
+}
+
+// test error against training time of every finished epoch of the last training run, for time-to-accuracy comparisons
+extern "C" DNN_API bool DNNGetEpochProgress(const UInt index, EpochProgress* info)
+{
+	if (model && info && index < model->Progress.size())
+	{
+		*info = model->Progress[index];
+		return true;
+	}
+
+	return false;
+}
+
+// seconds the last training run took to reach testErrorPercentage, negative when it never did
+extern "C" DNN_API Float DNNGetTimeToAccuracy(const Float testErrorPercentage)
+{
+	if (model)
+		return model->TimeToAccuracy(testErrorPercentage);
+
+	return Float(-1);
+}
+
+extern "C" DNN_API bool DNNQuantize(const UInt calibrationSamples, QuantizationInfo* info)
+{
+	if (model)
+		return model->Quantize(calibrationSamples, info);
+
+	return false;
+}
+
 extern "C" DNN_API void DNNStop()
 {
 	if (model)
@@ -787,7 +1141,8 @@ extern "C" DNN_API void DNNGetTrainingInfo(TrainingInfo* info)
 {
 	if (model)
 	{
-		const auto sampleIdx = model->SampleIndex + model->BatchSize;
+		// with data-parallel training the progress and the running averages are those of the own shard
+		const auto sampleIdx = (model->SampleIndex > model->ShardStart ? model->SampleIndex - model->ShardStart : 0ull) + model->BatchSize;
 
 		switch (model->State)
 		{
@@ -806,7 +1161,8 @@ extern "C" DNN_API void DNNGetTrainingInfo(TrainingInfo* info)
 
 		case States::Testing:
 		{
-			const auto adjustedsampleIndex = sampleIdx > dataprovider->TestingSamplesCount ? dataprovider->TestingSamplesCount : sampleIdx;
+			const auto shardSamples = dataprovider->TestingSamplesCount - std::min<UInt>(model->ShardStart, dataprovider->TestingSamplesCount - 1ull);
+			const auto adjustedsampleIndex = sampleIdx > shardSamples ? shardSamples : sampleIdx;
 
 			model->TestLoss = model->CostLayers[model->CostIndex]->TestLoss;
 			model->TestErrors = model->CostLayers[model->CostIndex]->TestErrors;
@@ -864,6 +1220,7 @@ extern "C" DNN_API void DNNGetTrainingInfo(TrainingInfo* info)
 		info->Rotation = model->CurrentTrainingRate.Rotation;
 
 		info->SampleSpeed = model->SampleSpeed;
+		info->ScalingEfficiency = model->ScalingEfficiency;
 		info->State = model->State.load();
 		info->TaskState = model->TaskState.load();
 	}
@@ -10,6 +10,7 @@
 #endif
 
 #include "Model.h"
+#include "Server.h"
 #include "Scripts.h"
 
 #ifdef _WIN32
@@ -44,6 +45,36 @@ DNN_API void DNNStop();
 DNN_API void DNNPause();
 DNN_API void DNNResume();
 DNN_API void DNNTesting();
+DNN_API bool DNNSetFakeQuantization(const bool enable);
+DNN_API bool DNNSetCheckpointing(const bool enable, const UInt memoryBudget);
+DNN_API bool DNNSetGradientAccumulation(const UInt effectiveBatchSize, const dnn::BatchNormStatistics statistics);
+DNN_API UInt DNNGetEffectiveBatchSize();
+DNN_API bool DNNSetDataParallel(const UInt rank, const UInt worldSize, const bool syncBatchNormStatistics);
+DNN_API bool DNNSetDistributed(const UInt rank, const char* peers, const bool syncBatchNormStatistics);
+DNN_API dnn::Model* DNNModelCreate(const char* definition, const char* weightsFileName, const UInt batchSize);
+DNN_API void DNNModelDestroy(dnn::Model* handle);
+DNN_API UInt DNNModelQuantize(dnn::Model* handle, const Float* samples, const UInt count);
+DNN_API dnn::Model* DNNInferenceContextCreate(dnn::Model* handle, const UInt batchSize);
+DNN_API void DNNInferenceContextDestroy(dnn::Model* context);
+DNN_API bool DNNInference(dnn::Model* context, const Float* input, const UInt batchSize, Float* output);
+DNN_API UInt DNNGetInferenceInputSize(dnn::Model* handle);
+DNN_API UInt DNNGetInferenceOutputSize(dnn::Model* handle);
+DNN_API bool DNNSetLatencyMode(dnn::Model* context, const bool enable);
+DNN_API Float DNNGetLayerLatency(dnn::Model* context, const UInt layerIndex);
+DNN_API bool DNNGenerateCode(const char* fileName, const bool embedParameters, dnn::CheckMsg& checkMsg);
+DNN_API UInt DNNExtractFeatures(const char* fileName, const char* layers, const bool trainingSplit, const bool globalPooling, const bool halfPrecision, dnn::CheckMsg& checkMsg);
+DNN_API UInt DNNCacheTeacherLogits(const char* fileName, const bool mirroredView, dnn::CheckMsg& checkMsg);
+DNN_API bool DNNSetTeacherLogits(const char* fileName, dnn::CheckMsg& checkMsg);
+DNN_API bool DNNSetPrefixCache(const bool enable, const char* fileName, const bool halfPrecision);
+DNN_API bool DNNSetDepthwiseEpilogue(const bool enable);
+DNN_API bool DNNSetWelfordStatistics(const bool enable);
+DNN_API bool DNNSetInPlaceBatchNorm(const bool enable);
+DNN_API bool DNNSetMaskBackward(const bool enable);
+DNN_API bool DNNSetElementwiseFusion(const bool enable);
+DNN_API bool DNNSetSelectiveBackprop(const bool enable, const SampleSelections selection, const Float value, const UInt history, dnn::CheckMsg& checkMsg);
+DNN_API bool DNNGetEpochProgress(const UInt index, EpochProgress* info);
+DNN_API Float DNNGetTimeToAccuracy(const Float testErrorPercentage);
+DNN_API bool DNNQuantize(const UInt calibrationSamples, dnn::QuantizationInfo* info);
 DNN_API void DNNGetTrainingInfo(dnn::TrainingInfo* info);
 DNN_API void DNNGetTestingInfo(dnn::TestingInfo* info);
 DNN_API void DNNGetModelInfo(dnn::ModelInfo* info);
@@ -161,6 +192,82 @@ void GetTrainingProgress(int seconds = 5, UInt trainingSamples = 50000, UInt tes
     delete info;
 }
 
+// closed-loop load generator: every client submits one random sample and waits for its result before sending the next one
+void ServingBenchmark(const std::string& definition, const UInt clients = 16, const UInt requestsPerClient = 1000, const UInt maxBatch = 32, const UInt maxWaitMicroseconds = 2000)
+{
+    auto handle = DNNModelCreate(definition.c_str(), nullptr, maxBatch);
+    if (!handle)
+    {
+        std::cout << std::endl << "Could not create model" << std::endl;
+        return;
+    }
+
+    auto context = DNNInferenceContextCreate(handle, maxBatch);
+    if (context)
+    {
+        auto server = BatchingServer(*context, maxBatch, std::chrono::microseconds(maxWaitMicroseconds));
+        const auto inputSize = DNNGetInferenceInputSize(handle);
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        auto threads = std::vector<std::thread>();
+        for (auto client = 0ull; client < clients; client++)
+            threads.emplace_back([&server, inputSize, requestsPerClient, client]()
+            {
+                auto generator = std::mt19937(static_cast<unsigned>(client));
+                auto distribution = std::normal_distribution<Float>(Float(0), Float(1));
+
+                for (auto i = 0ull; i < requestsPerClient; i++)
+                {
+                    auto sample = std::vector<Float>(inputSize);
+                    std::generate(sample.begin(), sample.end(), [&]() { return distribution(generator); });
+                    server.Submit(std::move(sample)).get();
+                }
+            });
+        for (auto& thread : threads)
+            thread.join();
+        const auto elapsed = std::chrono::duration<Float>(std::chrono::high_resolution_clock::now() - start).count();
+
+        const auto info = server.GetInfo();
+        std::cout << std::string("Requests: ") << std::to_string(info.Requests) << std::string("  Throughput: ") << FloatToStringFixed(Float(info.Requests) / elapsed, 2) << std::string(" samples/s  p50: ") << FloatToStringFixed(info.LatencyP50, 3) << std::string(" ms  p99: ") << FloatToStringFixed(info.LatencyP99, 3) << std::string(" ms  Avg batch: ") << FloatToStringFixed(info.AvgBatchFill, 2) << std::endl;
+        for (auto n = 1ull; n < info.BatchFill.size(); n++)
+            if (info.BatchFill[n] > 0ull)
+                std::cout << std::string("  batch ") << std::to_string(n) << std::string(": ") << std::to_string(info.BatchFill[n]) << std::endl;
+    }
+    else
+        std::cout << std::endl << "Could not create inference context" << std::endl;
+
+    DNNInferenceContextDestroy(context);
+    DNNModelDestroy(handle);
+}
+
+// trains from fresh weights with full backpropagation and then with Selective-Backprop on the same schedule and reports the time each run took to reach targetError
+void SelectiveBackpropBenchmark(const dnn::TrainingRate& rate, const dnn::ModelInfo& info, const Float targetError, const Float selection = Float(0.33))
+{
+    CheckMsg msg;
+
+    for (const auto selective : { false, true })
+    {
+        DNNResetWeights();
+        if (!DNNSetSelectiveBackprop(selective, SampleSelections::Percentile, selection, 1024, msg))
+        {
+            std::cout << std::endl << "Could not set selective backpropagation" << std::endl << msg.Message << std::endl;
+            return;
+        }
+
+        DNNAddTrainingRateSGDR(rate, true, 1, info.TrainingSamplesCount);
+        DNNTraining();
+        GetTrainingProgress(5, info.TrainingSamplesCount, info.TestingSamplesCount);
+        DNNStop();
+
+        auto progress = EpochProgress();
+        auto trainedSamples = 0ull;
+        for (auto epoch = 0ull; DNNGetEpochProgress(epoch, &progress); epoch++)
+            trainedSamples += progress.TrainedSamples;
+
+        const auto seconds = DNNGetTimeToAccuracy(targetError);
+        std::cout << std::endl << (selective ? std::string("Selective-Backprop") : std::string("Full backpropagation")) << std::string("  Time to ") << FloatToStringFixed(targetError, 2) << std::string("% error: ") << (seconds < Float(0) ? std::string("not reached") : FloatToStringFixed(seconds, 1) + std::string(" s")) << std::string("  Backpropagated samples: ") << std::to_string(trainedSamples) << std::endl;
+    }
+}
 
 #ifdef _WIN32
 int __cdecl wmain(int argc, wchar_t* argv[])
@@ -168,9 +275,6 @@ int __cdecl wmain(int argc, wchar_t* argv[])
 int main(int argc, char* argv[])
 #endif
 {
-    DNN_UNREF_PAR(argc);
-    DNN_UNREF_PAR(argv);
-
     CheckMsg msg;
 
     scripts::ScriptParameters p;
@@ -235,6 +339,16 @@ int main(int argc, char* argv[])
     rate.Scaling = 10.0f;
     rate.Rotation = 12.0f;
     
+#ifdef _WIN32
+    if (argc > 1 && std::wstring(argv[1]) == L"serve")
+#else
+    if (argc > 1 && std::string(argv[1]) == "serve")
+#endif
+    {
+        ServingBenchmark(model);
+        return 0;
+    }
+
     DNNDataprovider(path);
     
     if (DNNRead(model, msg) == 1)
@@ -250,6 +364,18 @@ int main(int argc, char* argv[])
 
             DNNSetNewEpochDelegate(&NewEpoch);
             DNNPersistOptimizer(persistOptimizer);
+
+#ifdef _WIN32
+            if (argc > 1 && std::wstring(argv[1]) == L"selective")
+#else
+            if (argc > 1 && std::string(argv[1]) == "selective")
+#endif
+            {
+                SelectiveBackpropBenchmark(rate, *info, argc > 2 ? Float(std::stof(argv[2])) : Float(10));
+                delete info;
+                return 0;
+            }
+
             DNNAddTrainingRateSGDR(rate, true, 1, info->TrainingSamplesCount);
             DNNTraining();
 
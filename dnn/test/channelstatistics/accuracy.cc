@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/channelstatistics.h>
+
+
+TEST(ChannelStatistics, Blocked) {
+	ChannelStatisticsTester()
+		.iterations(5)
+		.errorLimit(1.0e-4)
+		.batchSize(64)
+		.channels(40)
+		.height(16)
+		.width(16)
+		.plain(false)
+		.testAccuracy();
+}
+
+TEST(ChannelStatistics, Plain) {
+	ChannelStatisticsTester()
+		.iterations(5)
+		.errorLimit(1.0e-4)
+		.batchSize(64)
+		.channels(40)
+		.height(7)
+		.width(7)
+		.plain(true)
+		.testAccuracy();
+}
+
+TEST(ChannelStatistics, BlockedOffset) {
+	ChannelStatisticsTester()
+		.iterations(5)
+		.errorLimit(1.0e-3)
+		.batchSize(128)
+		.channels(32)
+		.height(16)
+		.width(16)
+		.offset(1000.0f)
+		.plain(false)
+		.testAccuracy();
+}
+
+TEST(ChannelStatistics, PlainOffset) {
+	ChannelStatisticsTester()
+		.iterations(5)
+		.errorLimit(1.0e-3)
+		.batchSize(128)
+		.channels(24)
+		.height(7)
+		.width(7)
+		.offset(1000.0f)
+		.plain(true)
+		.testAccuracy();
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/codegenerator.h>
+
+// the network generated by codegenerator-generate at build time
+#include CODEGENERATOR_NETWORK
+
+
+TEST(CodeGenerator, MatchesModel) {
+	auto reference = CodeGeneratorReference();
+	ASSERT_TRUE(reference.Read(CODEGENERATOR_REFERENCE));
+	ASSERT_EQ(reference.BatchSize, dnn::generated::N);
+	ASSERT_EQ(reference.Input.size(), dnn::generated::N * dnn::generated::InputSize);
+	ASSERT_EQ(reference.Output.size(), dnn::generated::N * dnn::generated::OutputSize);
+
+	auto network = dnn::generated::Network();
+	auto output = std::vector<float>(reference.Output.size());
+	network.Forward(reference.Input.data(), output.data());
+
+	for (size_t i = 0; i < output.size(); i++)
+		ASSERT_NEAR(output[i], reference.Output[i], 1.0e-3f * std::max(1.0f, std::abs(reference.Output[i]))) << "at " << i;
+
+	// the primitives are built once, a second pass gives the same result
+	auto again = std::vector<float>(reference.Output.size());
+	network.Forward(reference.Input.data(), again.data());
+	for (size_t i = 0; i < output.size(); i++)
+		ASSERT_EQ(again[i], output[i]) << "at " << i;
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <memory>
+#include <random>
+
+#include <CodeGenerator.h>
+#include <Definition.h>
+
+#include <testers/codegenerator.h>
+
+
+// writes the generated network (argv[1]) and the reference the test compares it with (argv[2])
+int main(int argc, char* argv[]) {
+	if (argc != 3)
+	{
+		std::cerr << "usage: " << argv[0] << " network.cpp reference.bin" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	constexpr size_t batchSize = 4;
+
+	auto checkMsg = dnn::CheckMsg();
+	auto model = std::unique_ptr<dnn::Model>(dnn::Read(std::string(CodeGeneratorDefinition), nullptr, checkMsg));
+	if (!model)
+	{
+		std::cerr << checkMsg.Message << std::endl;
+		return EXIT_FAILURE;
+	}
+	model->SetInferenceBatchSize(batchSize);
+
+	auto rng = std::mt19937(2024);
+	auto uniform = std::uniform_real_distribution<float>(-1.0f, 1.0f);
+
+	// running statistics and slopes away from their initial values, so the folded parameters are checked too
+	for (auto& layer : model->Layers)
+	{
+		auto randomize = [&](auto bn)
+		{
+			for (size_t c = 0; c < bn->C; c++)
+			{
+				bn->RunningMean[c] = 0.5f * uniform(rng);
+				bn->RunningVariance[c] = 0.5f + std::abs(uniform(rng));
+			}
+		};
+		if (auto bn = dynamic_cast<dnn::BatchNorm*>(layer.get()))
+			randomize(bn);
+		if (auto bn = dynamic_cast<dnn::BatchNormRelu*>(layer.get()))
+			randomize(bn);
+		if (layer->LayerType == dnn::LayerTypes::PRelu)
+			for (size_t c = 0; c < layer->C; c++)
+				layer->Biases[c] = 0.25f + 0.25f * uniform(rng);
+	}
+
+	auto reference = CodeGeneratorReference();
+	reference.BatchSize = batchSize;
+
+	const auto input = model->Layers[0].get();
+	reference.Input.resize(batchSize * input->CDHW());
+	for (auto& value : reference.Input)
+		value = uniform(rng);
+	std::copy(reference.Input.begin(), reference.Input.end(), input->Neurons.data());
+
+	for (size_t i = 1; i < model->Layers.size(); i++)
+		if (model->Layers[i]->LayerType != dnn::LayerTypes::Cost)
+			model->Layers[i]->ForwardProp(batchSize, false);
+
+	const auto output = model->CostLayers[model->CostIndex]->InputLayer;
+	const auto HW = output->HW();
+	for (size_t n = 0; n < batchSize; n++)
+		for (size_t c = 0; c < output->C; c++)
+			for (size_t hw = 0; hw < HW; hw++)
+				reference.Output.push_back(output->Neurons[output->IsPlainFormat() ?
+					n * output->CDHW() + c * HW + hw :
+					n * output->PaddedCDHW() + (c / dnn::VectorSize) * dnn::VectorSize * HW + hw * dnn::VectorSize + c % dnn::VectorSize]);
+
+	if (!reference.Write(std::string(argv[2])))
+	{
+		std::cerr << "cannot write " << argv[2] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		dnn::CodeGenerator(*model).Generate(std::string(argv[1]), true);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
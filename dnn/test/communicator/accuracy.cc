@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/communicator.h>
+
+
+TEST(SharedMemoryCommunicator, TwoRanks) {
+	CommunicatorTester()
+		.worldSize(2)
+		.count(2500)
+		.capacity(1024)
+		.testAccuracy();
+}
+
+TEST(SharedMemoryCommunicator, FourRanks) {
+	CommunicatorTester()
+		.worldSize(4)
+		.count(10007)
+		.capacity(1024)
+		.testAccuracy();
+}
+
+TEST(SharedMemoryCommunicator, StaleSegment) {
+	CommunicatorTester()
+		.worldSize(3)
+		.count(2500)
+		.capacity(1024)
+		.staleSegment(true)
+		.testAccuracy();
+}
+
+TEST(SharedMemoryCommunicator, AttachTimeout) {
+	CommunicatorTester()
+		.worldSize(2)
+		.capacity(1024)
+		.testAttachTimeout();
+}
+
+TEST(TcpCommunicator, TwoRanks) {
+	CommunicatorTester()
+		.worldSize(2)
+		.count(2500)
+		.capacity(1024)
+		.tcp(true)
+		.testAccuracy();
+}
+
+TEST(TcpCommunicator, ThreeRanks) {
+	CommunicatorTester()
+		.worldSize(3)
+		.count(10007)
+		.capacity(1024)
+		.tcp(true)
+		.testAccuracy();
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
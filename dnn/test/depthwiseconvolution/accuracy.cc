@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/depthwiseconvolution.h>
+
+
+TEST(DepthwiseConvolution, Kernel3x3Stride1) {
+	DepthwiseConvolutionTester()
+		.iterations(3)
+		.errorLimit(1.0e-4)
+		.batchSize(8)
+		.channels(36)
+		.height(13)
+		.width(11)
+		.kernel(3)
+		.stride(1)
+		.padding(1)
+		.testAccuracy();
+}
+
+TEST(DepthwiseConvolution, Kernel3x3Stride2) {
+	DepthwiseConvolutionTester()
+		.iterations(3)
+		.errorLimit(1.0e-4)
+		.batchSize(8)
+		.channels(36)
+		.height(13)
+		.width(11)
+		.kernel(3)
+		.stride(2)
+		.padding(1)
+		.testAccuracy();
+}
+
+TEST(DepthwiseConvolution, Kernel5x5Stride1) {
+	DepthwiseConvolutionTester()
+		.iterations(3)
+		.errorLimit(1.0e-4)
+		.batchSize(8)
+		.channels(36)
+		.height(13)
+		.width(11)
+		.kernel(5)
+		.stride(1)
+		.padding(2)
+		.testAccuracy();
+}
+
+TEST(DepthwiseConvolution, Kernel5x5Stride2) {
+	DepthwiseConvolutionTester()
+		.iterations(3)
+		.errorLimit(1.0e-4)
+		.batchSize(8)
+		.channels(36)
+		.height(13)
+		.width(11)
+		.kernel(5)
+		.stride(2)
+		.padding(2)
+		.testAccuracy();
+}
+
+TEST(DepthwiseConvolution, Kernel7x7Stride1) {
+	DepthwiseConvolutionTester()
+		.iterations(3)
+		.errorLimit(1.0e-4)
+		.batchSize(8)
+		.channels(36)
+		.height(13)
+		.width(11)
+		.kernel(7)
+		.stride(1)
+		.padding(3)
+		.testAccuracy();
+}
+
+TEST(DepthwiseConvolution, Kernel7x7Stride2) {
+	DepthwiseConvolutionTester()
+		.iterations(3)
+		.errorLimit(1.0e-4)
+		.batchSize(8)
+		.channels(36)
+		.height(13)
+		.width(11)
+		.kernel(7)
+		.stride(2)
+		.padding(3)
+		.testAccuracy();
+}
+
+TEST(DepthwiseConvolution, Kernel5x5Stride2NoPadding) {
+	DepthwiseConvolutionTester()
+		.iterations(3)
+		.errorLimit(1.0e-4)
+		.batchSize(8)
+		.channels(36)
+		.height(13)
+		.width(11)
+		.kernel(5)
+		.stride(2)
+		.padding(0)
+		.testAccuracy();
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
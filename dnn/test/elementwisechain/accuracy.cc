@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/elementwisechain.h>
+
+
+TEST(ElementwiseChain, Blocked) {
+	ElementwiseChainTester()
+		.iterations(3)
+		.errorLimit(2.0e-3)
+		.batchSize(8)
+		.channels(40)
+		.height(9)
+		.width(9)
+		.plain(false)
+		.testAccuracy();
+}
+
+TEST(ElementwiseChain, Plain) {
+	ElementwiseChainTester()
+		.iterations(3)
+		.errorLimit(2.0e-3)
+		.batchSize(8)
+		.channels(24)
+		.height(9)
+		.width(9)
+		.plain(true)
+		.testAccuracy();
+}
+
+TEST(ElementwiseChain, PlainTail) {
+	ElementwiseChainTester()
+		.iterations(3)
+		.errorLimit(2.0e-3)
+		.batchSize(8)
+		.channels(3)
+		.height(5)
+		.width(5)
+		.plain(true)
+		.testAccuracy();
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/gradientaccumulation.h>
+
+
+TEST(GradientAccumulation, FollowsBatchSizeChanges) {
+	GradientAccumulationTester()
+		.effectiveBatchSize(128)
+		.batchSizes({ 64, 256, 64 })
+		.testMicroBatches();
+}
+
+TEST(GradientAccumulation, SmallerBatch) {
+	GradientAccumulationTester()
+		.effectiveBatchSize(256)
+		.batchSizes({ 64, 32, 128, 64 })
+		.testMicroBatches();
+}
+
+TEST(GradientAccumulation, RejectsNonMultiple) {
+	GradientAccumulationTester()
+		.effectiveBatchSize(100)
+		.batchSizes({ 64 })
+		.testRejected();
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/inference.h>
+
+
+TEST(Inference, SpatialOutput) {
+	InferenceTester()
+		.batchSize(4)
+		.contexts(2)
+		.kernel(1)
+		.testAccuracy();
+}
+
+TEST(Inference, VectorOutput) {
+	InferenceTester()
+		.batchSize(5)
+		.contexts(3)
+		.kernel(28)
+		.testAccuracy();
+}
+
+TEST(Inference, SingleSample) {
+	InferenceTester()
+		.batchSize(1)
+		.contexts(2)
+		.kernel(28)
+		.testAccuracy();
+}
+
+TEST(Inference, QuantizedContexts) {
+	InferenceTester()
+		.batchSize(4)
+		.contexts(2)
+		.kernel(28)
+		.quantize(true)
+		.errorLimit(5.0e-2)
+		.testAccuracy();
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/inplacebatchnorm.h>
+
+
+TEST(InPlaceBatchNorm, LeakyReluBlocked) {
+	InPlaceBatchNormTester()
+		.iterations(3)
+		.errorLimit(1.0e-3)
+		.batchSize(16)
+		.channels(64)
+		.height(12)
+		.width(12)
+		.activation(dnn::Activations::Relu)
+		.alpha(0.1f)
+		.beta(0.0f)
+		.plain(false)
+		.testAccuracy();
+}
+
+TEST(InPlaceBatchNorm, LeakyReluPlain) {
+	InPlaceBatchNormTester()
+		.iterations(3)
+		.errorLimit(1.0e-3)
+		.batchSize(16)
+		.channels(40)
+		.height(7)
+		.width(7)
+		.activation(dnn::Activations::Relu)
+		.alpha(0.1f)
+		.beta(0.0f)
+		.plain(true)
+		.testAccuracy();
+}
+
+TEST(InPlaceBatchNorm, EluBlocked) {
+	InPlaceBatchNormTester()
+		.iterations(3)
+		.errorLimit(1.0e-3)
+		.batchSize(16)
+		.channels(64)
+		.height(12)
+		.width(12)
+		.activation(dnn::Activations::Elu)
+		.alpha(1.0f)
+		.beta(0.0f)
+		.plain(false)
+		.testAccuracy();
+}
+
+TEST(InPlaceBatchNorm, EluPlain) {
+	InPlaceBatchNormTester()
+		.iterations(3)
+		.errorLimit(1.0e-3)
+		.batchSize(16)
+		.channels(40)
+		.height(7)
+		.width(7)
+		.activation(dnn::Activations::Elu)
+		.alpha(1.0f)
+		.beta(0.0f)
+		.plain(true)
+		.testAccuracy();
+}
+
+TEST(InPlaceBatchNorm, LinearBlocked) {
+	InPlaceBatchNormTester()
+		.iterations(3)
+		.errorLimit(1.0e-3)
+		.batchSize(16)
+		.channels(64)
+		.height(12)
+		.width(12)
+		.activation(dnn::Activations::Linear)
+		.alpha(1.5f)
+		.beta(0.25f)
+		.plain(false)
+		.testAccuracy();
+}
+
+TEST(InPlaceBatchNorm, LinearPlain) {
+	InPlaceBatchNormTester()
+		.iterations(3)
+		.errorLimit(1.0e-3)
+		.batchSize(16)
+		.channels(40)
+		.height(7)
+		.width(7)
+		.activation(dnn::Activations::Linear)
+		.alpha(1.5f)
+		.beta(0.25f)
+		.plain(true)
+		.testAccuracy();
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/maskbackward.h>
+
+
+TEST(MaskBackward, ReluBlocked) {
+	MaskBackwardTester()
+		.iterations(3)
+		.batchSize(16)
+		.channels(40)
+		.height(9)
+		.width(9)
+		.activation(dnn::Activations::Relu)
+		.alpha(0.1f)
+		.beta(0.0f)
+		.plain(false)
+		.testAccuracy();
+}
+
+TEST(MaskBackward, ReluPlainTail) {
+	MaskBackwardTester()
+		.iterations(3)
+		.batchSize(16)
+		.channels(3)
+		.height(5)
+		.width(5)
+		.activation(dnn::Activations::Relu)
+		.alpha(0.1f)
+		.beta(0.0f)
+		.plain(true)
+		.testAccuracy();
+}
+
+TEST(MaskBackward, BoundedReluBlocked) {
+	MaskBackwardTester()
+		.iterations(3)
+		.batchSize(16)
+		.channels(40)
+		.height(9)
+		.width(9)
+		.activation(dnn::Activations::BoundedRelu)
+		.alpha(6.0f)
+		.beta(0.0f)
+		.plain(false)
+		.testAccuracy();
+}
+
+TEST(MaskBackward, BoundedReluPlainTail) {
+	MaskBackwardTester()
+		.iterations(3)
+		.batchSize(16)
+		.channels(3)
+		.height(5)
+		.width(5)
+		.activation(dnn::Activations::BoundedRelu)
+		.alpha(6.0f)
+		.beta(0.0f)
+		.plain(true)
+		.testAccuracy();
+}
+
+TEST(MaskBackward, HardSigmoidBlocked) {
+	MaskBackwardTester()
+		.iterations(3)
+		.batchSize(16)
+		.channels(40)
+		.height(9)
+		.width(9)
+		.activation(dnn::Activations::HardSigmoid)
+		.alpha(0.2f)
+		.beta(0.5f)
+		.plain(false)
+		.testAccuracy();
+}
+
+TEST(MaskBackward, HardSigmoidPlainTail) {
+	MaskBackwardTester()
+		.iterations(3)
+		.batchSize(16)
+		.channels(3)
+		.height(5)
+		.width(5)
+		.activation(dnn::Activations::HardSigmoid)
+		.alpha(0.2f)
+		.beta(0.5f)
+		.plain(true)
+		.testAccuracy();
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <Utils.h>
+
+#include <testers/shuffle.h>
+
+
+TEST(Shuffle, Plain116) {
+	ShuffleTester()
+		.iterations(3)
+		.batchSize(8)
+		.channels(116)
+		.groups(2)
+		.height(14)
+		.width(14)
+		.plain(true)
+		.testAccuracy();
+}
+
+TEST(Shuffle, Plain232) {
+	ShuffleTester()
+		.iterations(3)
+		.batchSize(8)
+		.channels(232)
+		.groups(2)
+		.height(7)
+		.width(7)
+		.plain(true)
+		.testAccuracy();
+}
+
+TEST(Shuffle, Blocked128) {
+	ShuffleTester()
+		.iterations(3)
+		.batchSize(8)
+		.channels(128)
+		.groups(2)
+		.height(7)
+		.width(7)
+		.plain(false)
+		.testAccuracy();
+}
+
+int main(int argc, char* argv[]) {
+	setenv("TERM", "xterm-256color", 0);
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
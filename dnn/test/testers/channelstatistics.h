@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include <ChannelStatistics.h>
+
+
+class ChannelStatisticsTester
+{
+public:
+	ChannelStatisticsTester() :
+		iterations_(1),
+		errorLimit_(1.0e-3),
+		batchSize_(1),
+		channels_(1),
+		height_(1),
+		width_(1),
+		offset_(0),
+		plain_(false)
+	{
+	}
+
+	inline ChannelStatisticsTester& iterations(size_t iterations)
+	{
+		this->iterations_ = iterations;
+		return *this;
+	}
+
+	inline size_t iterations() const
+	{
+		return this->iterations_;
+	}
+
+	inline ChannelStatisticsTester& errorLimit(float errorLimit)
+	{
+		this->errorLimit_ = errorLimit;
+		return *this;
+	}
+
+	inline float errorLimit() const
+	{
+		return this->errorLimit_;
+	}
+
+	inline ChannelStatisticsTester& batchSize(size_t batchSize)
+	{
+		this->batchSize_ = batchSize;
+		return *this;
+	}
+
+	inline size_t batchSize() const
+	{
+		return this->batchSize_;
+	}
+
+	inline ChannelStatisticsTester& channels(size_t channels)
+	{
+		this->channels_ = channels;
+		return *this;
+	}
+
+	inline size_t channels() const
+	{
+		return this->channels_;
+	}
+
+	inline ChannelStatisticsTester& height(size_t height)
+	{
+		this->height_ = height;
+		return *this;
+	}
+
+	inline size_t height() const
+	{
+		return this->height_;
+	}
+
+	inline ChannelStatisticsTester& width(size_t width)
+	{
+		this->width_ = width;
+		return *this;
+	}
+
+	inline size_t width() const
+	{
+		return this->width_;
+	}
+
+	// the values are offset + noise: a large offset makes the sum of squares minus the squared sum cancel out in fp32
+	inline ChannelStatisticsTester& offset(float offset)
+	{
+		this->offset_ = offset;
+		return *this;
+	}
+
+	inline float offset() const
+	{
+		return this->offset_;
+	}
+
+	inline ChannelStatisticsTester& plain(bool plain)
+	{
+		this->plain_ = plain;
+		return *this;
+	}
+
+	inline bool plain() const
+	{
+		return this->plain_;
+	}
+
+	// relative error of the mean and variance against a double precision two pass reference,
+	// the variance must also be at least as accurate as fp32 single pass sums of values and squares
+	void testAccuracy() const
+	{
+		const uint_fast32_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+		auto rng = std::bind(std::uniform_real_distribution<float>(-1.0f, 1.0f), std::mt19937(seed));
+
+		const auto C = channels();
+		const auto PaddedC = dnn::DivUp(C);
+		const auto HW = height() * width();
+		const auto stride = plain() ? C : PaddedC;
+		const auto count = batchSize() * HW;
+
+		dnn::FloatVector input(batchSize() * stride * HW, 0.0f);
+		dnn::FloatVector mean(PaddedC), variance(PaddedC), unbiasedVariance(PaddedC);
+
+		for (size_t iteration = 0; iteration < iterations(); iteration++)
+		{
+			// channel c of sample n at hw, scaled per channel so the channels differ
+			auto index = [&](size_t n, size_t c, size_t hw) { return plain() ? (n * C + c) * HW + hw : n * PaddedC * HW + (c / dnn::VectorSize) * dnn::VectorSize * HW + hw * dnn::VectorSize + c % dnn::VectorSize; };
+			for (size_t n = 0; n < batchSize(); n++)
+				for (size_t c = 0; c < C; c++)
+					for (size_t hw = 0; hw < HW; hw++)
+						input[index(n, c, hw)] = offset() + float(c + 1) * rng();
+
+			dnn::ChannelStatistics(input.data(), batchSize(), C, PaddedC, HW, plain(), mean.data(), variance.data(), unbiasedVariance.data());
+
+			for (size_t c = 0; c < C; c++)
+			{
+				double referenceMean = 0;
+				float sum = 0, squareSum = 0;
+				for (size_t n = 0; n < batchSize(); n++)
+					for (size_t hw = 0; hw < HW; hw++)
+					{
+						const auto value = input[index(n, c, hw)];
+						referenceMean += value;
+						sum += value;
+						squareSum += value * value;
+					}
+				referenceMean /= double(count);
+
+				double referenceVariance = 0;
+				for (size_t n = 0; n < batchSize(); n++)
+					for (size_t hw = 0; hw < HW; hw++)
+						referenceVariance += (input[index(n, c, hw)] - referenceMean) * (input[index(n, c, hw)] - referenceMean);
+				const auto referenceUnbiasedVariance = referenceVariance / double(count - 1);
+				referenceVariance /= double(count);
+
+				const auto naiveVariance = double(squareSum / float(count) - (sum / float(count)) * (sum / float(count)));
+
+				const auto meanError = std::abs(double(mean[c]) - referenceMean) / std::max(std::abs(referenceMean), 1.0);
+				const auto varianceError = std::abs(double(variance[c]) - referenceVariance) / referenceVariance;
+				const auto unbiasedVarianceError = std::abs(double(unbiasedVariance[c]) - referenceUnbiasedVariance) / referenceUnbiasedVariance;
+				const auto naiveVarianceError = std::abs(naiveVariance - referenceVariance) / referenceVariance;
+
+				ASSERT_LE(meanError, errorLimit()) << "channel " << c;
+				ASSERT_LE(varianceError, errorLimit()) << "channel " << c;
+				ASSERT_LE(unbiasedVarianceError, errorLimit()) << "channel " << c;
+				ASSERT_LE(varianceError, std::max(naiveVarianceError, double(errorLimit()))) << "channel " << c;
+			}
+		}
+	}
+
+private:
+	size_t iterations_;
+	float errorLimit_;
+	size_t batchSize_;
+	size_t channels_;
+	size_t height_;
+	size_t width_;
+	float offset_;
+	bool plain_;
+};
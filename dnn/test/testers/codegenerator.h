@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+
+
+// the model the generated network is built from, with the layers CodeGenerator maps on primitives, copies and fused chains
+static const char* CodeGeneratorDefinition = R"([codegenerator]
+Dataset=cifar10
+Dim=3,32,32
+ZeroPad=4,4
+RandomCrop=Yes
+WeightsFiller=HeNormal(In,1)
+Biases=Yes
+Dropout=0
+DepthDrop=0
+FixedDepthDrop=Yes
+Scaling=Yes
+Momentum=0.995
+Eps=0.0001
+
+[C1]
+Type=Convolution
+Inputs=Input
+Channels=20
+Kernel=3,3
+Pad=1,1
+
+[B1]
+Type=BatchNormRelu
+Inputs=C1
+
+[P1]
+Type=MaxPooling
+Inputs=B1
+Kernel=2,2
+Stride=2,2
+
+[C2]
+Type=Convolution
+Inputs=P1
+Channels=24
+Kernel=3,3
+Pad=1,1
+
+[PR1]
+Type=PRelu
+Inputs=C2
+
+[B2]
+Type=BatchNorm
+Inputs=PR1
+
+[P2]
+Type=AvgPooling
+Inputs=B2
+Kernel=3,3
+Stride=2,2
+Pad=1,1
+
+[CZP1]
+Type=ChannelZeroPad
+Inputs=P2
+Channels=32
+
+[R1]
+Type=Resampling
+Inputs=CZP1
+Factor=2,2
+Algorithm=Nearest
+
+[DC1]
+Type=DepthwiseConvolution
+Inputs=R1
+Kernel=3,3
+Pad=1,1
+
+[B3]
+Type=BatchNormRelu
+Inputs=DC1
+
+[A1]
+Type=Add
+Inputs=B3,R1
+
+[GAP]
+Type=GlobalAvgPooling
+Inputs=A1
+
+[D1]
+Type=Dense
+Inputs=GAP
+Channels=10
+
+[LSM]
+Type=LogSoftmax
+Inputs=D1
+
+[Cost]
+Type=Cost
+Inputs=LSM
+Cost=CategoricalCrossEntropy
+LabelIndex=0
+Channels=10
+Eps=0.125)";
+
+// the reference holds the batch size, the plain input and the plain output of the model the network was generated from
+struct CodeGeneratorReference
+{
+	size_t BatchSize;
+	std::vector<float> Input;
+	std::vector<float> Output;
+
+	bool Write(const std::string& fileName) const
+	{
+		auto file = std::ofstream(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+		const auto inputSize = Input.size();
+		const auto outputSize = Output.size();
+		file.write(reinterpret_cast<const char*>(&BatchSize), sizeof(BatchSize));
+		file.write(reinterpret_cast<const char*>(&inputSize), sizeof(inputSize));
+		file.write(reinterpret_cast<const char*>(&outputSize), sizeof(outputSize));
+		file.write(reinterpret_cast<const char*>(Input.data()), std::streamsize(inputSize * sizeof(float)));
+		file.write(reinterpret_cast<const char*>(Output.data()), std::streamsize(outputSize * sizeof(float)));
+
+		return file.good();
+	}
+
+	bool Read(const std::string& fileName)
+	{
+		auto file = std::ifstream(fileName, std::ios::in | std::ios::binary);
+		auto inputSize = size_t(0);
+		auto outputSize = size_t(0);
+		file.read(reinterpret_cast<char*>(&BatchSize), sizeof(BatchSize));
+		file.read(reinterpret_cast<char*>(&inputSize), sizeof(inputSize));
+		file.read(reinterpret_cast<char*>(&outputSize), sizeof(outputSize));
+		if (!file.good())
+			return false;
+
+		Input.resize(inputSize);
+		Output.resize(outputSize);
+		file.read(reinterpret_cast<char*>(Input.data()), std::streamsize(inputSize * sizeof(float)));
+		file.read(reinterpret_cast<char*>(Output.data()), std::streamsize(outputSize * sizeof(float)));
+
+		return file.good();
+	}
+};
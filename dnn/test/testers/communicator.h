@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <Communicator.h>
+
+
+class CommunicatorTester
+{
+public:
+	CommunicatorTester() :
+		errorLimit_(1.0e-5),
+		worldSize_(2),
+		count_(1),
+		capacity_(1024),
+		tcp_(false),
+		staleSegment_(false)
+	{
+	}
+
+	inline CommunicatorTester& errorLimit(float errorLimit)
+	{
+		this->errorLimit_ = errorLimit;
+		return *this;
+	}
+
+	inline float errorLimit() const
+	{
+		return this->errorLimit_;
+	}
+
+	inline CommunicatorTester& worldSize(size_t worldSize)
+	{
+		this->worldSize_ = worldSize;
+		return *this;
+	}
+
+	inline size_t worldSize() const
+	{
+		return this->worldSize_;
+	}
+
+	inline CommunicatorTester& count(size_t count)
+	{
+		this->count_ = count;
+		return *this;
+	}
+
+	inline size_t count() const
+	{
+		return this->count_;
+	}
+
+	// the window of the shared memory segment or the bucket of the ring
+	inline CommunicatorTester& capacity(size_t capacity)
+	{
+		this->capacity_ = capacity;
+		return *this;
+	}
+
+	inline size_t capacity() const
+	{
+		return this->capacity_;
+	}
+
+	inline CommunicatorTester& tcp(bool tcp)
+	{
+		this->tcp_ = tcp;
+		return *this;
+	}
+
+	inline bool tcp() const
+	{
+		return this->tcp_;
+	}
+
+	// leaves a segment with garbage counters and a dead owner behind, as a crashed run would
+	inline CommunicatorTester& staleSegment(bool staleSegment)
+	{
+		this->staleSegment_ = staleSegment;
+		return *this;
+	}
+
+	inline bool staleSegment() const
+	{
+		return this->staleSegment_;
+	}
+
+	// rank 0 runs in the test process, the other ranks in forked ones that report through their exit status
+	void testAccuracy() const
+	{
+		const auto name = std::string("communicator-test-") + std::to_string(getpid());
+		const auto basePort = 20000 + static_cast<int>(getpid() % 20000);
+
+		auto peers = std::vector<std::string>();
+		for (size_t rank = 0; rank < worldSize(); rank++)
+			peers.push_back(std::string("localhost:") + std::to_string(basePort + static_cast<int>(rank)));
+
+		if (staleSegment())
+		{
+			// the size of the segment the communicator asks for, so only the owner tells it apart
+			const auto size = 4096ull + (worldSize() + 2ull) * capacity() * sizeof(dnn::Float);
+			const auto segment = std::string("/dnn-") + name;
+			const auto handle = shm_open(segment.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+			ASSERT_GE(handle, 0);
+			ASSERT_EQ(ftruncate(handle, static_cast<off_t>(size)), 0);
+			auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+			ASSERT_NE(memory, MAP_FAILED);
+			std::memset(memory, 0xFF, 4096);
+			munmap(memory, size);
+			close(handle);
+		}
+
+		auto children = std::vector<pid_t>();
+		for (size_t rank = 1; rank < worldSize(); rank++)
+		{
+			const auto child = fork();
+			ASSERT_GE(child, 0);
+			if (child == 0)
+				_exit(run(name, peers, rank) ? 0 : 1);
+
+			children.push_back(child);
+		}
+
+		EXPECT_TRUE(run(name, peers, 0));
+
+		for (const auto child : children)
+		{
+			auto status = 0;
+			ASSERT_EQ(waitpid(child, &status, 0), child);
+			EXPECT_TRUE(WIFEXITED(status));
+			EXPECT_EQ(WEXITSTATUS(status), 0);
+		}
+	}
+
+	// the other ranks never start, rank 0 gives up after the timeout
+	void testAttachTimeout() const
+	{
+		const auto name = std::string("communicator-timeout-") + std::to_string(getpid());
+		EXPECT_THROW(std::make_unique<dnn::SharedMemoryCommunicator>(name, 0ull, worldSize(), capacity(), std::chrono::seconds(1)), std::runtime_error);
+	}
+
+private:
+	bool run(const std::string& name, const std::vector<std::string>& peers, const size_t rank) const
+	{
+		try
+		{
+			auto comm = tcp() ?
+				std::unique_ptr<dnn::Communicator>(new dnn::TcpCommunicator(peers, rank, capacity())) :
+				std::unique_ptr<dnn::Communicator>(new dnn::SharedMemoryCommunicator(name, rank, worldSize(), capacity()));
+
+			// two buffers, so the windows and buckets cross a buffer boundary
+			auto first = std::vector<dnn::Float>(count() / 3);
+			auto second = std::vector<dnn::Float>(count() - first.size());
+			const auto buffers = dnn::CommBuffers({ { first.data(), first.size() }, { second.data(), second.size() } });
+
+			auto fill = [&](const size_t value)
+			{
+				for (size_t i = 0; i < first.size(); i++)
+					first[i] = dnn::Float(value + i % 7);
+				for (size_t i = 0; i < second.size(); i++)
+					second[i] = dnn::Float(value + (first.size() + i) % 7);
+			};
+			auto check = [&](const dnn::Float expected)
+			{
+				for (size_t i = 0; i < count(); i++)
+				{
+					const auto actual = i < first.size() ? first[i] : second[i - first.size()];
+					if (std::abs(actual - (expected + dnn::Float(i % 7))) > errorLimit() * (expected + dnn::Float(7)))
+						return false;
+				}
+				return true;
+			};
+
+			const auto average = dnn::Float(worldSize() - 1) / dnn::Float(2);
+			auto ok = true;
+
+			fill(rank);
+			comm->Allreduce(buffers);
+			ok = check(average) && ok;
+
+			// two requests in flight at once, they are reduced in the order they were queued
+			fill(rank);
+			auto reducedFirst = comm->AllreduceAsync({ { first.data(), first.size() } });
+			auto reducedSecond = comm->AllreduceAsync({ { second.data(), second.size() } });
+			comm->Flush();
+			reducedFirst.get();
+			reducedSecond.get();
+			ok = check(average) && ok;
+
+			fill(rank + 1);
+			comm->Broadcast(buffers);
+			ok = check(dnn::Float(1)) && ok;
+
+			comm->Barrier();
+
+			return ok;
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+	}
+
+	float errorLimit_;
+	size_t worldSize_;
+	size_t count_;
+	size_t capacity_;
+	bool tcp_;
+	bool staleSegment_;
+};
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include <DepthwiseConvolution.h>
+
+#include <testers/source.h>
+
+
+class DepthwiseConvolutionTester
+{
+public:
+	DepthwiseConvolutionTester() :
+		iterations_(1),
+		errorLimit_(1.0e-4),
+		batchSize_(1),
+		channels_(1),
+		height_(1),
+		width_(1),
+		kernel_(3),
+		stride_(1),
+		padding_(1)
+	{
+	}
+
+	inline DepthwiseConvolutionTester& iterations(size_t iterations)
+	{
+		this->iterations_ = iterations;
+		return *this;
+	}
+
+	inline size_t iterations() const
+	{
+		return this->iterations_;
+	}
+
+	inline DepthwiseConvolutionTester& errorLimit(float errorLimit)
+	{
+		this->errorLimit_ = errorLimit;
+		return *this;
+	}
+
+	inline float errorLimit() const
+	{
+		return this->errorLimit_;
+	}
+
+	inline DepthwiseConvolutionTester& batchSize(size_t batchSize)
+	{
+		this->batchSize_ = batchSize;
+		return *this;
+	}
+
+	inline size_t batchSize() const
+	{
+		return this->batchSize_;
+	}
+
+	inline DepthwiseConvolutionTester& channels(size_t channels)
+	{
+		this->channels_ = channels;
+		return *this;
+	}
+
+	inline size_t channels() const
+	{
+		return this->channels_;
+	}
+
+	inline DepthwiseConvolutionTester& height(size_t height)
+	{
+		this->height_ = height;
+		return *this;
+	}
+
+	inline size_t height() const
+	{
+		return this->height_;
+	}
+
+	inline DepthwiseConvolutionTester& width(size_t width)
+	{
+		this->width_ = width;
+		return *this;
+	}
+
+	inline size_t width() const
+	{
+		return this->width_;
+	}
+
+	inline DepthwiseConvolutionTester& kernel(size_t kernel)
+	{
+		this->kernel_ = kernel;
+		return *this;
+	}
+
+	inline size_t kernel() const
+	{
+		return this->kernel_;
+	}
+
+	inline DepthwiseConvolutionTester& stride(size_t stride)
+	{
+		this->stride_ = stride;
+		return *this;
+	}
+
+	inline size_t stride() const
+	{
+		return this->stride_;
+	}
+
+	inline DepthwiseConvolutionTester& padding(size_t padding)
+	{
+		this->padding_ = padding;
+		return *this;
+	}
+
+	inline size_t padding() const
+	{
+		return this->padding_;
+	}
+
+	// the direct kernel against the grouped convolution of oneDNN (a plain output keeps the layer off the direct kernel):
+	// the output, the BatchNormActivation computed in its epilogue at inference and the sums it hands over in training,
+	// with new weights, biases and running statistics every iteration
+	void testAccuracy() const
+	{
+		const uint_fast32_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+		auto rng = std::bind(std::uniform_real_distribution<float>(-1.0f, 1.0f), std::mt19937(seed));
+
+		auto engine = dnnl::engine(dnnl::engine::kind::cpu, 0);
+		auto device = dnn::Device(engine, dnnl::stream(engine));
+
+		auto source = SourceLayer(device, false, channels(), height(), width());
+		auto depthwise = dnn::DepthwiseConvolution(device, dnn::BlockedFmt, "Depthwise", std::vector<dnn::Layer*>({ &source }), kernel(), kernel(), stride(), stride(), 1, 1, padding(), padding(), 1, true);
+		auto reference = dnn::DepthwiseConvolution(device, dnn::PlainFmt, "Reference", std::vector<dnn::Layer*>({ &source }), kernel(), kernel(), stride(), stride(), 1, 1, padding(), padding(), 1, true);
+		auto batchNorm = dnn::BatchNormActivation(device, dnnl::memory::format_tag::any, "BatchNorm", dnn::Activations::HardSwish, std::vector<dnn::Layer*>({ &depthwise }));
+		auto referenceBatchNorm = dnn::BatchNormActivation(device, dnnl::memory::format_tag::any, "ReferenceBatchNorm", dnn::Activations::HardSwish, std::vector<dnn::Layer*>({ &reference }));
+		source.Outputs = std::vector<dnn::Layer*>({ &depthwise, &reference });
+		depthwise.Outputs = std::vector<dnn::Layer*>({ &batchNorm });
+		reference.Outputs = std::vector<dnn::Layer*>({ &referenceBatchNorm });
+
+		const auto C = channels();
+		const auto taps = kernel() * kernel();
+		for (auto layer : { &depthwise, &reference })
+		{
+			layer->Weights.resize(layer->WeightCount, 0.0f);
+			layer->Biases.resize(layer->BiasCount, 0.0f);
+		}
+		for (auto layer : { &batchNorm, &referenceBatchNorm })
+		{
+			layer->Weights.resize(layer->PaddedC, 1.0f);
+			layer->Biases.resize(layer->PaddedC, 0.0f);
+		}
+
+		for (auto layer : std::vector<dnn::Layer*>({ &source, &depthwise, &reference, &batchNorm, &referenceBatchNorm }))
+			layer->SetBatchSize(batchSize());
+
+		ASSERT_NE(depthwise.GetDescription().find("Direct:"), std::string::npos);
+		ASSERT_EQ(reference.GetDescription().find("Direct:"), std::string::npos);
+		ASSERT_EQ(depthwise.H, reference.H);
+		ASSERT_EQ(depthwise.W, reference.W);
+
+		// the goihw weights go through a reorder into the format the primitive chose, as ResetWeights does
+		auto setWeights = [&](dnn::DepthwiseConvolution& layer, std::vector<float>& weights, const std::vector<float>& biases)
+		{
+			auto memWeights = dnnl::memory(*layer.PersistWeightsMemDesc, device.engine, weights.data());
+			auto weightsMem = dnnl::memory(*layer.WeightsMemDesc, device.engine, layer.Weights.data());
+			dnnl::reorder(memWeights, weightsMem).execute(device.stream, { {DNNL_ARG_FROM, memWeights}, {DNNL_ARG_TO, weightsMem} });
+			device.stream.wait();
+
+			std::copy(biases.begin(), biases.end(), layer.Biases.begin());
+			layer.WeightsChanged();
+		};
+
+		const auto HW = height() * width();
+		const auto outputHW = depthwise.HW();
+		auto blocked = [&](const dnn::Layer& layer, size_t n, size_t c, size_t hw) { return n * layer.PaddedCDHW() + (c / dnn::VectorSize) * dnn::VectorSize * layer.HW() + hw * dnn::VectorSize + c % dnn::VectorSize; };
+		auto plain = [&](const dnn::Layer& layer, size_t n, size_t c, size_t hw) { return (n * layer.C + c) * layer.HW() + hw; };
+
+		auto compare = [&](const std::vector<float>& expected, const std::vector<float>& actual, const char* name)
+		{
+			auto scale = 1.0e-6f;
+			for (const auto value : expected)
+				scale = std::max(scale, std::abs(value));
+			for (size_t i = 0; i < expected.size(); i++)
+				ASSERT_LE(std::abs(actual[i] - expected[i]) / scale, errorLimit()) << name << " at " << i;
+		};
+		auto gather = [&](const dnn::Layer& layer, const bool isPlain)
+		{
+			auto values = std::vector<float>();
+			for (size_t n = 0; n < batchSize(); n++)
+				for (size_t c = 0; c < C; c++)
+					for (size_t hw = 0; hw < outputHW; hw++)
+						values.push_back(layer.Neurons[isPlain ? plain(layer, n, c, hw) : blocked(layer, n, c, hw)]);
+			return values;
+		};
+
+		for (size_t iteration = 0; iteration < iterations(); iteration++)
+		{
+			auto weights = std::vector<float>(C * taps);
+			auto biases = std::vector<float>(C);
+			for (auto& weight : weights)
+				weight = rng();
+			for (auto& bias : biases)
+				bias = 0.5f * rng();
+			setWeights(depthwise, weights, biases);
+			setWeights(reference, weights, biases);
+
+			for (size_t c = 0; c < C; c++)
+			{
+				const auto weight = 0.5f + 0.5f * std::abs(rng());
+				const auto bias = 0.5f * rng();
+				const auto mean = 0.5f * rng();
+				const auto variance = 0.25f + std::abs(rng());
+				for (auto layer : { &batchNorm, &referenceBatchNorm })
+				{
+					layer->Weights[c] = weight;
+					layer->Biases[c] = bias;
+					layer->RunningMean[c] = mean;
+					layer->RunningVariance[c] = variance;
+				}
+			}
+			batchNorm.WeightsChanged();
+
+			for (size_t i = 0; i < source.Neurons.size(); i++)
+				source.Neurons[i] = 0.0f;
+			for (size_t n = 0; n < batchSize(); n++)
+				for (size_t c = 0; c < C; c++)
+					for (size_t hw = 0; hw < HW; hw++)
+						source.Neurons[blocked(source, n, c, hw)] = rng();
+
+			reference.ForwardProp(batchSize(), false);
+			referenceBatchNorm.ForwardProp(batchSize(), false);
+			const auto expected = gather(reference, true);
+			const auto expectedBatchNorm = gather(referenceBatchNorm, true);
+
+			depthwise.Epilogue = nullptr;
+			depthwise.ForwardProp(batchSize(), false);
+			compare(expected, gather(depthwise, false), "output");
+
+			depthwise.Epilogue = &batchNorm;
+			depthwise.ForwardProp(batchSize(), false);
+			batchNorm.ForwardProp(batchSize(), false);
+			compare(expectedBatchNorm, gather(batchNorm, false), "epilogue");
+
+			depthwise.ForwardProp(batchSize(), true);
+			compare(expected, gather(depthwise, false), "training output");
+
+			// the handed over statistics against a two-pass reference
+			auto means = std::vector<float>(C, 0.0f), variances = std::vector<float>(C, 0.0f);
+			for (size_t c = 0; c < C; c++)
+			{
+				const auto count = double(batchSize() * outputHW);
+				auto sum = 0.0;
+				for (size_t n = 0; n < batchSize(); n++)
+					for (size_t hw = 0; hw < outputHW; hw++)
+						sum += expected[(n * C + c) * outputHW + hw];
+				const auto mean = sum / count;
+
+				auto squareSum = 0.0;
+				for (size_t n = 0; n < batchSize(); n++)
+					for (size_t hw = 0; hw < outputHW; hw++)
+						squareSum += (expected[(n * C + c) * outputHW + hw] - mean) * (expected[(n * C + c) * outputHW + hw] - mean);
+				means[c] = float(mean);
+				variances[c] = float(squareSum / count);
+			}
+			ASSERT_TRUE(batchNorm.InputStatistics);
+			auto handedMeans = std::vector<float>(C, 0.0f), handedVariances = std::vector<float>(C, 0.0f);
+			auto block = std::vector<dnn::Float>(dnn::VectorSize);
+			for (size_t c = 0; c < C; c++)
+			{
+				const auto& statistics = batchNorm.InputBlockStatistics[c / dnn::VectorSize];
+				ASSERT_EQ(size_t(statistics.Count), batchSize() * outputHW);
+				statistics.Mean.store(block.data());
+				handedMeans[c] = block[c % dnn::VectorSize];
+				(statistics.M2 / statistics.Count).store(block.data());
+				handedVariances[c] = block[c % dnn::VectorSize];
+			}
+			compare(means, handedMeans, "mean");
+			compare(variances, handedVariances, "variance");
+			batchNorm.InputStatistics = false;
+		}
+	}
+
+private:
+	size_t iterations_;
+	float errorLimit_;
+	size_t batchSize_;
+	size_t channels_;
+	size_t height_;
+	size_t width_;
+	size_t kernel_;
+	size_t stride_;
+	size_t padding_;
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include <Activation.h>
+#include <Divide.h>
+#include <Multiply.h>
+#include <Substract.h>
+
+#include <testers/source.h>
+
+
+class ElementwiseChainTester
+{
+public:
+	ElementwiseChainTester() :
+		iterations_(1),
+		errorLimit_(1.0e-3),
+		batchSize_(1),
+		channels_(1),
+		height_(1),
+		width_(1),
+		plain_(false)
+	{
+	}
+
+	inline ElementwiseChainTester& iterations(size_t iterations)
+	{
+		this->iterations_ = iterations;
+		return *this;
+	}
+
+	inline size_t iterations() const
+	{
+		return this->iterations_;
+	}
+
+	inline ElementwiseChainTester& errorLimit(float errorLimit)
+	{
+		this->errorLimit_ = errorLimit;
+		return *this;
+	}
+
+	inline float errorLimit() const
+	{
+		return this->errorLimit_;
+	}
+
+	inline ElementwiseChainTester& batchSize(size_t batchSize)
+	{
+		this->batchSize_ = batchSize;
+		return *this;
+	}
+
+	inline size_t batchSize() const
+	{
+		return this->batchSize_;
+	}
+
+	inline ElementwiseChainTester& channels(size_t channels)
+	{
+		this->channels_ = channels;
+		return *this;
+	}
+
+	inline size_t channels() const
+	{
+		return this->channels_;
+	}
+
+	inline ElementwiseChainTester& height(size_t height)
+	{
+		this->height_ = height;
+		return *this;
+	}
+
+	inline size_t height() const
+	{
+		return this->height_;
+	}
+
+	inline ElementwiseChainTester& width(size_t width)
+	{
+		this->width_ = width;
+		return *this;
+	}
+
+	inline size_t width() const
+	{
+		return this->width_;
+	}
+
+	inline ElementwiseChainTester& plain(bool plain)
+	{
+		this->plain_ = plain;
+		return *this;
+	}
+
+	inline bool plain() const
+	{
+		return this->plain_;
+	}
+
+	// TanhExp((a - b) * gate / d) with the N x C x 1 x 1 gate broadcast: the root Activation computing the chain of steps in one pass
+	// against the Substract, Multiply, Divide and Activation layers one after the other, the output and the gradients of a, b, gate and d
+	// relative to the largest value (the unfused Divide uses an approximate reciprocal in the blocked layout)
+	void testAccuracy() const
+	{
+		const uint_fast32_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+		auto rng = std::bind(std::uniform_real_distribution<float>(-1.0f, 1.0f), std::mt19937(seed));
+
+		auto engine = dnnl::engine(dnnl::engine::kind::cpu, 0);
+		auto device = dnn::Device(engine, dnnl::stream(engine));
+		const auto format = dnnl::memory::format_tag::any;
+
+		auto a = SourceLayer(device, plain(), channels(), height(), width());
+		auto b = SourceLayer(device, plain(), channels(), height(), width());
+		auto gate = SourceLayer(device, plain(), channels(), 1, 1);
+		auto d = SourceLayer(device, plain(), channels(), height(), width());
+		auto substract = dnn::Substract(device, format, "Substract", std::vector<dnn::Layer*>({ &a, &b }));
+		auto multiply = dnn::Multiply(device, format, "Multiply", std::vector<dnn::Layer*>({ &substract, &gate }));
+		auto divide = dnn::Divide(device, format, "Divide", std::vector<dnn::Layer*>({ &multiply, &d }));
+		auto activation = dnn::Activation(device, format, "Activation", dnn::Activations::TanhExp, std::vector<dnn::Layer*>({ &divide }));
+		const auto sources = std::vector<SourceLayer*>({ &a, &b, &gate, &d });
+		const auto layers = std::vector<dnn::Layer*>({ &a, &b, &gate, &d, &substract, &multiply, &divide, &activation });
+
+		ASSERT_TRUE(activation.FusesAdd());
+
+		// the steps Model::FuseElementwiseChains gives this graph
+		auto chain = std::make_shared<dnn::ElementwiseChain>(device, &activation);
+		auto input = [&](dnn::Layer* owner, const dnn::Byte index, const bool broadcast)
+		{
+			auto node = dnn::ElementwiseNode(dnn::ElementwiseOps::Input, owner);
+			node.Index[0] = index;
+			node.Broadcast = broadcast;
+			chain->Nodes.push_back(node);
+			return chain->Nodes.size() - 1ull;
+		};
+		auto step = [&](const dnn::ElementwiseOps op, dnn::Layer* owner, const dnn::Byte first, const dnn::Byte second, const size_t operand0, const size_t operand1)
+		{
+			auto node = dnn::ElementwiseNode(op, owner);
+			node.Index = { first, second };
+			node.Operands = { operand0, operand1 };
+			chain->Nodes.push_back(node);
+			return chain->Nodes.size() - 1ull;
+		};
+		const auto nodeA = input(&substract, substract.first, false);
+		const auto nodeB = input(&substract, substract.second, false);
+		const auto difference = step(dnn::ElementwiseOps::Sum, &substract, substract.first, substract.second, nodeA, nodeB);
+		chain->Nodes[difference].Weights = { dnn::Float(1), dnn::Float(-1) };
+		chain->Nodes[difference].SurvivalProbability = &substract.SurvivalProbability;
+		const auto nodeGate = input(&multiply, multiply.second, true);
+		const auto product = step(dnn::ElementwiseOps::Multiply, &multiply, multiply.first, multiply.second, difference, nodeGate);
+		const auto nodeD = input(&divide, divide.second, false);
+		const auto quotient = step(dnn::ElementwiseOps::Divide, &divide, divide.first, divide.second, product, nodeD);
+		const auto root = step(dnn::ElementwiseOps::Activation, &activation, 0, 0, quotient, quotient);
+		chain->Nodes[root].f = activation.Func.f;
+		chain->Nodes[root].df = activation.Func.df;
+		chain->Nodes[root].fVec = activation.Func.fVec;
+		chain->Nodes[root].dfVec = activation.Func.dfVec;
+		chain->Nodes[root].Alpha = activation.Alpha;
+		chain->Nodes[root].Beta = activation.Beta;
+
+		auto setBatchSize = [&](const bool fused)
+		{
+			substract.Fused = fused;
+			multiply.Fused = fused;
+			divide.Fused = fused;
+			activation.Chain = fused ? chain : nullptr;
+			for (auto layer : layers)
+				layer->SetBatchSize(batchSize());
+		};
+
+		// the index of the value of channel c at hw of sample n, the channels padding the last block are never compared
+		auto index = [&](const dnn::Layer& layer, size_t n, size_t c, size_t hw) { return plain() ? (n * layer.C + c) * layer.HW() + hw : n * layer.PaddedCDHW() + (c / dnn::VectorSize) * dnn::VectorSize * layer.HW() + hw * dnn::VectorSize + c % dnn::VectorSize; };
+		auto gather = [&](const dnn::Layer& layer, const dnn::FloatArray& array)
+		{
+			auto values = std::vector<float>();
+			for (size_t n = 0; n < batchSize(); n++)
+				for (size_t c = 0; c < layer.C; c++)
+					for (size_t hw = 0; hw < layer.HW(); hw++)
+						values.push_back(array[index(layer, n, c, hw)]);
+			return values;
+		};
+
+		auto run = [&](const bool fused, const std::vector<std::vector<float>>& values, const std::vector<float>& outputD1, std::vector<float>& output, std::vector<std::vector<float>>& inputsD1)
+		{
+			setBatchSize(fused);
+
+			for (size_t i = 0; i < sources.size(); i++)
+			{
+				std::copy(values[i].begin(), values[i].end(), sources[i]->Neurons.data());
+				for (size_t j = 0; j < sources[i]->NeuronsD1.size(); j++)
+					sources[i]->NeuronsD1[j] = 0.0f;
+			}
+
+			for (auto layer : layers)
+				if (!layer->Fused)
+					layer->ForwardProp(batchSize(), true);
+
+			std::copy(outputD1.begin(), outputD1.end(), activation.NeuronsD1.data());
+
+			for (auto layer = layers.rbegin(); layer != layers.rend(); layer++)
+				if (!(*layer)->Fused)
+					(*layer)->BackwardProp(batchSize());
+
+			output = gather(activation, activation.Neurons);
+			inputsD1.clear();
+			for (auto source : sources)
+				inputsD1.push_back(gather(*source, source->NeuronsD1));
+		};
+
+		for (size_t iteration = 0; iteration < iterations(); iteration++)
+		{
+			setBatchSize(false);
+
+			// d is kept away from zero, its padding channels are one so the padding lanes stay finite
+			auto values = std::vector<std::vector<float>>();
+			for (auto source : sources)
+			{
+				const auto denominator = source == &d;
+				auto sourceValues = std::vector<float>(source->Neurons.size(), denominator ? 1.0f : 0.0f);
+				for (size_t n = 0; n < batchSize(); n++)
+					for (size_t c = 0; c < source->C; c++)
+						for (size_t hw = 0; hw < source->HW(); hw++)
+							sourceValues[index(*source, n, c, hw)] = denominator ? 1.0f + std::abs(rng()) : 2.0f * rng();
+				values.push_back(sourceValues);
+			}
+			auto outputD1 = std::vector<float>(activation.NeuronsD1.size(), 0.0f);
+			for (size_t n = 0; n < batchSize(); n++)
+				for (size_t c = 0; c < activation.C; c++)
+					for (size_t hw = 0; hw < activation.HW(); hw++)
+						outputD1[index(activation, n, c, hw)] = rng();
+
+			std::vector<float> output, fusedOutput;
+			std::vector<std::vector<float>> inputsD1, fusedInputsD1;
+			run(false, values, outputD1, output, inputsD1);
+			run(true, values, outputD1, fusedOutput, fusedInputsD1);
+
+			auto compare = [&](const std::vector<float>& expected, const std::vector<float>& actual, const char* name)
+			{
+				auto scale = 1.0e-6f;
+				for (const auto value : expected)
+					scale = std::max(scale, std::abs(value));
+				for (size_t i = 0; i < expected.size(); i++)
+					ASSERT_LE(std::abs(actual[i] - expected[i]) / scale, errorLimit()) << name << " at " << i;
+			};
+
+			compare(output, fusedOutput, "output");
+			const char* names[] = { "gradient of a", "gradient of b", "gradient of gate", "gradient of d" };
+			for (size_t i = 0; i < sources.size(); i++)
+				compare(inputsD1[i], fusedInputsD1[i], names[i]);
+		}
+	}
+
+private:
+	size_t iterations_;
+	float errorLimit_;
+	size_t batchSize_;
+	size_t channels_;
+	size_t height_;
+	size_t width_;
+	bool plain_;
+};
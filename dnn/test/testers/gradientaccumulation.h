@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include <Definition.h>
+
+
+static const char* GradientAccumulationDefinition = R"([gradientaccumulation]
+Dataset=cifar10
+Dim=3,32,32
+ZeroPad=4,4
+RandomCrop=Yes
+WeightsFiller=HeNormal(In,1)
+Biases=No
+Dropout=0
+DepthDrop=0
+FixedDepthDrop=Yes
+Scaling=Yes
+Momentum=0.995
+Eps=0.0001
+
+[C1]
+Type=Convolution
+Inputs=Input
+Channels=16
+Kernel=3,3
+Pad=1,1
+
+[B1]
+Type=BatchNormRelu
+Inputs=C1
+
+[GAP]
+Type=GlobalAvgPooling
+Inputs=B1
+
+[D1]
+Type=Dense
+Inputs=GAP
+Channels=10
+
+[LSM]
+Type=LogSoftmax
+Inputs=D1
+
+[Cost]
+Type=Cost
+Inputs=LSM
+Cost=CategoricalCrossEntropy
+LabelIndex=0
+Channels=10)";
+
+
+class GradientAccumulationTester
+{
+public:
+	GradientAccumulationTester() :
+		effectiveBatchSize_(128),
+		batchSizes_({ 64 })
+	{
+	}
+
+	inline GradientAccumulationTester& effectiveBatchSize(size_t effectiveBatchSize)
+	{
+		this->effectiveBatchSize_ = effectiveBatchSize;
+		return *this;
+	}
+
+	inline size_t effectiveBatchSize() const
+	{
+		return this->effectiveBatchSize_;
+	}
+
+	// the batch sizes the training rates switch through, the first one is the batch the effective batch size is set at
+	inline GradientAccumulationTester& batchSizes(const std::vector<size_t>& batchSizes)
+	{
+		this->batchSizes_ = batchSizes;
+		return *this;
+	}
+
+	inline const std::vector<size_t>& batchSizes() const
+	{
+		return this->batchSizes_;
+	}
+
+	void testMicroBatches() const
+	{
+		// no dataset is read, the provider only holds the sample counts the batch size change adjusts to
+		auto dataprovider = dnn::Dataprovider((std::filesystem::temp_directory_path() / "convnet-gradientaccumulation").string());
+		auto checkMsg = dnn::CheckMsg();
+		auto model = std::unique_ptr<dnn::Model>(dnn::Read(std::string(GradientAccumulationDefinition), &dataprovider, checkMsg));
+		ASSERT_NE(model, nullptr) << checkMsg.Message;
+
+		ASSERT_TRUE(model->ChangeResolution(batchSizes().front(), 32, 32, 4, 4));
+		ASSERT_TRUE(model->SetGradientAccumulation(effectiveBatchSize()));
+
+		for (const auto batchSize : batchSizes())
+		{
+			ASSERT_TRUE(model->ChangeResolution(batchSize, 32, 32, 4, 4));
+
+			const auto microBatches = effectiveBatchSize() > batchSize ? effectiveBatchSize() / batchSize : size_t(1);
+			EXPECT_EQ(model->MicroBatches, microBatches) << "at batch size " << batchSize;
+			EXPECT_EQ(model->UpdateRate(model->MicroBatches).BatchSize, microBatches * batchSize) << "at batch size " << batchSize;
+			if (effectiveBatchSize() % batchSize == 0)
+				EXPECT_EQ(model->UpdateRate(model->MicroBatches).BatchSize, effectiveBatchSize()) << "at batch size " << batchSize;
+		}
+	}
+
+	// an effective batch size that isn't a multiple of the batch size is refused
+	void testRejected() const
+	{
+		auto dataprovider = dnn::Dataprovider((std::filesystem::temp_directory_path() / "convnet-gradientaccumulation").string());
+		auto checkMsg = dnn::CheckMsg();
+		auto model = std::unique_ptr<dnn::Model>(dnn::Read(std::string(GradientAccumulationDefinition), &dataprovider, checkMsg));
+		ASSERT_NE(model, nullptr) << checkMsg.Message;
+
+		ASSERT_TRUE(model->ChangeResolution(batchSizes().front(), 32, 32, 4, 4));
+		EXPECT_FALSE(model->SetGradientAccumulation(effectiveBatchSize()));
+		EXPECT_EQ(model->MicroBatches, size_t(1));
+	}
+
+private:
+	size_t effectiveBatchSize_;
+	std::vector<size_t> batchSizes_;
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+
+#include <Model.h>
+
+
+extern "C" dnn::Model* DNNModelCreate(const char* definition, const char* weightsFileName, const dnn::UInt batchSize);
+extern "C" void DNNModelDestroy(dnn::Model* handle);
+extern "C" dnn::UInt DNNModelQuantize(dnn::Model* handle, const dnn::Float* samples, const dnn::UInt count);
+extern "C" dnn::Model* DNNInferenceContextCreate(dnn::Model* handle, const dnn::UInt batchSize);
+extern "C" void DNNInferenceContextDestroy(dnn::Model* context);
+extern "C" bool DNNInference(dnn::Model* context, const dnn::Float* input, const dnn::UInt batchSize, dnn::Float* output);
+extern "C" dnn::UInt DNNGetInferenceInputSize(dnn::Model* handle);
+extern "C" dnn::UInt DNNGetInferenceOutputSize(dnn::Model* handle);
+
+
+class InferenceTester
+{
+public:
+	InferenceTester() :
+		errorLimit_(1.0e-4),
+		batchSize_(1),
+		contexts_(1),
+		size_(28),
+		kernel_(1),
+		quantize_(false)
+	{
+	}
+
+	inline InferenceTester& errorLimit(float errorLimit)
+	{
+		this->errorLimit_ = errorLimit;
+		return *this;
+	}
+
+	inline float errorLimit() const
+	{
+		return this->errorLimit_;
+	}
+
+	inline InferenceTester& batchSize(size_t batchSize)
+	{
+		this->batchSize_ = batchSize;
+		return *this;
+	}
+
+	inline size_t batchSize() const
+	{
+		return this->batchSize_;
+	}
+
+	// every context runs on its own thread
+	inline InferenceTester& contexts(size_t contexts)
+	{
+		this->contexts_ = contexts;
+		return *this;
+	}
+
+	inline size_t contexts() const
+	{
+		return this->contexts_;
+	}
+
+	// height and width of the input, at least 28
+	inline InferenceTester& size(size_t size)
+	{
+		this->size_ = size;
+		return *this;
+	}
+
+	inline size_t size() const
+	{
+		return this->size_;
+	}
+
+	// kernel of the convolution feeding the cost layer, as large as the input it gives a 10 x 1 x 1 output
+	inline InferenceTester& kernel(size_t kernel)
+	{
+		this->kernel_ = kernel;
+		return *this;
+	}
+
+	inline size_t kernel() const
+	{
+		return this->kernel_;
+	}
+
+	inline InferenceTester& quantize(bool quantize)
+	{
+		this->quantize_ = quantize;
+		return *this;
+	}
+
+	inline bool quantize() const
+	{
+		return this->quantize_;
+	}
+
+	void testAccuracy() const
+	{
+		const auto definition = std::string("[inference]\nDataset=cifar10\nDim=3,") + std::to_string(size()) + "," + std::to_string(size()) + "\nZeroPad=4,4\nRandomCrop=Yes\nWeightsFiller=HeNormal(In,1)\nBiases=Yes\nDropout=0\nDepthDrop=0\nFixedDepthDrop=Yes\nScaling=Yes\nMomentum=0.995\nEps=0.0001\n\n"
+			"[C1]\nType=Convolution\nInputs=Input\nChannels=10\nKernel=" + std::to_string(kernel()) + "," + std::to_string(kernel()) + "\n\n"
+			"[Cost]\nType=Cost\nInputs=C1\nCost=CategoricalCrossEntropy\nLabelIndex=0\nChannels=10";
+
+		auto handle = DNNModelCreate(definition.c_str(), nullptr, batchSize());
+		ASSERT_NE(handle, nullptr);
+
+		const auto inputSize = DNNGetInferenceInputSize(handle);
+		const auto outputSize = DNNGetInferenceOutputSize(handle);
+		const auto outputHW = (size() - kernel() + 1) * (size() - kernel() + 1);
+		ASSERT_EQ(inputSize, 3 * size() * size());
+		ASSERT_EQ(outputSize, 10 * outputHW);
+
+		auto rng = std::mt19937(2024);
+		auto uniform = std::uniform_real_distribution<dnn::Float>(dnn::Float(-1), dnn::Float(1));
+
+		auto conv = handle->Layers[1].get();
+		for (auto& bias : conv->Biases)
+			bias = uniform(rng);
+
+		auto input = std::vector<dnn::Float>(batchSize() * inputSize);
+		for (auto& value : input)
+			value = uniform(rng);
+
+		// direct convolution on the plain weights, independent of the layout the primitive chose
+		const auto weights = conv->GetPlainWeights();
+		const auto outputSide = size() - kernel() + 1;
+		auto reference = std::vector<dnn::Float>(batchSize() * outputSize);
+		for (size_t n = 0; n < batchSize(); n++)
+			for (size_t c = 0; c < 10; c++)
+				for (size_t oh = 0; oh < outputSide; oh++)
+					for (size_t ow = 0; ow < outputSide; ow++)
+					{
+						auto sum = double(conv->Biases[c]);
+						for (size_t ic = 0; ic < 3; ic++)
+							for (size_t kh = 0; kh < kernel(); kh++)
+								for (size_t kw = 0; kw < kernel(); kw++)
+									sum += double(weights[((c * 3 + ic) * kernel() + kh) * kernel() + kw]) * double(input[n * inputSize + (ic * size() + oh + kh) * size() + ow + kw]);
+						reference[n * outputSize + c * outputHW + oh * outputSide + ow] = dnn::Float(sum);
+					}
+
+		if (quantize())
+			ASSERT_GT(DNNModelQuantize(handle, input.data(), batchSize()), 0ull);
+
+		auto contexts = std::vector<dnn::Model*>();
+		for (size_t i = 0; i < this->contexts(); i++)
+		{
+			contexts.push_back(DNNInferenceContextCreate(handle, batchSize()));
+			ASSERT_NE(contexts.back(), nullptr);
+			ASSERT_EQ(contexts.back()->Layers[1]->Quantized, quantize());
+		}
+
+		// every context runs the full and a partial batch, the partial one must not see the samples after it
+		auto outputs = std::vector<std::vector<dnn::Float>>(contexts.size(), std::vector<dnn::Float>(batchSize() * outputSize));
+		auto partials = std::vector<std::vector<dnn::Float>>(contexts.size(), std::vector<dnn::Float>(batchSize() * outputSize, dnn::Float(0)));
+		auto results = std::vector<int>(contexts.size(), 0);
+		auto threads = std::vector<std::thread>();
+		for (size_t i = 0; i < contexts.size(); i++)
+			threads.emplace_back([&, i]()
+			{
+				const auto partial = std::max<size_t>(batchSize() - 1, 1);
+				results[i] = DNNInference(contexts[i], input.data(), batchSize(), outputs[i].data()) && DNNInference(contexts[i], input.data(), partial, partials[i].data()) ? 1 : 0;
+			});
+		for (auto& thread : threads)
+			thread.join();
+
+		auto handleOutput = std::vector<dnn::Float>(batchSize() * outputSize);
+		ASSERT_TRUE(DNNInference(handle, input.data(), batchSize(), handleOutput.data()));
+
+		for (size_t i = 0; i < contexts.size(); i++)
+		{
+			ASSERT_EQ(results[i], 1);
+
+			const auto partial = std::max<size_t>(batchSize() - 1, 1) * outputSize;
+			for (size_t j = 0; j < reference.size(); j++)
+			{
+				ASSERT_NEAR(outputs[i][j], reference[j], errorLimit() * std::max(dnn::Float(1), std::abs(reference[j]))) << "context " << i << " at " << j;
+				ASSERT_EQ(outputs[i][j], handleOutput[j]) << "context " << i << " at " << j;
+				if (j < partial)
+					ASSERT_EQ(partials[i][j], outputs[i][j]) << "context " << i << " at " << j;
+				else
+					ASSERT_EQ(partials[i][j], dnn::Float(0)) << "context " << i << " at " << j;
+			}
+		}
+
+		for (auto context : contexts)
+			DNNInferenceContextDestroy(context);
+		DNNModelDestroy(handle);
+	}
+
+private:
+	float errorLimit_;
+	size_t batchSize_;
+	size_t contexts_;
+	size_t size_;
+	size_t kernel_;
+	bool quantize_;
+};
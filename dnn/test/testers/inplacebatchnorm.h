@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include <BatchNormActivation.h>
+
+#include <testers/source.h>
+
+
+class InPlaceBatchNormTester
+{
+public:
+	InPlaceBatchNormTester() :
+		iterations_(1),
+		errorLimit_(1.0e-3),
+		batchSize_(1),
+		channels_(1),
+		height_(1),
+		width_(1),
+		activation_(dnn::Activations::Relu),
+		alpha_(0),
+		beta_(0),
+		plain_(false)
+	{
+	}
+
+	inline InPlaceBatchNormTester& iterations(size_t iterations)
+	{
+		this->iterations_ = iterations;
+		return *this;
+	}
+
+	inline size_t iterations() const
+	{
+		return this->iterations_;
+	}
+
+	inline InPlaceBatchNormTester& errorLimit(float errorLimit)
+	{
+		this->errorLimit_ = errorLimit;
+		return *this;
+	}
+
+	inline float errorLimit() const
+	{
+		return this->errorLimit_;
+	}
+
+	inline InPlaceBatchNormTester& batchSize(size_t batchSize)
+	{
+		this->batchSize_ = batchSize;
+		return *this;
+	}
+
+	inline size_t batchSize() const
+	{
+		return this->batchSize_;
+	}
+
+	inline InPlaceBatchNormTester& channels(size_t channels)
+	{
+		this->channels_ = channels;
+		return *this;
+	}
+
+	inline size_t channels() const
+	{
+		return this->channels_;
+	}
+
+	inline InPlaceBatchNormTester& height(size_t height)
+	{
+		this->height_ = height;
+		return *this;
+	}
+
+	inline size_t height() const
+	{
+		return this->height_;
+	}
+
+	inline InPlaceBatchNormTester& width(size_t width)
+	{
+		this->width_ = width;
+		return *this;
+	}
+
+	inline size_t width() const
+	{
+		return this->width_;
+	}
+
+	inline InPlaceBatchNormTester& activation(dnn::Activations activation)
+	{
+		this->activation_ = activation;
+		return *this;
+	}
+
+	inline dnn::Activations activation() const
+	{
+		return this->activation_;
+	}
+
+	inline InPlaceBatchNormTester& alpha(float alpha)
+	{
+		this->alpha_ = alpha;
+		return *this;
+	}
+
+	inline float alpha() const
+	{
+		return this->alpha_;
+	}
+
+	inline InPlaceBatchNormTester& beta(float beta)
+	{
+		this->beta_ = beta;
+		return *this;
+	}
+
+	inline float beta() const
+	{
+		return this->beta_;
+	}
+
+	inline InPlaceBatchNormTester& plain(bool plain)
+	{
+		this->plain_ = plain;
+		return *this;
+	}
+
+	inline bool plain() const
+	{
+		return this->plain_;
+	}
+
+	// the input, scale and shift gradients of the backward pass reconstructing the input from the output (InPlace)
+	// against the one reading the stored input, relative to the largest gradient
+	void testAccuracy() const
+	{
+		const uint_fast32_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+		auto rng = std::bind(std::uniform_real_distribution<float>(-1.0f, 1.0f), std::mt19937(seed));
+
+		auto engine = dnnl::engine(dnnl::engine::kind::cpu, 0);
+		auto device = dnn::Device(engine, dnnl::stream(engine));
+
+		auto source = SourceLayer(device, plain(), channels(), height(), width());
+		auto batchNorm = dnn::BatchNormActivation(device, dnnl::memory::format_tag::any, "BatchNorm", activation(), std::vector<dnn::Layer*>({ &source }), true, alpha(), beta());
+		source.Outputs = std::vector<dnn::Layer*>({ &batchNorm });
+
+		ASSERT_TRUE(dnn::BatchNormActivation::Invertible(batchNorm.ActivationFunction, batchNorm.Alpha));
+
+		source.SetBatchSize(batchSize());
+		batchNorm.SetBatchSize(batchSize());
+
+		const auto PaddedC = batchNorm.PaddedC;
+		batchNorm.Weights.resize(PaddedC, 1.0f);
+		batchNorm.Biases.resize(PaddedC, 0.0f);
+		batchNorm.WeightsD1.resize(PaddedC, 0.0f);
+		batchNorm.BiasesD1.resize(PaddedC, 0.0f);
+
+		// the values of the padding channels stay zero in the blocked layout
+		const auto C = channels();
+		const auto HW = height() * width();
+		auto index = [&](size_t n, size_t c, size_t hw) { return plain() ? (n * C + c) * HW + hw : n * PaddedC * HW + (c / dnn::VectorSize) * dnn::VectorSize * HW + hw * dnn::VectorSize + c % dnn::VectorSize; };
+
+		for (size_t iteration = 0; iteration < iterations(); iteration++)
+		{
+			for (size_t c = 0; c < C; c++)
+			{
+				batchNorm.Weights[c] = (c % 2 ? 1.0f : -1.0f) * (0.5f + 0.5f * std::abs(rng()));
+				batchNorm.Biases[c] = 0.5f * rng();
+			}
+
+			for (size_t i = 0; i < source.Neurons.size(); i++)
+			{
+				source.Neurons[i] = 0.0f;
+				batchNorm.NeuronsD1[i] = 0.0f;
+			}
+			for (size_t n = 0; n < batchSize(); n++)
+				for (size_t c = 0; c < C; c++)
+					for (size_t hw = 0; hw < HW; hw++)
+					{
+						source.Neurons[index(n, c, hw)] = float(c % 5) + float(c % 3 + 1) * rng();
+						batchNorm.NeuronsD1[index(n, c, hw)] = rng();
+					}
+
+			batchNorm.ForwardProp(batchSize(), true);
+
+			auto backward = [&](const bool inPlace, std::vector<float>& inputD1, std::vector<float>& weightsD1, std::vector<float>& biasesD1)
+			{
+				batchNorm.InPlace = inPlace;
+				for (size_t i = 0; i < source.NeuronsD1.size(); i++)
+					source.NeuronsD1[i] = 0.0f;
+				std::fill(batchNorm.WeightsD1.begin(), batchNorm.WeightsD1.end(), 0.0f);
+				std::fill(batchNorm.BiasesD1.begin(), batchNorm.BiasesD1.end(), 0.0f);
+
+				batchNorm.BackwardProp(batchSize());
+
+				inputD1.resize(batchSize() * C * HW);
+				for (size_t n = 0; n < batchSize(); n++)
+					for (size_t c = 0; c < C; c++)
+						for (size_t hw = 0; hw < HW; hw++)
+							inputD1[(n * C + c) * HW + hw] = source.NeuronsD1[index(n, c, hw)];
+				weightsD1.assign(batchNorm.WeightsD1.begin(), batchNorm.WeightsD1.begin() + C);
+				biasesD1.assign(batchNorm.BiasesD1.begin(), batchNorm.BiasesD1.begin() + C);
+			};
+
+			std::vector<float> inputD1, weightsD1, biasesD1, inPlaceInputD1, inPlaceWeightsD1, inPlaceBiasesD1;
+			backward(false, inputD1, weightsD1, biasesD1);
+			backward(true, inPlaceInputD1, inPlaceWeightsD1, inPlaceBiasesD1);
+
+			auto compare = [&](const std::vector<float>& expected, const std::vector<float>& actual, const char* name)
+			{
+				auto scale = 1.0e-6f;
+				for (const auto value : expected)
+					scale = std::max(scale, std::abs(value));
+				for (size_t i = 0; i < expected.size(); i++)
+					ASSERT_LE(std::abs(actual[i] - expected[i]) / scale, errorLimit()) << name << " at " << i;
+			};
+
+			compare(inputD1, inPlaceInputD1, "input gradient");
+			compare(weightsD1, inPlaceWeightsD1, "scale gradient");
+			compare(biasesD1, inPlaceBiasesD1, "shift gradient");
+		}
+	}
+
+private:
+	size_t iterations_;
+	float errorLimit_;
+	size_t batchSize_;
+	size_t channels_;
+	size_t height_;
+	size_t width_;
+	dnn::Activations activation_;
+	float alpha_;
+	float beta_;
+	bool plain_;
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include <Activation.h>
+
+#include <testers/source.h>
+
+
+class MaskBackwardTester
+{
+public:
+	MaskBackwardTester() :
+		iterations_(1),
+		batchSize_(1),
+		channels_(1),
+		height_(1),
+		width_(1),
+		activation_(dnn::Activations::Relu),
+		alpha_(0),
+		beta_(0),
+		plain_(false)
+	{
+	}
+
+	inline MaskBackwardTester& iterations(size_t iterations)
+	{
+		this->iterations_ = iterations;
+		return *this;
+	}
+
+	inline size_t iterations() const
+	{
+		return this->iterations_;
+	}
+
+	inline MaskBackwardTester& batchSize(size_t batchSize)
+	{
+		this->batchSize_ = batchSize;
+		return *this;
+	}
+
+	inline size_t batchSize() const
+	{
+		return this->batchSize_;
+	}
+
+	inline MaskBackwardTester& channels(size_t channels)
+	{
+		this->channels_ = channels;
+		return *this;
+	}
+
+	inline size_t channels() const
+	{
+		return this->channels_;
+	}
+
+	inline MaskBackwardTester& height(size_t height)
+	{
+		this->height_ = height;
+		return *this;
+	}
+
+	inline size_t height() const
+	{
+		return this->height_;
+	}
+
+	inline MaskBackwardTester& width(size_t width)
+	{
+		this->width_ = width;
+		return *this;
+	}
+
+	inline size_t width() const
+	{
+		return this->width_;
+	}
+
+	inline MaskBackwardTester& activation(dnn::Activations activation)
+	{
+		this->activation_ = activation;
+		return *this;
+	}
+
+	inline dnn::Activations activation() const
+	{
+		return this->activation_;
+	}
+
+	inline MaskBackwardTester& alpha(float alpha)
+	{
+		this->alpha_ = alpha;
+		return *this;
+	}
+
+	inline float alpha() const
+	{
+		return this->alpha_;
+	}
+
+	inline MaskBackwardTester& beta(float beta)
+	{
+		this->beta_ = beta;
+		return *this;
+	}
+
+	inline float beta() const
+	{
+		return this->beta_;
+	}
+
+	inline MaskBackwardTester& plain(bool plain)
+	{
+		this->plain_ = plain;
+		return *this;
+	}
+
+	inline bool plain() const
+	{
+		return this->plain_;
+	}
+
+	// the input gradient from the bitmask (MaskBackward) against the one from the stored input, the values are spread over
+	// both sides of the active range, the plain layout with C * H * W not a multiple of VectorSize also runs the scalar tail
+	void testAccuracy() const
+	{
+		const uint_fast32_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+		auto rng = std::bind(std::uniform_real_distribution<float>(-1.0f, 1.0f), std::mt19937(seed));
+
+		auto engine = dnnl::engine(dnnl::engine::kind::cpu, 0);
+		auto device = dnn::Device(engine, dnnl::stream(engine));
+
+		auto source = SourceLayer(device, plain(), channels(), height(), width());
+		auto activationLayer = dnn::Activation(device, dnnl::memory::format_tag::any, "Activation", activation(), std::vector<dnn::Layer*>({ &source }), alpha(), beta());
+		source.Outputs = std::vector<dnn::Layer*>({ &activationLayer });
+
+		ASSERT_TRUE(dnn::Activation::Maskable(activationLayer.ActivationFunction));
+
+		source.SetBatchSize(batchSize());
+		activationLayer.SetBatchSize(batchSize());
+
+		const auto size = batchSize() * (plain() ? source.CDHW() : source.PaddedCDHW());
+		// the channels padding the last block stay zero
+		const auto blockSize = dnn::VectorSize * source.HW();
+		auto valid = [&](size_t i) { return plain() || ((i % source.PaddedCDHW()) / blockSize) * dnn::VectorSize + i % dnn::VectorSize < source.C; };
+
+		for (size_t iteration = 0; iteration < iterations(); iteration++)
+		{
+			for (size_t i = 0; i < source.Neurons.size(); i++)
+				source.Neurons[i] = 0.0f;
+			for (size_t i = 0; i < size; i++)
+				source.Neurons[i] = valid(i) ? 8.0f * rng() : 0.0f;
+
+			auto backward = [&](const bool maskBackward, std::vector<float>& inputD1)
+			{
+				activationLayer.MaskBackward = maskBackward;
+				activationLayer.ForwardProp(batchSize(), true);
+
+				auto gradient = std::bind(std::uniform_real_distribution<float>(-1.0f, 1.0f), std::mt19937(seed + uint_fast32_t(iteration)));
+				for (size_t i = 0; i < size; i++)
+					activationLayer.NeuronsD1[i] = valid(i) ? gradient() : 0.0f;
+				for (size_t i = 0; i < source.NeuronsD1.size(); i++)
+					source.NeuronsD1[i] = 0.0f;
+
+				activationLayer.BackwardProp(batchSize());
+
+				inputD1.assign(source.NeuronsD1.data(), source.NeuronsD1.data() + size);
+			};
+
+			std::vector<float> inputD1, maskInputD1;
+			backward(false, inputD1);
+			backward(true, maskInputD1);
+
+			for (size_t i = 0; i < size; i++)
+				ASSERT_NEAR(maskInputD1[i], inputD1[i], 1.0e-6f) << "at " << i << " input " << source.Neurons[i];
+		}
+	}
+
+private:
+	size_t iterations_;
+	size_t batchSize_;
+	size_t channels_;
+	size_t height_;
+	size_t width_;
+	dnn::Activations activation_;
+	float alpha_;
+	float beta_;
+	bool plain_;
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include <Concat.h>
+#include <Shuffle.h>
+
+#include <testers/source.h>
+
+
+class ShuffleTester
+{
+public:
+	ShuffleTester() :
+		iterations_(1),
+		batchSize_(1),
+		channels_(2),
+		groups_(2),
+		height_(1),
+		width_(1),
+		plain_(false)
+	{
+	}
+
+	inline ShuffleTester& iterations(size_t iterations)
+	{
+		this->iterations_ = iterations;
+		return *this;
+	}
+
+	inline size_t iterations() const
+	{
+		return this->iterations_;
+	}
+
+	inline ShuffleTester& batchSize(size_t batchSize)
+	{
+		this->batchSize_ = batchSize;
+		return *this;
+	}
+
+	inline size_t batchSize() const
+	{
+		return this->batchSize_;
+	}
+
+	inline ShuffleTester& channels(size_t channels)
+	{
+		this->channels_ = channels;
+		return *this;
+	}
+
+	inline size_t channels() const
+	{
+		return this->channels_;
+	}
+
+	inline ShuffleTester& groups(size_t groups)
+	{
+		this->groups_ = groups;
+		return *this;
+	}
+
+	inline size_t groups() const
+	{
+		return this->groups_;
+	}
+
+	inline ShuffleTester& height(size_t height)
+	{
+		this->height_ = height;
+		return *this;
+	}
+
+	inline size_t height() const
+	{
+		return this->height_;
+	}
+
+	inline ShuffleTester& width(size_t width)
+	{
+		this->width_ = width;
+		return *this;
+	}
+
+	inline size_t width() const
+	{
+		return this->width_;
+	}
+
+	inline ShuffleTester& plain(bool plain)
+	{
+		this->plain_ = plain;
+		return *this;
+	}
+
+	inline bool plain() const
+	{
+		return this->plain_;
+	}
+
+	// a Shuffle over the Concat of two inputs with channels / 2 channels each: the output and the input gradients with the Concat
+	// fused into the Shuffle (gathered per channel) against the Concat and the shuffle primitive
+	void testAccuracy() const
+	{
+		const uint_fast32_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+		auto rng = std::bind(std::uniform_real_distribution<float>(-1.0f, 1.0f), std::mt19937(seed));
+
+		auto engine = dnnl::engine(dnnl::engine::kind::cpu, 0);
+		auto device = dnn::Device(engine, dnnl::stream(engine));
+
+		auto first = SourceLayer(device, plain(), channels() / 2, height(), width());
+		auto second = SourceLayer(device, plain(), channels() / 2, height(), width());
+		auto concat = dnn::Concat(device, dnnl::memory::format_tag::any, "Concat", std::vector<dnn::Layer*>({ &first, &second }));
+		auto shuffle = dnn::Shuffle(device, dnnl::memory::format_tag::any, "Shuffle", std::vector<dnn::Layer*>({ &concat }), groups());
+		first.Outputs = std::vector<dnn::Layer*>({ &concat });
+		second.Outputs = std::vector<dnn::Layer*>({ &concat });
+		concat.Outputs = std::vector<dnn::Layer*>({ &shuffle });
+
+		auto setBatchSize = [&](const bool fused)
+		{
+			concat.Fused = fused;
+			for (auto layer : std::vector<dnn::Layer*>({ &first, &second, &concat, &shuffle }))
+				layer->SetBatchSize(batchSize());
+		};
+
+		// the values of the channels padding the last block stay zero
+		auto fill = [&](dnn::Layer& layer, dnn::FloatArray& array, const bool zero)
+		{
+			for (size_t i = 0; i < array.size(); i++)
+				array[i] = 0.0f;
+			if (zero)
+				return;
+			const auto HW = layer.HW();
+			for (size_t n = 0; n < batchSize(); n++)
+				for (size_t c = 0; c < layer.C; c++)
+					for (size_t hw = 0; hw < HW; hw++)
+						array[plain() ? (n * layer.C + c) * HW + hw : n * layer.PaddedCDHW() + (c / dnn::VectorSize) * dnn::VectorSize * HW + hw * dnn::VectorSize + c % dnn::VectorSize] = rng();
+		};
+
+		auto run = [&](const bool fused, const std::vector<float>& firstValues, const std::vector<float>& secondValues, const std::vector<float>& outputD1, std::vector<float>& output, std::vector<float>& firstD1, std::vector<float>& secondD1)
+		{
+			setBatchSize(fused);
+
+			std::copy(firstValues.begin(), firstValues.end(), first.Neurons.data());
+			std::copy(secondValues.begin(), secondValues.end(), second.Neurons.data());
+
+			concat.ForwardProp(batchSize(), true);
+			shuffle.ForwardProp(batchSize(), true);
+
+			std::copy(outputD1.begin(), outputD1.end(), shuffle.NeuronsD1.data());
+			fill(first, first.NeuronsD1, true);
+			fill(second, second.NeuronsD1, true);
+
+			shuffle.BackwardProp(batchSize());
+			concat.BackwardProp(batchSize());
+
+			output.assign(shuffle.Neurons.data(), shuffle.Neurons.data() + shuffle.Neurons.size());
+			firstD1.assign(first.NeuronsD1.data(), first.NeuronsD1.data() + first.NeuronsD1.size());
+			secondD1.assign(second.NeuronsD1.data(), second.NeuronsD1.data() + second.NeuronsD1.size());
+		};
+
+		for (size_t iteration = 0; iteration < iterations(); iteration++)
+		{
+			setBatchSize(false);
+			fill(first, first.Neurons, false);
+			fill(second, second.Neurons, false);
+			fill(shuffle, shuffle.NeuronsD1, false);
+
+			const auto firstValues = std::vector<float>(first.Neurons.data(), first.Neurons.data() + first.Neurons.size());
+			const auto secondValues = std::vector<float>(second.Neurons.data(), second.Neurons.data() + second.Neurons.size());
+			const auto outputD1 = std::vector<float>(shuffle.NeuronsD1.data(), shuffle.NeuronsD1.data() + shuffle.NeuronsD1.size());
+
+			std::vector<float> output, firstD1, secondD1, fusedOutput, fusedFirstD1, fusedSecondD1;
+			run(false, firstValues, secondValues, outputD1, output, firstD1, secondD1);
+			run(true, firstValues, secondValues, outputD1, fusedOutput, fusedFirstD1, fusedSecondD1);
+
+			for (size_t i = 0; i < output.size(); i++)
+				ASSERT_EQ(fusedOutput[i], output[i]) << "output at " << i;
+			for (size_t i = 0; i < firstD1.size(); i++)
+				ASSERT_EQ(fusedFirstD1[i], firstD1[i]) << "first input gradient at " << i;
+			for (size_t i = 0; i < secondD1.size(); i++)
+				ASSERT_EQ(fusedSecondD1[i], secondD1[i]) << "second input gradient at " << i;
+		}
+	}
+
+private:
+	size_t iterations_;
+	size_t batchSize_;
+	size_t channels_;
+	size_t groups_;
+	size_t height_;
+	size_t width_;
+	bool plain_;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Layer.h>
+
+
+// a layer holding the test input in the plain or the blocked layout
+class SourceLayer final : public dnn::Layer
+{
+public:
+	const bool Plain;
+
+	SourceLayer(const dnn::Device& device, const bool plain, const dnn::UInt c, const dnn::UInt h, const dnn::UInt w) :
+		dnn::Layer(device, plain ? dnn::PlainFmt : dnn::BlockedFmt, "Source", dnn::LayerTypes::Input, 0, 0, c, 1, h, w, 0, 0, 0, std::vector<dnn::Layer*>()),
+		Plain(plain)
+	{
+	}
+
+	std::string GetDescription() const final override { return GetDescriptionHeader(); }
+	dnn::UInt FanIn() const final override { return 1; }
+	dnn::UInt FanOut() const final override { return CDHW(); }
+
+	void InitializeDescriptors(const dnn::UInt batchSize) final override
+	{
+		ChosenFormat = Plain ? dnn::PlainFmt : dnn::BlockedFmt;
+		DstMemDesc = std::make_unique<dnnl::memory::desc>(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(batchSize), dnnl::memory::dim(C), dnnl::memory::dim(H), dnnl::memory::dim(W) }), dnnl::memory::data_type::f32, ChosenFormat));
+		DiffDstMemDesc = std::make_unique<dnnl::memory::desc>(dnnl::memory::desc(dnnl::memory::dims({ dnnl::memory::dim(batchSize), dnnl::memory::dim(C), dnnl::memory::dim(H), dnnl::memory::dim(W) }), dnnl::memory::data_type::f32, ChosenFormat));
+	}
+
+	void ForwardProp(const dnn::UInt batchSize, const bool training) final override { DNN_UNREF_PAR(batchSize); DNN_UNREF_PAR(training); }
+	void BackwardProp(const dnn::UInt batchSize) final override { DNN_UNREF_PAR(batchSize); }
+};
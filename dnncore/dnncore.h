@@ -70,7 +70,8 @@ namespace dnn
 		MeanAbsoluteEpsError = 2,
 		MeanAbsoluteError = 3,
 		MeanSquaredError = 4,
-		SmoothHinge = 5
+		SmoothHinge = 5,
+		Distillation = 6
 	};
 
 	enum class Fillers
@@ -666,7 +667,8 @@ namespace dnncore
 		MeanAbsoluteEpsError = 2,
 		MeanAbsoluteError = 3,
 		MeanSquaredError = 4,
-		SmoothHinge = 5
+		SmoothHinge = 5,
+		Distillation = 6
 	};
 
 	[Serializable()]